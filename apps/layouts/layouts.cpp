@@ -0,0 +1,159 @@
+#include "graph.h"
+#include "program.h"
+#include "mesh.h"
+#include "init.h"
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace simit;
+
+static const int numSteps = 100;
+
+static double runSprings(const std::string &codefile, const MeshVol &mesh) {
+  Set points;
+  Set springs(points, points);
+
+  FieldRef<double,3> x     = points.addField<double,3>("x");
+  FieldRef<double,3> v     = points.addField<double,3>("v");
+  FieldRef<double>   m     = points.addField<double>("m");
+  FieldRef<bool>     fixed = points.addField<bool>("fixed");
+
+  FieldRef<double> k  = springs.addField<double>("k");
+  FieldRef<double> l0 = springs.addField<double>("l0");
+
+  std::vector<ElementRef> pointRefs;
+  for (auto vertex : mesh.v) {
+    ElementRef point = points.add();
+    pointRefs.push_back(point);
+    x.set(point, vertex);
+    v.set(point, {0.0, 0.0, 0.0});
+    fixed.set(point, vertex[2] < 0.1);
+  }
+
+  std::vector<double> pointMasses(mesh.v.size(), 0.0);
+  for (auto e : mesh.edges) {
+    double dx[3];
+    for (int i = 0; i < 3; ++i) {
+      dx[i] = mesh.v[e[1]][i] - mesh.v[e[0]][i];
+    }
+    double l0_ = sqrt(dx[0]*dx[0] + dx[1]*dx[1] + dx[2]*dx[2]);
+    double mass = 3.14159265358979 * 0.01 * 0.01 * l0_ * 1e3;
+    pointMasses[e[0]] += 0.5*mass;
+    pointMasses[e[1]] += 0.5*mass;
+    ElementRef spring = springs.add(pointRefs[e[0]], pointRefs[e[1]]);
+    l0.set(spring, l0_);
+    k.set(spring, 1e4);
+  }
+  for (size_t i = 0; i < mesh.v.size(); ++i) {
+    m.set(pointRefs[i], pointMasses[i]);
+  }
+
+  Program program;
+  program.loadFile(codefile);
+  Function timestep = program.compile("timestep");
+  timestep.bind("points",  &points);
+  timestep.bind("springs", &springs);
+  timestep.init();
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numSteps; ++i) {
+    timestep.run();
+  }
+  timestep.mapArgs();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+static double runFEM(const std::string &codefile, const MeshVol &mesh) {
+  Set verts;
+  Set tets(verts, verts, verts, verts);
+
+  FieldRef<double,3>   x  = verts.addField<double,3>("x");
+  FieldRef<double,3>   v  = verts.addField<double,3>("v");
+  FieldRef<double,3>   fe = verts.addField<double,3>("fe");
+  FieldRef<int>        c  = verts.addField<int>("c");
+  FieldRef<double>     m  = verts.addField<double>("m");
+
+  FieldRef<double>     u  = tets.addField<double>("u");
+  FieldRef<double>     l  = tets.addField<double>("l");
+  tets.addField<double>("W");
+  tets.addField<double,3,3>("B");
+
+  double E = 5e3;
+  double nu = 0.45;
+
+  std::vector<ElementRef> vertRefs;
+  for (auto vertex : mesh.v) {
+    ElementRef p = verts.add();
+    vertRefs.push_back(p);
+    x.set(p, vertex);
+    v.set(p, {0.1, 0.0, 0.1});
+    fe.set(p, {0.0, 0.0, 0.0});
+    m.set(p, 0.0);
+    c.set(p, vertex[1] < 0.0001 ? 1 : 0);
+  }
+  for (auto e : mesh.e) {
+    ElementRef t = tets.add(vertRefs[e[0]], vertRefs[e[1]],
+                            vertRefs[e[2]], vertRefs[e[3]]);
+    u.set(t, 0.5*E/nu);
+    l.set(t, E*nu/((1+nu)*(1-2*nu)));
+  }
+
+  Program program;
+  program.loadFile(codefile);
+  Function precompute = program.compile("initializeTet");
+  precompute.bind("verts", &verts);
+  precompute.bind("tets",  &tets);
+  precompute.init();
+  precompute.runSafe();
+
+  Function timestep = program.compile("main");
+  timestep.bind("verts", &verts);
+  timestep.bind("tets",  &tets);
+  timestep.init();
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numSteps; ++i) {
+    timestep.run();
+  }
+  timestep.mapArgs();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 4) {
+    std::cerr << "Usage: layouts <path to esprings.sim> "
+              << "<path to fem_linear.sim> <path to data>" << std::endl;
+    return -1;
+  }
+  std::string springsfile = argv[1];
+  std::string femfile = argv[2];
+  std::string datafile = argv[3];
+
+  MeshVol mesh;
+  mesh.loadTet(datafile+".node", datafile+".ele");
+  mesh.loadTetEdge(datafile+".edge");
+
+  for (FieldLayout layout : {FieldLayout::SoA, FieldLayout::AoS,
+                             FieldLayout::AoSoA}) {
+    Settings settings;
+    settings.backend = "cpu";
+    settings.floatSize = sizeof(double);
+    // Group the fields that are read together by the timestep kernels
+    settings.fieldGroups = {
+      FieldGroup("Point",  {"x", "v", "m"}, layout),
+      FieldGroup("Spring", {"k", "l0"},     layout),
+      FieldGroup("Vert",   {"x", "v", "fe", "m"}, layout),
+      FieldGroup("Tet",    {"u", "l", "W", "B"},  layout)
+    };
+    simit::init(settings);
+
+    double springsTime = runSprings(springsfile, mesh);
+    double femTime = runFEM(femfile, mesh);
+    std::cout << layout << ": springs " << springsTime << "s, "
+              << "fem " << femTime << "s" << std::endl;
+  }
+}
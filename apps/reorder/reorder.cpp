@@ -0,0 +1,92 @@
+#include "graph.h"
+#include "graph_indices.h"
+#include "reorder.h"
+#include "mesh.h"
+#include <chrono>
+#include <vector>
+
+using namespace simit;
+
+static const int numSpMVs = 100;
+
+static void createMesh(const MeshVol &mesh, Set &verts, Set &tets) {
+  FieldRef<double,3> x = verts.addField<double,3>("x");
+  std::vector<ElementRef> vertRefs;
+  for (auto vertex : mesh.v) {
+    vertRefs.push_back(verts.add());
+    x.set(vertRefs.back(), vertex);
+  }
+  for (auto e : mesh.e) {
+    tets.add(vertRefs[e[0]], vertRefs[e[1]], vertRefs[e[2]], vertRefs[e[3]]);
+  }
+  verts.setSpatialField("x");
+}
+
+// Time numSpMVs multiplications with the vertex x vertex matrix of the tets
+static double timeSpMV(const Set &tets) {
+  const internal::NeighborIndex *index = tets.getNeighborIndex();
+  const int *start = index->getStartIndex();
+  const int *neighbors = index->getNeighborIndex();
+  const int n = tets.getEndpointSet(0)->getSize();
+
+  std::vector<double> vals(start[n], 1.0);
+  std::vector<double> x(n, 1.0);
+  std::vector<double> y(n);
+
+  auto begin = std::chrono::steady_clock::now();
+  for (int k = 0; k < numSpMVs; ++k) {
+    for (int i = 0; i < n; ++i) {
+      double sum = 0.0;
+      for (int j = start[i]; j < start[i+1]; ++j) {
+        sum += vals[j] * x[neighbors[j]];
+      }
+      y[i] = sum;
+    }
+    std::swap(x, y);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - begin).count();
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    std::cerr << "Usage: reorder <path to data>" << std::endl;
+    return -1;
+  }
+  std::string datafile = argv[1];
+
+  MeshVol mesh;
+  mesh.loadTet(datafile+".node", datafile+".ele");
+
+  Set origVerts;
+  Set origTets(origVerts, origVerts, origVerts, origVerts);
+  createMesh(mesh, origVerts, origTets);
+  double origTime = timeSpMV(origTets);
+  std::cout << "original: " << getBandwidth(origTets) << ", spmv "
+            << origTime << "s" << std::endl;
+
+  const std::vector<std::pair<std::string,ReorderingHeuristic>> heuristics = {
+    {"hilbert", ReorderingHeuristic::Hilbert},
+    {"morton",  ReorderingHeuristic::Morton},
+    {"rcm",     ReorderingHeuristic::RCM},
+    {"bfs",     ReorderingHeuristic::BFS}
+  };
+  for (auto &heuristic : heuristics) {
+    Set verts;
+    Set tets(verts, verts, verts, verts);
+    createMesh(mesh, verts, tets);
+
+    std::vector<int> edgeOrdering;
+    std::vector<int> vertexOrdering;
+    auto begin = std::chrono::steady_clock::now();
+    reorder(tets, verts, edgeOrdering, vertexOrdering, heuristic.second);
+    auto end = std::chrono::steady_clock::now();
+    double reorderTime = std::chrono::duration<double>(end - begin).count();
+
+    double time = timeSpMV(tets);
+    std::cout << heuristic.first << ": reorder " << reorderTime << "s, "
+              << getBandwidth(tets) << ", spmv " << time << "s ("
+              << origTime / time << "x)" << std::endl;
+  }
+}
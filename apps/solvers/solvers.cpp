@@ -0,0 +1,210 @@
+#include "graph.h"
+#include "program.h"
+#include "init.h"
+#include "runtime.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace simit;
+
+static const int numSolves = 10;
+static const int numSteps = 100;
+
+extern "C" {
+void dchol(int An,  int Am,  int* Arowptr, int* Acolidx,
+           int Ann, int Amm, double* Avals, void** solver);
+void dlltsolves(void** solverPtr, int bn, double *bvals, int xn, double *xvals);
+void dcholfree(void** solverPtr);
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// A blocked CSR matrix with the structure of the springs of an n x n grid,
+// where every point is connected to itself and its four neighbors
+struct GridMatrix {
+  int rows;
+  int blockSize;
+  std::vector<int> rowPtr;
+  std::vector<int> colIdx;
+  std::vector<double> vals;
+
+  GridMatrix(int n, int blockSize)
+      : rows(n*n*blockSize), blockSize(blockSize) {
+    rowPtr.push_back(0);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        if (i > 0)   colIdx.push_back((i-1)*n+j);
+        if (j > 0)   colIdx.push_back(i*n+j-1);
+        colIdx.push_back(i*n+j);
+        if (j+1 < n) colIdx.push_back(i*n+j+1);
+        if (i+1 < n) colIdx.push_back((i+1)*n+j);
+        rowPtr.push_back(colIdx.size());
+      }
+    }
+    vals.resize(colIdx.size()*blockSize*blockSize, 1.0);
+  }
+
+  // Sets the values to those of a symmetric positive definite stiffness
+  // matrix that is scaled by the step
+  void setStiffness(int step) {
+    const int bs = blockSize;
+    for (size_t i = 0; i+1 < rowPtr.size(); ++i) {
+      for (int ij = rowPtr[i]; ij < rowPtr[i+1]; ++ij) {
+        double diagonal = (colIdx[ij] == (int)i) ? 5.0 : -1.0;
+        for (int bi = 0; bi < bs; ++bi) {
+          for (int bj = 0; bj < bs; ++bj) {
+            vals[(ij*bs+bi)*bs+bj] = (bi == bj) ? diagonal*(1.0+step*0.01)
+                                                : 0.0;
+          }
+        }
+      }
+    }
+  }
+};
+
+// Times the conversion of the matrix to Eigen by csr2eigen, which builds it
+// from triplets every time, and by csr2eigenCached, which converts the
+// structure once and then only copies values
+static void benchmarkConversion(const GridMatrix &A) {
+  int* rowPtr = const_cast<int*>(A.rowPtr.data());
+  int* colIdx = const_cast<int*>(A.colIdx.data());
+  double* vals = const_cast<double*>(A.vals.data());
+  const int bs = A.blockSize;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numSolves; ++i) {
+    auto mat = csr2eigen<double,Eigen::ColMajor>(A.rows, A.rows, rowPtr,
+                                                 colIdx, bs, bs, vals);
+  }
+  double triplets = seconds(start) / numSolves;
+
+  start = std::chrono::steady_clock::now();
+  csr2eigenCached(A.rows, A.rows, rowPtr, colIdx, bs, bs, vals);
+  double first = seconds(start);
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numSolves; ++i) {
+    csr2eigenCached(A.rows, A.rows, rowPtr, colIdx, bs, bs, vals);
+  }
+  double cached = seconds(start) / numSolves;
+
+  std::cout << "  " << bs << "x" << bs << " blocks, " << A.rows << " rows: "
+            << "triplets " << triplets << "s, "
+            << "cached first " << first << "s, "
+            << "cached " << cached << "s per conversion ("
+            << triplets / cached << "x)" << std::endl;
+}
+
+// Times numSteps Cholesky factorizations and solves of a matrix whose values
+// change from step to step, by analyzing and factorizing the matrix on every
+// step as the chol intrinsic used to, and by the chol runtime function, which
+// keeps the symbolic analysis of the index and only factorizes
+static void benchmarkCholesky(GridMatrix &A) {
+  const int bs = A.blockSize;
+  std::vector<double> b(A.rows, 1.0);
+  std::vector<double> x(A.rows);
+  Eigen::Map<Eigen::VectorXd> bmap(b.data(), A.rows);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < numSteps; ++step) {
+    A.setStiffness(step);
+    const Eigen::SparseMatrix<double>& mat =
+        csr2eigenCached(A.rows, A.rows, A.rowPtr.data(), A.colIdx.data(), bs,
+                        bs, A.vals.data());
+    Eigen::SimplicialCholesky<Eigen::SparseMatrix<double>> solver;
+    solver.compute(mat);
+    Eigen::Map<Eigen::VectorXd>(x.data(), A.rows) = solver.solve(bmap);
+  }
+  double compute = seconds(start) / numSteps;
+
+  start = std::chrono::steady_clock::now();
+  for (int step = 0; step < numSteps; ++step) {
+    A.setStiffness(step);
+    void* solver;
+    dchol(A.rows, A.rows, A.rowPtr.data(), A.colIdx.data(), bs, bs,
+          A.vals.data(), &solver);
+    dlltsolves(&solver, A.rows, b.data(), A.rows, x.data());
+    dcholfree(&solver);
+  }
+  double factorize = seconds(start) / numSteps;
+
+  std::cout << "  " << bs << "x" << bs << " blocks, " << A.rows << " rows: "
+            << "analyze and factorize " << compute << "s, "
+            << "factorize " << factorize << "s per step ("
+            << compute / factorize << "x)" << std::endl;
+}
+
+// Times a function that assembles and solves the system of the springs of an
+// n x n grid
+static void benchmarkSolve(const std::string &codefile, int n) {
+  Set points;
+  Set springs(points, points);
+  FieldRef<double> b = points.addField<double>("b");
+  FieldRef<double> c = points.addField<double>("c");
+  FieldRef<double> a = springs.addField<double>("a");
+
+  std::vector<ElementRef> p;
+  for (int i = 0; i < n*n; ++i) {
+    p.push_back(points.add());
+    b.set(p.back(), (double)(i % 7));
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (j+1 < n) a.set(springs.add(p[i*n+j], p[i*n+j+1]), 1.0);
+      if (i+1 < n) a.set(springs.add(p[i*n+j], p[(i+1)*n+j]), 1.0);
+    }
+  }
+
+  Program program;
+  program.loadFile(codefile);
+  Function solve = program.compile("main");
+  solve.bind("points", &points);
+  solve.bind("springs", &springs);
+  solve.init();
+
+  auto start = std::chrono::steady_clock::now();
+  solve.run();
+  double first = seconds(start);
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numSolves; ++i) {
+    solve.run();
+  }
+  solve.mapArgs();
+  std::cout << "  " << n*n << " rows: first " << first << "s, then "
+            << seconds(start) / numSolves << "s per solve" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2 && argc != 3) {
+    std::cerr << "Usage: solvers <path to solve.sim> [grid size]"
+              << std::endl;
+    return -1;
+  }
+  const int n = (argc == 3) ? atoi(argv[2]) : 1000;
+  init("cpu", sizeof(double));
+
+  // Grids with about n*n rows for every block size
+  std::cout << "Conversion to Eigen" << std::endl;
+  for (int blockSize : {1, 2, 3}) {
+    benchmarkConversion(GridMatrix(n/sqrt(blockSize), blockSize));
+  }
+
+  // Factorizations fill in, so they are timed on smaller grids
+  std::cout << "Cholesky over " << numSteps << " steps" << std::endl;
+  for (int blockSize : {1, 3}) {
+    GridMatrix A(n/(4*sqrt(blockSize)), blockSize);
+    benchmarkCholesky(A);
+  }
+
+  std::cout << "Solve" << std::endl;
+  benchmarkSolve(argv[1], n);
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include "allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "numa.h"
+#include "init.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+void* allocate(size_t size, bool zeroed) {
+  const bool huge = size >= kHugePageSize;
+  const size_t alignment = huge ? kHugePageSize : kArrayAlignment;
+
+  void* data = nullptr;
+  if (posix_memalign(&data, alignment, max(size, (size_t)1)) != 0) {
+    ierror << "Could not allocate " << size << " bytes";
+  }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  // Must be advised before the pages are touched
+  if (huge && kHugePages) {
+    madvise(data, size / kHugePageSize * kHugePageSize, MADV_HUGEPAGE);
+  }
+#endif
+  // Placed before zeroing touches the pages, so that they are allocated on
+  // their nodes instead of being migrated there
+  placeMemory(data, size);
+  if (zeroed) {
+    memset(data, 0, size);
+  }
+  return data;
+}
+
+void* reallocate(void* data, size_t size, size_t newSize) {
+  void* newData = allocate(newSize);
+  if (data != nullptr) {
+    memcpy(newData, data, min(size, newSize));
+    deallocate(data);
+  }
+  return newData;
+}
+
+void deallocate(void* data) {
+  free(data);
+}
+
+}
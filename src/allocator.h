@@ -0,0 +1,32 @@
+#ifndef SIMIT_ALLOCATOR_H
+#define SIMIT_ALLOCATOR_H
+
+#include <cstddef>
+
+namespace simit {
+
+/// The alignment of the arrays that Simit allocates for field data, endpoints,
+/// indices and temporaries, which is the size of a cache line and of the
+/// widest vector registers. Generated code assumes that the field data of sets
+/// and global tensor buffers are aligned to it.
+const size_t kArrayAlignment = 64;
+
+/// Arrays of at least this many bytes are aligned to it, and backed by
+/// transparent huge pages if Settings::hugePages is set.
+const size_t kHugePageSize = 2 << 20;
+
+/// Allocates an array of size bytes aligned to kArrayAlignment, that is
+/// zero-filled if zeroed is true, and places it according to the NUMA policy
+/// (see placeMemory). The array is freed with deallocate, or with free.
+void* allocate(size_t size, bool zeroed=false);
+
+/// Moves the array to a new allocation of newSize bytes, keeping the first
+/// min(size, newSize) bytes. Unlike realloc the contents are always copied, so
+/// arrays should grow geometrically.
+void* reallocate(void* data, size_t size, size_t newSize);
+
+/// Frees an array returned by allocate or reallocate.
+void deallocate(void* data);
+
+}
+#endif
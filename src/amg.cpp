@@ -0,0 +1,617 @@
+#include "amg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "block_cg.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+// Rows are strongly coupled if the norm of their block exceeds
+// kStrengthThreshold times the geometric mean of the norms of their diagonal
+// blocks
+const double kStrengthThreshold = 0.08;
+
+// Levels are coarsened until they have at most kMaxCoarseRows rows (counting
+// the rows of blocks), or until aggregation stops reducing them by at least
+// kMaxCoarseningRatio
+const int kMaxCoarseRows = 256;
+const int kMaxLevels = 20;
+const double kMaxCoarseningRatio = 0.8;
+const int kMaxDenseRows = 512;
+
+const int kNumSweeps = 2;
+const int kNumCoarsestSweeps = 20;
+const int kNumPowerIterations = 10;
+
+// c += scale * a*b
+template <typename Float>
+void addProduct(int bs, double scale, const Float* a, const Float* b, Float* c) {
+  for (int i=0; i < bs; ++i) {
+    for (int k=0; k < bs; ++k) {
+      const Float aik = scale * a[i*bs+k];
+      for (int j=0; j < bs; ++j) {
+        c[i*bs+j] += aik * b[k*bs+j];
+      }
+    }
+  }
+}
+
+// c += a^T*b
+template <typename Float>
+void addTransposeProduct(int bs, const Float* a, const Float* b, Float* c) {
+  for (int k=0; k < bs; ++k) {
+    for (int i=0; i < bs; ++i) {
+      const Float aki = a[k*bs+i];
+      for (int j=0; j < bs; ++j) {
+        c[i*bs+j] += aki * b[k*bs+j];
+      }
+    }
+  }
+}
+
+template <typename Float>
+double norm(int size, const Float* a) {
+  double sum = 0.0;
+  for (int k=0; k < size; ++k) {
+    sum += (double)a[k] * a[k];
+  }
+  return sqrt(sum);
+}
+
+}
+
+template <typename Float>
+AlgebraicMultigrid<Float>::AlgebraicMultigrid(int numRows, int blockSize,
+                                              const int* rowPtr,
+                                              const int* colIdx,
+                                              const Float* vals)
+    : blockSize(blockSize) {
+  const int nnz = rowPtr[numRows];
+  this->rowPtr.assign(rowPtr, rowPtr+numRows+1);
+  this->colIdx.assign(colIdx, colIdx+nnz);
+  mirrors.assign(nnz, -1);
+  for (int i=0; i < numRows; ++i) {
+    for (int ij=rowPtr[i]; ij < rowPtr[i+1]; ++ij) {
+      const int j = colIdx[ij];
+      if (j > i) {
+        for (int ji=rowPtr[j]; ji < rowPtr[j+1]; ++ji) {
+          if (colIdx[ji] == i) {
+            mirrors[ij] = ji;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  Level fine;
+  fine.A.numRows = numRows;
+  fine.A.rowPtr = this->rowPtr;
+  fine.A.colIdx = this->colIdx;
+  levels.push_back(fine);
+  setFineValues(vals);
+
+  for (int l=0; ; ++l) {
+    computeSmoother(levels[l]);
+    const int levelRows = levels[l].A.numRows;
+    if (levelRows*blockSize <= kMaxCoarseRows || l+1 == kMaxLevels) {
+      break;
+    }
+    aggregate(levels[l]);
+    const int numAggregates = levels[l].aggregateSizes.size();
+    if (numAggregates == 0 || numAggregates > kMaxCoarseningRatio*levelRows) {
+      levels[l].aggregates.clear();
+      levels[l].aggregateSizes.clear();
+      break;
+    }
+    Level coarse = buildCoarseLevel(levels[l]);
+    computeCoarseValues(levels[l], coarse);
+    levels.push_back(coarse);
+  }
+  computeDenseInverse(levels.back());
+
+  for (Level& level : levels) {
+    const size_t n = (size_t)level.A.numRows * blockSize;
+    level.b.resize(n);
+    level.x.resize(n);
+    level.r.resize(n);
+  }
+}
+
+template <typename Float>
+bool AlgebraicMultigrid<Float>::matches(int numRows, int blockSize,
+                                        const int* rowPtr,
+                                        const int* colIdx) const {
+  return this->blockSize == blockSize &&
+         this->rowPtr.size() == (size_t)numRows+1 &&
+         equal(rowPtr, rowPtr+numRows+1, this->rowPtr.begin()) &&
+         equal(colIdx, colIdx+rowPtr[numRows], this->colIdx.begin());
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::setup(const Float* vals) {
+  setFineValues(vals);
+  for (size_t l=0; l < levels.size(); ++l) {
+    computeSmoother(levels[l]);
+    if (l+1 < levels.size()) {
+      computeCoarseValues(levels[l], levels[l+1]);
+    }
+  }
+  computeDenseInverse(levels.back());
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::vcycle(const Float* b, Float* x) {
+  vcycle(0, b, x);
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::setFineValues(const Float* vals) {
+  // Mirror the lower triangle, like blockCG
+  const int bs = blockSize;
+  const int bs2 = bs*bs;
+  Matrix& A = levels[0].A;
+  A.vals.assign(colIdx.size()*bs2, 0);
+  for (int i=0; i < A.numRows; ++i) {
+    for (int ij=rowPtr[i]; ij < rowPtr[i+1]; ++ij) {
+      const int j = colIdx[ij];
+      Float* block = &A.vals[ij*bs2];
+      if (j < i) {
+        copy(&vals[ij*bs2], &vals[(ij+1)*bs2], block);
+      }
+      else if (j == i) {
+        const Float* a = &vals[ij*bs2];
+        for (int bi=0; bi < bs; ++bi) {
+          for (int bj=0; bj < bs; ++bj) {
+            block[bi*bs+bj] = (bj <= bi) ? a[bi*bs+bj] : a[bj*bs+bi];
+          }
+        }
+      }
+      else if (mirrors[ij] != -1) {
+        const Float* a = &vals[mirrors[ij]*bs2];
+        for (int bi=0; bi < bs; ++bi) {
+          for (int bj=0; bj < bs; ++bj) {
+            block[bi*bs+bj] = a[bj*bs+bi];
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::computeSmoother(Level& level) {
+  const int bs = blockSize;
+  const int bs2 = bs*bs;
+  const Matrix& A = level.A;
+  level.invDiagonal.assign(A.numRows*bs2, 0);
+  vector<double> block(bs2);
+  for (int i=0; i < A.numRows; ++i) {
+    fill(block.begin(), block.end(), 0.0);
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      if (A.colIdx[ij] == i) {
+        copy(&A.vals[ij*bs2], &A.vals[(ij+1)*bs2], block.begin());
+      }
+    }
+    Float* inverse = &level.invDiagonal[i*bs2];
+    if (invertMatrix(bs, block)) {
+      copy(block.begin(), block.end(), inverse);
+    }
+    else {
+      // Singular blocks are left out
+      for (int bi=0; bi < bs; ++bi) {
+        inverse[bi*bs+bi] = 1;
+      }
+    }
+  }
+
+  // Estimate the spectral radius of D^-1*A with power iterations
+  const size_t n = (size_t)A.numRows*bs;
+  vector<Float> v(n);
+  vector<Float> w(n);
+  vector<Float> Av(n);
+  for (size_t k=0; k < n; ++k) {
+    v[k] = 1.0 + 0.5*sin((double)k);
+  }
+  double rho = 0.0;
+  for (int iteration=0; iteration < kNumPowerIterations; ++iteration) {
+    multiply(A, v.data(), Av.data());
+    for (int i=0; i < A.numRows; ++i) {
+      const Float* inverse = &level.invDiagonal[i*bs2];
+      for (int bi=0; bi < bs; ++bi) {
+        Float sum = 0;
+        for (int bj=0; bj < bs; ++bj) {
+          sum += inverse[bi*bs+bj] * Av[i*bs+bj];
+        }
+        w[i*bs+bi] = sum;
+      }
+    }
+    const double vNorm = norm(n, v.data());
+    const double wNorm = norm(n, w.data());
+    if (vNorm == 0.0 || wNorm == 0.0) {
+      break;
+    }
+    rho = wNorm / vNorm;
+    for (size_t k=0; k < n; ++k) {
+      v[k] = w[k] / wNorm;
+    }
+  }
+  level.weight = (rho > 0.0) ? 4.0 / (3.0*rho) : 1.0;
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::aggregate(Level& level) {
+  const int bs2 = blockSize*blockSize;
+  const Matrix& A = level.A;
+  const int numRows = A.numRows;
+
+  vector<double> diagonalNorms(numRows, 0.0);
+  for (int i=0; i < numRows; ++i) {
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      if (A.colIdx[ij] == i) {
+        diagonalNorms[i] = norm(bs2, &A.vals[ij*bs2]);
+      }
+    }
+  }
+  auto isStrong = [&](int i, int ij) {
+    const int j = A.colIdx[ij];
+    return j != i && norm(bs2, &A.vals[ij*bs2]) >
+           kStrengthThreshold * sqrt(diagonalNorms[i] * diagonalNorms[j]);
+  };
+
+  // Rows whose strong neighbors are all free start aggregates with them
+  vector<int>& aggregates = level.aggregates;
+  aggregates.assign(numRows, -1);
+  int numAggregates = 0;
+  for (int i=0; i < numRows; ++i) {
+    if (aggregates[i] != -1) {
+      continue;
+    }
+    bool free = true;
+    bool isolated = true;
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      if (isStrong(i, ij)) {
+        isolated = false;
+        free = free && aggregates[A.colIdx[ij]] == -1;
+      }
+    }
+    if (!free || isolated) {
+      continue;
+    }
+    aggregates[i] = numAggregates;
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      if (isStrong(i, ij)) {
+        aggregates[A.colIdx[ij]] = numAggregates;
+      }
+    }
+    ++numAggregates;
+  }
+
+  // The other rows join the aggregate they are most strongly coupled to
+  vector<int> initial = aggregates;
+  for (int i=0; i < numRows; ++i) {
+    if (initial[i] != -1) {
+      continue;
+    }
+    double strongest = 0.0;
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      const int j = A.colIdx[ij];
+      const double strength = norm(bs2, &A.vals[ij*bs2]);
+      if (isStrong(i, ij) && initial[j] != -1 && strength > strongest) {
+        aggregates[i] = initial[j];
+        strongest = strength;
+      }
+    }
+  }
+
+  // and those that are not coupled to any aggregate form new ones
+  for (int i=0; i < numRows; ++i) {
+    if (aggregates[i] != -1) {
+      continue;
+    }
+    aggregates[i] = numAggregates;
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      if (isStrong(i, ij) && aggregates[A.colIdx[ij]] == -1) {
+        aggregates[A.colIdx[ij]] = numAggregates;
+      }
+    }
+    ++numAggregates;
+  }
+
+  level.aggregateSizes.assign(numAggregates, 0);
+  for (int i=0; i < numRows; ++i) {
+    ++level.aggregateSizes[aggregates[i]];
+  }
+}
+
+template <typename Float>
+typename AlgebraicMultigrid<Float>::Level
+AlgebraicMultigrid<Float>::buildCoarseLevel(Level& level) {
+  const Matrix& A = level.A;
+  const int numRows = A.numRows;
+  const int numCoarseRows = level.aggregateSizes.size();
+  vector<int> marker(numCoarseRows, -1);
+
+  // Appends the union of the columns of the rows of B that f(i, add) adds to
+  // the rows of C
+  auto buildRows = [&](Matrix& C, int numRows,
+                       const function<void(int,
+                                           const function<void(int)>&)>& f) {
+    C.numRows = numRows;
+    C.rowPtr.assign(1, 0);
+    C.colIdx.clear();
+    for (int i=0; i < numRows; ++i) {
+      const int start = C.colIdx.size();
+      f(i, [&](int col) {
+        if (marker[col] != i) {
+          marker[col] = i;
+          C.colIdx.push_back(col);
+        }
+      });
+      sort(C.colIdx.begin()+start, C.colIdx.end());
+      C.rowPtr.push_back(C.colIdx.size());
+    }
+    fill(marker.begin(), marker.end(), -1);
+  };
+
+  // P = (I - w*D^-1*A)*T, where T interpolates every aggregate from its
+  // coarse row
+  buildRows(level.P, numRows, [&](int i, const function<void(int)>& add) {
+    add(level.aggregates[i]);
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      add(level.aggregates[A.colIdx[ij]]);
+    }
+  });
+  const Matrix& P = level.P;
+
+  buildRows(level.AP, numRows, [&](int i, const function<void(int)>& add) {
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      const int j = A.colIdx[ij];
+      for (int ja=P.rowPtr[j]; ja < P.rowPtr[j+1]; ++ja) {
+        add(P.colIdx[ja]);
+      }
+    }
+  });
+
+  level.transposeRowPtr.assign(numCoarseRows+1, 0);
+  for (int ia=0; ia < P.rowPtr[numRows]; ++ia) {
+    ++level.transposeRowPtr[P.colIdx[ia]+1];
+  }
+  for (int a=0; a < numCoarseRows; ++a) {
+    level.transposeRowPtr[a+1] += level.transposeRowPtr[a];
+  }
+  level.transposeRows.resize(P.rowPtr[numRows]);
+  level.transposeLocations.resize(P.rowPtr[numRows]);
+  vector<int> next(level.transposeRowPtr.begin(),
+                   level.transposeRowPtr.end()-1);
+  for (int i=0; i < numRows; ++i) {
+    for (int ia=P.rowPtr[i]; ia < P.rowPtr[i+1]; ++ia) {
+      const int k = next[P.colIdx[ia]]++;
+      level.transposeRows[k] = i;
+      level.transposeLocations[k] = ia;
+    }
+  }
+
+  // The coarse matrix P^T*(A*P)
+  Level coarse;
+  buildRows(coarse.A, numCoarseRows,
+            [&](int a, const function<void(int)>& add) {
+    for (int k=level.transposeRowPtr[a]; k < level.transposeRowPtr[a+1]; ++k) {
+      const int i = level.transposeRows[k];
+      for (int ib=level.AP.rowPtr[i]; ib < level.AP.rowPtr[i+1]; ++ib) {
+        add(level.AP.colIdx[ib]);
+      }
+    }
+  });
+  return coarse;
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::computeCoarseValues(Level& level,
+                                                    Level& coarse) {
+  const int bs = blockSize;
+  const int bs2 = bs*bs;
+  const Matrix& A = level.A;
+  Matrix& P = level.P;
+  Matrix& AP = level.AP;
+  const int numRows = A.numRows;
+  vector<int> locations(coarse.A.numRows, -1);
+
+  // Points the locations of the columns of row i of C to its blocks
+  auto mapRow = [&](const Matrix& C, int i) {
+    for (int ia=C.rowPtr[i]; ia < C.rowPtr[i+1]; ++ia) {
+      locations[C.colIdx[ia]] = ia;
+    }
+  };
+
+  vector<Float> scaled(bs2);
+  P.vals.assign(P.colIdx.size()*bs2, 0);
+  for (int i=0; i < numRows; ++i) {
+    mapRow(P, i);
+    const int a = level.aggregates[i];
+    Float* Pia = &P.vals[locations[a]*bs2];
+    const double scale = 1.0 / sqrt((double)level.aggregateSizes[a]);
+    for (int bi=0; bi < bs; ++bi) {
+      Pia[bi*bs+bi] += scale;
+    }
+    const Float* inverse = &level.invDiagonal[i*bs2];
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      const int b = level.aggregates[A.colIdx[ij]];
+      addProduct(bs, -level.weight / sqrt((double)level.aggregateSizes[b]),
+                 inverse, &A.vals[ij*bs2], &P.vals[locations[b]*bs2]);
+    }
+  }
+
+  AP.vals.assign(AP.colIdx.size()*bs2, 0);
+  for (int i=0; i < numRows; ++i) {
+    mapRow(AP, i);
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      const int j = A.colIdx[ij];
+      for (int jb=P.rowPtr[j]; jb < P.rowPtr[j+1]; ++jb) {
+        addProduct(bs, 1.0, &A.vals[ij*bs2], &P.vals[jb*bs2],
+                   &AP.vals[locations[P.colIdx[jb]]*bs2]);
+      }
+    }
+  }
+
+  Matrix& C = coarse.A;
+  C.vals.assign(C.colIdx.size()*bs2, 0);
+  for (int a=0; a < C.numRows; ++a) {
+    mapRow(C, a);
+    for (int k=level.transposeRowPtr[a]; k < level.transposeRowPtr[a+1]; ++k) {
+      const int i = level.transposeRows[k];
+      const Float* Pia = &P.vals[level.transposeLocations[k]*bs2];
+      for (int ib=AP.rowPtr[i]; ib < AP.rowPtr[i+1]; ++ib) {
+        addTransposeProduct(bs, Pia, &AP.vals[ib*bs2],
+                            &C.vals[locations[AP.colIdx[ib]]*bs2]);
+      }
+    }
+  }
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::computeDenseInverse(Level& level) {
+  const int bs = blockSize;
+  const int n = level.A.numRows * bs;
+  level.denseInverse.clear();
+  if (n > kMaxDenseRows) {
+    return;
+  }
+  const Matrix& A = level.A;
+  vector<double> dense(n*n, 0.0);
+  for (int i=0; i < A.numRows; ++i) {
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      const int j = A.colIdx[ij];
+      for (int bi=0; bi < bs; ++bi) {
+        for (int bj=0; bj < bs; ++bj) {
+          dense[(i*bs+bi)*n + j*bs+bj] = A.vals[(ij*bs+bi)*bs+bj];
+        }
+      }
+    }
+  }
+  if (invertMatrix(n, dense)) {
+    level.denseInverse.assign(dense.begin(), dense.end());
+  }
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::multiply(const Matrix& A, const Float* x,
+                                         Float* y) const {
+  const int bs = blockSize;
+  const int bs2 = bs*bs;
+  for (int i=0; i < A.numRows; ++i) {
+    Float* yi = &y[i*bs];
+    fill(yi, yi+bs, (Float)0);
+    for (int ij=A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      const Float* a = &A.vals[ij*bs2];
+      const Float* xj = &x[A.colIdx[ij]*bs];
+      for (int bi=0; bi < bs; ++bi) {
+        for (int bj=0; bj < bs; ++bj) {
+          yi[bi] += a[bi*bs+bj] * xj[bj];
+        }
+      }
+    }
+  }
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::smooth(Level& level, const Float* b, Float* x,
+                                       int numSweeps) {
+  const int bs = blockSize;
+  const int n = level.A.numRows * bs;
+  Float* r = level.r.data();
+  for (int sweep=0; sweep < numSweeps; ++sweep) {
+    multiply(level.A, x, r);
+    for (int k=0; k < n; ++k) {
+      r[k] = b[k] - r[k];
+    }
+    for (int i=0; i < level.A.numRows; ++i) {
+      const Float* inverse = &level.invDiagonal[i*bs*bs];
+      for (int bi=0; bi < bs; ++bi) {
+        Float correction = 0;
+        for (int bj=0; bj < bs; ++bj) {
+          correction += inverse[bi*bs+bj] * r[i*bs+bj];
+        }
+        x[i*bs+bi] += level.weight * correction;
+      }
+    }
+  }
+}
+
+template <typename Float>
+void AlgebraicMultigrid<Float>::vcycle(int l, const Float* b, Float* x) {
+  Level& level = levels[l];
+  const int bs = blockSize;
+  const int bs2 = bs*bs;
+  const int n = level.A.numRows * bs;
+  const bool coarsest = l+1 == (int)levels.size();
+  if (coarsest && !level.denseInverse.empty()) {
+    for (int i=0; i < n; ++i) {
+      const Float* row = &level.denseInverse[(size_t)i*n];
+      double sum = 0.0;
+      for (int j=0; j < n; ++j) {
+        sum += (double)row[j] * b[j];
+      }
+      x[i] = sum;
+    }
+    return;
+  }
+
+  fill(x, x+n, (Float)0);
+  if (coarsest) {
+    smooth(level, b, x, kNumCoarsestSweeps);
+    return;
+  }
+  smooth(level, b, x, kNumSweeps);
+
+  // Restrict the residual with P^T, correct from the coarse level and
+  // prolong the correction
+  Float* r = level.r.data();
+  multiply(level.A, x, r);
+  for (int k=0; k < n; ++k) {
+    r[k] = b[k] - r[k];
+  }
+  Level& coarse = levels[l+1];
+  for (int a=0; a < coarse.A.numRows; ++a) {
+    Float* ba = &coarse.b[a*bs];
+    fill(ba, ba+bs, (Float)0);
+    for (int k=level.transposeRowPtr[a]; k < level.transposeRowPtr[a+1]; ++k) {
+      const Float* Pia = &level.P.vals[level.transposeLocations[k]*bs2];
+      const Float* ri = &r[level.transposeRows[k]*bs];
+      for (int bj=0; bj < bs; ++bj) {
+        for (int bi=0; bi < bs; ++bi) {
+          ba[bj] += Pia[bi*bs+bj] * ri[bi];
+        }
+      }
+    }
+  }
+  vcycle(l+1, coarse.b.data(), coarse.x.data());
+  const Matrix& P = level.P;
+  for (int i=0; i < level.A.numRows; ++i) {
+    Float* xi = &x[i*bs];
+    for (int ia=P.rowPtr[i]; ia < P.rowPtr[i+1]; ++ia) {
+      const Float* Pia = &P.vals[ia*bs2];
+      const Float* xa = &coarse.x[P.colIdx[ia]*bs];
+      for (int bi=0; bi < bs; ++bi) {
+        for (int bj=0; bj < bs; ++bj) {
+          xi[bi] += Pia[bi*bs+bj] * xa[bj];
+        }
+      }
+    }
+  }
+
+  smooth(level, b, x, kNumSweeps);
+}
+
+template class AlgebraicMultigrid<float>;
+template class AlgebraicMultigrid<double>;
+
+}
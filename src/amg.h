@@ -0,0 +1,111 @@
+#ifndef SIMIT_AMG_H
+#define SIMIT_AMG_H
+
+#include <vector>
+
+namespace simit {
+
+/// A smoothed aggregation algebraic multigrid hierarchy of a symmetric
+/// positive definite blocked CSR matrix of numRows x numRows blocks of size
+/// blockSize x blockSize, of which only the lower triangle is read (see
+/// blockCG).
+///
+/// The block rows are grouped into aggregates of strongly coupled rows, and
+/// the tentative prolongation interpolates the blockSize components of every
+/// aggregate independently, so that the near null space of the coarse levels
+/// are the translations of every component, and coarse matrices keep the
+/// block size of the fine one (e.g. 3x3 blocks for elasticity). The tentative
+/// prolongation is smoothed with one damped block Jacobi step, the coarse
+/// matrices are the Galerkin products P^T*A*P, and levels are smoothed with
+/// damped block Jacobi. The coarsest level is solved with its dense inverse.
+///
+/// The aggregates, and the sparsity of the prolongations and coarse matrices,
+/// are computed once from the values given to the constructor, and setup
+/// only recomputes their values, so that a hierarchy is reused while the
+/// sparsity of the matrix is fixed, e.g. across the time steps of a
+/// simulation.
+template <typename Float>
+class AlgebraicMultigrid {
+public:
+  AlgebraicMultigrid(int numRows, int blockSize,
+                     const int* rowPtr, const int* colIdx, const Float* vals);
+
+  /// Whether the hierarchy was built for a matrix with the given structure.
+  bool matches(int numRows, int blockSize,
+               const int* rowPtr, const int* colIdx) const;
+
+  int getNumLevels() const {return levels.size();}
+
+  /// The number of block rows of a level, where level 0 is the fine matrix.
+  int getNumRows(int level) const {return levels[level].A.numRows;}
+
+  /// Recomputes the prolongations, coarse matrices and smoothers from the
+  /// given values of the fine matrix.
+  void setup(const Float* vals);
+
+  /// Approximates the solution of A*x = b with one V-cycle from x = 0.
+  void vcycle(const Float* b, Float* x);
+
+private:
+  /// A blocked CSR matrix that stores both triangles.
+  struct Matrix {
+    int numRows;
+    std::vector<int> rowPtr;
+    std::vector<int> colIdx;
+    std::vector<Float> vals;
+  };
+
+  struct Level {
+    Matrix A;
+
+    /// The inverses of the diagonal blocks, and the weight of the Jacobi
+    /// steps, 4/3 over the spectral radius of D^-1*A.
+    std::vector<Float> invDiagonal;
+    double weight;
+
+    /// The aggregate of every row, and the number of rows of every aggregate.
+    std::vector<int> aggregates;
+    std::vector<int> aggregateSizes;
+
+    /// The prolongation from the next coarser level, and A*P, whose columns
+    /// are the rows of the next coarser level.
+    Matrix P;
+    Matrix AP;
+
+    /// The rows of the blocks of every column of P, and their locations.
+    std::vector<int> transposeRowPtr;
+    std::vector<int> transposeRows;
+    std::vector<int> transposeLocations;
+
+    /// The dense inverse of the coarsest level.
+    std::vector<Float> denseInverse;
+
+    std::vector<Float> b;
+    std::vector<Float> x;
+    std::vector<Float> r;
+  };
+
+  int blockSize;
+
+  /// The structure of the fine matrix, and for every block above the diagonal
+  /// the location of its transpose below it, or -1.
+  std::vector<int> rowPtr;
+  std::vector<int> colIdx;
+  std::vector<int> mirrors;
+
+  std::vector<Level> levels;
+
+  void setFineValues(const Float* vals);
+  void computeSmoother(Level& level);
+  void aggregate(Level& level);
+  Level buildCoarseLevel(Level& level);
+  void computeCoarseValues(Level& level, Level& coarse);
+  void computeDenseInverse(Level& level);
+
+  void multiply(const Matrix& A, const Float* x, Float* y) const;
+  void smooth(Level& level, const Float* b, Float* x, int numSweeps);
+  void vcycle(int l, const Float* b, Float* x);
+};
+
+}
+#endif
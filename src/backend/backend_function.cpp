@@ -8,6 +8,7 @@ using namespace std;
 #include "ir.h"
 #include "ir_visitor.h"
 #include "graph_indices.h"
+#include "profiler.h"
 #include "util/collections.h"
 #include "error.h"
 
@@ -62,6 +63,10 @@ Function::Function(const ir::Func& func)
     }
   };
   literals = GatherLiteralsVisitor().gather(func);
+
+  if (environment->getProfileRegions().size() > 0) {
+    profiler = make_shared<Profiler>(environment->getProfileRegions());
+  }
 }
 
 Function::~Function() {
@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <functional>
+#include <memory>
 #include <set>
 
 #include "interfaces/printable.h"
@@ -13,6 +14,7 @@
 namespace simit {
 class Set;
 class TensorData;
+class Profiler;
 
 namespace ir {
 class Func;
@@ -74,8 +76,12 @@ public:
 
   const ir::Environment& getEnvironment() const;
 
+  /// The profiler of a function compiled with profiling, or nullptr.
+  const std::shared_ptr<Profiler>& getProfiler() const {return profiler;}
+
 private:
   ir::Environment* environment;
+  std::shared_ptr<Profiler> profiler;
 
   std::vector<std::string> arguments;
   std::map<std::string, ir::Type> argumentTypes;
@@ -465,8 +465,6 @@ void GPUBackend::compile(const ir::CallStmt& op) {
             callee != ir::intrinsics::dot())
         << "norm and dot should have been lowered";
 
-    std::string floatTypeName = ir::ScalarType::singleFloat() ? "_f32" : "_f64";
-
     // first, see if this is an LLVM intrinsic
     auto foundIntrinsic = nvvmIntrinsicByName.find(callee);
     if (foundIntrinsic != nvvmIntrinsicByName.end()) {
@@ -481,22 +479,23 @@ void GPUBackend::compile(const ir::CallStmt& op) {
     }
     else if (callee == ir::intrinsics::det()) {
       iassert(args.size() == 1);
-      std::string fname = callee.getName() + "3" + floatTypeName;
-      call = emitCall(fname, args, llvmFloatType());
+      call = emitDeterminant(args[0], op.actuals[0].type().toTensor());
     }
     else if (callee == ir::intrinsics::inv()) {
       iassert(args.size() == 1);
 
       ir::Var result = op.results[0];
       llvm::Value *llvmResult = symtable.get(result);
-      args.push_back(llvmResult);
-
-      std::string fname = callee.getName() + "3" + floatTypeName;
-      call = emitCall(fname, args);
+      emitInverse(args[0], llvmResult, op.actuals[0].type().toTensor());
+      return;
     }
     else if (op.callee == ir::intrinsics::loc()) {
       call = emitCall("loc", args, LLVM_INT);
     }
+    else if (callee == ir::intrinsics::profileBegin() ||
+             callee == ir::intrinsics::profileEnd()) {
+      not_supported_yet << "profiling GPU functions";
+    }
     else {
       ierror << "intrinsic " << op.callee.getName() << " not found";
     }
@@ -13,6 +13,7 @@
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Function.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/Support/raw_ostream.h"
 
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
@@ -22,6 +23,8 @@
 #endif
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 
@@ -33,13 +36,17 @@
 #else
 #include "llvm/IR/LegacyPassManager.h"
 #endif
+#if LLVM_MAJOR_VERSION > 3 || LLVM_MINOR_VERSION >= 8
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Target/TargetMachine.h"
+#endif
 
 #include "llvm_types.h"
 #include "llvm_codegen.h"
 #include "llvm_util.h"
 #include "llvm_data_layouts.h"
 
-#include "macros.h"
 #include "types.h"
 #include "func.h"
 #include "ir.h"
@@ -51,8 +58,10 @@
 #include "environment.h"
 #include "tensor_index.h"
 #include "llvm_function.h"
+#include "allocator.h"
 #include "macros.h"
 #include "path_expressions.h"
+#include "vector_math.h"
 #include "util/collections.h"
 
 using namespace std;
@@ -75,6 +84,9 @@ shared_ptr<llvm::EngineBuilder> createEngineBuilder(llvm::Module *module) {
   shared_ptr<llvm::EngineBuilder> engineBuilder(new llvm::EngineBuilder(
       unique_ptr<llvm::Module>(module)));
 #endif
+  // Generate code for the host's instruction set, e.g. to vectorize with its
+  // widest vectors
+  engineBuilder->setMCPU(llvm::sys::getHostCPUName());
   return engineBuilder;
 }
 
@@ -82,6 +94,11 @@ LLVMBackend::LLVMBackend() : builder(new SimitIRBuilder(LLVM_CTX)) {
   if (!llvmInitialized) {
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
+
+    // Make the vector math functions visible to the JIT-compiled code
+    for (const VectorFunction& function : getVectorFunctions()) {
+      llvm::sys::DynamicLibrary::AddSymbol(function.name, function.address);
+    }
     llvmInitialized = true;
   }
 }
@@ -180,11 +197,11 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   }
   iassert(llvmFunc);
 
-  // Declare malloc and free if necessary
+  // Declare the allocator and free if necessary
   llvm::FunctionType *m =
-      llvm::FunctionType::get(LLVM_INT8_PTR, {LLVM_INT}, false);
-  llvm::Function *malloc =
-      llvm::cast<llvm::Function>(module->getOrInsertFunction("malloc", m));
+      llvm::FunctionType::get(LLVM_INT8_PTR, {LLVM_INT64}, false);
+  llvm::Function *allocate = llvm::cast<llvm::Function>(
+      module->getOrInsertFunction("simitAllocate", m));
   llvm::FunctionType *f =
       llvm::FunctionType::get(LLVM_VOID, {LLVM_INT8_PTR}, false);
   llvm::Function *free =
@@ -204,8 +221,10 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
     const TensorType *ttype = type.toTensor();
     llvm::Value *len= emitComputeLen(ttype,this->storage.getStorage(bufferVar));
     unsigned compSize = ttype->getComponentType().bytes();
-    llvm::Value *size = builder->CreateMul(len, llvmInt(compSize));
-    llvm::Value *mem = builder->CreateCall(malloc, size);
+    // Compute the size in 64 bits, since large buffers overflow 32-bit sizes
+    len = builder->CreateZExt(len, LLVM_INT64);
+    llvm::Value *size = builder->CreateMul(len, llvmInt(compSize, 64));
+    llvm::Value *mem = builder->CreateCall(allocate, size);
 
     mem = builder->CreateCast(llvm::Instruction::CastOps::BitCast, mem, ltype);
     builder->CreateStore(mem, bufferVal);
@@ -263,6 +282,25 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   module->setDataLayout(dataLayout);
 #endif
 
+#if LLVM_MAJOR_VERSION > 3 || LLVM_MINOR_VERSION >= 8
+  // Let the vectorizers use the vector registers of the host, and map calls
+  // of math functions in vectorized loops to the vector math library
+  unique_ptr<llvm::TargetMachine> target(engineBuilder->selectTarget());
+  fpm.add(llvm::createTargetTransformInfoWrapperPass(
+      target->getTargetIRAnalysis()));
+  mpm.add(llvm::createTargetTransformInfoWrapperPass(
+      target->getTargetIRAnalysis()));
+
+  vector<llvm::VecDesc> vectorFunctions;
+  for (const VectorFunction& function : getVectorFunctions()) {
+    vectorFunctions.push_back({function.scalarName, function.name,
+                               (unsigned)function.width});
+  }
+  llvm::TargetLibraryInfoImpl libraryInfo(target->getTargetTriple());
+  libraryInfo.addVectorizableFunctions(vectorFunctions);
+  pmBuilder.LibraryInfo = &libraryInfo;
+#endif
+
   pmBuilder.populateFunctionPassManager(fpm);
   pmBuilder.populateModulePassManager(mpm);
 
@@ -734,12 +772,6 @@ LLVMBackend::emitArgument(ir::Expr argument, bool excludeStaticTypes) {
       auto tensorStorage = storage.getStorage(to<VarExpr>(argument)->var);
       auto tensorIndex = tensorStorage.getTensorIndex();
 
-      llvm::Value* rowptrPtr = symtable.get(tensorIndex.getRowptrArray());
-      llvm::Value* rowptr = builder->CreateAlignedLoad(rowptrPtr, 8);
-
-      llvm::Value* colidxPtr = symtable.get(tensorIndex.getColidxArray());
-      llvm::Value* colidx = builder->CreateAlignedLoad(colidxPtr, 8);
-
       auto n = emitComputeLen(dimensions[0]);
       auto m = emitComputeLen(dimensions[1]);
 
@@ -759,13 +791,48 @@ LLVMBackend::emitArgument(ir::Expr argument, bool excludeStaticTypes) {
 
       // Argument list:
       // - Top-level type:    n, m
-      // - Top-level indices: rowPtr, colIdx,
+      // - Top-level indices: rowPtr, colIdx, or for stencil matrices the
+      //                      number of lattice dimensions, three lattice
+      //                      dimensions (1 if unused), the stencil size and
+      //                      its offsets
       // - Block type:        nn, mm
       // - Values:  vals
       argumentValues.push_back(n);
       argumentValues.push_back(m);
-      argumentValues.push_back(rowptr);
-      argumentValues.push_back(colidx);
+      if (tensorStorage.getKind() == TensorStorage::Stencil) {
+        const StencilLayout& stencil = tensorIndex.getStencilLayout();
+        const map<int, vector<int>> offsets = stencil.getLayoutReversed();
+        const Var latticeSet = stencil.getLatticeSet();
+        const int numDims = latticeSet.getType().toLatticeLinkSet()->dimensions;
+        tassert(numDims <= 3)
+            << "solves on lattices of more than three dimensions";
+
+        argumentValues.push_back(llvmInt(numDims));
+        for (int d = 0; d < 3; ++d) {
+          argumentValues.push_back(
+              (d < numDims)
+              ? compile(IndexRead::make(latticeSet, IndexRead::LatticeDim, d))
+              : llvmInt(1));
+        }
+        vector<int> offsetsData;
+        for (auto& offset : offsets) {
+          iassert((int)offset.second.size() == numDims);
+          offsetsData.insert(offsetsData.end(), offset.second.begin(),
+                             offset.second.end());
+        }
+        argumentValues.push_back(llvmInt(offsets.size()));
+        argumentValues.push_back(emitGlobalIntArray(offsetsData));
+      }
+      else {
+        llvm::Value* rowptrPtr = symtable.get(tensorIndex.getRowptrArray());
+        llvm::Value* rowptr = builder->CreateAlignedLoad(rowptrPtr, 8);
+
+        llvm::Value* colidxPtr = symtable.get(tensorIndex.getColidxArray());
+        llvm::Value* colidx = builder->CreateAlignedLoad(colidxPtr, 8);
+
+        argumentValues.push_back(rowptr);
+        argumentValues.push_back(colidx);
+      }
       argumentValues.push_back(nn);
       argumentValues.push_back(mm);
     }
@@ -900,12 +967,34 @@ void LLVMBackend::emitInternalCall(const ir::CallStmt& callStmt) {
   }
 }
 
+/// Extern functions expect sparse matrices that store both triangles, so only
+/// the solvers that have upper triangular variants take matrices with upper
+/// triangular indices.
+static bool hasUpperTriangularArgument(const ir::CallStmt& callStmt,
+                                       const ir::Storage& storage) {
+  for (auto& actual : callStmt.actuals) {
+    if (isa<VarExpr>(actual) && storage.hasStorage(to<VarExpr>(actual)->var)) {
+      const TensorStorage& ts = storage.getStorage(to<VarExpr>(actual)->var);
+      if (ts.hasTensorIndex() && ts.getTensorIndex().isUpperTriangular()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 void LLVMBackend::emitExternCall(const ir::CallStmt& callStmt) {
   // ensure it is called with the correct number of arguments.
   uassert(callStmt.actuals.size() == callStmt.callee.getArguments().size()) <<
       "External function '" << callStmt.callee.getName() << "' called with " <<
       callStmt.actuals.size() << " arguments, but expected " <<
       callStmt.callee.getArguments().size() << " arguments.";
+  std::string name = callStmt.callee.getName();
+  name = name.substr(0, name.find("@"));
+  const bool upperTriangular = hasUpperTriangularArgument(callStmt, storage);
+  tassert(!upperTriangular || name == ir::intrinsics::chol().getName())
+      << "matrices with upper triangular indices cannot be passed to "
+      << callStmt.callee.getName();
 
   // Arguments
   auto args = emitArguments(callStmt.actuals, false);
@@ -918,10 +1007,8 @@ void LLVMBackend::emitExternCall(const ir::CallStmt& callStmt) {
   }
 
   // Function name
-  std::string name = callStmt.callee.getName();
-  name = name.substr(0, name.find("@"));
   std::string floatType = ir::ScalarType::singleFloat() ? "s" : "d";
-  name = floatType + name;
+  name = floatType + name + (upperTriangular ? "Upper" : "");
 
   auto errorCode = emitCall(name, args, LLVM_INT);
   UNUSED(errorCode);  // TODO: Accept and handle error code from extern func
@@ -973,6 +1060,11 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
            callStmt.callee == ir::intrinsics::acos()) {
     std::string fname = callStmt.callee.getName() + floatTypeName;
     call = emitCall(fname, args, llvmFloatType());
+
+    // They are pure, so that loops that call them can be vectorized
+    llvm::Function* libmFunc = module->getFunction(fname);
+    libmFunc->setDoesNotAccessMemory();
+    libmFunc->setDoesNotThrow();
   }
   else if (callStmt.callee == ir::intrinsics::mod()) {
     iassert(callStmt.actuals.size() == 2) << "mod takes two inputs, got"
@@ -1006,26 +1098,50 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
   else if (callStmt.callee == ir::intrinsics::clock()) {
     call = emitCall("clock", args, llvmFloatType());
   }
-  else if (callStmt.callee == ir::intrinsics::storeTime()) {
-    call = emitCall("storeTime", args);
+  else if (callee == ir::intrinsics::profileBegin()) {
+    const int region = to<Literal>(callStmt.actuals[0])->getIntVal(0);
+    profileRegionStarts[region] = emitReadCycleCounter();
+    return;
+  }
+  else if (callee == ir::intrinsics::profileEnd()) {
+    const int region = to<Literal>(callStmt.actuals[0])->getIntVal(0);
+    iassert(util::contains(profileRegionStarts, region))
+        << "profiling region " << region << " ends before it begins";
+    llvm::Value *end = emitReadCycleCounter();
+    llvm::Value *profiler = compile(environment->getProfiler());
+    emitCall("simitProfilerRecord",
+             {profiler, args[0], profileRegionStarts.at(region), end});
+    return;
   }
   else if (callee == ir::intrinsics::det()) {
     iassert(args.size() == 1);
-    std::string fname = callStmt.callee.getName() + "3" + floatTypeName;
-    call = emitCall(fname, args, llvmFloatType());
+    call = emitDeterminant(args[0], callStmt.actuals[0].type().toTensor());
   }
   else if (callee == ir::intrinsics::inv()) {
     iassert(args.size() == 1);
 
     Var result = callStmt.results[0];
     llvm::Value *llvmResult = symtable.get(result);
-    args.push_back(llvmResult);
-
-    std::string fname = callStmt.callee.getName() + "3" + floatTypeName;
-    call = emitCall(fname, args);
+    emitInverse(args[0], llvmResult, callStmt.actuals[0].type().toTensor());
+    return;
   }
   else if (callStmt.callee == ir::intrinsics::solve()) {
-    std::string fname = "cMatSolve" + floatTypeName;
+    const Expr& A = callStmt.actuals[0];
+    const bool isStencil =
+        isa<VarExpr>(A) && storage.hasStorage(to<VarExpr>(A)->var) &&
+        storage.getStorage(to<VarExpr>(A)->var).getKind() ==
+            TensorStorage::Stencil;
+    const bool isUpperTriangular = hasUpperTriangularArgument(callStmt,
+                                                              storage);
+    std::string fname = (isStencil ? "cStencilSolve" :
+                         isUpperTriangular ? "cUpperMatSolve" : "cMatSolve") +
+                        floatTypeName;
+    call = emitCall(fname, args);
+  }
+  else if (callStmt.callee == ir::intrinsics::symmatvec()) {
+    iassert(callStmt.results.size() == 1);
+    args.push_back(compile(callStmt.results[0]));
+    std::string fname = "symmatvec" + floatTypeName;
     call = emitCall(fname, args);
   }
   else if (callStmt.callee == ir::intrinsics::complexNorm()) {
@@ -1405,8 +1521,14 @@ llvm::Value *LLVMBackend::emitFieldRead(const Expr &elemOrSet,
   
   assert(elemType->hasField(fieldName));
   unsigned fieldLoc = fieldsOffset + elemType->fieldNames.at(fieldName);
-  return builder->CreateExtractValue(setOrElemValue, {fieldLoc},
-                                     setOrElemValue->getName()+"."+fieldName);
+  llvm::Value *fieldPtr =
+      builder->CreateExtractValue(setOrElemValue, {fieldLoc},
+                                  setOrElemValue->getName()+"."+fieldName);
+  // The field data of sets is allocated by simit::allocate
+  if (elemOrSet.type().isSet()) {
+    emitAlignmentAssumption(fieldPtr);
+  }
+  return fieldPtr;
 }
 
 llvm::Value *LLVMBackend::emitComputeLen(const TensorType *tensorType,
@@ -1517,6 +1639,125 @@ llvm::Value *LLVMBackend::loadFromArray(llvm::Value *array, llvm::Value *index){
   return builder->CreateLoad(loc);
 }
 
+typedef std::pair<vector<unsigned>,vector<unsigned>> Submatrix;
+
+/// Emit the determinant of the submatrix of `elements` (a row-major n x n
+/// matrix) with the given rows and columns, by cofactor expansion along its
+/// first row. The expansions of a matrix and of its cofactors share most of
+/// their minors, so the minors are emitted once and looked up in `minors`.
+static llvm::Value *emitMinor(SimitIRBuilder *builder,
+                              const vector<llvm::Value*>& elements, unsigned n,
+                              const Submatrix& submatrix,
+                              map<Submatrix,llvm::Value*>* minors) {
+  const vector<unsigned>& rows = submatrix.first;
+  const vector<unsigned>& cols = submatrix.second;
+  iassert(rows.size() == cols.size() && rows.size() > 0);
+  if (rows.size() == 1) {
+    return elements[rows[0]*n + cols[0]];
+  }
+  if (util::contains(*minors, submatrix)) {
+    return minors->at(submatrix);
+  }
+
+  const vector<unsigned> subrows(rows.begin()+1, rows.end());
+  llvm::Value *expansion = nullptr;
+  for (size_t j = 0; j < cols.size(); ++j) {
+    vector<unsigned> subcols = cols;
+    subcols.erase(subcols.begin() + j);
+    llvm::Value *term =
+        builder->CreateFMul(elements[rows[0]*n + cols[j]],
+                            emitMinor(builder, elements, n, {subrows, subcols},
+                                      minors));
+    expansion = (expansion == nullptr) ? term
+              : (j % 2 == 0) ? builder->CreateFAdd(expansion, term)
+                             : builder->CreateFSub(expansion, term);
+  }
+  minors->insert({submatrix, expansion});
+  return expansion;
+}
+
+/// The number of rows and columns of a matrix passed to det or inv, which are
+/// computed in closed form for dense matrices of up to 4x4 components.
+static unsigned getSmallMatrixSize(const TensorType *type) {
+  const vector<IndexDomain> dims = type->getDimensions();
+  uassert(dims.size() == 2 && !type->isSparse() && dims[0] == dims[1] &&
+          dims[0].getNumIndexSets() == 1)
+      << "det and inv are only supported for dense, square and unblocked "
+      << "matrices";
+  unsigned n = dims[0].getSize();
+  uassert(n <= 4)
+      << "det and inv are only supported for matrices of up to 4x4 components";
+  return n;
+}
+
+static vector<unsigned> allIndices(unsigned n) {
+  vector<unsigned> indices(n);
+  for (unsigned i = 0; i < n; ++i) {
+    indices[i] = i;
+  }
+  return indices;
+}
+
+llvm::Value *LLVMBackend::emitDeterminant(llvm::Value *matrix,
+                                          const TensorType *type) {
+  unsigned n = getSmallMatrixSize(type);
+  vector<llvm::Value*> elements;
+  for (unsigned i = 0; i < n*n; ++i) {
+    elements.push_back(loadFromArray(matrix, llvmInt(i)));
+  }
+  map<Submatrix,llvm::Value*> minors;
+  return emitMinor(builder.get(), elements, n,
+                   {allIndices(n), allIndices(n)}, &minors);
+}
+
+void LLVMBackend::emitInverse(llvm::Value *matrix, llvm::Value *inverse,
+                              const TensorType *type) {
+  unsigned n = getSmallMatrixSize(type);
+  vector<llvm::Value*> elements;
+  for (unsigned i = 0; i < n*n; ++i) {
+    elements.push_back(loadFromArray(matrix, llvmInt(i)));
+  }
+  map<Submatrix,llvm::Value*> minors;
+  llvm::Value *det = emitMinor(builder.get(), elements, n,
+                               {allIndices(n), allIndices(n)}, &minors);
+  llvm::Value *rdet = builder->CreateFDiv(llvmFP(1.0), det);
+  llvm::Value *negRdet = builder->CreateFNeg(rdet);
+
+  // The inverse is the transposed matrix of cofactors divided by the
+  // determinant. All the elements are loaded before the inverse is stored,
+  // so `inverse` may alias `matrix`.
+  vector<llvm::Value*> inverseElements(n*n);
+  for (unsigned i = 0; i < n; ++i) {
+    for (unsigned j = 0; j < n; ++j) {
+      vector<unsigned> subrows = allIndices(n);
+      vector<unsigned> subcols = allIndices(n);
+      subrows.erase(subrows.begin() + i);
+      subcols.erase(subcols.begin() + j);
+      llvm::Value *cofactor = (n == 1) ? llvmFP(1.0)
+          : emitMinor(builder.get(), elements, n, {subrows, subcols}, &minors);
+      inverseElements[j*n + i] =
+          builder->CreateFMul(cofactor, ((i+j) % 2 == 0) ? rdet : negRdet);
+    }
+  }
+  for (unsigned i = 0; i < n*n; ++i) {
+    builder->CreateStore(inverseElements[i],
+                         builder->CreateInBoundsGEP(inverse, llvmInt(i)));
+  }
+}
+
+llvm::Value *LLVMBackend::emitReadCycleCounter() {
+  // The runtime reads the time stamp counter on x86, which is what
+  // llvm.readcyclecounter compiles to there, and a clock elsewhere
+  llvm::Triple::ArchType arch = llvm::Triple(llvm::sys::getProcessTriple())
+                                    .getArch();
+  if (arch == llvm::Triple::x86 || arch == llvm::Triple::x86_64) {
+    llvm::Function *readCycleCounter = llvm::Intrinsic::getDeclaration(
+        module, llvm::Intrinsic::readcyclecounter);
+    return builder->CreateCall(readCycleCounter);
+  }
+  return emitCall("simitReadCycleCounter", {}, LLVM_INT64);
+}
+
 llvm::Value *LLVMBackend::emitCall(string name, vector<llvm::Value*> args) {
   return emitCall(name, args, LLVM_VOID);
 }
@@ -1559,6 +1800,27 @@ llvm::Constant *LLVMBackend::emitGlobalString(const std::string& str) {
 #endif
 }
 
+llvm::Constant *LLVMBackend::emitGlobalIntArray(const std::vector<int>& data) {
+  std::vector<uint32_t> values(data.begin(), data.end());
+  auto arrayValue = llvm::ConstantDataArray::get(LLVM_CTX, values);
+  auto arrayType = llvm::ArrayType::get(LLVM_INT, data.size());
+
+  llvm::GlobalVariable *arrayGlobal =
+      new llvm::GlobalVariable(*module, arrayType, true,
+                               llvm::GlobalValue::PrivateLinkage, arrayValue,
+                               "_ints");
+  llvm::Constant *zero = llvm::Constant::getNullValue(LLVM_INT);
+
+  std::vector<llvm::Constant*> idx;
+  idx.push_back(zero);
+  idx.push_back(zero);
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  return llvm::ConstantExpr::getGetElementPtr(arrayGlobal, idx);
+#else
+  return llvm::ConstantExpr::getGetElementPtr(nullptr, arrayGlobal, idx);
+#endif
+}
+
 llvm::Function *LLVMBackend::emitEmptyFunction(const string &name,
                                                const vector<ir::Var> &arguments,
                                                const vector<ir::Var> &results,
@@ -1644,6 +1906,17 @@ void LLVMBackend::emitGlobals(const ir::Environment& env) {
     this->globals.insert(ext);
   }
 
+  // Emit the pointer to the profiler that the profiled regions record to,
+  // which the function sets when it is created
+  if (env.getProfileRegions().size() > 0) {
+    const Var& profiler = env.getProfiler();
+    llvm::GlobalVariable* ptr = createGlobal(module, profiler,
+                                             llvm::GlobalValue::ExternalLinkage,
+                                             globalAddrspace());
+    this->symtable.insert(profiler, ptr);
+    this->globals.insert(profiler);
+  }
+
   // Emit global temporaries
   for (const Var& tmp : env.getTemporaries()) {
     llvm::GlobalVariable* ptr = createGlobal(module, tmp,
@@ -1671,6 +1944,36 @@ void LLVMBackend::emitGlobals(const ir::Environment& env) {
       this->globals.insert(colidx);
     }
   }
+
+  // Emit global iteration orders
+  for (auto& iterationOrder : env.getIterationOrders()) {
+    const Var& order = iterationOrder.second;
+    llvm::GlobalVariable* orderPtr =
+        createGlobal(module, order, llvm::GlobalValue::ExternalLinkage,
+                     globalAddrspace());
+    this->symtable.insert(order, orderPtr);
+    this->globals.insert(order);
+  }
+
+  // Emit global sparse tiles
+  for (auto& tiling : env.getSparseTilings()) {
+    for (const Var& array : {tiling.tileStarts, tiling.tileEdges}) {
+      llvm::GlobalVariable* arrayPtr =
+          createGlobal(module, array, llvm::GlobalValue::ExternalLinkage,
+                       globalAddrspace());
+      this->symtable.insert(array, arrayPtr);
+      this->globals.insert(array);
+    }
+  }
+
+  // Emit global location tables
+  for (auto& table : env.getLocationTables()) {
+    llvm::GlobalVariable* locationsPtr =
+        createGlobal(module, table.locations,
+                     llvm::GlobalValue::ExternalLinkage, globalAddrspace());
+    this->symtable.insert(table.locations, locationsPtr);
+    this->globals.insert(table.locations);
+  }
 }
 
 void LLVMBackend::emitAssign(Var var, const Expr& value) {
@@ -1772,7 +2075,17 @@ llvm::Value *LLVMBackend::makeGlobalTensor(ir::Var var) {
   buffers.insert(pair<Var, llvm::Value*>(var, buffer));
 
   // Add load to symtable
-  return builder->CreateLoad(buffer, buffer->getName());
+  llvm::Value *bufferPtr = builder->CreateLoad(buffer, buffer->getName());
+  emitAlignmentAssumption(bufferPtr);
+  return bufferPtr;
+}
+
+void LLVMBackend::emitAlignmentAssumption(llvm::Value *ptr) {
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  // Alignment assumptions were added in LLVM 3.6
+#else
+  builder->CreateAlignmentAssumption(*dataLayout, ptr, kArrayAlignment);
+#endif
 }
 
 }}
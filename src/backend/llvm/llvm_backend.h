@@ -65,6 +65,9 @@ protected:
   ir::Storage storage;
   const ir::Environment* environment;
 
+  // The cycle counter values read when the profiling regions were entered
+  std::map<int, llvm::Value*> profileRegionStarts;
+
   llvm::Module *module;
   std::unique_ptr<llvm::DataLayout> dataLayout;
   std::unique_ptr<SimitIRBuilder> builder;
@@ -129,9 +132,25 @@ protected:
   llvm::Value *emitCall(std::string name, std::vector<llvm::Value*> args,
                         llvm::Type *returnType);
 
+  /// Emit the determinant of the small (up to 4x4) dense matrix of the given
+  /// type that `matrix` points to, as an inline closed-form expression.
+  llvm::Value *emitDeterminant(llvm::Value *matrix, const ir::TensorType *type);
+
+  /// Emit the inverse of the small (up to 4x4) dense matrix of the given type
+  /// that `matrix` points to, as inline closed-form expressions, and store it
+  /// to `inverse`.
+  void emitInverse(llvm::Value *matrix, llvm::Value *inverse,
+                   const ir::TensorType *type);
+
+  /// Emit a read of the cycle counter that the Profiler measures regions with.
+  llvm::Value *emitReadCycleCounter();
+
   /// Build a global string and return a constant pointer to it
   llvm::Constant *emitGlobalString(const std::string& str);
 
+  /// Build a global constant array of ints and return a pointer to it
+  llvm::Constant *emitGlobalIntArray(const std::vector<int>& data);
+
   /// Gets a reference to a named built-in
   llvm::Function* getBuiltIn(std::string name,
                              llvm::Type *retTy,
@@ -168,6 +187,10 @@ protected:
   /// Allocate a global pointer for a tensor, and add to the symtable
   /// and list of global buffers
   virtual llvm::Value *makeGlobalTensor(ir::Var var);
+
+  /// Tell the optimizer that the array pointed to by ptr was allocated by
+  /// simit::allocate, and is aligned to kArrayAlignment
+  void emitAlignmentAssumption(llvm::Value *ptr);
   
   /// Compile a single argument and return its llvm values
   std::vector<llvm::Value*> emitArgument(ir::Expr argument,
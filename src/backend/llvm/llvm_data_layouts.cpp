@@ -1,6 +1,5 @@
 #include "llvm_data_layouts.h"
 
-#include "init.h"
 #include "ir.h"
 #include "llvm_codegen.h"
 #include "llvm_types.h"
@@ -157,24 +156,21 @@ llvm::Value* LatticeEdgeSetLayout::getTotalSize() {
 }
 
 llvm::Value* LatticeEdgeSetLayout::getEpsArray() {
-  iassert(!kIndexlessStencils)
-      << "Endpoints array undefined when in indexless mode";
-  return builder->CreateExtractValue(
-      value, {1}, util::toString(set)+".eps()");
+  ierror << "Endpoints array undefined for lattice link sets, whose links are "
+         << "computed from lattice coordinates";
+  return nullptr;
 }
 
 llvm::Value* LatticeEdgeSetLayout::getNbrsStartArray() {
-  iassert(!kIndexlessStencils)
-      << "Neighbors start array undefined when in indexless mode";
-  return builder->CreateExtractValue(
-      value, {2}, util::toString(set)+".nbrs_start()");
+  ierror << "Neighbors start array undefined for lattice link sets, whose links are "
+         << "computed from lattice coordinates";
+  return nullptr;
 }
 
 llvm::Value* LatticeEdgeSetLayout::getNbrsArray() {
-  iassert(!kIndexlessStencils)
-      << "Neighbors array undefined when in indexless mode";
-  return builder->CreateExtractValue(
-      value, {3}, util::toString(set)+".nbrs()");
+  ierror << "Neighbors array undefined for lattice link sets, whose links are "
+         << "computed from lattice coordinates";
+  return nullptr;
 }
 
 int LatticeEdgeSetLayout::getFieldsOffset() {
@@ -197,23 +193,12 @@ llvm::Value* LatticeEdgeSetLayout::makeSet(Set *actual, ir::Type type) {
       << dimensions.size() << " passed, but " << ndims
       << " required";
   setData.push_back(llvmPtr(LLVM_INT_PTR, dimensions.data()));
-    
-  // CSR data: only set if kIndexlessStencils is false, otherwise
-  // we set these to NULL.
-  if (kIndexlessStencils) {
-    // Three NULL pointers for endpoints, nbrs_start, and nbrs
-    setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
-    setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
-    setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
-  }
-  else {
-    // Endpoints index
-    setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getEndpointsData()));
-    // Neighbor indices
-    const internal::NeighborIndex *nbrs = actual->getNeighborIndex();
-    setData.push_back(llvmPtr(LLVM_INT_PTR, nbrs->getStartIndex()));
-    setData.push_back(llvmPtr(LLVM_INT_PTR, nbrs->getNeighborIndex()));
-  }
+
+  // Lattice link sets are implicit, so there are no endpoints or neighbor
+  // indices: three NULL pointers for endpoints, nbrs_start, and nbrs
+  setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
+  setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
+  setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
     
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
@@ -233,23 +218,12 @@ void LatticeEdgeSetLayout::writeSet(Set *actual, ir::Type type, void *externPtr)
   // Set sizes
   const vector<int> &dimensions = actual->getDimensions();
   ((const int**)externPtrCast)[0] = dimensions.data();
-    
-  // CSR data: only set if kIndexlessStencils is false, otherwise
-  // we set these to NULL.
-  if (kIndexlessStencils) {
-    // Three NULL pointers for endpoints, nbrs_start, and nbrs
-    externPtrCast[1] = NULL;
-    externPtrCast[2] = NULL;
-    externPtrCast[3] = NULL;
-  }
-  else {
-    // Endpoints index
-    externPtrCast[1] = actual->getEndpointsData();
-    // Neighbor indices
-    const internal::NeighborIndex *nbrs = actual->getNeighborIndex();
-    ((const int**)externPtrCast)[2] = nbrs->getStartIndex();
-    ((const int**)externPtrCast)[3] = nbrs->getNeighborIndex();
-  }
+
+  // Lattice link sets are implicit, so there are no endpoints or neighbor
+  // indices: three NULL pointers for endpoints, nbrs_start, and nbrs
+  externPtrCast[1] = NULL;
+  externPtrCast[2] = NULL;
+  externPtrCast[3] = NULL;
 
   void **externPtrFieldCast = (void**)(externPtrCast+4);
   // Fields
@@ -90,6 +90,8 @@ private:
 
 /// Lattice edge set layout:
 /// <sizes_ptr> <eps_ptr> <nbrs_start_ptr> <nbrs_ptr> <f1> <f2> ...
+/// Lattice links are computed from the sizes, so the eps, nbrs_start and nbrs
+/// pointers are always NULL.
 class LatticeEdgeSetLayout : public SetLayout {
 public:
   virtual llvm::Value* getSize(unsigned i);
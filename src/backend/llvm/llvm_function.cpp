@@ -21,10 +21,15 @@
 #include "llvm_data_layouts.h"
 
 #include "backend/actual.h"
+#include "allocator.h"
 #include "graph.h"
 #include "graph_indices.h"
+#include "index_files.h"
+#include "init.h"
 #include "tensor_index.h"
 #include "path_indices.h"
+#include "reorder.h"
+#include "solvers.h"
 #include "util/collections.h"
 #include "util/util.h"
 #include "llvm_util.h"
@@ -92,6 +97,14 @@ LLVMFunction::LLVMFunction(ir::Func func, const ir::Storage &storage,
     temporaryPtrs.insert({tmp.getName(), tmpPtr});
   }
 
+  // Point the profiled regions to the function's profiler
+  if (env.getProfileRegions().size() > 0) {
+    uint64_t addr =
+        executionEngine->getGlobalValueAddress(env.getProfiler().getName());
+    void** profilerPtr = (void**)addr;
+    *profilerPtr = getProfiler().get();
+  }
+
   // Initialize tensorIndex ptrs
   for (const TensorIndex& tensorIndex : env.getTensorIndices()) {
     uint64_t addr;
@@ -117,14 +130,55 @@ LLVMFunction::LLVMFunction(ir::Func func, const ir::Storage &storage,
       not_supported_yet;
     }
   }
+
+  // Initialize iteration order ptrs
+  for (auto& iterationOrder : env.getIterationOrders()) {
+    const Var& order = iterationOrder.second;
+    uint64_t addr = executionEngine->getGlobalValueAddress(order.getName());
+    const int** orderPtr = (const int**)addr;
+    *orderPtr = nullptr;
+    iterationOrderPtrs.insert({iterationOrder.first.getName(), orderPtr});
+  }
+
+  // Initialize sparse tile ptrs
+  for (auto& tiling : env.getSparseTilings()) {
+    SparseTiles& tiles = sparseTiles[tiling.edgeSet.getName()];
+    tiles.tileSize = tiling.tileSize;
+    tiles.tileStartsPtr = (const int**)executionEngine->getGlobalValueAddress(
+        tiling.tileStarts.getName());
+    tiles.tileEdgesPtr = (const int**)executionEngine->getGlobalValueAddress(
+        tiling.tileEdges.getName());
+    *tiles.tileStartsPtr = nullptr;
+    *tiles.tileEdgesPtr = nullptr;
+  }
+
+  // Initialize location table ptrs
+  for (auto& table : env.getLocationTables()) {
+    LocationTable& locationTable = locationTables[table.locations.getName()];
+    locationTable.edgeSet = table.edgeSet.getName();
+    locationTable.rowptr = table.rowptr.getName();
+    locationTable.locationsPtr = (const int**)
+        executionEngine->getGlobalValueAddress(table.locations.getName());
+    *locationTable.locationsPtr = nullptr;
+  }
 }
 
 LLVMFunction::~LLVMFunction() {
   if (deinit) {
     deinit();
   }
+  for (auto& ptrPair : tensorIndexPtrs) {
+    freeSolverCaches((const int*)*ptrPair.second.first,
+                     (const int*)*ptrPair.second.second);
+  }
+  for (const TensorIndex& tensorIndex : getEnvironment().getTensorIndices()) {
+    if (tensorIndex.getKind() == TensorIndex::Sten) {
+      freeStencilSolverCaches();
+      break;
+    }
+  }
   for (auto& tmpPtr : temporaryPtrs) {
-    free(*tmpPtr.second);
+    deallocate(*tmpPtr.second);
     *tmpPtr.second = nullptr;
   }
 
@@ -278,7 +332,7 @@ Function::FuncType LLVMFunction::init() {
         size_t blockSize = blockType.toTensor()->size();
         size_t componentSize = tensorType->getComponentType().bytes();
         *temporaryPtrs.at(tmp.getName()) =
-            calloc(size(vecDimension) *blockSize, componentSize);
+            allocate(size(vecDimension) * blockSize * componentSize, true);
       }
       else if (order == 2) {
         Type blockType = tensorType->getBlockType();
@@ -292,7 +346,7 @@ Function::FuncType LLVMFunction::init() {
           iassert(util::contains(pathIndices, pexpr));
           size_t matSize = pathIndices.at(pexpr).numNeighbors() *
               blockSize * componentSize;
-          *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
+          *temporaryPtrs.at(tmp.getName()) = allocate(matSize);
         }
         else if (ti.getKind() == TensorIndex::Sten) {
           auto iss = tensorType->getOuterDimensions();
@@ -303,7 +357,7 @@ Function::FuncType LLVMFunction::init() {
           const StencilLayout& stencil = ti.getStencilLayout();
           size_t matSize = stencil.getLayout().size() *
               latticeSize * blockSize * componentSize;
-          *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
+          *temporaryPtrs.at(tmp.getName()) = allocate(matSize);
         }
         else {
           not_supported_yet;
@@ -435,13 +489,40 @@ void LLVMFunction::initIndices(pe::PathIndexBuilder& piBuilder,
   for (const TensorIndex& tensorIndex : environment.getTensorIndices()) {
     if (tensorIndex.getKind() == TensorIndex::PExpr) {
       pe::PathExpression pexpr = tensorIndex.getPathExpression();
-      pe::PathIndex pidx = piBuilder.buildSegmented(pexpr, 0);
-      pathIndices.insert({pexpr, pidx});
+      bool upperTriangular = tensorIndex.isUpperTriangular();
+
+      // Load the path index from the index cache if it was previously built
+      // for the same graphs, and otherwise build it and add it to the cache.
+      pe::PathIndex pidx;
+      string filename;
+      if (!kIndexCacheDir.empty()) {
+        filename = internal::getIndexFilename(
+            kIndexCacheDir,
+            upperTriangular ? internal::IndexFileKind::UpperTriangularIndex
+                            : internal::IndexFileKind::PathIndex,
+            piBuilder.fingerprint(pexpr));
+        pidx = piBuilder.load(pexpr, filename, upperTriangular);
+      }
+      if (!pidx.defined()) {
+        pidx = upperTriangular ? piBuilder.buildUpperTriangular(pexpr)
+                               : piBuilder.buildSegmented(pexpr, 0);
+        if (!filename.empty()) {
+          piBuilder.save(pexpr, pidx, filename, upperTriangular);
+        }
+      }
+      // Replace the index of sets that were bound before the graphs changed
+      pathIndices[pexpr] = pidx;
 
       pair<const uint32_t**,const uint32_t**> ptrPair = tensorIndexPtrs.at(pexpr);
 
       if (isa<pe::SegmentedPathIndex>(pidx)) {
         const pe::SegmentedPathIndex* spidx = to<pe::SegmentedPathIndex>(pidx);
+        // Solves cache structures by index, which must not outlive it
+        if (*ptrPair.first != spidx->getCoordData() ||
+            *ptrPair.second != spidx->getSinkData()) {
+          freeSolverCaches((const int*)*ptrPair.first,
+                           (const int*)*ptrPair.second);
+        }
         *ptrPair.first = spidx->getCoordData();
         *ptrPair.second = spidx->getSinkData();
       }
@@ -456,6 +537,58 @@ void LLVMFunction::initIndices(pe::PathIndexBuilder& piBuilder,
       not_supported_yet;
     }
   }
+
+  // Inspect the sets whose map loops are executed in an iteration order
+  for (auto& orderPtr : iterationOrderPtrs) {
+    const string& setName = orderPtr.first;
+    Actual* setActual = util::contains(globals, setName)
+                        ? globals.at(setName).get()
+                        : arguments.at(setName).get();
+    iassert(isa<SetActual>(setActual));
+    vector<int>& order = iterationOrders[setName];
+    order.clear();
+    computeIterationOrder(*to<SetActual>(setActual)->getSet(), order);
+    *orderPtr.second = order.data();
+  }
+
+  // Inspect the edge sets whose maps are executed in sparse tiles
+  for (auto& setTiles : sparseTiles) {
+    const string& setName = setTiles.first;
+    SparseTiles& tiles = setTiles.second;
+    Actual* setActual = util::contains(globals, setName)
+                        ? globals.at(setName).get()
+                        : arguments.at(setName).get();
+    iassert(isa<SetActual>(setActual));
+    computeSparseTiles(*to<SetActual>(setActual)->getSet(), tiles.tileSize,
+                       tiles.tileStarts, tiles.tileEdges);
+    *tiles.tileStartsPtr = tiles.tileStarts.data();
+    *tiles.tileEdgesPtr = tiles.tileEdges.data();
+  }
+
+  // Compute where the maps over edge sets assemble their blocks in the path
+  // indices, which were initialized above
+  for (auto& namedTable : locationTables) {
+    LocationTable& table = namedTable.second;
+    Actual* setActual = util::contains(globals, table.edgeSet)
+                        ? globals.at(table.edgeSet).get()
+                        : arguments.at(table.edgeSet).get();
+    iassert(isa<SetActual>(setActual));
+
+    pe::PathIndex pidx;
+    for (const TensorIndex& tensorIndex : environment.getTensorIndices()) {
+      if (tensorIndex.getKind() == TensorIndex::PExpr &&
+          tensorIndex.getRowptrArray().getName() == table.rowptr) {
+        pidx = pathIndices.at(tensorIndex.getPathExpression());
+      }
+    }
+    iassert(isa<pe::SegmentedPathIndex>(pidx))
+        << "no path index for location table " << namedTable.first;
+    const pe::SegmentedPathIndex* spidx = to<pe::SegmentedPathIndex>(pidx);
+    internal::computeLocationTable(*to<SetActual>(setActual)->getSet(),
+                                   spidx->getCoordData(),
+                                   spidx->getSinkData(), table.locations);
+    *table.locationsPtr = table.locations.data();
+  }
 }
 
 void LLVMFunction::createHarness(
@@ -75,6 +75,29 @@ class LLVMFunction : public backend::Function {
            std::pair<const uint32_t**,const uint32_t**>> tensorIndexPtrs;
   std::map<pe::PathExpression, pe::PathIndex>            pathIndices;
 
+  /// Iteration orders, by the name of the set they order
+  std::map<std::string, const int**>       iterationOrderPtrs;
+  std::map<std::string, std::vector<int>>  iterationOrders;
+
+  /// Sparse tiles, by the name of the edge set they partition
+  struct SparseTiles {
+    int tileSize;
+    const int** tileStartsPtr;
+    const int** tileEdgesPtr;
+    std::vector<int> tileStarts;
+    std::vector<int> tileEdges;
+  };
+  std::map<std::string, SparseTiles> sparseTiles;
+
+  /// Location tables, by the name of their locations array
+  struct LocationTable {
+    std::string edgeSet;
+    std::string rowptr;
+    const int** locationsPtr;
+    std::vector<int> locations;
+  };
+  std::map<std::string, LocationTable> locationTables;
+
  private:
   std::shared_ptr<llvm::EngineBuilder>   engineBuilder;
   std::shared_ptr<llvm::ExecutionEngine> executionEngine;
@@ -0,0 +1,537 @@
+#include "block_cg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "allocator.h"
+#include "amg.h"
+#include "thread_pool.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+// The diagonal blocks of a blocked CSR structure, and the transposes of the
+// blocks of the triangle that is read, which stand in for the blocks of the
+// other triangle
+struct SymmetricStructure {
+  vector<int> rowPtr;
+  vector<int> colIdx;
+
+  // Whether the blocks above the diagonal are read instead of those below it
+  bool upperTriangular;
+
+  // The location of block (i,i) of every row i, or -1
+  vector<int> diagonals;
+
+  // For every row i, the columns j and locations of the blocks (j,i) of the
+  // triangle that is read, whose transposes are the blocks (i,j) of the other
+  vector<int> transposeRowPtr;
+  vector<int> transposeCols;
+  vector<int> transposeLocs;
+
+  void build(int numRows, const int* rowPtr, const int* colIdx,
+             bool upperTriangular) {
+    const int nnz = rowPtr[numRows];
+    this->rowPtr.assign(rowPtr, rowPtr+numRows+1);
+    this->colIdx.assign(colIdx, colIdx+nnz);
+    this->upperTriangular = upperTriangular;
+    diagonals.assign(numRows, -1);
+    transposeRowPtr.assign(numRows+1, 0);
+    for (int i=0; i < numRows; ++i) {
+      for (int ij=rowPtr[i]; ij < rowPtr[i+1]; ++ij) {
+        const int j = colIdx[ij];
+        if (j == i) {
+          diagonals[i] = ij;
+        }
+        else if ((j > i) == upperTriangular) {
+          ++transposeRowPtr[j+1];
+        }
+      }
+    }
+    for (int i=0; i < numRows; ++i) {
+      transposeRowPtr[i+1] += transposeRowPtr[i];
+    }
+    transposeCols.resize(transposeRowPtr[numRows]);
+    transposeLocs.resize(transposeRowPtr[numRows]);
+    vector<int> next(transposeRowPtr.begin(), transposeRowPtr.end()-1);
+    for (int i=0; i < numRows; ++i) {
+      for (int ij=rowPtr[i]; ij < rowPtr[i+1]; ++ij) {
+        const int j = colIdx[ij];
+        if (j != i && (j > i) == upperTriangular) {
+          transposeCols[next[j]] = i;
+          transposeLocs[next[j]] = ij;
+          ++next[j];
+        }
+      }
+    }
+  }
+
+  bool matches(int numRows, const int* rowPtr, const int* colIdx,
+               bool upperTriangular) const {
+    return this->upperTriangular == upperTriangular &&
+           this->rowPtr.size() == (size_t)numRows+1 &&
+           equal(rowPtr, rowPtr+numRows+1, this->rowPtr.begin()) &&
+           equal(colIdx, colIdx+rowPtr[numRows], this->colIdx.begin());
+  }
+};
+
+// Guards the maps of the caches below. The entries of an index are used
+// while its index mutex is held, so that solves with different indices run
+// concurrently while solves with the same index, which rebuild its entries,
+// run one after another.
+std::mutex& getCachesMutex() {
+  static std::mutex cachesMutex;
+  return cachesMutex;
+}
+
+map<pair<const int*,const int*>, unique_ptr<std::mutex>>& getIndexMutexes() {
+  static map<pair<const int*,const int*>, unique_ptr<std::mutex>> mutexes;
+  return mutexes;
+}
+
+std::mutex& getIndexMutex(const int* rowPtr, const int* colIdx) {
+  lock_guard<std::mutex> lock(getCachesMutex());
+  unique_ptr<std::mutex>& mutex = getIndexMutexes()[{rowPtr, colIdx}];
+  if (mutex == nullptr) {
+    mutex.reset(new std::mutex());
+  }
+  return *mutex;
+}
+
+map<pair<const int*,const int*>, SymmetricStructure>&
+getSymmetricStructures() {
+  static map<pair<const int*,const int*>, SymmetricStructure> structures;
+  return structures;
+}
+
+// Builds the symmetric structure of every blocked CSR index once, like
+// csr2eigenCached. The caller holds the index mutex.
+const SymmetricStructure& getSymmetricStructure(int numRows,
+                                                const int* rowPtr,
+                                                const int* colIdx,
+                                                bool upperTriangular) {
+  SymmetricStructure* cached;
+  {
+    lock_guard<std::mutex> lock(getCachesMutex());
+    cached = &getSymmetricStructures()[{rowPtr, colIdx}];
+  }
+  SymmetricStructure& structure = *cached;
+  if (!structure.matches(numRows, rowPtr, colIdx, upperTriangular)) {
+    structure.build(numRows, rowPtr, colIdx, upperTriangular);
+  }
+  return structure;
+}
+
+template <typename Float>
+map<pair<const int*,const int*>, unique_ptr<AlgebraicMultigrid<Float>>>&
+getAlgebraicMultigrids() {
+  static map<pair<const int*,const int*>,
+             unique_ptr<AlgebraicMultigrid<Float>>> hierarchies;
+  return hierarchies;
+}
+
+// Builds the algebraic multigrid hierarchy of every blocked CSR index once,
+// and recomputes its values on every solve. The caller holds the index mutex.
+template <typename Float>
+AlgebraicMultigrid<Float>& getAlgebraicMultigrid(int numRows, int blockSize,
+                                                 const int* rowPtr,
+                                                 const int* colIdx,
+                                                 const Float* vals) {
+  unique_ptr<AlgebraicMultigrid<Float>>* cached;
+  {
+    lock_guard<std::mutex> lock(getCachesMutex());
+    cached = &getAlgebraicMultigrids<Float>()[{rowPtr, colIdx}];
+  }
+  unique_ptr<AlgebraicMultigrid<Float>>& hierarchy = *cached;
+  if (hierarchy == nullptr ||
+      !hierarchy->matches(numRows, blockSize, rowPtr, colIdx)) {
+    hierarchy.reset(new AlgebraicMultigrid<Float>(numRows, blockSize, rowPtr,
+                                                  colIdx, vals));
+  }
+  else {
+    hierarchy->setup(vals);
+  }
+  return *hierarchy;
+}
+
+// An array of the solver, that is first touched by the threads that own its
+// rows
+template <typename Float>
+struct Array {
+  Float* data;
+  explicit Array(size_t size) : data((Float*)allocate(size*sizeof(Float))) {}
+  ~Array() {deallocate(data);}
+};
+
+// Conjugate gradients on blocks of size B, or of blockSize if B is 0
+template <typename Float, int B>
+SolverStatistics cg(int numRows, int blockSize,
+                    const int* rowPtr, const int* colIdx,
+                    const Float* vals, const Float* b, Float* x,
+                    bool upperTriangular, const SolverSettings& settings) {
+  const int bs = (B > 0) ? B : blockSize;
+  const int bs2 = bs*bs;
+  lock_guard<std::mutex> indexLock(getIndexMutex(rowPtr, colIdx));
+  const SymmetricStructure& structure =
+      getSymmetricStructure(numRows, rowPtr, colIdx, upperTriangular);
+  const int* diagonals = structure.diagonals.data();
+  const int* transposeRowPtr = structure.transposeRowPtr.data();
+  const int* transposeCols = structure.transposeCols.data();
+  const int* transposeLocs = structure.transposeLocs.data();
+  const bool multigrid = settings.preconditioner ==
+                         Preconditioner::AlgebraicMultigrid;
+  const bool preconditioned = settings.preconditioner !=
+                              Preconditioner::Identity && !multigrid;
+  AlgebraicMultigrid<Float>* amg =
+      multigrid ? &getAlgebraicMultigrid(numRows, bs, rowPtr, colIdx, vals)
+                : nullptr;
+
+  // Split the rows into chunks of about the same number of blocks, without
+  // starting threads for small systems
+  const int nnz = rowPtr[numRows];
+  const long long minBlocksPerThread = (1 << 14) / bs2 + 1;
+  ThreadPool& pool = getThreadPool(settings.numThreads);
+  const unsigned numChunks = max(1ll, min((long long)pool.getNumThreads(),
+                                          nnz / minBlocksPerThread));
+  vector<int> chunkStarts(numChunks+1);
+  for (unsigned c=0; c <= numChunks; ++c) {
+    chunkStarts[c] = lower_bound(rowPtr, rowPtr+numRows+1,
+                                 (long long)nnz * c / numChunks) - rowPtr;
+  }
+  chunkStarts[numChunks] = numRows;
+
+  // Runs f(chunk, begin, end) on the rows of every chunk, and sums the
+  // numSums values that every chunk writes to sums[chunk*numSums]
+  vector<double> chunkSums(numChunks*3);
+  auto forRows = [&](int numSums, double* sums,
+                     const function<void(double*,int,int)>& f) {
+    fill(chunkSums.begin(), chunkSums.end(), 0.0);
+    pool.parallelFor(numChunks, numChunks,
+                     [&](unsigned chunk, size_t, size_t) {
+      f(&chunkSums[chunk*3], chunkStarts[chunk], chunkStarts[chunk+1]);
+    });
+    for (int k=0; k < numSums; ++k) {
+      sums[k] = 0.0;
+      for (unsigned chunk=0; chunk < numChunks; ++chunk) {
+        sums[k] += chunkSums[chunk*3+k];
+      }
+    }
+  };
+
+  // Entry (bi,bj) of the diagonal block a, read from the triangle of A that
+  // is read
+  auto diagonalEntry = [&](const Float* a, int bi, int bj) {
+    return ((bj <= bi) != upperTriangular || bi == bj) ? a[bi*bs+bj]
+                                                        : a[bj*bs+bi];
+  };
+
+  // yi = row i of A times v, reading only one triangle of A
+  auto multiplyRow = [&](int i, const Float* v, Float* yi) {
+    for (int bi=0; bi < bs; ++bi) {
+      yi[bi] = 0;
+    }
+    for (int ij=rowPtr[i]; ij < rowPtr[i+1]; ++ij) {
+      const int j = colIdx[ij];
+      const Float* vj = &v[j*bs];
+      const Float* a = &vals[ij*bs2];
+      if (j == i) {
+        for (int bi=0; bi < bs; ++bi) {
+          for (int bj=0; bj < bs; ++bj) {
+            yi[bi] += diagonalEntry(a, bi, bj) * vj[bj];
+          }
+        }
+      }
+      else if ((j > i) == upperTriangular) {
+        for (int bi=0; bi < bs; ++bi) {
+          for (int bj=0; bj < bs; ++bj) {
+            yi[bi] += a[bi*bs+bj] * vj[bj];
+          }
+        }
+      }
+    }
+    for (int ji=transposeRowPtr[i]; ji < transposeRowPtr[i+1]; ++ji) {
+      const Float* vj = &v[transposeCols[ji]*bs];
+      const Float* a = &vals[transposeLocs[ji]*bs2];
+      for (int bi=0; bi < bs; ++bi) {
+        for (int bj=0; bj < bs; ++bj) {
+          yi[bi] += a[bj*bs+bi] * vj[bj];
+        }
+      }
+    }
+  };
+
+  // The inverse of the diagonal, or of the diagonal blocks, of every row
+  Array<Float> M(preconditioned ? (size_t)numRows*bs2 : 0);
+  // block is a scratch buffer of bs2 entries, allocated once per chunk
+  auto computePreconditioner = [&](int i, vector<double>& block) {
+    fill(block.begin(), block.end(), 0.0);
+    if (diagonals[i] != -1) {
+      const Float* a = &vals[diagonals[i]*bs2];
+      for (int bi=0; bi < bs; ++bi) {
+        for (int bj=0; bj < bs; ++bj) {
+          block[bi*bs+bj] = diagonalEntry(a, bi, bj);
+        }
+      }
+    }
+    Float* Mi = &M.data[i*bs2];
+    fill(Mi, Mi+bs2, (Float)0);
+    if (settings.preconditioner == Preconditioner::BlockJacobi &&
+        invertMatrix(bs, block)) {
+      copy(block.begin(), block.end(), Mi);
+      return;
+    }
+    // Zeros on the diagonal, and singular blocks, are left out
+    for (int bi=0; bi < bs; ++bi) {
+      const double d = (settings.preconditioner == Preconditioner::Jacobi)
+                       ? block[bi*bs+bi] : 0.0;
+      Mi[bi*bs+bi] = (d != 0.0) ? 1.0/d : 1.0;
+    }
+  };
+  auto precondition = [&](int i, const Float* ri, Float* zi) {
+    if (multigrid) {
+      // Applied to the whole vector after the pass (see applyMultigrid)
+      return;
+    }
+    if (!preconditioned) {
+      copy(ri, ri+bs, zi);
+      return;
+    }
+    const Float* Mi = &M.data[i*bs2];
+    for (int bi=0; bi < bs; ++bi) {
+      zi[bi] = 0;
+      for (int bj=0; bj < bs; ++bj) {
+        zi[bi] += Mi[bi*bs+bj] * ri[bj];
+      }
+    }
+  };
+
+  const size_t n = (size_t)numRows*bs;
+  Array<Float> r(n);
+  Array<Float> z(n);
+  Array<Float> p(n);
+  Array<Float> q(n);
+
+  // z = M*r with a multigrid V-cycle, which also sets p = z if initial, and
+  // returns r.z
+  double sums[3];
+  auto applyMultigrid = [&](bool initial) {
+    amg->vcycle(r.data, z.data);
+    forRows(1, sums, [&](double* chunkSums, int begin, int end) {
+      for (size_t k=(size_t)begin*bs; k < (size_t)end*bs; ++k) {
+        chunkSums[0] += (double)r.data[k] * z.data[k];
+        if (initial) {
+          p.data[k] = z.data[k];
+        }
+      }
+    });
+    return sums[0];
+  };
+
+  // r = b - A*x, z = M*r, p = z
+  const bool warmStart = settings.warmStart;
+  forRows(3, sums, [&](double* chunkSums, int begin, int end) {
+    vector<double> block(preconditioned ? bs2 : 0);
+    for (int i=begin; i < end; ++i) {
+      if (preconditioned) {
+        computePreconditioner(i, block);
+      }
+      Float* ri = &r.data[i*bs];
+      Float* zi = &z.data[i*bs];
+      const Float* bi = &b[i*bs];
+      if (warmStart) {
+        multiplyRow(i, x, ri);
+        for (int k=0; k < bs; ++k) {
+          ri[k] = bi[k] - ri[k];
+        }
+      }
+      else {
+        fill(&x[i*bs], &x[i*bs]+bs, (Float)0);
+        copy(bi, bi+bs, ri);
+      }
+      precondition(i, ri, zi);
+      copy(zi, zi+bs, &p.data[i*bs]);
+      for (int k=0; k < bs; ++k) {
+        chunkSums[0] += (double)bi[k] * bi[k];
+        chunkSums[1] += (double)ri[k] * ri[k];
+        chunkSums[2] += (double)ri[k] * zi[k];
+      }
+    }
+  });
+  const double bb = sums[0];
+  double rr = sums[1];
+  double rz = sums[2];
+
+  SolverStatistics statistics = {0, 0.0, true};
+  if (bb == 0.0) {
+    fill(x, x+n, (Float)0);
+    return statistics;
+  }
+  const double tolerance = (settings.tolerance > 0.0)
+                           ? settings.tolerance
+                           : numeric_limits<Float>::epsilon();
+  const double threshold = max(tolerance*tolerance*bb,
+                               (double)numeric_limits<Float>::min());
+  if (multigrid) {
+    rz = applyMultigrid(true);
+  }
+
+  while (rr >= threshold && statistics.iterations < settings.maxIterations) {
+    // q = A*p
+    forRows(1, sums, [&](double* chunkSums, int begin, int end) {
+      for (int i=begin; i < end; ++i) {
+        Float* qi = &q.data[i*bs];
+        const Float* pi = &p.data[i*bs];
+        multiplyRow(i, p.data, qi);
+        for (int k=0; k < bs; ++k) {
+          chunkSums[0] += (double)pi[k] * qi[k];
+        }
+      }
+    });
+    const Float alpha = rz / sums[0];
+
+    // x += alpha*p, r -= alpha*q, z = M*r
+    forRows(2, sums, [&](double* chunkSums, int begin, int end) {
+      for (int i=begin; i < end; ++i) {
+        Float* xi = &x[i*bs];
+        Float* ri = &r.data[i*bs];
+        Float* zi = &z.data[i*bs];
+        const Float* pi = &p.data[i*bs];
+        const Float* qi = &q.data[i*bs];
+        for (int k=0; k < bs; ++k) {
+          xi[k] += alpha * pi[k];
+          ri[k] -= alpha * qi[k];
+        }
+        precondition(i, ri, zi);
+        for (int k=0; k < bs; ++k) {
+          chunkSums[0] += (double)ri[k] * ri[k];
+          chunkSums[1] += (double)ri[k] * zi[k];
+        }
+      }
+    });
+    rr = sums[0];
+    ++statistics.iterations;
+    if (rr < threshold) {
+      break;
+    }
+    const double rzNew = multigrid ? applyMultigrid(false) : sums[1];
+    const Float beta = rzNew / rz;
+    rz = rzNew;
+
+    // p = z + beta*p
+    forRows(0, sums, [&](double*, int begin, int end) {
+      for (size_t k=(size_t)begin*bs; k < (size_t)end*bs; ++k) {
+        p.data[k] = z.data[k] + beta * p.data[k];
+      }
+    });
+  }
+
+  statistics.error = sqrt(rr / bb);
+  statistics.converged = statistics.error <= tolerance;
+  return statistics;
+}
+
+}
+
+bool invertMatrix(int size, vector<double>& a) {
+  vector<double> inv(size*size, 0.0);
+  double maxAbs = 0.0;
+  for (int i=0; i < size; ++i) {
+    inv[i*size+i] = 1.0;
+    for (int j=0; j < size; ++j) {
+      maxAbs = max(maxAbs, fabs(a[i*size+j]));
+    }
+  }
+  const double epsilon = size * numeric_limits<double>::epsilon() * maxAbs;
+  for (int k=0; k < size; ++k) {
+    int pivot = k;
+    for (int i=k+1; i < size; ++i) {
+      if (fabs(a[i*size+k]) > fabs(a[pivot*size+k])) {
+        pivot = i;
+      }
+    }
+    if (fabs(a[pivot*size+k]) <= epsilon) {
+      return false;
+    }
+    for (int j=0; j < size; ++j) {
+      swap(a[k*size+j], a[pivot*size+j]);
+      swap(inv[k*size+j], inv[pivot*size+j]);
+    }
+    const double scale = 1.0 / a[k*size+k];
+    for (int j=0; j < size; ++j) {
+      a[k*size+j] *= scale;
+      inv[k*size+j] *= scale;
+    }
+    for (int i=0; i < size; ++i) {
+      const double factor = a[i*size+k];
+      if (i == k || factor == 0.0) {
+        continue;
+      }
+      for (int j=0; j < size; ++j) {
+        a[i*size+j] -= factor * a[k*size+j];
+        inv[i*size+j] -= factor * inv[k*size+j];
+      }
+    }
+  }
+  a = inv;
+  return true;
+}
+
+template <typename Float>
+SolverStatistics blockCG(int numRows, int blockSize,
+                         const int* rowPtr, const int* colIdx,
+                         const Float* vals, const Float* b, Float* x,
+                         bool upperTriangular,
+                         const SolverSettings& settings) {
+  iassert(settings.preconditioner == Preconditioner::Identity ||
+          settings.preconditioner == Preconditioner::Jacobi ||
+          settings.preconditioner == Preconditioner::BlockJacobi ||
+          (settings.preconditioner == Preconditioner::AlgebraicMultigrid &&
+           !upperTriangular))
+      << "Unsupported preconditioner";
+  switch (blockSize) {
+    case 1:
+      return cg<Float,1>(numRows, 1, rowPtr, colIdx, vals, b, x,
+                           upperTriangular, settings);
+    case 2:
+      return cg<Float,2>(numRows, 2, rowPtr, colIdx, vals, b, x,
+                           upperTriangular, settings);
+    case 3:
+      return cg<Float,3>(numRows, 3, rowPtr, colIdx, vals, b, x,
+                           upperTriangular, settings);
+    case 4:
+      return cg<Float,4>(numRows, 4, rowPtr, colIdx, vals, b, x,
+                           upperTriangular, settings);
+    default:
+      return cg<Float,0>(numRows, blockSize, rowPtr, colIdx, vals, b, x,
+                         upperTriangular, settings);
+  }
+}
+
+template SolverStatistics blockCG<float>(int, int, const int*, const int*,
+                                         const float*, const float*, float*,
+                                         bool, const SolverSettings&);
+template SolverStatistics blockCG<double>(int, int, const int*, const int*,
+                                          const double*, const double*,
+                                          double*, bool,
+                                          const SolverSettings&);
+
+void freeBlockCGCaches(const int* rowPtr, const int* colIdx) {
+  // Indices are freed between runs, when no solve holds their mutex
+  lock_guard<std::mutex> lock(getCachesMutex());
+  getIndexMutexes().erase({rowPtr, colIdx});
+  getSymmetricStructures().erase({rowPtr, colIdx});
+  getAlgebraicMultigrids<float>().erase({rowPtr, colIdx});
+  getAlgebraicMultigrids<double>().erase({rowPtr, colIdx});
+}
+
+}
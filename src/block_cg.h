@@ -0,0 +1,45 @@
+#ifndef SIMIT_BLOCK_CG_H
+#define SIMIT_BLOCK_CG_H
+
+#include <vector>
+
+#include "solvers.h"
+
+namespace simit {
+
+/// Solves A*x = b with preconditioned conjugate gradients directly on a
+/// blocked CSR matrix of numRows x numRows blocks of size blockSize x
+/// blockSize, without converting it to another format. Like the Eigen solvers
+/// only the lower triangle of A is read, so that the matrix is symmetric even
+/// if its assembly is not exactly, or only the upper triangle if
+/// upperTriangular is true, which solves matrices with upper triangular
+/// indices (see TensorIndex::isUpperTriangular).
+///
+/// The sparse matrix-vector products use kernels specialized for blocks of
+/// size 1 to 4, and each iteration updates the vectors and computes their dot
+/// products in three fused passes over the rows, that are split over the
+/// threads of a thread pool. Block rows are partitioned by number of blocks,
+/// and every thread touches the solver vectors of its rows first, so that a
+/// matrix reordered for locality and placed on NUMA nodes by partition is
+/// mostly read by threads on the same node.
+///
+/// The method of the settings is ignored, and the preconditioner must be
+/// Identity, Jacobi, BlockJacobi or AlgebraicMultigrid, whose V-cycles run on
+/// the calling thread and which reads the lower triangle.
+template <typename Float>
+SolverStatistics blockCG(int numRows, int blockSize,
+                         const int* rowPtr, const int* colIdx,
+                         const Float* vals, const Float* b, Float* x,
+                         bool upperTriangular, const SolverSettings& settings);
+
+/// Frees the structures and multigrid hierarchies that blockCG cached for the
+/// blocked CSR index with the given row and column arrays.
+void freeBlockCGCaches(const int* rowPtr, const int* colIdx);
+
+/// Inverts the size x size row-major matrix a in place by Gauss-Jordan
+/// elimination with partial pivoting, or returns false and leaves a undefined
+/// if it is singular.
+bool invertMatrix(int size, std::vector<double>& a);
+
+}
+#endif
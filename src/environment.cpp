@@ -1,5 +1,6 @@
 #include "environment.h"
 
+#include "graph.h"
 #include "var.h"
 #include "ir.h"
 #include "path_expressions.h"
@@ -32,10 +33,25 @@ struct Environment::Content {
   set<Var>                       temporarySet;
 
   vector<TensorIndex>            tensorIndices;
-  map<pe::PathExpression,size_t> locationOfTensorIndex;
+  map<pair<pe::PathExpression,bool>,size_t> locationOfTensorIndex;
   map<StencilLayout,size_t>      locationOfTensorIndexStencil;
 
   map<Var,TensorIndex>           tensorIndexOfVar;
+
+  vector<pair<Var,Var>>          iterationOrders;
+  map<Var,size_t>                locationOfIterationOrder;
+
+  vector<SparseTiling>           sparseTilings;
+  map<Var,size_t>                locationOfSparseTiling;
+
+  vector<LocationTable>          locationTables;
+  map<pair<Var,Var>,size_t>      locationOfLocationTable;
+
+  vector<ProfileRegion>          profileRegions;
+  Var                            profiler;
+
+  vector<FieldGroup>             fieldGroups;
+  vector<string>                 mapsReadingReducedFields;
 };
 
 Environment::Environment() : content(new Content) {
@@ -123,20 +139,24 @@ const std::vector<TensorIndex>& Environment::getTensorIndices() const {
   return content->tensorIndices;
 }
 
-bool Environment::hasTensorIndex(const pe::PathExpression& pexpr) const {
+bool Environment::hasTensorIndex(const pe::PathExpression& pexpr,
+                                 bool upperTriangular) const {
   if (!pexpr.defined()) {
     return false;
   }
-  return util::contains(content->locationOfTensorIndex, pexpr);
+  return util::contains(content->locationOfTensorIndex,
+                        make_pair(pexpr, upperTriangular));
 }
 
 const TensorIndex&
-Environment::getTensorIndex(const pe::PathExpression& pexpr) const {
+Environment::getTensorIndex(const pe::PathExpression& pexpr,
+                            bool upperTriangular) const {
   iassert(pexpr.defined())
       << "Tensors in the environment have defined path expressions";
-  iassert(util::contains(content->locationOfTensorIndex, pexpr))
+  iassert(hasTensorIndex(pexpr, upperTriangular))
       << "Could not find " << pexpr << " in environment";
-  return content->tensorIndices[content->locationOfTensorIndex.at(pexpr)];
+  return content->tensorIndices[
+      content->locationOfTensorIndex.at({pexpr, upperTriangular})];
 }
 
 bool Environment::hasTensorIndex(const Var& var) const {
@@ -160,6 +180,70 @@ const TensorIndex& Environment::getTensorIndex(
       content->locationOfTensorIndexStencil.at(stencil)];
 }
 
+const std::vector<std::pair<Var,Var>>&
+Environment::getIterationOrders() const {
+  return content->iterationOrders;
+}
+
+bool Environment::hasIterationOrder(const Var& set) const {
+  return util::contains(content->locationOfIterationOrder, set);
+}
+
+const Var& Environment::getIterationOrder(const Var& set) const {
+  iassert(hasIterationOrder(set)) << set << " has no iteration order";
+  return content->iterationOrders[
+      content->locationOfIterationOrder.at(set)].second;
+}
+
+const std::vector<SparseTiling>& Environment::getSparseTilings() const {
+  return content->sparseTilings;
+}
+
+bool Environment::hasSparseTiling(const Var& edgeSet) const {
+  return util::contains(content->locationOfSparseTiling, edgeSet);
+}
+
+const SparseTiling& Environment::getSparseTiling(const Var& edgeSet) const {
+  iassert(hasSparseTiling(edgeSet)) << edgeSet << " has no sparse tiling";
+  return content->sparseTilings[content->locationOfSparseTiling.at(edgeSet)];
+}
+
+const std::vector<LocationTable>& Environment::getLocationTables() const {
+  return content->locationTables;
+}
+
+bool Environment::hasLocationTable(const Var& edgeSet,
+                                   const TensorIndex& index) const {
+  return util::contains(content->locationOfLocationTable,
+                        make_pair(edgeSet, index.getRowptrArray()));
+}
+
+const LocationTable& Environment::getLocationTable(
+    const Var& edgeSet, const TensorIndex& index) const {
+  iassert(hasLocationTable(edgeSet, index))
+      << edgeSet << " has no location table in " << index;
+  return content->locationTables[content->locationOfLocationTable.at(
+      {edgeSet, index.getRowptrArray()})];
+}
+
+const std::vector<ProfileRegion>& Environment::getProfileRegions() const {
+  return content->profileRegions;
+}
+
+const Var& Environment::getProfiler() const {
+  iassert(content->profileRegions.size() > 0) << "function is not profiled";
+  return content->profiler;
+}
+
+const std::vector<FieldGroup>& Environment::getFieldGroups() const {
+  return content->fieldGroups;
+}
+
+const std::vector<std::string>&
+Environment::getMapsReadingReducedFields() const {
+  return content->mapsReadingReducedFields;
+}
+
 void Environment::addConstant(const Var& var, const Expr& initializer) {
   content->constants.push_back({var, initializer});
 }
@@ -193,7 +277,7 @@ Var Environment::createTemporary(const Type &type, const std::string name) {
 }
 
 void Environment::addTensorIndex(const pe::PathExpression& pexpr,
-                                 const Var& var) {
+                                 const Var& var, bool upperTriangular) {
   iassert(pexpr.defined())
       << "Attempting to add tensor " << util::quote(var)
       << " index with an undefined path expression";
@@ -204,13 +288,14 @@ void Environment::addTensorIndex(const pe::PathExpression& pexpr,
 
   // Lazily create a new index if no index with the given pexpr exist.
   // TODO: Maybe rename indices as they get used by multiple tensors
-  if (!hasTensorIndex(pexpr)) {
-    TensorIndex ti(name+"_index", pexpr);
+  if (!hasTensorIndex(pexpr, upperTriangular)) {
+    TensorIndex ti(name+"_index", pexpr, upperTriangular);
     content->tensorIndices.push_back(ti);
     size_t loc = content->tensorIndices.size() - 1;
-    content->locationOfTensorIndex.insert({pexpr, loc});
+    content->locationOfTensorIndex.insert({{pexpr, upperTriangular}, loc});
   }
-  content->tensorIndexOfVar.insert({var, getTensorIndex(pexpr)});
+  content->tensorIndexOfVar.insert({var,
+                                    getTensorIndex(pexpr, upperTriangular)});
 }
 
 void Environment::addTensorIndex(const StencilLayout& stencil, const Var& var) {
@@ -230,6 +315,72 @@ void Environment::addTensorIndex(const StencilLayout& stencil, const Var& var) {
   content->tensorIndexOfVar.insert({var, getTensorIndex(stencil)});
 }
 
+const Var& Environment::addIterationOrder(const Var& set) {
+  iassert(set.getType().isSet());
+  if (!hasIterationOrder(set)) {
+    Var order(set.getName() + ".order", ArrayType::make(ScalarType::Int));
+    content->iterationOrders.push_back({set, order});
+    content->locationOfIterationOrder.insert(
+        {set, content->iterationOrders.size()-1});
+  }
+  return getIterationOrder(set);
+}
+
+const SparseTiling& Environment::addSparseTiling(const Var& edgeSet,
+                                                 int tileSize) {
+  iassert(edgeSet.getType().isUnstructuredSet());
+  iassert(tileSize > 0);
+  if (!hasSparseTiling(edgeSet)) {
+    SparseTiling tiling;
+    tiling.edgeSet = edgeSet;
+    tiling.tileSize = tileSize;
+    tiling.tileStarts = Var(edgeSet.getName() + ".tile_starts",
+                            ArrayType::make(ScalarType::Int));
+    tiling.tileEdges = Var(edgeSet.getName() + ".tile_edges",
+                           ArrayType::make(ScalarType::Int));
+    content->sparseTilings.push_back(tiling);
+    content->locationOfSparseTiling.insert(
+        {edgeSet, content->sparseTilings.size()-1});
+  }
+  iassert(getSparseTiling(edgeSet).tileSize == tileSize);
+  return getSparseTiling(edgeSet);
+}
+
+const LocationTable& Environment::addLocationTable(const Var& edgeSet,
+                                                   const TensorIndex& index) {
+  iassert(edgeSet.getType().isUnstructuredSet());
+  iassert(index.getKind() == TensorIndex::PExpr);
+  if (!hasLocationTable(edgeSet, index)) {
+    LocationTable table;
+    table.edgeSet = edgeSet;
+    table.rowptr = index.getRowptrArray();
+    table.colidx = index.getColidxArray();
+    table.locations = Var(edgeSet.getName() + "." + index.getName() + "_locs",
+                          ArrayType::make(ScalarType::Int));
+    content->locationTables.push_back(table);
+    content->locationOfLocationTable.insert(
+        {{edgeSet, table.rowptr}, content->locationTables.size()-1});
+  }
+  return getLocationTable(edgeSet, index);
+}
+
+int Environment::addProfileRegion(const ProfileRegion& region) {
+  if (content->profileRegions.size() == 0) {
+    content->profiler = Var(INTERNAL_PREFIX("profiler"), Type(Type::Opaque));
+  }
+  content->profileRegions.push_back(region);
+  return content->profileRegions.size() - 1;
+}
+
+void Environment::setFieldGroups(const std::vector<FieldGroup>& fieldGroups) {
+  content->fieldGroups = fieldGroups;
+}
+
+void Environment::setMapsReadingReducedFields(
+    const std::vector<std::string>& maps) {
+  content->mapsReadingReducedFields = maps;
+}
+
 std::ostream& operator<<(std::ostream& os, const Environment& env) {
   bool somethingPrinted = false;
 
@@ -290,6 +441,51 @@ std::ostream& operator<<(std::ostream& os, const Environment& env) {
     }
     somethingPrinted = true;
   }
+  // Iteration orders
+  if (env.getIterationOrders().size() > 0) {
+    if (somethingPrinted) {
+      os << std::endl;
+    }
+    auto iterationOrders = env.getIterationOrders();
+    os << iterationOrders.begin()->second << " : order of "
+       << iterationOrders.begin()->first << ";";
+    for (auto& order : util::excludeFirst(iterationOrders)) {
+      os << std::endl << order.second << " : order of " << order.first << ";";
+    }
+    somethingPrinted = true;
+  }
+  // Sparse tilings
+  for (auto& tiling : env.getSparseTilings()) {
+    if (somethingPrinted) {
+      os << std::endl;
+    }
+    os << tiling.tileStarts << ", " << tiling.tileEdges << " : tiles of "
+       << tiling.edgeSet << ";";
+    somethingPrinted = true;
+  }
+  // Location tables
+  for (auto& table : env.getLocationTables()) {
+    if (somethingPrinted) {
+      os << std::endl;
+    }
+    os << table.locations << " : locations of " << table.edgeSet << " in "
+       << table.rowptr << ", " << table.colidx << ";";
+    somethingPrinted = true;
+  }
+  // Profile regions
+  for (size_t i = 0; i < env.getProfileRegions().size(); ++i) {
+    if (somethingPrinted) {
+      os << std::endl;
+    }
+    const ProfileRegion& region = env.getProfileRegions()[i];
+    os << env.getProfiler() << "[" << i << "] : " << region.kind << " "
+       << region.name;
+    if (region.parent >= 0) {
+      os << " in " << env.getProfiler() << "[" << region.parent << "]";
+    }
+    os << ";";
+    somethingPrinted = true;
+  }
   UNUSED(somethingPrinted);
 
   return os;
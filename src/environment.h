@@ -6,9 +6,11 @@
 #include <ostream>
 #include "var.h"
 #include "macros.h"
+#include "profiler.h"
 #include "util/name_generator.h"
 
 namespace simit {
+struct FieldGroup;
 namespace pe {
 class PathExpression;
 }
@@ -36,6 +38,31 @@ private:
 
 std::ostream& operator<<(std::ostream&, const VarMapping&);
 
+/// A SparseTiling partitions an edge set's vertices into tiles of consecutive
+/// locations, and its edges into the tiles of their smallest endpoint (see
+/// Settings::sparseTileSize). The edges of tile t are stored at locations
+/// tileStarts[t]:tileStarts[t+1] of tileEdges.
+struct SparseTiling {
+  Var edgeSet;
+  int tileSize;
+  Var tileStarts;
+  Var tileEdges;
+};
+
+/// A LocationTable stores where the blocks that maps over an edge set assemble
+/// go in the values of matrices with the CSR index rowptr/colidx. The location
+/// of the block of endpoints i and j of edge e is stored at
+/// locations[(e*cardinality + i)*cardinality + j], or -1 if the index does not
+/// store the block (e.g. the lower triangle of an upper triangular index).
+/// Tables are computed when a function is initialized, so that assembly does
+/// not search the index for every block it writes.
+struct LocationTable {
+  Var edgeSet;
+  Var rowptr;
+  Var colidx;
+  Var locations;
+};
+
 /// An Environment keeps track of global constants, externs and temporaries.
 /// It also keeps track of the data arrays and shared index arrays of tensors
 /// that have path expressions. (The latter are added to the environment as the
@@ -84,11 +111,15 @@ public:
   /// Retrieve all the tensor indices in the environment.
   const std::vector<TensorIndex>& getTensorIndices() const;
 
-  /// True of the environment has a tensor index for the given path expression.
-  bool hasTensorIndex(const pe::PathExpression& pexpr) const;
+  /// True of the environment has a tensor index for the given path expression,
+  /// that is upper triangular or not.
+  bool hasTensorIndex(const pe::PathExpression& pexpr,
+                      bool upperTriangular=false) const;
 
-  /// Retrieve the tensor index of the given path expression.
-  const TensorIndex& getTensorIndex(const pe::PathExpression& pexpr) const;
+  /// Retrieve the tensor index of the given path expression, that is upper
+  /// triangular or not.
+  const TensorIndex& getTensorIndex(const pe::PathExpression& pexpr,
+                                    bool upperTriangular=false) const;
 
   /// True of the environment contains the tensor index of var.
   bool hasTensorIndex(const Var& var) const;
@@ -102,6 +133,54 @@ public:
   /// Retrieve the tensor index of the given stencil.
   const TensorIndex& getTensorIndex(const StencilLayout& stencil) const;
 
+  /// Retrieve the iteration orders in the environment, as pairs of a set and
+  /// the array that lists the locations of its elements in the order that
+  /// loops over the set visit them (see Settings::iterationOrder).
+  const std::vector<std::pair<Var,Var>>& getIterationOrders() const;
+
+  /// True if the environment has an iteration order for the given set.
+  bool hasIterationOrder(const Var& set) const;
+
+  /// Retrieve the iteration order array of the given set.
+  const Var& getIterationOrder(const Var& set) const;
+
+  /// Retrieve the sparse tilings in the environment.
+  const std::vector<SparseTiling>& getSparseTilings() const;
+
+  /// True if the environment has a sparse tiling of the given edge set.
+  bool hasSparseTiling(const Var& edgeSet) const;
+
+  /// Retrieve the sparse tiling of the given edge set.
+  const SparseTiling& getSparseTiling(const Var& edgeSet) const;
+
+  /// Retrieve the location tables in the environment.
+  const std::vector<LocationTable>& getLocationTables() const;
+
+  /// True if the environment has a location table of the given edge set in
+  /// the given tensor index.
+  bool hasLocationTable(const Var& edgeSet, const TensorIndex& index) const;
+
+  /// Retrieve the location table of the given edge set in the given tensor
+  /// index.
+  const LocationTable& getLocationTable(const Var& edgeSet,
+                                        const TensorIndex& index) const;
+
+  /// Retrieve the regions of a function compiled with profiling, or an empty
+  /// vector if the function is not profiled.
+  const std::vector<ProfileRegion>& getProfileRegions() const;
+
+  /// Retrieve the opaque pointer to the Profiler that the regions of a
+  /// profiled function record their executions in.
+  const Var& getProfiler() const;
+
+  /// Retrieve the groups of interleaved fields (see Settings::fieldGroups)
+  /// that the function was compiled for.
+  const std::vector<FieldGroup>& getFieldGroups() const;
+
+  /// Retrieve the maps that read vertex fields written after a reduce map
+  /// (see getMapsReadingReducedFields in ir_queries.h).
+  const std::vector<std::string>& getMapsReadingReducedFields() const;
+
   /// Insert a constant into the environment.
   void addConstant(const Var& var, const Expr& initializer);
 
@@ -122,13 +201,40 @@ public:
                       const std::string name=INTERNAL_PREFIX("tmp"));
 
   /// Add a tensor index described by the given path expression to the
-  /// environment, and associate it with var.
-  void addTensorIndex(const pe::PathExpression& pexpr, const Var& var);
+  /// environment, that is upper triangular or not, and associate it with var.
+  void addTensorIndex(const pe::PathExpression& pexpr, const Var& var,
+                      bool upperTriangular=false);
 
   /// Add a tensor index described by the given stencil to the environment,
   /// and associate it with var.
   void addTensorIndex(const StencilLayout& stencil, const Var& var);
 
+  /// Add an iteration order array for the given set to the environment, and
+  /// return it. Returns the existing array if the set already has one.
+  const Var& addIterationOrder(const Var& set);
+
+  /// Add a sparse tiling of the given edge set, with tiles of tileSize
+  /// vertices, to the environment and return it. Returns the existing tiling
+  /// if the edge set already has one.
+  const SparseTiling& addSparseTiling(const Var& edgeSet, int tileSize);
+
+  /// Add a location table of the given edge set in the given tensor index,
+  /// which must have a path expression, to the environment and return it.
+  /// Returns the existing table if the environment already has one.
+  const LocationTable& addLocationTable(const Var& edgeSet,
+                                        const TensorIndex& index);
+
+  /// Add a profiled region to the environment and return its index, which
+  /// the region's profileBegin and profileEnd intrinsics take.
+  int addProfileRegion(const ProfileRegion& region);
+
+  /// Set the groups of interleaved fields that the function is compiled for.
+  /// Sets bound to the function are converted to exactly these groups.
+  void setFieldGroups(const std::vector<FieldGroup>& fieldGroups);
+
+  /// Set the maps that read vertex fields written after a reduce map.
+  void setMapsReadingReducedFields(const std::vector<std::string>& maps);
+
 private:
   struct Content;
   Content* content;
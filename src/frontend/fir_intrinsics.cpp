@@ -60,13 +60,6 @@ addScalarIntrinsic(std::vector<fir::FuncDecl::Ptr>* intrinsics,
 std::vector<fir::FuncDecl::Ptr> createIntrinsics() {
   std::vector<fir::FuncDecl::Ptr> intrinsics;
 
-  const auto threeDim = std::make_shared<RangeIndexSet>();
-  threeDim->range = 3;
-
-  const auto threeByThreeTensorType = std::make_shared<NDTensorType>();
-  threeByThreeTensorType->blockType = makeTensorType(ScalarType::Type::FLOAT);
-  threeByThreeTensorType->indexSets = {threeDim, threeDim};
-
   auto genericParam = std::make_shared<fir::GenericParam>();
   genericParam->type = fir::GenericParam::Type::UNKNOWN;
   genericParam->name = "N";
@@ -134,20 +127,18 @@ std::vector<fir::FuncDecl::Ptr> createIntrinsics() {
   addScalarIntrinsic(&intrinsics,
                      ir::intrinsics::clock().getName(),
                      {}, {ScalarType::Type::FLOAT});
-  addScalarIntrinsic(&intrinsics,
-                     ir::intrinsics::storeTime().getName(),
-                     {ScalarType::Type::INT, ScalarType::Type::FLOAT},
-                     {ScalarType::Type::FLOAT});
 
   // Local vectors/matrices
   addIntrinsic(&intrinsics,
                ir::intrinsics::det().getName(),
-               {threeByThreeTensorType},
-               {makeTensorType(ScalarType::Type::FLOAT)});
+               {nMatrixType},
+               {makeTensorType(ScalarType::Type::FLOAT)},
+               {genericParam});
   addIntrinsic(&intrinsics,
                ir::intrinsics::inv().getName(),
-               {threeByThreeTensorType},
-               {threeByThreeTensorType});
+               {nMatrixType},
+               {nMatrixType},
+               {genericParam});
 
   // System vectors/matrices
   addIntrinsic(&intrinsics,
@@ -5,6 +5,7 @@
 #include "domain.h"
 #include "error.h"
 #include "ir.h"
+#include "util/collections.h"
 
 namespace simit {
 namespace fir {
@@ -616,9 +617,18 @@ void IREmitter::visit(TransposeExpr::Ptr expr) {
 }
 
 void IREmitter::visit(CallExpr::Ptr expr) {
-  const ir::Func func = ctx->getFunction(expr->func->ident);
+  ir::Func func = ctx->getFunction(expr->func->ident);
   const std::vector<ir::Var> results = func.getResults();
 
+  // Specializations of generic intrinsics (e.g. det of a 2x2 matrix) have the 
+  // specialized result types, but call the intrinsic itself.
+  const std::string name = func.getName().substr(0, func.getName().find("@"));
+  if (name != func.getName() && 
+      util::contains(ir::intrinsics::byNames(), name) &&
+      ir::intrinsics::byNames().at(name).getKind() == ir::Func::Intrinsic) {
+    func = ir::intrinsics::byNames().at(name);
+  }
+
   std::vector<ir::Expr> arguments;
   for (auto argument : expr->args) {
     iassert((bool)argument);
@@ -1,8 +1,11 @@
 #include "function.h"
 
 #include "backend/backend_function.h"
+#include "environment.h"
 #include "types_convert.h"
 #include "graph.h"  // TODO: should not need this include
+#include "init.h"
+#include "reorder.h"
 
 using namespace std;
 
@@ -87,6 +90,28 @@ void Function::bind(const std::string& name, simit::Set *set) {
   }
 #endif
 
+  // Store grouped fields in the layout the function was compiled for
+  ir::Type setType = impl->getBindableType(name);
+  const std::string &elementType =
+      setType.toSet()->elementType.toElement()->name;
+  set->setFieldLayouts(elementType, impl->getEnvironment().getFieldGroups());
+
+  // Reorder the storage of bound vertex sets for locality. All the edge sets
+  // with endpoints in the vertex set are reordered with it.
+  if (kReorder && set->getKind() == Set::Unstructured &&
+      set->getCardinality() == 0 && !set->getEdgeSets().empty() &&
+      !set->isPermuted()) {
+    bool unstructured = true;
+    for (const Set *edgeSet : set->getEdgeSets()) {
+      unstructured &= edgeSet->getKind() == Set::Unstructured;
+    }
+    if (unstructured) {
+      reorderStorage(*set, set->hasSpatialField()
+                               ? ReorderingHeuristic::Hilbert
+                               : ReorderingHeuristic::RCM);
+    }
+  }
+
   impl->bind(name, set);
 }
 
@@ -152,6 +177,15 @@ void Function::printMachine(std::ostream& os) const {
   }
 }
 
+std::shared_ptr<Profiler> Function::getProfiler() const {
+  return defined() ? impl->getProfiler() : nullptr;
+}
+
+std::vector<std::string> Function::getMapsReadingReducedFields() const {
+  return defined() ? impl->getEnvironment().getMapsReadingReducedFields()
+                   : std::vector<std::string>();
+}
+
 std::ostream& operator<<(std::ostream& os, const Function& f) {
   f.print(os);
   return os;
@@ -3,11 +3,13 @@
 
 #include <string>
 #include <functional>
+#include <vector>
 #include "tensor.h"
 
 namespace simit {
 class Set;
 class TensorData;
+class Profiler;
 
 namespace backend {
 class Function;
@@ -87,6 +89,16 @@ public:
   /// Print the function to the stream as machine assembly code.
   void printMachine(std::ostream& os) const;
 
+  /// The profiler that records where the function spends its time, if it was
+  /// compiled with Program::compileWithTimers, or nullptr otherwise.
+  std::shared_ptr<Profiler> getProfiler() const;
+
+  /// The maps that read vertex fields written after a reduce map, in the same
+  /// run or in an earlier iteration of a loop. A function with such maps
+  /// cannot run on a domain decomposition (see HaloExchange), because they
+  /// read ghost values before the halo is exchanged.
+  std::vector<std::string> getMapsReadingReducedFields() const;
+
 private:
   std::shared_ptr<backend::Function> impl;
 
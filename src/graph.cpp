@@ -1,34 +1,268 @@
 #include "graph.h"
 
 #include <iostream>
+#include <thread>
 #include "graph_indices.h"
+#include "index_files.h"
+#include "init.h"
+#include "util/collections.h"
 
 using namespace std;
 
 namespace simit {
 
+std::ostream &operator<<(std::ostream &os, FieldLayout layout) {
+  switch (layout) {
+    case FieldLayout::SoA:
+      return os << "SoA";
+    case FieldLayout::AoS:
+      return os << "AoS";
+    case FieldLayout::AoSoA:
+      return os << "AoSoA";
+  }
+  return os;
+}
+
 Set::~Set() {
+  for (auto &group : fieldGroups) {
+    deallocate(group[0]->data);
+  }
   for (auto f: fields) {
     delete f;
   }
-  free(endpoints);
-  free(latticePoints);
-  free(latticeLinks);
+  deallocate(endpoints);
 
   delete this->neighbors;
+
+  // Unregister from the endpoint sets, and make edge sets that outlive this
+  // set forget it
+  for (const Set *endpointSet : endpointSets) {
+    if (endpointSet != nullptr) {
+      vector<Set*> &siblings = endpointSet->edgeSets;
+      siblings.erase(std::remove(siblings.begin(), siblings.end(), this),
+                     siblings.end());
+    }
+  }
+  for (Set *edgeSet : edgeSets) {
+    replace(edgeSet->endpointSets.begin(), edgeSet->endpointSets.end(),
+            (const Set*)this, (const Set*)nullptr);
+  }
 }
 
 void Set::increaseCapacity() {
+  resizeFields(getIncreasedCapacity());
+}
+
+void Set::resizeFields(int newCapacity) {
+  iassert(newCapacity % capacityIncrement == 0)
+      << "capacity must be a multiple of the tile widths of AoSoA fields";
+
+  auto resize = [&](void *data, size_t typeSize) {
+    data = reallocate(data, capacity * typeSize, newCapacity * typeSize);
+    memset((char*)(data)+capacity*typeSize, 0,
+           (newCapacity-capacity)*typeSize);
+    return data;
+  };
+
   for (auto f : fields) {
-    int typeSize = f->sizeOfType;
-    f->data = realloc(f->data, (capacity+capacityIncrement) * typeSize);
-    memset((char*)(f->data)+capacity*typeSize, 0, capacityIncrement*typeSize);
+    if (f->layout == FieldLayout::SoA) {
+      f->data = resize(f->data, f->sizeOfType);
+    }
+  }
+  for (auto &group : fieldGroups) {
+    size_t typeSize = group[0]->groupStride *
+                      componentSize(group[0]->type->getComponentType());
+    void *data = resize(group[0]->data, typeSize);
+    for (auto f : group) {
+      f->data = data;
+    }
+  }
 
+  for (auto f : fields) {
     for (FieldRefBase *fieldRef : f->fieldReferences) {
       fieldRef->data = f->data;
     }
   }
-  capacity += capacityIncrement;
+  capacity = newCapacity;
+}
+
+ElementRef Set::add(const std::vector<ElementRef>& edgeEndpoints) {
+  uassert(edgeEndpoints.size() == (size_t)getCardinality())
+      << "Wrong number of endpoints.";
+  uassert(kind != LatticeLink)
+      << "Element addition disallowed for lattice link edge sets";
+  if (numElements > capacity-1) {
+    increaseEdgeCapacity();
+  }
+  for (size_t i=0; i < edgeEndpoints.size(); ++i) {
+    uassert(endpointSets[i]->getSize() > edgeEndpoints[i].ident)
+        << "Invalid member of set in addEdge";
+    endpoints[numElements*getCardinality()+i] =
+        endpointSets[i]->getLocation(edgeEndpoints[i]);
+  }
+
+  if (numElements > capacity-1) {
+    increaseCapacity();
+  }
+  if (isPermuted()) {
+    locations.push_back(numElements);
+    identifiers.push_back(numElements);
+  }
+  return ElementRef(numElements++);
+}
+
+void Set::addElements(int num) {
+  iassert(getCardinality() == 0 || kind == LatticeLink)
+      << "edges must be added with their endpoints";
+  if (numElements+num > capacity-1) {
+    int newCapacity = ((numElements+num) / capacityIncrement + 1) *
+                      capacityIncrement;
+    resizeFields(newCapacity);
+  }
+  numElements += num;
+}
+
+void Set::setFieldLayout(const std::vector<std::string> &names,
+                         FieldLayout layout, int tileWidth) {
+  uassert(layout != FieldLayout::AoSoA ||
+          (tileWidth > 0 && capacityIncrement % tileWidth == 0))
+      << "AoSoA tile width must divide " << capacityIncrement;
+
+  vector<FieldData*> group;
+  for (const string &name : names) {
+    uassert(fieldNames.find(name) != fieldNames.end())
+        << "Invalid field name in setFieldLayout(): " << name;
+    FieldData *field = fields[fieldNames.at(name)];
+    uassert(group.empty() || field->type->getComponentType() ==
+                             group.front()->type->getComponentType())
+        << "Interleaved fields must have the same component type";
+    group.push_back(field);
+  }
+
+  // Move fields in existing groups back to separate arrays
+  for (size_t i=fieldGroups.size(); i > 0; --i) {
+    for (FieldData *field : fieldGroups[i-1]) {
+      if (util::contains(group, field)) {
+        splitFieldGroup(i-1);
+        break;
+      }
+    }
+  }
+
+  if (layout == FieldLayout::SoA || group.empty()) {
+    return;
+  }
+
+  size_t stride = 0;
+  for (FieldData *field : group) {
+    stride += field->type->getSize();
+  }
+  size_t compSize = componentSize(group[0]->type->getComponentType());
+  void *data = allocate(capacity * stride * compSize, true);
+
+  size_t offset = 0;
+  for (FieldData *field : group) {
+    void *fieldData = field->data;
+    field->data = data;
+    field->layout = layout;
+    field->groupStride = stride;
+    field->groupOffset = offset;
+    field->tileWidth = (layout == FieldLayout::AoSoA) ? tileWidth : 1;
+    offset += field->type->getSize();
+
+    size_t blockSize = field->type->getSize();
+    for (int elem=0; elem < numElements; ++elem) {
+      for (size_t i=0; i < blockSize; ++i) {
+        memcpy((char*)data + field->getComponentIndex(elem,i)*compSize,
+               (char*)fieldData + (elem*blockSize + i)*compSize, compSize);
+      }
+    }
+    deallocate(fieldData);
+
+    for (FieldRefBase *fieldRef : field->fieldReferences) {
+      fieldRef->data = field->data;
+    }
+  }
+  fieldGroups.push_back(group);
+}
+
+bool Set::hasFieldLayout(const std::vector<std::string> &names,
+                         FieldLayout layout, int tileWidth) const {
+  vector<FieldData*> fieldsWithNames;
+  for (const string &name : names) {
+    uassert(fieldNames.find(name) != fieldNames.end())
+        << "Invalid field name in hasFieldLayout(): " << name;
+    FieldData *field = fields[fieldNames.at(name)];
+    if (field->layout != layout ||
+        (layout == FieldLayout::AoSoA && field->tileWidth != tileWidth)) {
+      return false;
+    }
+    fieldsWithNames.push_back(field);
+  }
+  return layout == FieldLayout::SoA ||
+         util::contains(fieldGroups, fieldsWithNames);
+}
+
+void Set::setFieldLayouts(const std::string &elementType,
+                          const std::vector<FieldGroup> &groups) {
+  vector<const FieldGroup*> elementGroups;
+  for (const FieldGroup &group : groups) {
+    if (group.elementType == elementType && group.layout != FieldLayout::SoA) {
+      elementGroups.push_back(&group);
+    }
+  }
+
+  // Split the interleaved fields that are not grouped as given
+  for (size_t i=fieldGroups.size(); i > 0; --i) {
+    vector<string> names;
+    for (FieldData *field : fieldGroups[i-1]) {
+      names.push_back(field->name);
+    }
+    bool given = false;
+    for (const FieldGroup *group : elementGroups) {
+      given |= group->fields == names &&
+               hasFieldLayout(names, group->layout, group->tileWidth);
+    }
+    if (!given) {
+      splitFieldGroup(i-1);
+    }
+  }
+
+  for (const FieldGroup *group : elementGroups) {
+    if (!hasFieldLayout(group->fields, group->layout, group->tileWidth)) {
+      setFieldLayout(group->fields, group->layout, group->tileWidth);
+    }
+  }
+}
+
+void Set::splitFieldGroup(size_t groupIndex) {
+  iassert(groupIndex < fieldGroups.size());
+  vector<FieldData*> group = fieldGroups[groupIndex];
+  fieldGroups.erase(fieldGroups.begin() + groupIndex);
+
+  void *data = group[0]->data;
+  size_t compSize = componentSize(group[0]->type->getComponentType());
+  for (FieldData *field : group) {
+    size_t blockSize = field->type->getSize();
+    void *fieldData = allocate(capacity * field->sizeOfType, true);
+    for (int elem=0; elem < numElements; ++elem) {
+      for (size_t i=0; i < blockSize; ++i) {
+        memcpy((char*)fieldData + (elem*blockSize + i)*compSize,
+               (char*)data + field->getComponentIndex(elem,i)*compSize,
+               compSize);
+      }
+    }
+    field->data = fieldData;
+    field->layout = FieldLayout::SoA;
+    field->groupStride = blockSize;
+    field->groupOffset = 0;
+    field->tileWidth = 1;
+
+    for (FieldRefBase *fieldRef : field->fieldReferences) {
+      fieldRef->data = field->data;
+    }
+  }
+  deallocate(data);
 }
 
 const internal::NeighborIndex *Set::getNeighborIndex() const {
@@ -37,11 +271,128 @@ const internal::NeighborIndex *Set::getNeighborIndex() const {
 
   if (getCardinality() >= 2 && neighbors == nullptr) {
     // Cast to non-const since adding a neighbor index does not change the 
-    this->neighbors = new internal::NeighborIndex(*this);
+    if (kIndexCacheDir.empty()) {
+      this->neighbors = new internal::NeighborIndex(*this);
+    }
+    else {
+      string filename = internal::getIndexFilename(
+          kIndexCacheDir, internal::IndexFileKind::NeighborIndex,
+          internal::fingerprint(*this));
+      this->neighbors = internal::NeighborIndex::load(*this, filename);
+      if (this->neighbors == nullptr) {
+        this->neighbors = new internal::NeighborIndex(*this);
+        this->neighbors->save(*this, filename);
+      }
+    }
   }
   return this->neighbors;
 }
 
+void Set::clearNeighborIndex() {
+  delete this->neighbors;
+  this->neighbors = nullptr;
+}
+
+
+void Set::relocateElements(const std::vector<int>& ordering,
+                           bool keepIdentifiers) {
+  uassert(kind == Unstructured)
+      << "Lattice link sets are ordered by their lattice coordinates and "
+      << "cannot be relocated";
+  uassert(ordering.size() == (size_t)numElements)
+      << "Ordering must be the same size as the set: " << ordering.size()
+      << " != " << numElements;
+  for (const Set *edgeSet : edgeSets) {
+    uassert(edgeSet->kind == Unstructured)
+        << "The points of a lattice cannot be relocated";
+  }
+
+  // Move field data, one thread per field for large sets
+  auto moveField = [this, &ordering](FieldData *field) {
+    size_t compSize = componentSize(field->type->getComponentType());
+    size_t blockSize = field->type->getSize();
+    char *data = static_cast<char*>(field->data);
+    if (field->layout == FieldLayout::SoA) {
+      size_t elemSize = blockSize * compSize;
+      vector<char> oldData(data, data + numElements*elemSize);
+      for (int loc=0; loc < numElements; ++loc) {
+        memcpy(data + ordering[loc]*elemSize, &oldData[loc*elemSize],
+               elemSize);
+      }
+      return;
+    }
+    vector<char> oldData(numElements * blockSize * compSize);
+    for (int loc=0; loc < numElements; ++loc) {
+      for (size_t i=0; i < blockSize; ++i) {
+        memcpy(&oldData[(loc*blockSize + i)*compSize],
+               data + field->getComponentIndex(loc, i)*compSize, compSize);
+      }
+    }
+    for (int loc=0; loc < numElements; ++loc) {
+      for (size_t i=0; i < blockSize; ++i) {
+        memcpy(data + field->getComponentIndex(ordering[loc], i)*compSize,
+               &oldData[(loc*blockSize + i)*compSize], compSize);
+      }
+    }
+  };
+  if (fields.size() > 1 && numElements >= (1 << 14)) {
+    vector<thread> threads;
+    for (FieldData *field : fields) {
+      threads.push_back(thread(moveField, field));
+    }
+    for (thread &t : threads) {
+      t.join();
+    }
+  }
+  else {
+    for (FieldData *field : fields) {
+      moveField(field);
+    }
+  }
+
+  // Move endpoints
+  if (getCardinality() > 0) {
+    const int cardinality = getCardinality();
+    vector<int> oldEndpoints(endpoints, endpoints + numElements*cardinality);
+    for (int loc=0; loc < numElements; ++loc) {
+      copy(&oldEndpoints[loc*cardinality], &oldEndpoints[(loc+1)*cardinality],
+           endpoints + ordering[loc]*cardinality);
+    }
+    clearNeighborIndex();
+  }
+
+  // Update the endpoints of edge sets that connect this set
+  for (Set *edgeSet : edgeSets) {
+    const int cardinality = edgeSet->getCardinality();
+    for (int j=0; j < cardinality; ++j) {
+      if (edgeSet->endpointSets[j] != this) continue;
+      for (int e=0; e < edgeSet->numElements; ++e) {
+        int &endpoint = edgeSet->endpoints[e*cardinality + j];
+        endpoint = ordering[endpoint];
+      }
+    }
+    edgeSet->clearNeighborIndex();
+  }
+
+  // Record the permutation
+  if (!keepIdentifiers) {
+    locations.clear();
+    identifiers.clear();
+    return;
+  }
+  if (!isPermuted()) {
+    locations.resize(numElements);
+    identifiers.resize(numElements);
+    for (int i=0; i < numElements; ++i) {
+      locations[i] = i;
+      identifiers[i] = i;
+    }
+  }
+  for (int i=0; i < numElements; ++i) {
+    locations[i] = ordering[locations[i]];
+    identifiers[locations[i]] = i;
+  }
+}
 
 // Graph generators
 void createElements(Set *elements, unsigned num) {
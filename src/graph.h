@@ -1,6 +1,7 @@
 #ifndef SIMIT_GRAPH_H
 #define SIMIT_GRAPH_H
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 #include <vector>
@@ -11,6 +12,7 @@
 
 #include "tensor_type.h"
 #include "error.h"
+#include "allocator.h"
 #include "types.h"
 #include "util/variadic.h"
 #include "interfaces/comparable.h"
@@ -86,6 +88,39 @@ private:
 };
 
 
+/// The ways the fields of the elements in a set can be laid out in memory.
+enum class FieldLayout {
+  /// Each field is stored in a separate array (struct of arrays).
+  SoA,
+
+  /// A group of fields is stored in one array, where the fields of each element
+  /// are stored next to each other (array of structs).
+  AoS,
+
+  /// A group of fields is stored in one array of tiles of consecutive elements,
+  /// where each field component of the elements in a tile is stored next to
+  /// each other (array of structs of arrays).
+  AoSoA
+};
+
+std::ostream &operator<<(std::ostream &os, FieldLayout layout);
+
+/// A group of fields, of the elements of the given element type, that are
+/// stored interleaved with the given layout. The fields must have the same
+/// component type.
+struct FieldGroup {
+  std::string elementType;
+  std::vector<std::string> fields;
+  FieldLayout layout;
+  int tileWidth;  // elements per tile in the AoSoA layout
+
+  FieldGroup(const std::string &elementType,
+             const std::vector<std::string> &fields,
+             FieldLayout layout, int tileWidth=8)
+      : elementType(elementType), fields(fields), layout(layout),
+        tileWidth(tileWidth) {}
+};
+
 // Base class for Sets
 // Sets are used to represent collections within C++,
 // and can be passed as bound inputs to Simit programs.
@@ -102,7 +137,9 @@ public:
     static_assert(util::areSame<Set, Sets...>{},
         "Set constructor takes an optional name followed by zero or more Sets");
     this->endpointSets = {&sets...};
-    this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
+    this->endpoints    =
+        (int*)allocate(capacity * getCardinality() * sizeof(int), true);
+    registerWithEndpointSets();
   }
 
   template <typename ...Sets>
@@ -112,6 +149,9 @@ public:
   Set(const Sets& ...sets) : Set("", sets...) {}
 
   /// LATTICE LINK constructors
+  /// Lattice link sets are implicit: the endpoints of a link, as well as the
+  /// lattice points and links at given coordinates, are computed from the
+  /// lattice dimensions on demand, so no endpoint array is stored.
   Set(const char *name, Set& points, std::vector<int> dims)
       : Set(std::string(name), LatticeLink) {
     uassert(dims.size() > 0)
@@ -121,48 +161,22 @@ public:
         << "Lattice link Set constructor must be passed an empty underlying "
         << "point set, which it will then proceed to initialize.";
     this->endpointSets = {&points, &points};
-    this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
     this->dimensions = dims;
     this->latticePointSet = &points;
+    registerWithEndpointSets();
 
     int totalPoints = 1;
-    std::vector<int> cumDims;
     for (int d : dims) {
       totalPoints *= d;
-      cumDims.push_back(totalPoints);
     }
 
-    this->latticePoints = (ElementRef*)calloc(sizeof(ElementRef), totalPoints);
-    this->latticeLinks = (ElementRef*)calloc(
-        sizeof(ElementRef), totalPoints*dims.size());
-    
-    std::vector<int> indices(dims.size());
-    // Pad underlying set to have N_1 x N_2 x ... N_d elements, storing their
-    // references in latticePoints.
-    int count = 0;
-    util::variableLoop(dims.begin(), dims.end(),
-                       indices.begin(), indices.end(), [&](){
-        this->latticePoints[count] = points.add();
-        count++;
-      });
-
-    // Generate N_1 x N_2 x ... N_d x d elements for this set, linking the
-    // underlying points in a lattice structure, and store their references in
-    // the canonically ordered latticeLinks.
-    count = 0;
-    dims.push_back(dims.size()); // dimension index runs outermost
-    indices.push_back(0);
-    util::variableLoop(dims.begin(), dims.end(),
-                       indices.begin(), indices.end(), [&](){
-        int off = cumDims[indices.back()];
-        // Assumes periodic boundary conditions
-        this->latticeLinks[count] = add(
-            this->latticePoints[count%totalPoints],
-            this->latticePoints[(count+off)%totalPoints]);
-        count++;
-      });
+    // Pad underlying set to have N_1 x N_2 x ... N_d elements, and this set to
+    // have N_1 x N_2 x ... N_d x d links. Lattice point i is element i of the
+    // underlying set, and the link in direction dir from point i is element
+    // i*d + dir of this set.
+    points.addElements(totalPoints);
+    addElements(totalPoints * dims.size());
   }
-
   Set(Set& points, std::vector<int> dims) : Set("", points, dims) {}
 
   ~Set();
@@ -201,7 +215,7 @@ public:
     uassert(index >= 0 && index < totalSize)
         << "Coordinates must not be negative and must fall within the "
         << "lattice dimensions";
-    return latticePoints[index];
+    return ElementRef(index);
   }
 
   /// Return the lattice link at the given location and direction.
@@ -224,7 +238,7 @@ public:
     uassert(index >= 0 && index < totalSize)
         << "Coordinates must not be negative and must fall within the "
         << "lattice dimensions";
-    return latticeLinks[index];
+    return ElementRef(index);
   }
 
   inline std::vector<int> getLatticePointCoords(ElementRef elt) const {
@@ -250,7 +264,7 @@ public:
     FieldData::TensorType *type =
         new FieldData::TensorType(typeOf<T>(), {dimensions...});
     FieldData *fieldData = new FieldData(name, type, this);
-    fieldData->data = calloc(capacity, fieldData->sizeOfType);
+    fieldData->data = allocate(capacity * fieldData->sizeOfType, true);
     fields.push_back(fieldData);
     fieldNames[name] = fields.size()-1;
     return FieldRef<T, dimensions...>(fieldData);
@@ -263,11 +277,42 @@ public:
     FieldData *fieldData = fields[fieldNames[name]];
     uassert(fieldData->type->getOrder() == 1) << "Spatial Data must be order 1. \
       Currently order:" << fieldData->type->getOrder();
-    uassert(fieldData->type->getDimension(0) == 3) << "Spatial Data must be 3D \
-      in order 1. Currently: " << fieldData->type->getDimension(0); 
+    uassert(fieldData->type->getDimension(0) == 2 ||
+            fieldData->type->getDimension(0) == 3) << "Spatial Data must be 2D \
+      or 3D. Currently: " << fieldData->type->getDimension(0); 
+    uassert(fieldData->type->getComponentType() == ComponentType::Float ||
+            fieldData->type->getComponentType() == ComponentType::Double)
+        << "Spatial Data must have float or double components";
     spatialFieldName = name;
   }
 
+  /// Store the given fields interleaved with the given layout, where
+  /// `tileWidth` is the number of elements per tile in the AoSoA layout. The
+  /// fields must have the same component type. Fields that were previously
+  /// interleaved with other fields are first moved back to separate arrays, as
+  /// are the other fields in their group. Field references remain valid.
+  void setFieldLayout(const std::vector<std::string> &fieldNames,
+                      FieldLayout layout, int tileWidth=8);
+
+  /// Returns true if the given fields are stored with the given layout and, if
+  /// they are interleaved, form a field group in the given order.
+  bool hasFieldLayout(const std::vector<std::string> &fieldNames,
+                      FieldLayout layout, int tileWidth=8) const;
+
+  /// Store the fields of this set's element type exactly with the given field
+  /// groups: the groups of the element type that the fields do not already
+  /// form are interleaved, and all other fields are moved back to separate
+  /// arrays. Groups of other element types are ignored.
+  void setFieldLayouts(const std::string &elementType,
+                       const std::vector<FieldGroup> &groups);
+
+  /// Returns the layout of the given field.
+  FieldLayout getFieldLayout(const std::string &fieldName) const {
+    uassert(fieldNames.find(fieldName) != fieldNames.end())
+        << "Invalid field name in getFieldLayout()";
+    return fields[fieldNames.at(fieldName)]->layout;
+  }
+
   /// Get a Field corresponding to the string fieldName
   template <typename T, int... dimensions>
   FieldRef<T, dimensions...> getField(std::string fieldName) {
@@ -287,6 +332,8 @@ public:
   ElementRef add(Endpoints... endpoints) {
     iassert(sizeof...(endpoints) == getCardinality()) <<"Wrong number of \
       endpoints.";
+    uassert(kind != LatticeLink)
+        << "Element addition disallowed for lattice link edge sets";
     if (numElements > capacity-1) {
       increaseEdgeCapacity();
     }
@@ -295,46 +342,49 @@ public:
     if (numElements > capacity-1) {
       increaseCapacity();
     }
+    if (isPermuted()) {
+      locations.push_back(numElements);
+      identifiers.push_back(numElements);
+    }
     return ElementRef(numElements++);
   }
 
+  /// Add a new edge with as many endpoints as the cardinality of the set,
+  /// returning its handle. Used when the cardinality is only known at runtime.
+  ElementRef add(const std::vector<ElementRef>& edgeEndpoints);
+
   /// Remove an element from the Set
   void remove(ElementRef element) {
     uassert(kind != LatticeLink)
         << "Element removal disallowed for lattice link edge sets";
+    const int location = getLocation(element);
+    const int lastLocation = numElements-1;
     for (auto f : fields){
-      switch (f->type->getComponentType()) {
-        case ComponentType::Float: {
-          float* data = (float*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Double: {
-          double* data = (double*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Int: {
-          int* data = (int*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Boolean: {
-          bool* data = (bool*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::FloatComplex: {
-          float_complex* data = (float_complex*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::DoubleComplex: {
-          double_complex* data = (double_complex*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
+      size_t compSize = componentSize(f->type->getComponentType());
+      for (size_t i=0; i < f->type->getSize(); ++i) {
+        memcpy((char*)f->data + f->getComponentIndex(location,i)*compSize,
+               (char*)f->data + f->getComponentIndex(lastLocation,i)*compSize,
+               compSize);
+      }
+    }
+    if (kind == Unstructured) {
+      memcpy(endpoints + location*getCardinality(),
+             endpoints + lastLocation*getCardinality(),
+             getCardinality()*sizeof(int));
+    }
+    if (isPermuted()) {
+      // The element stored last moves to the location of the removed element,
+      // and the element with the last identifier takes the removed identifier.
+      int moved = identifiers[lastLocation];
+      locations[moved] = location;
+      identifiers[location] = moved;
+      int last = numElements-1;
+      if (element.ident != last) {
+        locations[element.ident] = locations[last];
+        identifiers[locations[last]] = element.ident;
       }
+      locations.pop_back();
+      identifiers.pop_back();
     }
     numElements--;
   }
@@ -419,7 +469,35 @@ public:
 
   /// Get an endpoint of an edge
   ElementRef getEndpoint(ElementRef edge, int endpointNum) const {
-    return ElementRef(endpoints[edge.ident*getCardinality() + endpointNum]);
+    if (kind == LatticeLink) {
+      return getLatticeLinkEndpoint(edge, endpointNum);
+    }
+    int endpoint = getEndpointLocation(getLocation(edge), endpointNum);
+    return endpointSets[endpointNum]->getElementAt(endpoint);
+  }
+
+  /// Get the storage location of an endpoint of the edge stored at the given
+  /// location. Indices used by generated code are built from locations.
+  int getEndpointLocation(int edgeLocation, int endpointNum) const {
+    if (kind == LatticeLink) {
+      return getLatticeLinkEndpoint(ElementRef(edgeLocation), endpointNum).ident;
+    }
+    return endpoints[edgeLocation*getCardinality() + endpointNum];
+  }
+
+  /// Returns true if the elements of the set are not stored in the order of
+  /// their identifiers, because the set was reordered by relocateElements.
+  bool isPermuted() const { return !locations.empty(); }
+
+  /// Get the location of an element in the set's field and endpoint storage,
+  /// which is its identifier unless the set is permuted.
+  int getLocation(ElementRef element) const {
+    return isPermuted() ? locations[element.ident] : element.ident;
+  }
+
+  /// Get the element stored at the given location.
+  ElementRef getElementAt(int location) const {
+    return ElementRef(isPermuted() ? identifiers[location] : location);
   }
   
   class Endpoints {
@@ -433,7 +511,7 @@ public:
 
       Iterator(const Set *set, ElementRef elem, int endpointN=0)
           : curElem(elem), retElem(-1), endpointNum(endpointN), set(set) {
-        if (set->getCardinality() > 0) {
+        if (endpointNum < set->getCardinality()) {
           retElem = set->getEndpoint(curElem, endpointNum);
         }
       }
@@ -447,10 +525,10 @@ public:
       Iterator& operator++() {
         const int cardinality = set->getCardinality();
         endpointNum++;
-        if (endpointNum > set->getCardinality()-1)
+        if (endpointNum > cardinality-1)
           retElem.ident = -1;   // return invalid element
         else
-          retElem.ident = set->endpoints[curElem.ident*cardinality+endpointNum];
+          retElem = set->getEndpoint(curElem, endpointNum);
         return *this;
       }
 
@@ -460,7 +538,7 @@ public:
         if (endpointNum > cardinality-1)
           retElem.ident = -1;   // return invalid element
         else
-          retElem.ident = set->endpoints[curElem.ident*cardinality+endpointNum];
+          retElem = set->getEndpoint(curElem, endpointNum);
         return *this;
       }
 
@@ -517,7 +595,9 @@ public:
   }
 
   /// Get an array containing, for each edge in a set, the elements it connects.
+  /// Lattice link sets have no endpoints array and return nullptr.
   int *getEndpointsData() { return endpoints; }
+  const int *getEndpointsData() const { return endpoints; }
 
   /// If this set is an edge set with cardinality 2 then return an index that
   /// for each element in the first connected set contains it's neighbors in the
@@ -563,15 +643,41 @@ public:
     };
 
     FieldData(const std::string &name, const TensorType *type, Set *set)
-        : name(name), type(type), set(set), data(nullptr) {
+        : name(name), type(type), set(set), data(nullptr),
+          layout(FieldLayout::SoA), groupStride(type->getSize()),
+          groupOffset(0), tileWidth(1) {
       sizeOfType = componentSize(type->getComponentType()) * type->getSize();
     }
 
     ~FieldData() {
-      free(data);
+      // Interleaved field data is owned by the set
+      if (layout == FieldLayout::SoA) {
+        deallocate(data);
+      }
       delete type;
     }
 
+    /// The location, in components from the start of the data, of the given
+    /// component of the given element's tensor.
+    inline size_t getComponentIndex(int elem, size_t component) const {
+      switch (layout) {
+        case FieldLayout::SoA:
+        case FieldLayout::AoS:
+          return elem*groupStride + groupOffset + component;
+        case FieldLayout::AoSoA:
+          return (elem/tileWidth)*tileWidth*groupStride +
+                 (groupOffset + component)*tileWidth + elem%tileWidth;
+      }
+      unreachable;
+      return 0;
+    }
+
+    /// The distance, in components, between consecutive components of an
+    /// element's tensor.
+    inline size_t getComponentStride() const {
+      return (layout == FieldLayout::AoSoA) ? tileWidth : 1;
+    }
+
     std::string name;
     
     const TensorType *type;
@@ -580,9 +686,18 @@ public:
     // The Set this field is a member of. Used for printing, etc.
     Set *set;
 
-    /// Buffer for the field data
+    /// Buffer for the field data. Interleaved fields share the buffer of their
+    /// field group.
     void* data;
 
+    /// The layout of the field data. Interleaved fields store groupStride
+    /// components per element, of which this field's tensor starts at
+    /// groupOffset.
+    FieldLayout layout;
+    size_t groupStride;
+    size_t groupOffset;
+    int tileWidth;
+
     /// Field references so that we can update their data pointers if we realloc
     /// field data. Avoids two loads on field get/set.
     std::set<FieldRefBase*> fieldReferences;
@@ -598,14 +713,34 @@ public:
   inline int getFieldIndex(std::string name) { return fieldNames[name]; } inline 
     std::vector<FieldData*>& getFields() { return fields; } inline std::string 
     getSpatialFieldName() const { return spatialFieldName; }
+  inline int getFieldIndex(const std::string& name) const {
+    iassert(fieldNames.find(name) != fieldNames.end());
+    return fieldNames.at(name);
+  }
+  inline const std::vector<FieldData*>& getFields() const { return fields; }
   inline bool hasSpatialField() const { return !spatialFieldName.empty(); }
 
+  /// Discard the neighbor index, which must be rebuilt after the endpoints of
+  /// the set are changed.
+  void clearNeighborIndex();
+
+  /// Move the element stored at location i to location ordering[i]. If
+  /// keepIdentifiers is true, element identifiers do not change: element and
+  /// field references keep referring to the same elements. Otherwise elements
+  /// are renumbered by their new locations. The endpoints of the edge sets
+  /// that connect this set are updated to the new locations.
+  void relocateElements(const std::vector<int>& ordering,
+                        bool keepIdentifiers=true);
+
+  /// Get the edge sets that have endpoints in this set.
+  const std::vector<Set*>& getEdgeSets() const { return edgeSets; }
+
 private:
 
   // Private constructor for delegation
   Set(const std::string &name, Kind kind)
       : kind(kind), name(name), numElements(0), endpoints(nullptr),
-        latticePoints(nullptr), latticeLinks(nullptr),
+        latticePointSet(nullptr),
         capacity(capacityIncrement), neighbors(nullptr) {}
 
   // Set data
@@ -619,8 +754,6 @@ private:
   // Lattice link set data
   std::vector<int> dimensions;               // the lattice dimensions
   const Set* latticePointSet;                // the underlying point set
-  ElementRef* latticePoints;                 // ordered refs to lattice points
-  ElementRef* latticeLinks;                  // ordered refs to lattice links
 
   int capacity;                              // current capacity of the set
   static const int capacityIncrement = 1024; // increment for capacity increases
@@ -628,6 +761,14 @@ private:
   mutable internal::NeighborIndex *neighbors;// neighbor index (lazily created)
   std::map<std::string, int> fieldNames;     // name to field lookups
   std::vector<FieldData*> fields;            // fields of elements in the set
+  std::vector<std::vector<FieldData*>> fieldGroups; // interleaved fields
+
+  // Element permutation of relocated sets, empty if elements are stored in the
+  // order of their identifiers.
+  std::vector<int> locations;                // identifier to location
+  std::vector<int> identifiers;              // location to identifier
+
+  mutable std::vector<Set*> edgeSets;        // sets with endpoints in this set
 
   /// disable copy constructors
   Set(const Set& s);
@@ -636,6 +777,54 @@ private:
   /// increase capacity of all fields
   void increaseCapacity();
 
+  /// The capacity after the next increase. Capacity grows geometrically, since
+  /// arrays are copied when they are reallocated (see reallocate).
+  int getIncreasedCapacity() const {
+    int increment = capacity/2/capacityIncrement*capacityIncrement;
+    return capacity + (increment > 0 ? increment : capacityIncrement);
+  }
+
+  /// resize the data of all fields to hold newCapacity elements
+  void resizeFields(int newCapacity);
+
+  /// store the fields of a field group in separate arrays
+  void splitFieldGroup(size_t group);
+
+  /// add `num` elements without endpoints, growing the capacity once
+  void addElements(int num);
+
+  /// register this set as an edge set of its endpoint sets
+  void registerWithEndpointSets() {
+    for (size_t i=0; i < endpointSets.size(); ++i) {
+      if (std::find(endpointSets.begin(), endpointSets.begin()+i,
+                    endpointSets[i]) == endpointSets.begin()+i) {
+        endpointSets[i]->edgeSets.push_back(this);
+      }
+    }
+  }
+
+  /// compute an endpoint of a lattice link from the lattice coordinates
+  ElementRef getLatticeLinkEndpoint(ElementRef link, int endpointNum) const {
+    iassert(kind == LatticeLink);
+    int ndims = dimensions.size();
+    int point = link.ident / ndims;
+    if (endpointNum == 0) {
+      return ElementRef(point);
+    }
+
+    // The second endpoint is the next point in the link direction, assuming
+    // periodic boundary conditions
+    int dir = link.ident % ndims;
+    int stride = 1;
+    for (int i = 0; i < dir; ++i) {
+      stride *= dimensions[i];
+    }
+    int coord = (point / stride) % dimensions[dir];
+    int next = (coord+1 == dimensions[dir]) ? point - coord*stride
+                                            : point + stride;
+    return ElementRef(next);
+  }
+
   /// helpers for constructing endpoint sets
   template <typename F, typename ...T> std::vector<const Set*>
   epsMaker(std::vector<const Set*> sofar, const F& f, const T& ... sets) const {
@@ -651,8 +840,9 @@ private:
   epsMaker(std::vector<const Set*> sofar) {return sofar;}
 
   void increaseEdgeCapacity() {
-    size_t newSize = (capacity+capacityIncrement)*getCardinality()*sizeof(int);
-    endpoints = (int*)realloc(endpoints, newSize);
+    size_t edgeSize = getCardinality()*sizeof(int);
+    endpoints = (int*)reallocate(endpoints, capacity*edgeSize,
+                                 getIncreasedCapacity()*edgeSize);
   }
 
   // helper for adding edges
@@ -660,14 +850,16 @@ private:
   void addEndpoints(int which, F f, T ... eps) {
     uassert(endpointSets[which]->getSize() > f.ident)
         << "Invalid member of set in addEdge";
-    endpoints[numElements*getCardinality()+which] = f.ident;
+    endpoints[numElements*getCardinality()+which] =
+        endpointSets[which]->getLocation(f);
     addEndpoints(which+1, eps...);
   }
   template <typename F>
   void addEndpoints(int which, F f) {
     uassert(endpointSets[which]->getSize() > f.ident)
         << "Invalid member of set in addEdge";
-    endpoints[numElements*getCardinality()+which] = f.ident;
+    endpoints[numElements*getCardinality()+which] =
+        endpointSets[which]->getLocation(f);
   }
   void addEndpoints(int) {}
 
@@ -700,7 +892,7 @@ private:
       FieldData::TensorType *type =
           new FieldData::TensorType(ctype, dims);
       FieldData *fieldData = new FieldData(field.name, type, this);
-      fieldData->data = calloc(capacity, fieldData->sizeOfType);
+      fieldData->data = allocate(capacity * fieldData->sizeOfType, true);
       fields.push_back(fieldData);
       fieldNames[field.name] = fields.size()-1;
     }
@@ -714,9 +906,9 @@ private:
       os << it->ident;
       if (getCardinality() > 0) {
         os << ":(";
-        os << endpoints[0];
+        os << getEndpoint(*it, 0).ident;
         for (int i=1; i<getCardinality(); ++i) {
-          os << "," << endpoints[i];
+          os << "," << getEndpoint(*it, i).ident;
         }
         os << ")";
       }
@@ -726,9 +918,9 @@ private:
       os << ", " << it->ident;
       if (getCardinality() > 0) {
         os << ":(";
-        os << endpoints[it->ident*getCardinality() + 0];
+        os << getEndpoint(*it, 0).ident;
         for (int i=1; i<getCardinality(); ++i) {
-          os << "," << endpoints[it->ident*getCardinality() + i];
+          os << "," << getEndpoint(*it, i).ident;
         }
         os << ")";
       }
@@ -786,7 +978,8 @@ public:
 
   // Return the field's data.  The data is a contigues sequence containing the
   // tensor of each element in no particular order.  The tensors are currently
-  // laid out in row-major order, but this may change in the future.
+  // laid out in row-major order, but this may change in the future. The data
+  // of interleaved fields is the data of their field group (see FieldLayout).
   inline void *getData() {
     return static_cast<void*>(data);
   }
@@ -799,9 +992,14 @@ protected:
   }
 
   template <typename T>
-  inline T *getElemDataPtr(ElementRef element, size_t elementFieldSize) const {
+  inline T *getElemDataPtr(ElementRef element) const {
     iassert(sizeof(T) == componentSize(fieldData->type->getComponentType()));
-    return &static_cast<T*>(data)[element.ident * elementFieldSize];
+    int location = fieldData->set->getLocation(element);
+    return &static_cast<T*>(data)[fieldData->getComponentIndex(location, 0)];
+  }
+
+  inline size_t getComponentStride() const {
+    return fieldData->getComponentStride();
   }
 
   Set::FieldData *fieldData;
@@ -816,11 +1014,13 @@ template <typename T, int... dimensions>
 class FieldRefBaseParameterized : public FieldRefBase {
  public:
   TensorRef<T, dimensions...> get(ElementRef element) {
-    return TensorRef<T, dimensions...>(getElemDataPtr(element));
+    return TensorRef<T, dimensions...>(getElemDataPtr(element),
+                                       this->getComponentStride());
   }
 
   const TensorRef<T, dimensions...> get(ElementRef element) const {
-    return TensorRef<T, dimensions...>(getElemDataPtr(element));
+    return TensorRef<T, dimensions...>(getElemDataPtr(element),
+                                       this->getComponentStride());
   }
 
   TensorRef<T, dimensions...> operator()(ElementRef element) {
@@ -835,9 +1035,10 @@ class FieldRefBaseParameterized : public FieldRefBase {
     iassert(values.size() == (TensorRef<T,dimensions...>::getSize()))
         << "Incorrect number of init values";
     T *elemData = this->getElemDataPtr(element);
+    size_t stride = this->getComponentStride();
     size_t i=0;
     for (T val : values) {
-      elemData[i++] = val;
+      elemData[stride*i++] = val;
     }
   }
 
@@ -847,16 +1048,16 @@ class FieldRefBaseParameterized : public FieldRefBase {
         << "Incorrect number of init values : " << 
         (TensorRef<T,dimensions...>::getSize());
     T *elemData = this->getElemDataPtr(element);
+    size_t stride = this->getComponentStride();
     size_t i=0;
     for (T val : values) {
-      elemData[i++] = val;
+      elemData[stride*i++] = val;
     }
   }
 
  protected:
   inline T *getElemDataPtr(ElementRef element) const {
-    size_t elementFieldSize = TensorRef<T,dimensions...>::getSize();
-    return FieldRefBase::getElemDataPtr<T>(element, elementFieldSize);
+    return FieldRefBase::getElemDataPtr<T>(element);
   }
 
   FieldRefBaseParameterized(void *fieldData) : FieldRefBase(fieldData) {}
@@ -946,7 +1147,7 @@ public:
     iassert(vals.size() == util::product<Dimensions...>::value);
     size_t i=0;
     for (ComponentType val : vals) {
-      data[i++] = val;
+      data[stride*i++] = val;
     }
     return *this;
   }
@@ -955,14 +1156,16 @@ public:
   inline ComponentType& operator()(Indices... index) {
     static_assert(sizeof...(index) == sizeof...(Dimensions),
                   "Incorrect number of indices used to index tensor");
-    return data[util::computeOffset(util::seq<Dimensions...>(), index...)];
+    return data[stride *
+                util::computeOffset(util::seq<Dimensions...>(), index...)];
   }
 
   template <typename... Indices> inline
   const ComponentType& operator()(Indices... index) const {
     static_assert(sizeof...(index) == sizeof...(Dimensions),
                   "Incorrect number of indices used to index tensor");
-    return data[util::computeOffset(util::seq<Dimensions...>(), index...)];
+    return data[stride *
+                util::computeOffset(util::seq<Dimensions...>(), index...)];
   }
 
   friend bool operator==(const TensorRef& l, const TensorRef& r){
@@ -974,8 +1177,11 @@ public:
   }
 
 private:
-  inline TensorRef(ComponentType *data) : data(data) {}
+  /// `stride` is the distance between consecutive components in `data`.
+  inline TensorRef(ComponentType *data, size_t stride=1)
+      : data(data), stride(stride) {}
   ComponentType *data;
+  size_t stride;
 
   friend class FieldRefBaseParameterized<ComponentType, Dimensions...>;
 };
@@ -1012,7 +1218,7 @@ public:
   }
 
 private:
-  inline TensorRef(ComponentType *data) : data(data) {}
+  inline TensorRef(ComponentType *data, size_t stride=1) : data(data) {}
   ComponentType* data;
 
   friend class FieldRefBaseParameterized<ComponentType>;
@@ -11,10 +11,11 @@ VertexToEdgeEndpointIndex:: VertexToEdgeEndpointIndex(const Set &edgeSet) {
     endpointSets.push_back(es);
   }
 
+  // Indices are built from element locations (see Set::getLocation)
   for (auto e : edgeSet) {
     for (int epi=0; epi<(int)(endpointSets.size()); epi++) {
-      auto ep = edgeSet.getEndpoint(e, epi);
-      whichEdgesForVertex[std::make_pair(epi, ep.ident)].insert(e.ident);
+      int ep = edgeSet.getEndpointLocation(e.ident, epi);
+      whichEdgesForVertex[std::make_pair(epi, ep)].insert(e.ident);
     }
   }
 }
@@ -32,11 +33,12 @@ VertexToEdgeIndex::VertexToEdgeIndex(const Set &edgeSet) {
     endpointSets.push_back(es);
   }
 
+  // Indices are built from element locations (see Set::getLocation)
   for (auto e : edgeSet) {
     for (int epi=0; epi<(int)(endpointSets.size()); epi++) {
-      auto ep = edgeSet.getEndpoint(e, epi);
-      whichEdgesForVertex[std::make_pair(
-          endpointSets[epi], ep.ident)].insert(e.ident);
+      int ep = edgeSet.getEndpointLocation(e.ident, epi);
+      whichEdgesForVertex[std::make_pair(endpointSets[epi], ep)].insert(
+          e.ident);
     }
   }
 }
@@ -53,29 +55,66 @@ NeighborIndex::NeighborIndex(const Set &edgeSet) {
   unsigned cardinality = edgeSet.getCardinality();
 
   const Set* vSet = edgeSet.getEndpointSet(0);
-  startIndex = (int*)malloc(sizeof(int) * (vSet->getSize()+1));
+  numVertices = vSet->getSize();
+  startIndex = (int*)allocate(sizeof(int) * (numVertices+1));
   startIndex[0] = 0;
+  std::vector<int> nbrs;
   for(auto v : *vSet){
     std::set<int> edgeNeighbors = VToE.getWhichEdgesForElement(v, *vSet);
 
     std::vector<int> nbr;
     for(int eIdx : edgeNeighbors) {
       for(unsigned jj = 0; jj<cardinality; jj++){
-        int nbrIdx = edgeSet.getEndpoint(ElementRef(eIdx), jj).ident;
+        int nbrIdx = edgeSet.getEndpointLocation(eIdx, jj);
         addNoCollision(nbrIdx, nbr);
       }
     }
-    neighbors.insert(neighbors.end(), nbr.begin(), nbr.end());
-    startIndex[v.ident+1] = neighbors.size();
+    nbrs.insert(nbrs.end(), nbr.begin(), nbr.end());
+    startIndex[v.ident+1] = nbrs.size();
   }
 
-  for (int i=0; i < vSet->getSize(); ++i) {
-    std::sort(neighbors.begin()+startIndex[i], neighbors.begin()+startIndex[i+1]);
+  for (int i=0; i < numVertices; ++i) {
+    std::sort(nbrs.begin()+startIndex[i], nbrs.begin()+startIndex[i+1]);
   }
+
+  neighbors = (int*)allocate(sizeof(int) * nbrs.size());
+  std::copy(nbrs.begin(), nbrs.end(), neighbors);
 }
 
 NeighborIndex::~NeighborIndex() {
-  free(startIndex);
+  if (!indexFile) {
+    deallocate(startIndex);
+    deallocate(neighbors);
+  }
+}
+
+NeighborIndex *NeighborIndex::load(const Set &edgeSet,
+                                   const std::string &filename) {
+  std::shared_ptr<MappedIndexFile> indexFile =
+      MappedIndexFile::open(filename, IndexFileKind::NeighborIndex,
+                            fingerprint(edgeSet));
+  if (indexFile == nullptr ||
+      indexFile->getNumElements() !=
+          (size_t)edgeSet.getEndpointSet(0)->getSize()) {
+    return nullptr;
+  }
+
+  // The index file is mapped read-only, and neighbor indices are never
+  // modified after they are built.
+  NeighborIndex *index = new NeighborIndex();
+  index->numVertices = indexFile->getNumElements();
+  index->startIndex = (int*)indexFile->getCoords();
+  index->neighbors = (int*)indexFile->getSinks();
+  index->indexFile = indexFile;
+  return index;
+}
+
+bool NeighborIndex::save(const Set &edgeSet,
+                         const std::string &filename) const {
+  return writeIndexFile(filename, IndexFileKind::NeighborIndex,
+                        fingerprint(edgeSet), numVertices,
+                        (const uint32_t*)startIndex,
+                        (const uint32_t*)neighbors);
 }
 
 void NeighborIndex::addNoCollision(int x, std::vector<int> & a) {
@@ -87,4 +126,29 @@ void NeighborIndex::addNoCollision(int x, std::vector<int> & a) {
   a.push_back(x);
 }
 
+// Location tables
+void computeLocationTable(const Set &edgeSet, const uint32_t *coords,
+                          const uint32_t *sinks, std::vector<int> &locations) {
+  const int cardinality = edgeSet.getCardinality();
+  const int numEdges = edgeSet.getSize();
+  locations.resize((size_t)numEdges * cardinality * cardinality);
+  int* location = locations.data();
+  for (int e = 0; e < numEdges; ++e) {
+    for (int i = 0; i < cardinality; ++i) {
+      const int row = edgeSet.getEndpointLocation(e, i);
+      for (int j = 0; j < cardinality; ++j) {
+        const uint32_t col = edgeSet.getEndpointLocation(e, j);
+        *location = -1;
+        for (uint32_t l = coords[row]; l < coords[row+1]; ++l) {
+          if (sinks[l] == col) {
+            *location = l;
+            break;
+          }
+        }
+        ++location;
+      }
+    }
+  }
+}
+
 }}
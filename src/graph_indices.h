@@ -2,7 +2,10 @@
 #define SIMIT_INDICES_H
 
 #include "graph.h"
+#include "index_files.h"
 #include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace simit {
@@ -56,13 +59,23 @@ class NeighborIndex {
  public:
   NeighborIndex(const Set &edgeSet);
   ~NeighborIndex();
+
+  /// Load the neighbor index of `edgeSet` from the index file `filename`
+  /// (see index_files.h). The index arrays are memory mapped from the file.
+  /// Returns nullptr if the file does not exist or was saved for an edge set
+  /// with different endpoints.
+  static NeighborIndex *load(const Set &edgeSet, const std::string &filename);
+
+  /// Save the neighbor index, which must have been built from `edgeSet`, to
+  /// the index file `filename`.  Returns false on I/O errors.
+  bool save(const Set &edgeSet, const std::string &filename) const;
   
   int getNumNeighbors(ElementRef vertex) const {
     return startIndex[vertex.ident+1] - startIndex[vertex.ident];
   }
 
   int getSize() const {
-    return neighbors.size();
+    return startIndex[numVertices];
   }
 
   // Get a pointer to the neighbors of the given element.
@@ -72,19 +85,37 @@ class NeighborIndex {
 
   const int* getStartIndex() const { return startIndex; }
   
-  const int* getNeighborIndex() const { return neighbors.data(); }
+  const int* getNeighborIndex() const { return neighbors; }
   
  private:
+  int numVertices;
+
   /// start index into neighbors array for vertex.
   /// the last index is total size of neighbors array, which is also the number
   /// of non-zeros in a vertex x vertex matrix.
   int* startIndex;
 
   /// which edges v belongs to
-  std::vector<int> neighbors;
+  int* neighbors;
+
+  /// The index file that startIndex and neighbors are mapped from, if the
+  /// index was loaded.
+  std::shared_ptr<MappedIndexFile> indexFile;
+
+  NeighborIndex() : numVertices(0), startIndex(nullptr), neighbors(nullptr) {}
 
   void addNoCollision(int x, std::vector<int> & a);
 };
 
+/// Computes the location table of an edge set in the segmented index
+/// coords/sinks of matrices over its endpoints (see ir::LocationTable), where
+/// `coords[v]:coords[v+1]` is the range of locations of the neighbors of the
+/// vertex at location v in `sinks`. The table stores the location of endpoint
+/// j of the edge at location e in the neighbors of its endpoint i at
+/// `locations[(e*cardinality + i)*cardinality + j]`, or -1 if it is not one of
+/// them.
+void computeLocationTable(const Set &edgeSet, const uint32_t *coords,
+                          const uint32_t *sinks, std::vector<int> &locations);
+
 }} // simit::internal
 #endif
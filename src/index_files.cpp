@@ -0,0 +1,148 @@
+#include "index_files.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+namespace internal {
+
+static const char     INDEX_FILE_MAGIC[8] = {'S','I','M','I','T','I','D','X'};
+static const uint32_t INDEX_FILE_VERSION  = 1;
+
+struct IndexFileHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t kind;
+  uint64_t fingerprint;
+  uint64_t numElements;
+  uint64_t numNeighbors;
+};
+
+// class MappedIndexFile
+MappedIndexFile::~MappedIndexFile() {
+  munmap(data, size);
+}
+
+shared_ptr<MappedIndexFile> MappedIndexFile::open(const string &filename,
+                                                  IndexFileKind kind,
+                                                  uint64_t fingerprint) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexFileHeader)) {
+    close(fd);
+    return nullptr;
+  }
+
+  size_t size = st.st_size;
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  shared_ptr<MappedIndexFile> file(new MappedIndexFile(data, size));
+
+  const IndexFileHeader *header = static_cast<const IndexFileHeader*>(data);
+  if (memcmp(header->magic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC)) != 0 ||
+      header->version != INDEX_FILE_VERSION ||
+      header->kind != static_cast<uint32_t>(kind) ||
+      header->fingerprint != fingerprint) {
+    return nullptr;
+  }
+
+  size_t expectedSize = sizeof(IndexFileHeader) +
+      (header->numElements + 1 + header->numNeighbors) * sizeof(uint32_t);
+  if (size != expectedSize) {
+    return nullptr;
+  }
+
+  file->numElements = header->numElements;
+  file->numNeighbors = header->numNeighbors;
+  file->coords = reinterpret_cast<const uint32_t*>(header + 1);
+  file->sinks = file->coords + header->numElements + 1;
+  return file;
+}
+
+
+// Free functions
+bool writeIndexFile(const string &filename, IndexFileKind kind,
+                    uint64_t fingerprint, size_t numElements,
+                    const uint32_t *coords, const uint32_t *sinks) {
+  IndexFileHeader header;
+  memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC));
+  header.version = INDEX_FILE_VERSION;
+  header.kind = static_cast<uint32_t>(kind);
+  header.fingerprint = fingerprint;
+  header.numElements = numElements;
+  header.numNeighbors = coords[numElements];
+
+  string tmpFilename = filename + ".tmp" + to_string(getpid());
+  FILE *file = fopen(tmpFilename.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(coords, sizeof(uint32_t), numElements+1, file) == numElements+1 &&
+      fwrite(sinks, sizeof(uint32_t), header.numNeighbors, file) ==
+          header.numNeighbors;
+  written = (fclose(file) == 0) && written;
+
+  if (!written || rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+    remove(tmpFilename.c_str());
+    return false;
+  }
+  return true;
+}
+
+string getIndexFilename(const string &dir, IndexFileKind kind,
+                        uint64_t fingerprint) {
+  static const char *prefixes[] = {"pidx", "utidx", "nbrs"};
+  char name[64];
+  snprintf(name, sizeof(name), "%s-%016llx.idx",
+           prefixes[static_cast<uint32_t>(kind)],
+           static_cast<unsigned long long>(fingerprint));
+  return dir.empty() ? string(name) : dir + "/" + name;
+}
+
+uint64_t fingerprint(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *bytes = static_cast<const unsigned char*>(data);
+  uint64_t hash = seed;
+  for (size_t i=0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+uint64_t fingerprint(const Set &set, uint64_t seed) {
+  int32_t sizes[3] = {(int32_t)set.getKind(), set.getSize(),
+                      set.getCardinality()};
+  uint64_t hash = fingerprint(sizes, sizeof(sizes), seed);
+
+  if (set.getKind() == Set::LatticeLink) {
+    const vector<int> &dimensions = set.getDimensions();
+    return fingerprint(dimensions.data(), dimensions.size()*sizeof(int), hash);
+  }
+
+  for (int i=0; i < set.getCardinality(); ++i) {
+    int32_t endpointSetSize = set.getEndpointSet(i)->getSize();
+    hash = fingerprint(&endpointSetSize, sizeof(endpointSetSize), hash);
+  }
+  return fingerprint(set.getEndpointsData(),
+                     set.getSize() * set.getCardinality() * sizeof(int), hash);
+}
+
+}}
@@ -0,0 +1,89 @@
+#ifndef SIMIT_INDEX_FILES_H
+#define SIMIT_INDEX_FILES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace simit {
+class Set;
+
+namespace internal {
+
+/// \file
+/// Index files store segmented (CSR) indices, such as path indices and
+/// neighbor indices, so that they can be reused by later runs on the same
+/// graph. An index file consists of a header followed by the coordinate array
+/// and the sink array. The header records a fingerprint of the graph the index
+/// was built from, and an index file is only loaded if the fingerprint matches
+/// the graph it is loaded for. Index files are loaded by memory mapping them,
+/// so the index arrays are used without copying them.
+
+/// The kinds of indices stored in index files.
+enum class IndexFileKind : uint32_t {
+  PathIndex              = 0,
+  UpperTriangularIndex   = 1,
+  NeighborIndex          = 2
+};
+
+/// A read-only memory mapped index file.
+class MappedIndexFile {
+public:
+  ~MappedIndexFile();
+
+  /// Map the index file `filename`. Returns nullptr if the file does not
+  /// exist, is not a valid index file of the current version, or was saved
+  /// with a different kind or fingerprint.
+  static std::shared_ptr<MappedIndexFile> open(const std::string &filename,
+                                               IndexFileKind kind,
+                                               uint64_t fingerprint);
+
+  /// The number of elements that the index maps to neighbors.
+  size_t getNumElements() const {return numElements;}
+
+  /// The total number of neighbors stored in the index.
+  size_t getNumNeighbors() const {return numNeighbors;}
+
+  /// Segmented vector, where `coords[i]:coords[i+1]` is the range of locations
+  /// of neighbors of `i` in `sinks`.
+  const uint32_t *getCoords() const {return coords;}
+  const uint32_t *getSinks() const {return sinks;}
+
+private:
+  void *data;
+  size_t size;
+  size_t numElements;
+  size_t numNeighbors;
+  const uint32_t *coords;
+  const uint32_t *sinks;
+
+  MappedIndexFile(void *data, size_t size)
+      : data(data), size(size), numElements(0), numNeighbors(0),
+        coords(nullptr), sinks(nullptr) {}
+};
+
+/// Write a segmented index to the index file `filename`. The file is written
+/// to a temporary file that is renamed when complete, so concurrent readers
+/// never see partially written index files. Returns false on I/O errors.
+bool writeIndexFile(const std::string &filename, IndexFileKind kind,
+                    uint64_t fingerprint, size_t numElements,
+                    const uint32_t *coords, const uint32_t *sinks);
+
+/// The name of the file in the directory `dir` that stores the index of the
+/// given kind and fingerprint.
+std::string getIndexFilename(const std::string &dir, IndexFileKind kind,
+                             uint64_t fingerprint);
+
+/// Fingerprint (64-bit FNV-1a hash) of `size` bytes at `data`, continuing
+/// from the fingerprint `seed`.
+uint64_t fingerprint(const void *data, size_t size,
+                     uint64_t seed=0xcbf29ce484222325ull);
+
+/// Fingerprint of the structure of a set: its size, lattice dimensions, and
+/// the sizes and endpoints of its edges.
+uint64_t fingerprint(const Set &set, uint64_t seed=0xcbf29ce484222325ull);
+
+}}
+
+#endif
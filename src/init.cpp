@@ -2,4 +2,14 @@
 
 namespace simit {
 bool kIndexlessStencils;
+std::vector<std::string> kSymmetricMatrices;
+std::string kIndexCacheDir;
+std::vector<FieldGroup> kFieldGroups;
+bool kReorder;
+bool kIterationOrder;
+int kSparseTileSize;
+bool kMatrixFree;
+NumaPolicy kNumaPolicy;
+bool kHugePages;
+SolverSettings kSolverSettings;
 }
@@ -5,20 +5,87 @@
 #include <string>
 
 #include "error.h"
+#include "graph.h"
 #include "ir.h"
+#include "numa.h"
 #include "program.h"
+#include "solvers.h"
 
 namespace simit {
 
 extern const std::vector<std::string> VALID_BACKENDS;
 extern std::string kBackend;
 extern bool kIndexlessStencils;
+extern std::vector<std::string> kSymmetricMatrices;
+extern std::string kIndexCacheDir;
+extern std::vector<FieldGroup> kFieldGroups;
+extern bool kReorder;
+extern bool kIterationOrder;
+extern int kSparseTileSize;
+extern bool kMatrixFree;
+extern NumaPolicy kNumaPolicy;
+extern bool kHugePages;
+extern SolverSettings kSolverSettings;
 
 // Settings struct with default values
 struct Settings {
   std::string backend="cpu";
   int floatSize = 8;
   bool indexlessStencils = false;
+  // Names of the matrices, as declared in the program, whose values are
+  // symmetric. Those of them that have symmetric path expressions are stored
+  // in upper triangular form, and so are matrices combined elementwise from
+  // them. Such matrices may be assembled, combined elementwise, multiplied
+  // with vectors, solved with CG and factorized with chol, but not passed to
+  // extern functions. Matrices whose values are not symmetric must not be
+  // listed, since only their upper triangle is computed.
+  std::vector<std::string> symmetricMatrices;
+  // Directory where path indices and neighbor indices are saved when they are
+  // built, and loaded from when a function is initialized on the same graphs
+  // again. Indices are not cached if empty.
+  std::string indexCacheDir = "";
+  // Groups of fields that are stored interleaved (see FieldLayout). Functions
+  // are compiled for the groups set when they are compiled, and the fields of
+  // sets bound to them are converted to exactly these groups.
+  std::vector<FieldGroup> fieldGroups;
+  // Reorder the storage of vertex sets for locality when they are bound to a
+  // function, by Hilbert order of their spatial field if they have one and by
+  // reverse Cuthill-McKee otherwise. All the edge sets with endpoints in a
+  // vertex set are reordered with it, so the vertex set must be bound, not only
+  // its edge sets.
+  // Element and field references keep referring to the same elements (see
+  // reorderStorage). Sets should be bound before functions that use them are
+  // initialized, since indices built for the old order are not rebuilt.
+  bool reorder = false;
+  // Visit the edges of extern edge sets in map loops in a locality-friendly
+  // order that is computed when a function is initialized (see
+  // computeIterationOrder), instead of moving the sets' data. Sums may be
+  // computed in a different order. Not supported by the GPU backend.
+  bool iterationOrder = false;
+  // Execute maps over extern edge sets together with the pointwise loops over
+  // their vertices that follow them, in tiles of this many vertices, so that
+  // map results are still in cache when the vertex loops read them (see
+  // lowerSparseTiles). Tiles are ranges of vertex locations, so this works
+  // best on reordered sets. Disabled if 0. Not supported by the GPU backend.
+  int sparseTileSize = 0;
+  // Never assemble matrices that are only multiplied with vectors, but compute
+  // the products by running the matrices' assembly kernels every time instead
+  // (see lowerMatrixFreeProducts). This saves the memory and bandwidth of the
+  // matrices when their kernels are cheap, e.g. in iterative solvers of large
+  // meshes. Not supported by the GPU backend.
+  bool matrixFree = false;
+  // Where the pages of field data, endpoints, path indices and temporaries are
+  // placed on machines with several NUMA nodes (see NumaPolicy). Sets whose
+  // partitions are computed on different nodes are placed by placeByPartition.
+  NumaPolicy numaPolicy = NumaPolicy::Default;
+  // Back field data, indices and temporaries of at least kHugePageSize bytes
+  // with transparent huge pages, to reduce TLB misses on large meshes. Only
+  // supported on Linux.
+  bool hugePages = false;
+  // The Krylov method, preconditioner and stopping criteria of the solve
+  // intrinsic (see SolverSettings). The statistics of the solves are returned
+  // by getSolverStatistics and getSolverTotals.
+  SolverSettings solver;
 };
 
 inline void init(const Settings& settings) {
@@ -36,6 +103,51 @@ inline void init(const Settings& settings) {
 
   // indexlessStencils
   kIndexlessStencils = settings.indexlessStencils;
+
+  // symmetricMatrices
+  kSymmetricMatrices = settings.symmetricMatrices;
+
+  // indexCacheDir
+  kIndexCacheDir = settings.indexCacheDir;
+
+  // fieldGroups
+  for (const FieldGroup &group : settings.fieldGroups) {
+    // Tiles must divide the capacity increment of sets (1024 elements)
+    uassert(group.layout != FieldLayout::AoSoA ||
+            (group.tileWidth > 0 && 1024 % group.tileWidth == 0))
+        << "Invalid AoSoA tile width: " << group.tileWidth
+        << ", it must divide 1024";
+  }
+  kFieldGroups = settings.fieldGroups;
+
+  // reorder
+  kReorder = settings.reorder;
+
+  // iterationOrder
+  kIterationOrder = settings.iterationOrder;
+
+  // sparseTileSize
+  uassert(settings.sparseTileSize >= 0)
+      << "Invalid sparse tile size: " << settings.sparseTileSize;
+  kSparseTileSize = settings.sparseTileSize;
+
+  // matrixFree
+  kMatrixFree = settings.matrixFree;
+
+  // numaPolicy
+  kNumaPolicy = settings.numaPolicy;
+
+  // hugePages
+  kHugePages = settings.hugePages;
+
+  // solver
+  uassert(settings.solver.tolerance >= 0.0)
+      << "Invalid solver tolerance: " << settings.solver.tolerance;
+  uassert(settings.solver.maxIterations > 0)
+      << "Invalid solver iterations: " << settings.solver.maxIterations;
+  uassert(settings.solver.numThreads >= 0)
+      << "Invalid solver threads: " << settings.solver.numThreads;
+  kSolverSettings = settings.solver;
 }
 
 inline void init(std::string backend="cpu", int floatSize=8) {
@@ -18,16 +18,21 @@ namespace simit {
 namespace ir {
 
 Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
-                       MapFunctionRewriter &rewriter, Storage* storage);
+                       MapFunctionRewriter &rewriter, Storage* storage,
+                       Var locationTable);
 
 Stmt MapFunctionRewriter::inlineMapFunc(const Map *map, Var targetLoopVar,
                                         Storage *storage,
                                         Var endpoints, Var locs,
                                         std::map<vector<int>, Expr> clocs,
-                                        vector<Var> latticeIndexVars) {
+                                        vector<Var> latticeIndexVars,
+                                        Var locationTable,
+                                        Var upperTriangularLocs) {
   this->endpoints = endpoints;
   this->locs = locs;
+  this->upperTriangularLocs = upperTriangularLocs;
   this->clocs = clocs;
+  this->locationTable = locationTable;
   this->reduction = map->reduction;
   this->targetLoopVar = targetLoopVar;
   this->latticeIndexVars = latticeIndexVars;
@@ -263,7 +268,8 @@ StencilContent* buildStencilLocs(Func kernel, Var stencilVar, Var loopVar,
 /// Inlines the mapped function with respect to the given loop variable over
 /// the target set, using the given rewriter.
 Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
-                       MapFunctionRewriter &rewriter, Storage* storage) {
+                       MapFunctionRewriter &rewriter, Storage* storage,
+                       Var locationTable) {
   // Compute locations of the mapped edge
   bool returnsMatrix = false;
   for (auto& result : map->function.getResults()) {
@@ -278,7 +284,14 @@ Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
   iassert(map->target.type().isSet());
   int cardinality = map->target.type().toUnstructuredSet()->endpointSets.size();
   // Map over edge set to build matrix
-  if (returnsMatrix && cardinality > 0) {
+  if (returnsMatrix && cardinality > 0 && locationTable.defined()) {
+    // The locations of the edge's blocks were computed when the function was
+    // initialized
+    iassert(ivs.size() == 0);
+    return rewriter.inlineMapFunc(map, lv, storage, Var(), Var(), {}, {},
+                                  locationTable);
+  }
+  else if (returnsMatrix && cardinality > 0) {
     iassert(ivs.size() == 0);
     // Computes the return matrix locations of the endpoints of the edge being
     // assembled.  These are stored in an array and used when storing values to
@@ -310,32 +323,69 @@ Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
     Stmt epsInit = TensorWrite::make(eps, {i}, ep);
     Stmt epsInitLoop = ForRange::make(i, 0, cardinality, epsInit);
 
-    Var locs(INTERNAL_PREFIX("locs"), TensorType::make(ScalarType::Int,
-                                                       {IndexDomain(cardinality),
-                                                        IndexDomain(cardinality)}));
-
-    Expr nbrs_start = IndexRead::make(target, IndexRead::NeighborsStart);
-    Expr nbrs = IndexRead::make(target, IndexRead::Neighbors);
-
-    Var locVar(INTERNAL_PREFIX("locVar"), Int);
-    Stmt locStmt = CallStmt::make({locVar}, intrinsics::loc(),
-                                  {Load::make(eps,i),
-                                   Load::make(eps,j),
-                                   nbrs_start, nbrs});
-
-    Stmt locsInit = Block::make({locStmt,
-                                TensorWrite::make(locs, {i,j}, locVar)});
+    // Matrices with upper triangular indices only store the locations of
+    // endpoint pairs whose first endpoint is not greater than the second, so
+    // their locations are computed against their own index in a separate
+    // table whose remaining locations are set to -1.
+    TensorIndex upperTriangularIndex;
+    bool hasFullResults = false;
+    for (auto& var : map->vars) {
+      const TensorStorage& varStorage = storage->getStorage(var);
+      if (varStorage.getKind() != TensorStorage::Kind::Indexed) {
+        continue;
+      }
+      if (varStorage.getTensorIndex().isUpperTriangular()) {
+        upperTriangularIndex = varStorage.getTensorIndex();
+      }
+      else {
+        hasFullResults = true;
+      }
+    }
 
-    Stmt locsInitLoop = ForRange::make(j, 0, cardinality, locsInit);
-    locsInitLoop      = ForRange::make(i, 0, cardinality, locsInitLoop);
+    auto buildLocs = [&](Var locs, Expr nbrs_start, Expr nbrs,
+                         bool upperTriangular) {
+      Var locVar(INTERNAL_PREFIX("locVar"), Int);
+      Stmt locStmt = CallStmt::make({locVar}, intrinsics::loc(),
+                                    {Load::make(eps,i),
+                                     Load::make(eps,j),
+                                     nbrs_start, nbrs});
+
+      Stmt locsInit = Block::make({locStmt,
+                                  TensorWrite::make(locs, {i,j}, locVar)});
+      if (upperTriangular) {
+        Expr isUpper = Le::make(Load::make(eps,i), Load::make(eps,j));
+        locsInit = IfThenElse::make(isUpper, locsInit,
+                                    TensorWrite::make(locs, {i,j}, -1));
+      }
 
-    Stmt computeLocs = Block::make({VarDecl::make(eps),
-                                    epsInitLoop,
-                                    VarDecl::make(locs),
-                                    locsInitLoop});
+      Stmt locsInitLoop = ForRange::make(j, 0, cardinality, locsInit);
+      locsInitLoop      = ForRange::make(i, 0, cardinality, locsInitLoop);
+      return Block::make(VarDecl::make(locs), locsInitLoop);
+    };
+
+    Type locsType = TensorType::make(ScalarType::Int,
+                                     {IndexDomain(cardinality),
+                                      IndexDomain(cardinality)});
+    vector<Stmt> computeLocs = {VarDecl::make(eps), epsInitLoop};
+    Var locs, upperTriangularLocs;
+    if (hasFullResults || !upperTriangularIndex.defined()) {
+      locs = Var(INTERNAL_PREFIX("locs"), locsType);
+      computeLocs.push_back(
+          buildLocs(locs, IndexRead::make(target, IndexRead::NeighborsStart),
+                    IndexRead::make(target, IndexRead::Neighbors), false));
+    }
+    if (upperTriangularIndex.defined()) {
+      upperTriangularLocs = Var(INTERNAL_PREFIX("upperLocs"), locsType);
+      computeLocs.push_back(
+          buildLocs(upperTriangularLocs,
+                    upperTriangularIndex.getRowptrArray(),
+                    upperTriangularIndex.getColidxArray(), true));
+    }
 
-    return Block::make(computeLocs,
-                       rewriter.inlineMapFunc(map, lv, storage, eps, locs));
+    return Block::make(Block::make(computeLocs),
+                       rewriter.inlineMapFunc(map, lv, storage, eps, locs,
+                                              {}, {}, Var(),
+                                              upperTriangularLocs));
   }
   // Map through local coordinate structure to build matrix
   // TODO: This branching should be handled in a less ad-hoc manner
@@ -384,7 +434,7 @@ Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
 }
 
 Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
-               Storage* storage) {
+               Storage* storage, Var iterationOrder, Var locationTable) {
   Func kernel = map->function;
   kernel = insertTemporaries(kernel);
 
@@ -404,7 +454,7 @@ Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
   }
 
   Stmt inlinedMapFunc = inlineMapFunction(map, loopVar, latticeIndexVars,
-                                          rewriter, storage);
+                                          rewriter, storage, locationTable);
 
   Stmt inlinedMap;
   auto initializers = vector<Stmt>();
@@ -417,8 +467,17 @@ Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
   Stmt loop;
   if (!map->through.defined()) {
     iassert(latticeIndexVars.size() == 0);
-    ForDomain domain(map->target);
-    loop = For::make(loopVar, domain, inlinedMapFunc);
+    if (iterationOrder.defined()) {
+      Var i(loopVar.getName() + "_i", Int);
+      Stmt next = AssignStmt::make(loopVar, Load::make(iterationOrder, i));
+      loop = ForRange::make(i, 0, Length::make(IndexSet(map->target)),
+                            Block::make(next, inlinedMapFunc));
+      loop = Block::make(VarDecl::make(loopVar), loop);
+    }
+    else {
+      ForDomain domain(map->target);
+      loop = For::make(loopVar, domain, inlinedMapFunc);
+    }
   }
   else {
     iassert(map->through.type().isLatticeLinkSet());
@@ -22,7 +22,9 @@ public:
                      Storage *storage,
                      Var endpoints=Var(), Var locs=Var(),
                      std::map<vector<int>, Expr> clocs={},
-                     vector<Var> latticeIndexVars={});
+                     vector<Var> latticeIndexVars={},
+                     Var locationTable=Var(),
+                     Var upperTriangularLocs=Var());
 
 protected:
   std::map<Var,Var> resultToMapVar;
@@ -47,8 +49,13 @@ protected:
   // Compiled endpoints and locs arrays for matrix assembly
   Var endpoints;
   Var locs;
+  // Locs of matrices with upper triangular indices, -1 below the diagonal
+  Var upperTriangularLocs;
   // Compile-time version of locs, used for generating stencil indices
   std::map<vector<int>, Expr> clocs;
+  // Precomputed locs of every edge of the target set (see LocationTable),
+  // used instead of endpoints and locs if defined
+  Var locationTable;
 
   /// Check if the given variable is a result variable
   bool isResult(Var var);
@@ -74,9 +81,14 @@ protected:
   void visit(const VarExpr *op);
 };
 
-/// Inlines the map returning a loop, using the given rewriter.
+/// Inlines the map returning a loop, using the given rewriter. If the
+/// iteration order array is defined, the loop visits the target set's
+/// elements at the locations it lists, in order. If the location table is
+/// defined, assembled matrices are written at the locations it stores instead
+/// of searching their index.
 Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
-               Storage* storage);
+               Storage* storage, Var iterationOrder=Var(),
+               Var locationTable=Var());
 
 }}
 
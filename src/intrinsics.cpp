@@ -263,8 +263,7 @@ const Func& dot() {
 static Func detVar;
 void detInit() {
   detVar = Func("det",
-                {Var("m", TensorType::make(ScalarType::Float,
-                                           {IndexDomain(3),IndexDomain(3)}))},
+                {Var("m", Type())},
                 {Var("r", Float)},
                 Func::Intrinsic);
 }
@@ -278,10 +277,8 @@ const Func& det() {
 static Func invVar;
 void invInit() {
   invVar = Func("inv",
-                {Var("m", TensorType::make(ScalarType::Float,
-                                           {IndexDomain(3),IndexDomain(3)}))},
-                {Var("r", TensorType::make(ScalarType::Float,
-                                           {IndexDomain(3),IndexDomain(3)}))},
+                {Var("m", Type())},
+                {Var("r", Type())},
                 Func::Intrinsic);
 }
 const Func& inv() {
@@ -417,18 +414,32 @@ const Func& clock() {
   return clockVar;
 }
 
-static Func storeTimeVar;
-void storeTimeInit() {
-  storeTimeVar = Func("storeTime",
-                      {Var("i", Int), Var("val", Float)},
-                      {Var("r", Float)},
-                      Func::Intrinsic);
+static Func profileBeginVar;
+void profileBeginInit() {
+  profileBeginVar = Func("__profileBegin",
+                         {Var("region", Int)},
+                         {},
+                         Func::Intrinsic);
+}
+const Func& profileBegin() {
+  if (!profileBeginVar.defined()) {
+    profileBeginInit();
+  }
+  return profileBeginVar;
+}
+
+static Func profileEndVar;
+void profileEndInit() {
+  profileEndVar = Func("__profileEnd",
+                       {Var("region", Int)},
+                       {},
+                       Func::Intrinsic);
 }
-const Func& storeTime() {
-  if (!storeTimeVar.defined()) {
-    storeTimeInit();
+const Func& profileEnd() {
+  if (!profileEndVar.defined()) {
+    profileEndInit();
   }
-  return storeTimeVar;
+  return profileEndVar;
 }
 
 static Func mallocVar;
@@ -473,6 +484,20 @@ const Func& loc() {
   return locVar;
 }
 
+static Func symmatvecVar;
+void symmatvecInit() {
+  symmatvecVar = Func("__symmatvec",
+                      {Var("A", Type()), Var("x", Type())},
+                      {Var("y", Type())},
+                      Func::Intrinsic);
+}
+const Func& symmatvec() {
+  if (!symmatvecVar.defined()) {
+    symmatvecInit();
+  }
+  return symmatvecVar;
+}
+
 
 const std::map<std::string,Func> &byNames() {
   static std::map<std::string,Func> byNameMap;
@@ -506,10 +531,12 @@ const std::map<std::string,Func> &byNames() {
     strcpyInit();
     strcatInit();
     clockInit();
-    storeTimeInit();
+    profileBeginInit();
+    profileEndInit();
     mallocInit();
     freeInit();
     locInit();
+    symmatvecInit();
     byNameMap.insert({{"mod",modVar},
                       {"sin",sinVar},
                       {"cos",cosVar},
@@ -539,10 +566,12 @@ const std::map<std::string,Func> &byNames() {
                       {"strcpy", strcpyVar},
                       {"strcat", strcatVar},
                       {"clock",clockVar},
-                      {"storeTime",storeTimeVar},
+                      {"__profileBegin",profileBeginVar},
+                      {"__profileEnd",profileEndVar},
                       {"malloc", mallocVar},
                       {"free", freeVar},
-                      {"__loc", locVar}});
+                      {"__loc", locVar},
+                      {"__symmatvec", symmatvecVar}});
   }
   return byNameMap;
 }
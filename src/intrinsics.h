@@ -54,12 +54,16 @@ const Func& strcat();
 
 // Clock
 const Func& clock();
-const Func& storeTime();
+
+// Profiling (see Profiler)
+const Func& profileBegin();
+const Func& profileEnd();
 
 // Internal functions
 const Func& malloc();
 const Func& free();
 const Func& loc();
+const Func& symmatvec();
 
 const std::map<std::string,Func> &byNames();
 
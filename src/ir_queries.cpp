@@ -5,6 +5,8 @@
 #include <stack>
 
 #include "types.h"
+#include "util/collections.h"
+#include "util/util.h"
 
 using namespace std;
 
@@ -283,4 +285,109 @@ std::vector<Func> getCallTree(Func func) {
   return GetCallTree().get(func);
 }
 
+static string getElementTypeName(const Expr& elementOrSet) {
+  const Type& type = elementOrSet.type();
+  if (type.isElement()) {
+    return type.toElement()->name;
+  }
+  if (type.isSet()) {
+    return type.toSet()->elementType.toElement()->name;
+  }
+  return "";
+}
+
+std::vector<std::string> getMapsReadingReducedFields(Func func) {
+  class GetMapsReadingReducedFields : public IRVisitor {
+  public:
+    vector<string> get(Func func) {
+      func.accept(this);
+      return maps;
+    }
+
+  private:
+    /// True once a reduce map has executed.
+    bool reduced = false;
+
+    /// The (element type, field) pairs written after a reduce map.
+    set<pair<string,string>> written;
+
+    vector<string> maps;
+
+    using IRVisitor::visit;
+
+    void visit(const FieldWrite* op) {
+      if (reduced) {
+        written.insert({getElementTypeName(op->elementOrSet), op->fieldName});
+      }
+      IRVisitor::visit(op);
+    }
+
+    void visit(const CallStmt* op) {
+      IRVisitor::visit(op);
+      if (op->callee.getKind() == Func::Internal &&
+          op->callee.getBody().defined()) {
+        op->callee.getBody().accept(this);
+      }
+    }
+
+    void visit(const Map* op) {
+      IRVisitor::visit(op);
+      if (reduced && readsWrittenEndpointField(op)) {
+        string map = "map " + op->function.getName() + " to " +
+                     util::toString(op->target);
+        if (!util::contains(maps, map)) {
+          maps.push_back(map);
+        }
+      }
+      if (op->reduction.getKind() != ReductionOperator::Undefined) {
+        reduced = true;
+      }
+      // Field writes of the mapped function (e.g. p.x = ...)
+      if (reduced) {
+        op->function.getBody().accept(this);
+      }
+    }
+
+    // A loop's writes are visible to the next iteration's maps
+    void visit(const For* op) {
+      IRVisitor::visit(op);
+      IRVisitor::visit(op);
+    }
+    void visit(const ForRange* op) {
+      IRVisitor::visit(op);
+      IRVisitor::visit(op);
+    }
+    void visit(const While* op) {
+      IRVisitor::visit(op);
+      IRVisitor::visit(op);
+    }
+
+    bool readsWrittenEndpointField(const Map* op) {
+      if (!op->target.type().isUnstructuredSet()) {
+        return false;
+      }
+      set<string> endpointTypes;
+      for (const Expr* endpointSet :
+               op->target.type().toUnstructuredSet()->endpointSets) {
+        endpointTypes.insert(getElementTypeName(*endpointSet));
+      }
+
+      bool readsWritten = false;
+      match(op->function.getBody(),
+        function<void(const FieldRead*,Matcher*)>([&](const FieldRead* read,
+                                                      Matcher* ctx) {
+          string elementType = getElementTypeName(read->elementOrSet);
+          if (util::contains(endpointTypes, elementType) &&
+              util::contains(written, make_pair(elementType, read->fieldName))) {
+            readsWritten = true;
+          }
+          ctx->match(read->elementOrSet);
+        })
+      );
+      return readsWritten;
+    }
+  };
+  return GetMapsReadingReducedFields().get(func);
+}
+
 }}
@@ -1,6 +1,9 @@
 #ifndef SIMIT_EXPR_QUERIES_H
 #define SIMIT_EXPR_QUERIES_H
 
+#include <string>
+#include <vector>
+
 #include "ir.h"
 #include "indexvar.h"
 
@@ -32,6 +35,12 @@ bool isBlocked(Stmt stmt);
 /// (transitively) called from `func`.
 std::vector<Func> getCallTree(Func func);
 
+/// Returns the maps over edge sets in `func` that read an endpoint field that
+/// was written after a reduce map (in the same or in a previous iteration of a
+/// loop). When `func` runs on a domain decomposition these maps read ghost
+/// values that are only complete once the halo has been exchanged.
+std::vector<std::string> getMapsReadingReducedFields(Func func);
+
 }}
 
 #endif
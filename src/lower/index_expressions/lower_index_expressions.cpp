@@ -3,6 +3,7 @@
 #include "ir.h"
 #include "ir_rewriter.h"
 #include "ir_transforms.h"
+#include "intrinsics.h"
 
 #include "lower_indexexprs.h"
 #include "lower_scatter_workspace.h"
@@ -158,6 +159,45 @@ inline bool isGemm(const IndexExpr* iexpr) {
   return result;
 }
 
+/// Matches the matrix-vector product `(i) A(i,+j)*x(+j)`, where `A` has an
+/// upper triangular tensor index, and returns `A` and `x`. Returns undefined
+/// expressions if the index expression does not have this form.
+inline std::pair<Expr,Expr> getUpperTriangularMatVec(const IndexExpr* iexpr,
+                                                     const Storage& storage) {
+  const std::pair<Expr,Expr> noMatch;
+  if (iexpr->resultVars.size() != 1 || !isa<Mul>(iexpr->value) ||
+      !iexpr->type.toTensor()->getComponentType().isFloat()) {
+    return noMatch;
+  }
+
+  const Mul* mul = to<Mul>(iexpr->value);
+  if (!isa<IndexedTensor>(mul->a) || !isa<IndexedTensor>(mul->b)) {
+    return noMatch;
+  }
+  const IndexedTensor* A = to<IndexedTensor>(mul->a);
+  const IndexedTensor* x = to<IndexedTensor>(mul->b);
+  if (A->indexVars.size() != 2 || x->indexVars.size() != 1 ||
+      !isa<VarExpr>(A->tensor) ||
+      !(isa<VarExpr>(x->tensor) || isa<FieldRead>(x->tensor))) {
+    return noMatch;
+  }
+
+  const Var& matrix = to<VarExpr>(A->tensor)->var;
+  if (!storage.hasStorage(matrix) ||
+      storage.getStorage(matrix).getKind() != TensorStorage::Indexed ||
+      !storage.getStorage(matrix).getTensorIndex().isUpperTriangular()) {
+    return noMatch;
+  }
+
+  const IndexVar& i = iexpr->resultVars[0];
+  const IndexVar& j = x->indexVars[0];
+  if (!(A->indexVars[0] == i) || !(A->indexVars[1] == j) ||
+      !j.isReductionVar() || j.getOperator() != ReductionOperator::Sum) {
+    return noMatch;
+  }
+  return {A->tensor, x->tensor};
+}
+
 Func lowerIndexExpressions(Func func) {
   class LowerIndexExpressionsRewriter : private IRRewriter {
   public:
@@ -197,6 +237,15 @@ Func lowerIndexExpressions(Func func) {
 
       const IndexExpr* iexpr = to<IndexExpr>(op->value);
 
+      // Only the upper triangle of upper triangular matrices is stored, so
+      // their matrix-vector products must also apply the transposed blocks.
+      Expr matrix, vec;
+      std::tie(matrix, vec) = getUpperTriangularMatVec(iexpr, *storage);
+      if (matrix.defined() && op->cop == CompoundOperator::None) {
+        stmt = lowerUpperTriangularMatVec(op->var, matrix, vec);
+        return;
+      }
+
       // Dispatch the index expression lowering to the correct lowering pass.
       enum Kind {Unknown, DenseResult, MatrixScale,
                  MatrixElwiseWithSameStructureOrDiagonal, MatrixElwise,
@@ -251,6 +300,22 @@ Func lowerIndexExpressions(Func func) {
         IRRewriter::visit(op);
         return;
       }
+
+      // Compute upper triangular matrix-vector products into a temporary
+      // vector, that is then written to the field
+      if (isa<IndexExpr>(op->value) && op->cop == CompoundOperator::None) {
+        const IndexExpr* iexpr = to<IndexExpr>(op->value);
+        Expr matrix, vec;
+        std::tie(matrix, vec) = getUpperTriangularMatVec(iexpr, *storage);
+        if (matrix.defined()) {
+          Var result = createTemporaryVector(op->value.type());
+          Stmt write = FieldWrite::make(op->elementOrSet, op->fieldName,
+                                        copyVector(result));
+          stmt = Block::make(lowerUpperTriangularMatVec(result, matrix, vec),
+                             lowerIndexStatement(write, &environment, *storage));
+          return;
+        }
+      }
       stmt = lowerIndexStatement(op, &environment, *storage);
     }
 
@@ -266,6 +331,34 @@ Func lowerIndexExpressions(Func func) {
       iassert_scalar(Expr(op));
       expr = rewrite(op->value);
     }
+
+    /// Lowers `result = A*vec`, where A is upper triangular, to a symmatvec
+    /// call. Fields are first copied to a temporary vector.
+    Stmt lowerUpperTriangularMatVec(const Var& result, Expr matrix, Expr vec) {
+      vector<Stmt> stmts;
+      if (isa<FieldRead>(vec)) {
+        Var copy = createTemporaryVector(vec.type());
+        Stmt copyStmt = AssignStmt::make(copy, copyVector(vec));
+        stmts.push_back(lowerIndexStatement(copyStmt, &environment, *storage));
+        vec = copy;
+      }
+      stmts.push_back(CallStmt::make({result}, intrinsics::symmatvec(),
+                                     {matrix, vec}));
+      return Block::make(stmts);
+    }
+
+    /// The index expression `(i) vec(i)`.
+    static Expr copyVector(Expr vec) {
+      IndexVar i("i", vec.type().toTensor()->getDimensions()[0]);
+      return IndexExpr::make({i}, IndexedTensor::make(vec, {i}));
+    }
+
+    Var createTemporaryVector(const Type& type) {
+      Var tmp = environment.createTemporary(type, INTERNAL_PREFIX("symmatvec"));
+      environment.addTemporary(tmp);
+      storage->add(tmp, TensorStorage::Kind::Dense);
+      return tmp;
+    }
   };
   func = LowerIndexExpressionsRewriter().lower(func);
   func = insertVarDecls(func);
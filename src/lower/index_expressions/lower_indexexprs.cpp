@@ -636,6 +636,9 @@ Stmt lowerIndexStatement(Stmt stmt, Environment* environment, Storage storage) {
       if (tensorIndex.getKind() == TensorIndex::PExpr) {
         iassert(tensorIndex.getColidxArray().defined())
             << "Empty tensor index returned from: " << stmt;
+        tassert(!tensorIndex.isUpperTriangular() || !loopVar->hasReduction())
+            << "reductions over upper triangular matrices are only supported "
+            << "for matrix-vector products: " << stmt;
 
         Expr jRead = Load::make(tensorIndex.getColidxArray(), ij);
 
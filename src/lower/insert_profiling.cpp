@@ -0,0 +1,157 @@
+#include "insert_profiling.h"
+
+#include "intrinsics.h"
+#include "ir_rewriter.h"
+#include "profiler.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+/// The statement printed on one line, without its terminating semicolon.
+static string describe(string stmt) {
+  stmt = util::trim(stmt);
+  if (stmt.size() > 0 && stmt.back() == ';') {
+    stmt.pop_back();
+  }
+  return stmt;
+}
+
+/// lowerMaps comments the statements it lowers a map to with the map.
+static bool isLoweredMap(const Comment* op) {
+  return op->commentedStmt.defined() &&
+         (op->comment.compare(0, 4, "map ") == 0 ||
+          op->comment.find(" = map ") != string::npos);
+}
+
+static bool isSolve(const Func& callee) {
+  // Generic solvers are called through their specializations (e.g. chol@1)
+  string name = callee.getName().substr(0, callee.getName().find("@"));
+  return name == intrinsics::solve().getName() ||
+         name == intrinsics::chol().getName() ||
+         name == intrinsics::lltsolves().getName();
+}
+
+class InsertProfiling : public IRRewriterCallGraph {
+public:
+  InsertProfiling(Environment* environment) : environment(environment) {}
+
+  using IRRewriterCallGraph::rewrite;
+
+private:
+  Environment* environment;
+
+  /// The region that contains the statements being rewritten.
+  int region = -1;
+
+  /// True inside loop and map regions, whose loops are not regions.
+  bool inLoop = false;
+
+  /// True inside map regions, whose statements are not regions.
+  bool inMap = false;
+
+  using IRRewriterCallGraph::visit;
+
+  void visit(const Func* op) {
+    if (op->getKind() != Func::Internal) {
+      func = *op;
+      return;
+    }
+
+    // The body of a function is not in the loops and maps it is called from
+    const int caller = region;
+    const bool callerInLoop = inLoop;
+    const bool callerInMap = inMap;
+    region = environment->addProfileRegion(
+        ProfileRegion(op->getName(), ProfileRegion::Function, caller));
+    inLoop = false;
+    inMap = false;
+
+    Stmt body = rewrite(op->getBody());
+    func = Func(*op, Block::make(
+        {CallStmt::make({}, intrinsics::profileBegin(), {region}),
+         body,
+         CallStmt::make({}, intrinsics::profileEnd(), {region})}));
+
+    region = caller;
+    inLoop = callerInLoop;
+    inMap = callerInMap;
+  }
+
+  void visit(const Comment* op) {
+    if (!isLoweredMap(op) || inMap) {
+      IRRewriter::visit(op);
+      return;
+    }
+    visitRegion(op, describe(op->comment), ProfileRegion::Map);
+  }
+
+  void visit(const ForRange* op) {
+    visitLoop(op, "for " + util::toString(op->var) + " in " +
+                  util::toString(op->start) + ":" + util::toString(op->end));
+  }
+
+  void visit(const For* op) {
+    visitLoop(op, "for " + util::toString(op->var) + " in " +
+                  util::toString(op->domain));
+  }
+
+  void visit(const While* op) {
+    visitLoop(op, "while " + util::toString(op->condition));
+  }
+
+  void visit(const CallStmt* op) {
+    if (isSolve(op->callee) && !inMap) {
+      visitRegion(op, describe(util::toString(*op)), ProfileRegion::Solve);
+      return;
+    }
+    IRRewriterCallGraph::visit(op);
+  }
+
+  template <typename Loop>
+  void visitLoop(const Loop* op, const string& name) {
+    if (inLoop) {
+      IRRewriter::visit(op);
+      return;
+    }
+    visitRegion(op, name, ProfileRegion::Loop);
+  }
+
+  /// Rewrite the statement as a region of the given kind, nested in the
+  /// current region.
+  template <typename T>
+  void visitRegion(const T* op, const string& name, ProfileRegion::Kind kind) {
+    const int parent = region;
+    const bool parentInLoop = inLoop;
+    const bool parentInMap = inMap;
+    region = environment->addProfileRegion(ProfileRegion(name, kind, parent));
+    inLoop = inLoop || kind == ProfileRegion::Loop || kind == ProfileRegion::Map;
+    inMap = inMap || kind == ProfileRegion::Map;
+
+    visitChildren(op);
+    if (stmt.defined()) {
+      stmt = Block::make(
+          {CallStmt::make({}, intrinsics::profileBegin(), {region}),
+           stmt,
+           CallStmt::make({}, intrinsics::profileEnd(), {region})});
+    }
+
+    region = parent;
+    inLoop = parentInLoop;
+    inMap = parentInMap;
+  }
+
+  void visitChildren(const Comment* op)  {IRRewriter::visit(op);}
+  void visitChildren(const ForRange* op) {IRRewriter::visit(op);}
+  void visitChildren(const For* op)      {IRRewriter::visit(op);}
+  void visitChildren(const While* op)    {IRRewriter::visit(op);}
+  void visitChildren(const CallStmt* op) {IRRewriterCallGraph::visit(op);}
+};
+
+Func insertProfiling(Func func) {
+  return InsertProfiling(&func.getEnvironment()).rewrite(func);
+}
+
+}}
@@ -0,0 +1,18 @@
+#ifndef SIMIT_INSERT_PROFILING_H
+#define SIMIT_INSERT_PROFILING_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Instruments a lowered function and the internal functions it calls with
+/// profiling regions (see Profiler): the function bodies, the maps, the loops
+/// that are not nested in other loops or maps, and the solves. Every region is
+/// added to the function's environment, and calls profileBegin and profileEnd
+/// with its index before and after it executes.
+Func insertProfiling(Func func);
+
+}}
+
+#endif
@@ -10,15 +10,18 @@
 #include "lower_prints.h"
 #include "lower_string_ops.h"
 #include "lower_stencil_assemblies.h"
+#include "lower_sparse_tiles.h"
+#include "lower_matrix_free.h"
 
 #include "storage.h"
-#include "timers.h"
 #include "temps.h"
 #include "flatten.h"
 #include "insert_frees.h"
+#include "insert_profiling.h"
 #include "ir_rewriter.h"
 #include "ir_transforms.h"
 #include "ir_printer.h"
+#include "ir_queries.h"
 #include "path_expressions.h"
 
 #ifdef GPU
@@ -71,13 +74,6 @@ void visitCallGraph(Func func, const function<void(Func)>& visitRule) {
   func.accept(&visitor);
 }
 
-static inline
-void printTimedCallGraph(string headerText, Func func, bool print) {
-  stringstream ss;
-  simit::ir::IRPrinterCallGraph(ss).print(func);
-  TimerStorage::getInstance().addSourceLines(ss);
-}
-
 static inline
 void printCallGraph(string headerText, Func func, bool print) {
   if (print) {
@@ -88,6 +84,10 @@ void printCallGraph(string headerText, Func func, bool print) {
 }
 
 Func lower(Func func, bool print, bool time) {
+  // Record the maps that must not run on a domain decomposition (HaloExchange)
+  func.getEnvironment().setMapsReadingReducedFields(
+      getMapsReadingReducedFields(func));
+
 #ifdef GPU
   // Rewrite system assignments
   if (kBackend == "gpu") {
@@ -101,6 +101,11 @@ Func lower(Func func, bool print, bool time) {
   func = rewriteCallGraph(func, insertTemporaries);
   printCallGraph("Insert Temporaries and Flatten Index Expressions", func, print);
 
+  // Multiply with assembled matrices by running their assembly kernels, before
+  // storage is determined so that the matrices are not stored
+  func = rewriteCallGraph(func, lowerMatrixFreeProducts);
+  printCallGraph("Lower Matrix-Free Products", func, print);
+
   // Determine Storage
   func = rewriteCallGraph(func, [](Func func) -> Func {
     updateStorage(func, &func.getStorage(), &func.getEnvironment());
@@ -133,21 +138,33 @@ Func lower(Func func, bool print, bool time) {
   printCallGraph("Normalize Row Indices", func, print);
 
   // Lower maps
-  func = rewriteCallGraph(func, lowerMaps);
+  const string exported = func.getName();
+  func = rewriteCallGraph(func, [&exported](Func f) -> Func {
+    return lowerMaps(f, f.getName() == exported);
+  });
   printCallGraph("Lower Maps", func, print);
 
   // Lower Index Expressions
   func = rewriteCallGraph(func, lowerIndexExpressions);
   printCallGraph("Lower Index Expressions", func, print);
 
+  // Execute maps over bound sets, and the vertex loops that follow them, in
+  // sparse tiles
+  func = lowerSparseTiles(func);
+  printCallGraph("Lower Sparse Tiles", func, print);
+
   // Lower Tensor Reads and Writes
   func = rewriteCallGraph(func, lowerTensorAccesses);
   printCallGraph("Lower Tensor Reads and Writes", func, print);
 
+  // Lower Interleaved Field Accesses
+  func = rewriteCallGraph(func, lowerFieldLayouts);
+  printCallGraph("Lower Field Layouts", func, print);
+
+  // Insert Profiling Regions
   if (time) {
-    printTimedCallGraph("Insert Timers", func, print);
-    func = rewriteCallGraph(func, insertTimers);
-    printCallGraph("Insert Timers", func, print);
+    func = insertProfiling(func);
+    printCallGraph("Insert Profiling", func, print);
   }
 
   // Lower to GPU Kernels
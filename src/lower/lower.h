@@ -8,7 +8,8 @@ namespace ir {
 
 /// Optimize and lower `func` into the low level part of the Simit IR, that is
 /// is supported by backends. If `print` is true, then the IR will be printed
-/// to stdout between each lowering step.
+/// to stdout between each lowering step. If `time` is true, then the function
+/// is instrumented with profiling regions (see insertProfiling).
 Func lower(Func func, bool print=false, bool time=false);
 
 }}
@@ -3,10 +3,12 @@
 #include <algorithm>
 #include <map>
 
+#include "init.h"
 #include "ir_rewriter.h"
 #include "intrinsics.h"
 #include "path_expressions.h"
 #include "tensor_index.h"
+#include "util/collections.h"
 #include "util/util.h"
 #include "var_replace_rewriter.h"
 
@@ -260,6 +262,190 @@ Func lowerTensorAccesses(Func func) {
   return LowerTensorAccesses(func.getStorage()).rewrite(func);
 }
 
+// lowerFieldLayouts
+namespace {
+/// The layout of a set field that is interleaved with other fields.
+struct InterleavedField {
+  FieldLayout layout;
+  int tileWidth;
+  int blockSize;  // components per element in the field
+  int stride;     // components per element in the field group
+  int offset;     // offset of the field in the field group
+};
+}
+
+/// Returns the field group in the given groups that contains the given field
+/// of the given element type, or nullptr if the field is not grouped.
+static const FieldGroup *getFieldGroup(const vector<FieldGroup> &groups,
+                                       const string &elementType,
+                                       const string &field) {
+  for (const FieldGroup &group : groups) {
+    if (group.elementType == elementType && group.layout != FieldLayout::SoA &&
+        util::contains(group.fields, field)) {
+      return &group;
+    }
+  }
+  return nullptr;
+}
+
+static bool getInterleavedField(Expr fieldRead,
+                                const vector<FieldGroup> &groups,
+                                InterleavedField *field) {
+  if (!isa<FieldRead>(fieldRead)) {
+    return false;
+  }
+  const FieldRead *op = to<FieldRead>(fieldRead);
+  if (!op->elementOrSet.type().isSet()) {
+    return false;
+  }
+
+  const ElementType *elemType =
+      op->elementOrSet.type().toSet()->elementType.toElement();
+  const FieldGroup *group = getFieldGroup(groups, elemType->name,
+                                          op->fieldName);
+  if (group == nullptr) {
+    return false;
+  }
+
+  const TensorType *fieldType = elemType->field(op->fieldName).type.toTensor();
+  field->layout = group->layout;
+  field->tileWidth = (group->layout == FieldLayout::AoSoA) ? group->tileWidth
+                                                           : 1;
+  field->blockSize = fieldType->size();
+  field->stride = 0;
+  field->offset = 0;
+  for (const string &name : group->fields) {
+    uassert(elemType->hasField(name))
+        << "Element type " << elemType->name << " has no grouped field "
+        << quote(name);
+    const TensorType *type = elemType->field(name).type.toTensor();
+    uassert(type->getComponentType() == fieldType->getComponentType())
+        << "Interleaved fields must have the same component type";
+    if (name == op->fieldName) {
+      field->offset = field->stride;
+    }
+    field->stride += type->size();
+  }
+  return true;
+}
+
+/// Map the location of a component in the dense (SoA) field to its location in
+/// the interleaved field group.
+static Expr getInterleavedIndex(Expr index, const InterleavedField &field) {
+  Expr elem = index;
+  Expr component = field.offset;
+  if (field.blockSize > 1) {
+    elem = index / field.blockSize;
+    component = (index % field.blockSize) + field.offset;
+  }
+
+  switch (field.layout) {
+    case FieldLayout::AoS:
+      return elem * field.stride + component;
+    case FieldLayout::AoSoA: {
+      int tile = field.tileWidth;
+      return (elem / tile) * (tile * field.stride) + component * tile +
+             elem % tile;
+    }
+    case FieldLayout::SoA:
+      unreachable;
+  }
+  return index;
+}
+
+Func lowerFieldLayouts(Func func) {
+  // Sets bound to the function are converted to the groups it is compiled for
+  func.getEnvironment().setFieldGroups(kFieldGroups);
+  if (kFieldGroups.empty()) {
+    return func;
+  }
+
+  class LowerFieldLayouts : public IRRewriter {
+  public:
+    LowerFieldLayouts(const vector<FieldGroup> &groups) : groups(groups) {}
+
+  private:
+    vector<FieldGroup> groups;
+
+    using IRRewriter::visit;
+
+    void visit(const Load *op) {
+      InterleavedField field;
+      if (getInterleavedField(op->buffer, groups, &field)) {
+        expr = Load::make(op->buffer,
+                          getInterleavedIndex(rewrite(op->index), field));
+      }
+      else {
+        IRRewriter::visit(op);
+      }
+    }
+
+    void visit(const Store *op) {
+      InterleavedField field;
+      if (getInterleavedField(op->buffer, groups, &field)) {
+        stmt = Store::make(op->buffer,
+                           getInterleavedIndex(rewrite(op->index), field),
+                           rewrite(op->value), op->cop);
+      }
+      else {
+        IRRewriter::visit(op);
+      }
+    }
+
+    void visit(const FieldRead *op) {
+      InterleavedField field;
+      tassert(!getInterleavedField(op, groups, &field))
+          << "interleaved field " << quote(Expr(op))
+          << " can only be accessed by element or assigned";
+      IRRewriter::visit(op);
+    }
+
+    /// Copies between interleaved fields and dense tensors are lowered to
+    /// loops over the field components.
+    void visit(const AssignStmt *op) {
+      InterleavedField field;
+      if (op->cop == CompoundOperator::None &&
+          getInterleavedField(op->value, groups, &field)) {
+        Var i(INTERNAL_PREFIX("i"), Int);
+        Stmt copy = Store::make(op->var, i,
+            Load::make(op->value, getInterleavedIndex(i, field)));
+        stmt = ForRange::make(i, 0, getFieldLength(op->value, field), copy);
+      }
+      else {
+        IRRewriter::visit(op);
+      }
+    }
+
+    void visit(const FieldWrite *op) {
+      Expr fieldRead = FieldRead::make(op->elementOrSet, op->fieldName);
+      InterleavedField field;
+      if (getInterleavedField(fieldRead, groups, &field)) {
+        Var i(INTERNAL_PREFIX("i"), Int);
+        Expr value = rewrite(op->value);
+        if (value.type().toTensor()->order() > 0) {
+          tassert(isa<VarExpr>(value))
+              << "only variables can be assigned to interleaved field "
+              << quote(fieldRead);
+          value = Load::make(value, i);
+        }
+        Stmt copy = Store::make(fieldRead, getInterleavedIndex(i, field),
+                                value, op->cop);
+        stmt = ForRange::make(i, 0, getFieldLength(fieldRead, field), copy);
+      }
+      else {
+        IRRewriter::visit(op);
+      }
+    }
+
+    static Expr getFieldLength(Expr fieldRead, const InterleavedField &field) {
+      Expr set = to<FieldRead>(fieldRead)->elementOrSet;
+      return Length::make(IndexSet(set)) * field.blockSize;
+    }
+  };
+  return LowerFieldLayouts(func.getEnvironment().getFieldGroups())
+      .rewrite(func);
+}
+
 Func lowerFieldAccesses(Func func) {
   class FindElementVars : public IRVisitor {
     public:
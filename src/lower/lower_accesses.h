@@ -12,5 +12,9 @@ Func lowerTensorAccesses(Func func);
 
 Func lowerFieldAccesses(Func func);
 
+/// Lower loads from and stores to fields that are interleaved in field groups
+/// (see Settings::fieldGroups) to the address arithmetic of their layout.
+Func lowerFieldLayouts(Func func);
+
 }}
 #endif
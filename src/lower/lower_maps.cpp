@@ -1,5 +1,6 @@
 #include "lower_maps.h"
 
+#include "init.h"
 #include "storage.h"
 #include "ir_builder.h"
 #include "ir_rewriter.h"
@@ -96,15 +97,30 @@ class LowerMapFunctionRewriter : public MapFunctionRewriter {
       }
       else if (storage->getStorage(mapVar).getKind() ==
                TensorStorage::Kind::Indexed) {
-        iassert(locs.defined());
         iassert(op->indices.size() == 2);
-        iassert(endpoints.defined());
+        bool isUpperTriangular =
+            storage->getStorage(mapVar).getTensorIndex().isUpperTriangular();
         vector<Expr> indices;
         for (auto& index : op->indices) {
           iassert(isa<TupleRead>(index)) << index;
           indices.push_back(to<TupleRead>(index)->index);
         }
-        Expr index = TensorRead::make(locs, indices);
+        Expr index;
+        if (locationTable.defined()) {
+          int cardinality = neighbors.getType().toTuple()->size;
+          Expr pair = Add::make(Mul::make(indices[0], cardinality),
+                                indices[1]);
+          index = Load::make(locationTable,
+                             Add::make(Mul::make(targetLoopVar,
+                                                 cardinality*cardinality),
+                                       pair));
+        }
+        else {
+          iassert(endpoints.defined());
+          Var resultLocs = isUpperTriangular ? upperTriangularLocs : locs;
+          iassert(resultLocs.defined());
+          index = TensorRead::make(resultLocs, indices);
+        }
 
         // Change assignments to result to compound  assignments, using the map
         // reduction operator.
@@ -120,6 +136,12 @@ class LowerMapFunctionRewriter : public MapFunctionRewriter {
             break;
           }
         }
+
+        // Upper triangular matrices have no locations for the lower triangle,
+        // which is implied by symmetry.
+        if (isUpperTriangular) {
+          stmt = IfThenElse::make(Ge::make(index, 0), stmt);
+        }
       }
       else {
         // Change assignments to result to compound  assignments, using the map
@@ -142,14 +164,40 @@ class LowerMapFunctionRewriter : public MapFunctionRewriter {
   }
 };
 
+/// Returns the tensor index with a path expression that the matrices of a map
+/// are assembled into, or an undefined index if they have none or several.
+static TensorIndex getAssemblyIndex(const vector<Var>& vars,
+                                    const Storage& storage) {
+  TensorIndex index;
+  for (const Var& var : vars) {
+    const TensorStorage& tensorStorage = storage.getStorage(var);
+    if (tensorStorage.getKind() != TensorStorage::Indexed) {
+      continue;
+    }
+    if (!tensorStorage.hasTensorIndex()) {
+      return TensorIndex();
+    }
+    const TensorIndex& varIndex = tensorStorage.getTensorIndex();
+    if (varIndex.getKind() != TensorIndex::PExpr ||
+        !varIndex.getPathExpression().defined() ||
+        (index.defined() &&
+         varIndex.getRowptrArray() != index.getRowptrArray())) {
+      return TensorIndex();
+    }
+    index = varIndex;
+  }
+  return index;
+}
+
 class LowerMaps : public IRRewriter {
 public:
-  LowerMaps(Storage *storage, Environment *env)
-      : storage(storage), env(env) {}
+  LowerMaps(Storage *storage, Environment *env, const set<Var>& boundSets)
+      : storage(storage), env(env), boundSets(boundSets) {}
 
 private:
   Storage *storage;
   Environment *env;
+  set<Var> boundSets;
   
   using IRRewriter::visit;
 
@@ -157,8 +205,31 @@ private:
     iassert(hasStorage(op->vars, *storage))
         << "Every assembled tensor should have a storage descriptor";
 
+    bool boundEdgeSet =
+        !op->through.defined() && isa<VarExpr>(op->target) &&
+        util::contains(boundSets, to<VarExpr>(op->target)->var) &&
+        op->target.type().isUnstructuredSet() &&
+        op->target.type().toUnstructuredSet()->endpointSets.size() > 0;
+
+    // Visit the edges of bound edge sets in their inspected iteration order
+    Var iterationOrder;
+    if (kIterationOrder && kBackend != "gpu" && boundEdgeSet) {
+      iterationOrder = env->addIterationOrder(to<VarExpr>(op->target)->var);
+    }
+
+    // Assemble the matrices of bound edge sets at precomputed locations
+    Var locationTable;
+    if (kBackend != "gpu" && boundEdgeSet) {
+      TensorIndex index = getAssemblyIndex(op->vars, *storage);
+      if (index.defined()) {
+        locationTable = env->addLocationTable(to<VarExpr>(op->target)->var,
+                                              index).locations;
+      }
+    }
+
     LowerMapFunctionRewriter mapFunctionRewriter;
-    stmt = inlineMap(op, mapFunctionRewriter, storage);
+    stmt = inlineMap(op, mapFunctionRewriter, storage, iterationOrder,
+                     locationTable);
 
     // Add comment
     stmt = Comment::make(util::toString(*op), stmt, true);
@@ -171,7 +242,8 @@ private:
       auto tensorStorage = storage->getStorage(result);
       if (tensorStorage.getKind() == TensorStorage::Indexed) {
         auto& pexpr = tensorStorage.getTensorIndex().getPathExpression();
-        env->addTensorIndex(pexpr, result);
+        env->addTensorIndex(pexpr, result,
+                            tensorStorage.getTensorIndex().isUpperTriangular());
       }
     }
 
@@ -186,8 +258,21 @@ private:
   }
 };
 
-Func lowerMaps(Func func) {
-  Stmt body = LowerMaps(&func.getStorage(),&func.getEnvironment())
+Func lowerMaps(Func func, bool exported) {
+  set<Var> boundSets;
+  if (exported) {
+    for (const Var& argument : func.getArguments()) {
+      if (argument.getType().isSet()) {
+        boundSets.insert(argument);
+      }
+    }
+    for (const Var& ext : func.getEnvironment().getExternVars()) {
+      if (ext.getType().isSet()) {
+        boundSets.insert(ext);
+      }
+    }
+  }
+  Stmt body = LowerMaps(&func.getStorage(), &func.getEnvironment(), boundSets)
       .rewrite(func.getBody());
   func = Func(func, body);
   func = insertVarDecls(func);
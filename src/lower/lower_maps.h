@@ -7,8 +7,11 @@ namespace simit {
 namespace ir {
 
 /// Lower map statements to loops. Map assemblies are lowered to loops that
-/// store the resulting tensors as specified by Func's Storage descriptor.
-Func lowerMaps(Func func);
+/// store the resulting tensors as specified by Func's Storage descriptor. If
+/// `exported` is true, func is the function that sets are bound to, and maps
+/// over its set arguments and externs may visit their edges in an inspected
+/// iteration order (see Settings::iterationOrder).
+Func lowerMaps(Func func, bool exported=false);
 
 }}
 #endif
@@ -0,0 +1,498 @@
+#include "lower_matrix_free.h"
+
+#include <map>
+#include <set>
+
+#include "init.h"
+#include "ir_builder.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "util/collections.h"
+
+using namespace std;
+using namespace simit::internal;
+
+namespace simit {
+namespace ir {
+
+static bool isVar(const Expr& expr, const Var& var) {
+  return isa<VarExpr>(expr) && to<VarExpr>(expr)->var == var;
+}
+
+/// Returns the tensor that a (possibly blocked) tensor write writes to.
+static Expr getWrittenTensor(const TensorWrite* op) {
+  Expr tensor = op->tensor;
+  while (isa<TensorRead>(tensor)) {
+    tensor = to<TensorRead>(tensor)->tensor;
+  }
+  return tensor;
+}
+
+/// Returns the vector x if the statement assigns the product A*x of the
+/// matrix to a variable other than x, or an undefined expression otherwise.
+static Expr getProductVector(const AssignStmt* op, const Var& matrix) {
+  if (op->cop != CompoundOperator::None || !isa<IndexExpr>(op->value)) {
+    return Expr();
+  }
+  const IndexExpr* indexExpr = to<IndexExpr>(op->value);
+  if (indexExpr->resultVars.size() != 1 || !isa<Mul>(indexExpr->value)) {
+    return Expr();
+  }
+  const Mul* mul = to<Mul>(indexExpr->value);
+  if (!isa<IndexedTensor>(mul->a) || !isa<IndexedTensor>(mul->b)) {
+    return Expr();
+  }
+  const IndexedTensor* a = to<IndexedTensor>(mul->a);
+  const IndexedTensor* b = to<IndexedTensor>(mul->b);
+  if (isVar(b->tensor, matrix)) {
+    swap(a, b);
+  }
+  if (!isVar(a->tensor, matrix) || !isa<VarExpr>(b->tensor) ||
+      a->indexVars.size() != 2 || b->indexVars.size() != 1) {
+    return Expr();
+  }
+
+  const IndexVar& i = indexExpr->resultVars[0];
+  const IndexVar& j = a->indexVars[1];
+  if (a->indexVars[0] != i || b->indexVars[0] != j || !j.isReductionVar() ||
+      j.getOperator().getKind() != ReductionOperator::Sum) {
+    return Expr();
+  }
+  const Var& x = to<VarExpr>(b->tensor)->var;
+  if (x == matrix || x == op->var) {
+    return Expr();
+  }
+  return b->tensor;
+}
+
+/// Collects the products y = A*x of a matrix, and whether it is defined or
+/// used in any other way.
+class MatrixUses : public IRVisitor {
+public:
+  vector<const AssignStmt*> products;
+  int numDecls = 0;
+  int numMaps = 0;
+  bool otherUses = false;
+
+  MatrixUses(const Var& matrix) : matrix(matrix) {}
+
+private:
+  Var matrix;
+
+  using IRVisitor::visit;
+
+  void visit(const VarExpr* op) {
+    if (op->var == matrix) {
+      otherUses = true;
+    }
+  }
+
+  void visit(const VarDecl* op) {
+    if (op->var == matrix) {
+      ++numDecls;
+    }
+  }
+
+  void visit(const AssignStmt* op) {
+    if (getProductVector(op, matrix).defined()) {
+      products.push_back(op);
+      return;
+    }
+    if (op->var == matrix) {
+      otherUses = true;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const CallStmt* op) {
+    if (util::contains(op->results, matrix)) {
+      otherUses = true;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Map* op) {
+    if (util::contains(op->vars, matrix)) {
+      ++numMaps;
+    }
+    IRVisitor::visit(op);
+  }
+};
+
+/// Checks whether statements write fields, directly, in the kernels of their
+/// maps or in the functions they call.
+class FieldWrites : public IRVisitor {
+public:
+  bool check(const Stmt& stmt) {
+    stmt.accept(this);
+    return writes;
+  }
+
+private:
+  bool writes = false;
+
+  using IRVisitor::visit;
+
+  void visit(const FieldWrite* op) {
+    writes = true;
+  }
+
+  void visit(const TensorWrite* op) {
+    if (isa<FieldRead>(getWrittenTensor(op))) {
+      writes = true;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Map* op) {
+    if (op->function.getBody().defined()) {
+      op->function.getBody().accept(this);
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const CallStmt* op) {
+    if (op->callee.getKind() == Func::Internal &&
+        op->callee.getBody().defined()) {
+      op->callee.getBody().accept(this);
+    }
+    else if (op->callee.getKind() != Func::Intrinsic) {
+      writes = true;
+    }
+    IRVisitor::visit(op);
+  }
+};
+
+/// Collects the variables that statements assign to.
+class WrittenVars : public IRVisitor {
+public:
+  set<Var> written;
+
+private:
+  using IRVisitor::visit;
+
+  void visit(const AssignStmt* op) {
+    written.insert(op->var);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const CallStmt* op) {
+    written.insert(op->results.begin(), op->results.end());
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Map* op) {
+    written.insert(op->vars.begin(), op->vars.end());
+    IRVisitor::visit(op);
+  }
+
+  void visit(const TensorWrite* op) {
+    Expr tensor = getWrittenTensor(op);
+    if (isa<VarExpr>(tensor)) {
+      written.insert(to<VarExpr>(tensor)->var);
+    }
+    IRVisitor::visit(op);
+  }
+};
+
+/// Collects the variables that expressions read.
+class ReadVars : public IRVisitor {
+public:
+  set<Var> read;
+
+private:
+  using IRVisitor::visit;
+
+  void visit(const VarExpr* op) {
+    read.insert(op->var);
+  }
+};
+
+/// Checks that an assembly kernel only writes whole blocks of its result, and
+/// does not read it.
+class ElementwiseAssembly : public IRVisitor {
+public:
+  ElementwiseAssembly(const Var& result) : result(result) {}
+
+  bool check(const Stmt& body) {
+    body.accept(this);
+    return elementwise;
+  }
+
+private:
+  Var result;
+  bool elementwise = true;
+
+  using IRVisitor::visit;
+
+  void visit(const VarExpr* op) {
+    if (op->var == result) {
+      elementwise = false;
+    }
+  }
+
+  void visit(const AssignStmt* op) {
+    if (op->var == result) {
+      elementwise = false;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const CallStmt* op) {
+    if (util::contains(op->results, result)) {
+      elementwise = false;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const TensorWrite* op) {
+    if (!isVar(op->tensor, result)) {
+      IRVisitor::visit(op);
+      return;
+    }
+    if (op->indices.size() != 2) {
+      elementwise = false;
+    }
+    for (const Expr& index : op->indices) {
+      index.accept(this);
+    }
+    op->value.accept(this);
+  }
+};
+
+/// Rewrites the writes of an assembly kernel to the blocks A(i,j) of its
+/// result into writes of the products A(i,j)*x(j) to the blocks y(i) of a
+/// vector.
+class MatrixFreeKernel : public IRRewriter {
+public:
+  MatrixFreeKernel(const Var& matrix, const Var& x, const Var& y)
+      : matrix(matrix), x(x), y(y) {}
+
+private:
+  Var matrix;
+  Var x;
+  Var y;
+
+  using IRRewriter::visit;
+
+  void visit(const TensorWrite* op) {
+    if (!isVar(op->tensor, matrix)) {
+      IRRewriter::visit(op);
+      return;
+    }
+    iassert(op->indices.size() == 2);
+    const Expr& row = op->indices[0];
+    const Expr& col = op->indices[1];
+    Expr value = rewrite(op->value);
+    Expr xBlock = TensorRead::make(VarExpr::make(x), {col});
+
+    Type blockType = matrix.getType().toTensor()->getBlockType();
+    if (isScalar(blockType)) {
+      stmt = TensorWrite::make(VarExpr::make(y), {row},
+                               Mul::make(value, xBlock), op->cop);
+      return;
+    }
+
+    // Computed blocks are stored in a variable, to keep index expressions flat
+    vector<Stmt> stmts;
+    Expr block = value;
+    if (!isa<VarExpr>(value) && !isa<FieldRead>(value)) {
+      Var blockVar(INTERNAL_PREFIX("block"), blockType);
+      stmts.push_back(VarDecl::make(blockVar));
+      stmts.push_back(AssignStmt::make(blockVar, value));
+      block = VarExpr::make(blockVar);
+    }
+    stmts.push_back(TensorWrite::make(VarExpr::make(y), {row},
+                                      IRBuilder().gemv(block, xBlock),
+                                      op->cop));
+    stmt = Block::make(stmts);
+  }
+};
+
+class MatrixFreeProducts : public IRRewriter {
+public:
+  MatrixFreeProducts(const Func& func) : func(func) {}
+
+private:
+  Func func;
+
+  /// The maps that assemble the matrix-free matrices, and the kernels that
+  /// multiply their blocks with each vector.
+  map<Var, const Map*> assemblies;
+  map<pair<Var,Var>, Func> kernels;
+
+  using IRRewriter::visit;
+
+  static void flatten(const Stmt& stmt, vector<Stmt>* stmts) {
+    if (isa<Block>(stmt)) {
+      flatten(to<Block>(stmt)->first, stmts);
+      if (to<Block>(stmt)->rest.defined()) {
+        flatten(to<Block>(stmt)->rest, stmts);
+      }
+    }
+    else {
+      stmts->push_back(stmt);
+    }
+  }
+
+  /// Whether the map assembles a matrix that may be replaced by products.
+  bool isAssembly(const Map* map) {
+    if (map->vars.size() != 1 ||
+        map->reduction.getKind() != ReductionOperator::Sum ||
+        map->through.defined() || !map->target.type().isUnstructuredSet()) {
+      return false;
+    }
+    const Var& matrix = map->vars[0];
+    if (!matrix.getType().isTensor() ||
+        matrix.getType().toTensor()->order() != 2 ||
+        util::contains(func.getArguments(), matrix) ||
+        util::contains(func.getResults(), matrix)) {
+      return false;
+    }
+
+    const Func& kernel = map->function;
+    if (kernel.getKind() != Func::Internal || !kernel.getBody().defined() ||
+        kernel.getResults().size() != 1) {
+      return false;
+    }
+    return ElementwiseAssembly(kernel.getResults()[0]).check(kernel.getBody())
+        && !FieldWrites().check(kernel.getBody());
+  }
+
+  /// Returns the number of statements after the assembly at stmts[i] up to
+  /// and including the last product of its matrix, or 0 if the matrix cannot
+  /// be replaced by products. The products must all be in these statements,
+  /// which may not write fields or the partial actuals of the assembly.
+  size_t countProductStmts(const vector<Stmt>& stmts, size_t i) {
+    const Map* map = to<Map>(stmts[i]);
+    const Var& matrix = map->vars[0];
+
+    MatrixUses uses(matrix);
+    func.getBody().accept(&uses);
+    if (uses.otherUses || uses.numDecls != 1 || uses.numMaps != 1 ||
+        uses.products.size() == 0) {
+      return 0;
+    }
+
+    size_t numStmts = 0;
+    size_t numProducts = 0;
+    for (size_t j = i+1; j < stmts.size(); ++j) {
+      MatrixUses stmtUses(matrix);
+      stmts[j].accept(&stmtUses);
+      if (stmtUses.products.size() > 0) {
+        numProducts += stmtUses.products.size();
+        numStmts = j - i;
+      }
+    }
+    if (numProducts != uses.products.size()) {
+      return 0;
+    }
+
+    ReadVars actuals;
+    for (const Expr& actual : map->partial_actuals) {
+      actual.accept(&actuals);
+    }
+    for (size_t j = i+1; j <= i+numStmts; ++j) {
+      if (FieldWrites().check(stmts[j])) {
+        return 0;
+      }
+      WrittenVars writes;
+      stmts[j].accept(&writes);
+      for (const Var& var : actuals.read) {
+        if (util::contains(writes.written, var)) {
+          return 0;
+        }
+      }
+    }
+    return numStmts;
+  }
+
+  /// Creates a kernel that computes the products of the assembly's blocks
+  /// with the product's vector. The kernel reads the vector directly instead
+  /// of taking it as a partial actual, which would copy it every time.
+  Func createKernel(const Map* map, const AssignStmt* product) {
+    const Func& assembly = map->function;
+    const Var& matrix = assembly.getResults()[0];
+    const Var& x = to<VarExpr>(getProductVector(product, map->vars[0]))->var;
+    Var y(product->var.getName(), product->var.getType());
+    Stmt body = MatrixFreeKernel(matrix, x, y).rewrite(assembly.getBody());
+    return Func(assembly.getName() + "_" + x.getName(),
+                assembly.getArguments(), {y}, body,
+                assembly.getEnvironment());
+  }
+
+  void visit(const Block* op) {
+    vector<Stmt> stmts;
+    flatten(op, &stmts);
+
+    set<size_t> removed;
+    for (size_t i = 0; i < stmts.size(); ++i) {
+      if (!isa<Map>(stmts[i]) || !isAssembly(to<Map>(stmts[i]))) {
+        continue;
+      }
+      const Map* map = to<Map>(stmts[i]);
+      const Var& matrix = map->vars[0];
+
+      // The matrix must be declared in the same block, so that its
+      // declaration can be removed with the assembly
+      size_t decl = i;
+      for (size_t j = 0; j < i; ++j) {
+        if (isa<VarDecl>(stmts[j]) && to<VarDecl>(stmts[j])->var == matrix) {
+          decl = j;
+        }
+      }
+      if (decl == i || countProductStmts(stmts, i) == 0) {
+        continue;
+      }
+
+      MatrixUses uses(matrix);
+      func.getBody().accept(&uses);
+      for (const AssignStmt* product : uses.products) {
+        const Var& x = to<VarExpr>(getProductVector(product, matrix))->var;
+        if (!util::contains(kernels, make_pair(matrix, x))) {
+          kernels.insert({{matrix, x}, createKernel(map, product)});
+        }
+      }
+      assemblies.insert({matrix, map});
+      removed.insert(decl);
+      removed.insert(i);
+    }
+
+    if (removed.size() == 0) {
+      IRRewriter::visit(op);
+      return;
+    }
+    vector<Stmt> result;
+    for (size_t i = 0; i < stmts.size(); ++i) {
+      if (!util::contains(removed, i)) {
+        result.push_back(rewrite(stmts[i]));
+      }
+    }
+    stmt = Block::make(result);
+  }
+
+  void visit(const AssignStmt* op) {
+    for (auto& assembly : assemblies) {
+      Expr x = getProductVector(op, assembly.first);
+      if (x.defined()) {
+        const Map* map = assembly.second;
+        const Func& kernel = kernels.at({assembly.first,
+                                         to<VarExpr>(x)->var});
+        stmt = Map::make({op->var}, kernel, map->partial_actuals, map->target,
+                         map->neighbors, Expr(), map->reduction);
+        return;
+      }
+    }
+    IRRewriter::visit(op);
+  }
+};
+
+Func lowerMatrixFreeProducts(Func func) {
+  if (!kMatrixFree || kBackend == "gpu") {
+    return func;
+  }
+  Stmt body = MatrixFreeProducts(func).rewrite(func.getBody());
+  return Func(func, body);
+}
+
+}}
@@ -0,0 +1,25 @@
+#ifndef SIMIT_LOWER_MATRIX_FREE_H
+#define SIMIT_LOWER_MATRIX_FREE_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Replaces the matrix-vector products `y = A*x` of a matrix assembled by a
+/// map, `A = map f to edges reduce +`, with maps of a kernel that computes the
+/// contributions of each element to A as f does and multiplies them with x,
+/// so that A is never stored (matrix-free products). This trades the memory
+/// traffic of the assembled matrix for recomputing the elements' blocks every
+/// time A is applied, e.g. in every iteration of a Krylov solver.
+///
+/// Matrices are only made matrix-free when they are not arguments or results
+/// of the function, f only writes them elementwise, they are only multiplied
+/// with vector variables after the map, and no fields, partial actuals of the
+/// map or calls that might change them are written before the last product.
+/// Other matrices are assembled as before. Enabled by Settings::matrixFree.
+Func lowerMatrixFreeProducts(Func func);
+
+}}
+
+#endif
@@ -0,0 +1,477 @@
+#include "lower_sparse_tiles.h"
+
+#include <set>
+
+#include "init.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "util/collections.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+static bool isVar(const Expr& expr, const Var& var) {
+  return isa<VarExpr>(expr) && to<VarExpr>(expr)->var == var;
+}
+
+static bool isSameSet(const Expr& a, const Expr& b) {
+  return isa<VarExpr>(a) && isa<VarExpr>(b) &&
+         to<VarExpr>(a)->var == to<VarExpr>(b)->var;
+}
+
+/// Returns the vertex set of an edge set whose endpoints are all in the same
+/// set, or an undefined expression otherwise.
+static Expr getVertexSet(const Expr& edgeSet) {
+  if (!edgeSet.type().isUnstructuredSet()) {
+    return Expr();
+  }
+  const vector<Expr*>& endpointSets =
+      edgeSet.type().toUnstructuredSet()->endpointSets;
+  if (endpointSets.size() == 0) {
+    return Expr();
+  }
+  for (const Expr* endpointSet : endpointSets) {
+    if (!isSameSet(*endpointSet, *endpointSets[0])) {
+      return Expr();
+    }
+  }
+  return *endpointSets[0];
+}
+
+/// Returns the set of a loop over a set, or an undefined expression if the
+/// statement is not such a loop.
+static Expr getLoopSet(const Stmt& stmt) {
+  if (!isa<For>(stmt)) {
+    return Expr();
+  }
+  const ForDomain& domain = to<For>(stmt)->domain;
+  if (domain.kind != ForDomain::IndexSet ||
+      domain.indexSet.getKind() != IndexSet::Set) {
+    return Expr();
+  }
+  return domain.indexSet.getSet();
+}
+
+/// Collects the variables declared outside a statement that it assigns to.
+class OuterWrites : public IRVisitor {
+public:
+  set<Var> declared;
+  set<Var> written;
+
+private:
+  using IRVisitor::visit;
+
+  void visit(const VarDecl* op) {
+    declared.insert(op->var);
+  }
+
+  void visit(const ForRange* op) {
+    declared.insert(op->var);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const For* op) {
+    declared.insert(op->var);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const AssignStmt* op) {
+    if (!util::contains(declared, op->var)) {
+      written.insert(op->var);
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const CallStmt* op) {
+    for (const Var& result : op->results) {
+      if (!util::contains(declared, result)) {
+        written.insert(result);
+      }
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const TensorWrite* op) {
+    Expr tensor = op->tensor;
+    while (isa<TensorRead>(tensor)) {
+      tensor = to<TensorRead>(tensor)->tensor;
+    }
+    if (isa<VarExpr>(tensor) &&
+        !util::contains(declared, to<VarExpr>(tensor)->var)) {
+      written.insert(to<VarExpr>(tensor)->var);
+    }
+    IRVisitor::visit(op);
+  }
+};
+
+/// Checks that a loop over the vertex set is pointwise: it only accesses
+/// vertex-indexed tensors at the loop vertex, writes nothing declared outside
+/// of it except vertex-indexed tensors, and does not read the outer variables
+/// in `forbidden`.
+class PointwiseLoop : public IRVisitor {
+public:
+  PointwiseLoop(const Var& vertex, const Expr& vertexSet,
+                const set<Var>& forbidden)
+      : vertex(vertex), vertexSet(vertexSet), forbidden(forbidden),
+        pointwise(true) {}
+
+  bool check(const Stmt& body) {
+    body.accept(this);
+    return pointwise;
+  }
+
+private:
+  Var vertex;
+  Expr vertexSet;
+  const set<Var>& forbidden;
+  set<Var> declared;
+  bool pointwise;
+
+  using IRVisitor::visit;
+
+  bool isVertexIndexed(const Type& type) {
+    if (!type.isTensor()) {
+      return false;
+    }
+    for (const IndexSet& dim : type.toTensor()->getOuterDimensions()) {
+      if (dim.getKind() == IndexSet::Set &&
+          isSameSet(dim.getSet(), vertexSet)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Vertex-indexed dimensions must be indexed by the loop vertex
+  void checkAccess(const Expr& tensor, const vector<Expr>& indices) {
+    if (isVertexIndexed(tensor.type())) {
+      vector<IndexSet> dims = tensor.type().toTensor()->getOuterDimensions();
+      if (indices.size() != dims.size()) {
+        pointwise = false;
+        return;
+      }
+      for (size_t i = 0; i < dims.size(); ++i) {
+        if (dims[i].getKind() == IndexSet::Set &&
+            isSameSet(dims[i].getSet(), vertexSet) &&
+            !isVar(indices[i], vertex)) {
+          pointwise = false;
+        }
+      }
+    }
+    for (const Expr& index : indices) {
+      index.accept(this);
+    }
+
+    // The accessed tensor may be a variable, a field or a block of a tensor
+    if (isa<VarExpr>(tensor)) {
+      const Var& var = to<VarExpr>(tensor)->var;
+      if (util::contains(forbidden, var) && !isVertexIndexed(var.getType())) {
+        pointwise = false;
+      }
+    }
+    else if (!isa<FieldRead>(tensor)) {
+      tensor.accept(this);
+    }
+  }
+
+  void visit(const VarExpr* op) {
+    if (isVertexIndexed(op->type) || util::contains(forbidden, op->var)) {
+      pointwise = false;
+    }
+  }
+
+  void visit(const FieldRead* op) {
+    // Whole fields may only be accessed through tensor reads and writes
+    if (isVertexIndexed(op->type)) {
+      pointwise = false;
+    }
+  }
+
+  void visit(const TensorRead* op) {
+    checkAccess(op->tensor, op->indices);
+  }
+
+  void visit(const TensorWrite* op) {
+    checkAccess(op->tensor, op->indices);
+    op->value.accept(this);
+
+    Expr tensor = op->tensor;
+    while (isa<TensorRead>(tensor)) {
+      tensor = to<TensorRead>(tensor)->tensor;
+    }
+    if (!isVertexIndexed(tensor.type()) &&
+        !(isa<VarExpr>(tensor) &&
+          util::contains(declared, to<VarExpr>(tensor)->var))) {
+      pointwise = false;
+    }
+  }
+
+  void visit(const VarDecl* op) {
+    declared.insert(op->var);
+  }
+
+  void visit(const AssignStmt* op) {
+    if (!util::contains(declared, op->var)) {
+      pointwise = false;
+    }
+    op->value.accept(this);
+  }
+
+  void visit(const ForRange* op) {
+    declared.insert(op->var);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const For* op) {
+    // Loops over the vertex's blocks are fine, loops over sets are not
+    if (op->domain.kind != ForDomain::IndexSet ||
+        op->domain.indexSet.getKind() != IndexSet::Range) {
+      pointwise = false;
+      return;
+    }
+    declared.insert(op->var);
+    op->body.accept(this);
+  }
+
+  void visit(const CallStmt* op) {
+    pointwise = false;
+  }
+
+  void visit(const Load* op) {
+    pointwise = false;
+  }
+
+  void visit(const Store* op) {
+    pointwise = false;
+  }
+
+  void visit(const FieldWrite* op) {
+    pointwise = false;
+  }
+
+  void visit(const Map* op) {
+    pointwise = false;
+  }
+};
+
+/// Checks that an expression only combines literals and the scalar variables
+/// that are not in `forbidden`, so that it can be evaluated earlier.
+class ScalarExpr : public IRVisitor {
+public:
+  ScalarExpr(const set<Var>& forbidden) : forbidden(forbidden), scalar(true) {}
+
+  bool check(const Expr& expr) {
+    expr.accept(this);
+    return scalar;
+  }
+
+private:
+  const set<Var>& forbidden;
+  bool scalar;
+
+  using IRVisitor::visit;
+
+  void visit(const VarExpr* op) {
+    if (!isScalar(op->type) || util::contains(forbidden, op->var)) {
+      scalar = false;
+    }
+  }
+
+  void visit(const FieldRead* op)   {scalar = false;}
+  void visit(const TensorRead* op)  {scalar = false;}
+  void visit(const TupleRead* op)   {scalar = false;}
+  void visit(const IndexedTensor* op) {scalar = false;}
+  void visit(const IndexExpr* op)   {scalar = false;}
+  void visit(const Length* op)      {scalar = false;}
+  void visit(const Load* op)        {scalar = false;}
+};
+
+class SparseTiler : public IRRewriter {
+public:
+  SparseTiler(Environment* environment, const set<Var>& boundSets,
+              int tileSize)
+      : environment(environment), boundSets(boundSets), tileSize(tileSize) {}
+
+private:
+  Environment* environment;
+  set<Var> boundSets;
+  int tileSize;
+
+  using IRRewriter::visit;
+
+  static void flatten(const Stmt& stmt, vector<Stmt>* stmts) {
+    if (isa<Block>(stmt)) {
+      flatten(to<Block>(stmt)->first, stmts);
+      if (to<Block>(stmt)->rest.defined()) {
+        flatten(to<Block>(stmt)->rest, stmts);
+      }
+    }
+    else if (isa<Comment>(stmt) && to<Comment>(stmt)->commentedStmt.defined()) {
+      const Comment* comment = to<Comment>(stmt);
+      stmts->push_back(Comment::make(comment->comment, Stmt(), false,
+                                     comment->headerSpace));
+      flatten(comment->commentedStmt, stmts);
+    }
+    else if (isa<Scope>(stmt)) {
+      // Inlined maps scope their loop
+      vector<Stmt> scoped;
+      flatten(to<Scope>(stmt)->scopedStmt, &scoped);
+      stmts->push_back((scoped.size() == 1 && isa<For>(scoped[0]))
+                       ? scoped[0] : stmt);
+    }
+    else {
+      stmts->push_back(stmt);
+    }
+  }
+
+  /// Returns the number of statements after the edge loop at stmts[i] that are
+  /// executed with it in sparse tiles. These are pointwise loops over the
+  /// vertex set, and the comments and scalar computations between them, which
+  /// are hoisted out of the tiles.
+  size_t countTiledStmts(const vector<Stmt>& stmts, size_t i) {
+    Expr edgeSet = getLoopSet(stmts[i]);
+    if (!edgeSet.defined() || !isa<VarExpr>(edgeSet) ||
+        !util::contains(boundSets, to<VarExpr>(edgeSet)->var)) {
+      return 0;
+    }
+    Expr vertexSet = getVertexSet(edgeSet);
+    if (!vertexSet.defined() || !isa<VarExpr>(vertexSet)) {
+      return 0;
+    }
+
+    OuterWrites edgeWrites;
+    to<For>(stmts[i])->body.accept(&edgeWrites);
+    const set<Var>& forbidden = edgeWrites.written;
+
+    set<Var> hoisted;
+    size_t numStmts = 0;
+    for (size_t j = i+1; j < stmts.size(); ++j) {
+      const Stmt& stmt = stmts[j];
+      if (isa<Comment>(stmt)) {
+        continue;
+      }
+      if (isa<VarDecl>(stmt) && isScalar(to<VarDecl>(stmt)->var.getType())) {
+        hoisted.insert(to<VarDecl>(stmt)->var);
+        continue;
+      }
+      if (isa<AssignStmt>(stmt)) {
+        const AssignStmt* assign = to<AssignStmt>(stmt);
+        if (util::contains(hoisted, assign->var) &&
+            ScalarExpr(forbidden).check(assign->value)) {
+          continue;
+        }
+        break;
+      }
+
+      Expr loopSet = getLoopSet(stmt);
+      if (!loopSet.defined() || !isSameSet(loopSet, vertexSet)) {
+        break;
+      }
+      const For* loop = to<For>(stmt);
+      if (!PointwiseLoop(loop->var, vertexSet, forbidden).check(loop->body)) {
+        break;
+      }
+      numStmts = j - i;
+    }
+    return numStmts;
+  }
+
+  Stmt tile(const For* edgeLoop, const vector<Stmt>& tiledStmts) {
+    Expr edgeSet = edgeLoop->domain.indexSet.getSet();
+    Expr vertexSet = getVertexSet(edgeSet);
+    const SparseTiling& tiling =
+        environment->addSparseTiling(to<VarExpr>(edgeSet)->var, tileSize);
+
+    Var tile(INTERNAL_PREFIX("tile"), Int);
+    Var k(INTERNAL_PREFIX("k"), Int);
+    Var vertexEnd(INTERNAL_PREFIX("vertexEnd"), Int);
+    Expr numVertices = Length::make(IndexSet(vertexSet));
+    Expr numTiles = Div::make(Add::make(numVertices, tileSize-1), tileSize);
+
+    vector<Stmt> result;
+    result.push_back(VarDecl::make(edgeLoop->var));
+    result.push_back(VarDecl::make(vertexEnd));
+
+    // The edges of the tile
+    Stmt nextEdge = AssignStmt::make(edgeLoop->var,
+                                     Load::make(tiling.tileEdges, k));
+    vector<Stmt> tileBody;
+    tileBody.push_back(ForRange::make(k,
+        Load::make(tiling.tileStarts, tile),
+        Load::make(tiling.tileStarts, Add::make(tile, 1)),
+        Block::make(nextEdge, rewrite(edgeLoop->body))));
+
+    // The vertices of the tile
+    Expr vertexStart = Mul::make(tile, tileSize);
+    tileBody.push_back(AssignStmt::make(vertexEnd,
+                                        Add::make(vertexStart, tileSize)));
+    tileBody.push_back(IfThenElse::make(Gt::make(vertexEnd, numVertices),
+                                        AssignStmt::make(vertexEnd,
+                                                         numVertices)));
+    for (const Stmt& stmt : tiledStmts) {
+      if (isa<For>(stmt)) {
+        const For* loop = to<For>(stmt);
+        tileBody.push_back(ForRange::make(loop->var, vertexStart, vertexEnd,
+                                          rewrite(loop->body)));
+      }
+      else if (isa<Comment>(stmt)) {
+        tileBody.push_back(stmt);
+      }
+      else {
+        result.push_back(stmt);
+      }
+    }
+
+    result.push_back(ForRange::make(tile, 0, numTiles, Block::make(tileBody)));
+    return Block::make(result);
+  }
+
+  void visit(const Block* op) {
+    vector<Stmt> stmts;
+    flatten(op, &stmts);
+
+    vector<Stmt> result;
+    bool tiled = false;
+    for (size_t i = 0; i < stmts.size(); ++i) {
+      size_t numStmts = countTiledStmts(stmts, i);
+      if (numStmts == 0) {
+        result.push_back(rewrite(stmts[i]));
+        continue;
+      }
+      vector<Stmt> tiledStmts(stmts.begin()+i+1, stmts.begin()+i+1+numStmts);
+      result.push_back(tile(to<For>(stmts[i]), tiledStmts));
+      i += numStmts;
+      tiled = true;
+    }
+
+    if (!tiled) {
+      IRRewriter::visit(op);
+      return;
+    }
+    stmt = Block::make(result);
+  }
+};
+
+Func lowerSparseTiles(Func func) {
+  if (kSparseTileSize <= 0 || kBackend == "gpu") {
+    return func;
+  }
+  set<Var> boundSets;
+  for (const Var& argument : func.getArguments()) {
+    if (argument.getType().isSet()) {
+      boundSets.insert(argument);
+    }
+  }
+  for (const Var& ext : func.getEnvironment().getExternVars()) {
+    if (ext.getType().isSet()) {
+      boundSets.insert(ext);
+    }
+  }
+  Stmt body = SparseTiler(&func.getEnvironment(), boundSets, kSparseTileSize)
+      .rewrite(func.getBody());
+  return Func(func, body);
+}
+
+}}
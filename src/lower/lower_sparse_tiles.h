@@ -0,0 +1,24 @@
+#ifndef SIMIT_LOWER_SPARSE_TILES_H
+#define SIMIT_LOWER_SPARSE_TILES_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Executes a map over an edge set bound to the function, and the loops over
+/// the edge set's vertices that follow it, tile by tile (full sparse tiling).
+/// Vertex tile t holds the Settings::sparseTileSize vertices stored at
+/// locations [t*size, (t+1)*size), and the edges whose smallest endpoint is in
+/// the tile. Every edge that touches a tile is therefore executed by it or by
+/// an earlier tile, so the vertex loops of a tile can run as soon as its edges
+/// are done and the map results of the tile are still in cache. The vertex
+/// loops must be pointwise: they may only access vertex-indexed tensors at the
+/// loop vertex and may not write anything else. Scalar computations between
+/// the loops are hoisted out of the tiles. Sequences that do not qualify are
+/// left as they are.
+Func lowerSparseTiles(Func func);
+
+}}
+
+#endif
@@ -0,0 +1,627 @@
+#include "multigrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "block_cg.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+// The damping of the Jacobi smoother, which damps the high frequencies of
+// Poisson-like operators in one to three dimensions
+const double kSmootherWeight = 2.0/3.0;
+const int kNumSweeps = 2;
+const int kNumCoarsestSweeps = 20;
+
+// Lattices are coarsened until they have at most this many points, and the
+// coarsest lattice is solved directly if it has at most kMaxDenseRows rows
+const int kMinCoarsePoints = 64;
+const int kMaxDenseRows = 512;
+
+int getNumPoints(const vector<int>& dims) {
+  int numPoints = 1;
+  for (int dim : dims) {
+    numPoints *= dim;
+  }
+  return numPoints;
+}
+
+// The index of the point at the given coordinates, which wrap around
+int getPoint(const vector<int>& dims, const vector<int>& coords) {
+  int point = 0;
+  for (int d=dims.size()-1; d >= 0; --d) {
+    point = point*dims[d] + ((coords[d] % dims[d]) + dims[d]) % dims[d];
+  }
+  return point;
+}
+
+vector<int> getCoords(const vector<int>& dims, int point) {
+  vector<int> coords(dims.size());
+  for (size_t d=0; d < dims.size(); ++d) {
+    coords[d] = point % dims[d];
+    point /= dims[d];
+  }
+  return coords;
+}
+
+vector<int> computeNeighbors(const vector<int>& dims,
+                             const vector<vector<int>>& offsets) {
+  const int numPoints = getNumPoints(dims);
+  const int stencilSize = offsets.size();
+  vector<int> neighbors(numPoints*stencilSize);
+  vector<int> coords(dims.size());
+  for (int i=0; i < numPoints; ++i) {
+    const vector<int> point = getCoords(dims, i);
+    for (int e=0; e < stencilSize; ++e) {
+      for (size_t d=0; d < dims.size(); ++d) {
+        coords[d] = point[d] + offsets[e][d];
+      }
+      neighbors[i*stencilSize + e] = getPoint(dims, coords);
+    }
+  }
+  return neighbors;
+}
+
+template <typename Float>
+void multiplyStencil(int numPoints, int stencilSize, int bs,
+                     const int* neighbors, const Float* vals,
+                     const Float* x, Float* y) {
+  const int bs2 = bs*bs;
+  for (int i=0; i < numPoints; ++i) {
+    Float* yi = &y[i*bs];
+    fill(yi, yi+bs, (Float)0);
+    for (int e=0; e < stencilSize; ++e) {
+      const int ie = i*stencilSize + e;
+      const Float* a = &vals[ie*bs2];
+      const Float* xj = &x[neighbors[ie]*bs];
+      for (int bi=0; bi < bs; ++bi) {
+        for (int bj=0; bj < bs; ++bj) {
+          yi[bi] += a[bi*bs+bj] * xj[bj];
+        }
+      }
+    }
+  }
+}
+
+// The inverses of the diagonal blocks of the rows, which are the sums of the
+// blocks that couple points to themselves, or of their diagonals if blocks is
+// false. Zeros on the diagonal and singular blocks are left out.
+template <typename Float>
+vector<Float> invertDiagonal(int numPoints, int stencilSize, int bs,
+                             const int* neighbors, const Float* vals,
+                             bool blocks) {
+  const int bs2 = bs*bs;
+  vector<Float> inverses(numPoints*bs2, (Float)0);
+  vector<double> block(bs2);
+  for (int i=0; i < numPoints; ++i) {
+    fill(block.begin(), block.end(), 0.0);
+    for (int e=0; e < stencilSize; ++e) {
+      const int ie = i*stencilSize + e;
+      if (neighbors[ie] == i) {
+        for (int k=0; k < bs2; ++k) {
+          block[k] += vals[ie*bs2 + k];
+        }
+      }
+    }
+    Float* inverse = &inverses[i*bs2];
+    if (blocks && invertMatrix(bs, block)) {
+      copy(block.begin(), block.end(), inverse);
+      continue;
+    }
+    for (int bi=0; bi < bs; ++bi) {
+      const double d = blocks ? 0.0 : block[bi*bs+bi];
+      inverse[bi*bs+bi] = (d != 0.0) ? 1.0/d : 1.0;
+    }
+  }
+  return inverses;
+}
+
+template <typename Float>
+void multiplyBlocks(int numPoints, int bs, const Float* blocks,
+                    const Float* x, Float* y) {
+  for (int i=0; i < numPoints; ++i) {
+    const Float* block = &blocks[i*bs*bs];
+    for (int bi=0; bi < bs; ++bi) {
+      Float sum = 0;
+      for (int bj=0; bj < bs; ++bj) {
+        sum += block[bi*bs+bj] * x[i*bs+bj];
+      }
+      y[i*bs+bi] = sum;
+    }
+  }
+}
+
+template <typename Float>
+double dot(size_t n, const Float* a, const Float* b) {
+  double sum = 0.0;
+  for (size_t k=0; k < n; ++k) {
+    sum += (double)a[k] * b[k];
+  }
+  return sum;
+}
+
+}
+
+int StencilStructure::getNumPoints() const {
+  return simit::getNumPoints(dims);
+}
+
+template <typename Float>
+GeometricMultigrid<Float>::GeometricMultigrid(const StencilStructure& structure)
+    : blockSize(structure.blockSize) {
+  uassert(!structure.dims.empty() && !structure.offsets.empty())
+      << "Multigrid requires a lattice stencil";
+  const int numDims = structure.dims.size();
+
+  Level fine;
+  fine.dims = structure.dims;
+  fine.numPoints = structure.getNumPoints();
+  fine.stencilSize = structure.offsets.size();
+  fine.neighbors = computeNeighbors(fine.dims, structure.offsets);
+  fine.vals = nullptr;
+  levels.push_back(fine);
+
+  vector<vector<int>> offsets = structure.offsets;
+  while (levels.back().numPoints > kMinCoarsePoints) {
+    const vector<int>& fineDims = levels.back().dims;
+    vector<bool> coarsened(numDims);
+    bool anyCoarsened = false;
+    for (int d=0; d < numDims; ++d) {
+      coarsened[d] = fineDims[d] % 2 == 0 && fineDims[d] >= 4;
+      anyCoarsened = anyCoarsened || coarsened[d];
+    }
+    if (!anyCoarsened) {
+      break;
+    }
+
+    Level coarse;
+    coarse.vals = nullptr;
+    for (int d=0; d < numDims; ++d) {
+      coarse.dims.push_back(coarsened[d] ? fineDims[d]/2 : fineDims[d]);
+    }
+    coarse.numPoints = getNumPoints(coarse.dims);
+
+    // The children of a coarse point, at offsets in {-1,0,1} in the coarsened
+    // dimensions, with the tensor products of the weights 1/2, 1, 1/2
+    vector<vector<int>> childOffsets = {{}};
+    for (int d=0; d < numDims; ++d) {
+      vector<vector<int>> extended;
+      for (const vector<int>& offset : childOffsets) {
+        for (int s = coarsened[d] ? -1 : 0; s <= (coarsened[d] ? 1 : 0); ++s) {
+          extended.push_back(offset);
+          extended.back().push_back(s);
+        }
+      }
+      childOffsets = extended;
+    }
+    const int numChildren = childOffsets.size();
+    for (const vector<int>& s : childOffsets) {
+      double weight = 1.0;
+      for (int d=0; d < numDims; ++d) {
+        weight *= (s[d] == 0) ? 1.0 : 0.5;
+      }
+      coarse.childWeights.push_back(weight);
+    }
+    coarse.children.resize(coarse.numPoints * numChildren);
+    vector<int> coords(numDims);
+    for (int I=0; I < coarse.numPoints; ++I) {
+      const vector<int> point = getCoords(coarse.dims, I);
+      for (int c=0; c < numChildren; ++c) {
+        for (int d=0; d < numDims; ++d) {
+          coords[d] = coarsened[d] ? 2*point[d] + childOffsets[c][d]
+                                   : point[d];
+        }
+        coarse.children[I*numChildren + c] = getPoint(fineDims, coords);
+      }
+    }
+
+    // Block e of child s couples it to the fine point s + offsets[e] from 2I,
+    // which interpolates from the coarse points J - I in every dimension: u/2
+    // if u is even and (u-1)/2 and (u+1)/2 with weight 1/2 if it is odd
+    map<vector<int>, int> coarseLayout;
+    vector<vector<int>> coarseOffsets;
+    for (int c=0; c < numChildren; ++c) {
+      for (size_t e=0; e < offsets.size(); ++e) {
+        vector<pair<vector<int>,double>> targets = {{{}, coarse.childWeights[c]}};
+        for (int d=0; d < numDims; ++d) {
+          const int u = childOffsets[c][d] + offsets[e][d];
+          vector<pair<int,double>> options;
+          if (!coarsened[d]) {
+            options.push_back({u, 1.0});
+          }
+          else if (u % 2 == 0) {
+            options.push_back({u/2, 1.0});
+          }
+          else {
+            options.push_back({(u-1)/2, 0.5});
+            options.push_back({(u+1)/2, 0.5});
+          }
+          vector<pair<vector<int>,double>> extended;
+          for (const auto& target : targets) {
+            for (const auto& option : options) {
+              extended.push_back(target);
+              extended.back().first.push_back(option.first);
+              extended.back().second *= option.second;
+            }
+          }
+          targets = extended;
+        }
+        for (const auto& target : targets) {
+          auto entry = coarseLayout.find(target.first);
+          if (entry == coarseLayout.end()) {
+            entry = coarseLayout.insert({target.first,
+                                         (int)coarseOffsets.size()}).first;
+            coarseOffsets.push_back(target.first);
+          }
+          coarse.galerkinTerms.push_back({c, (int)e, entry->second,
+                                          target.second});
+        }
+      }
+    }
+    coarse.stencilSize = coarseOffsets.size();
+    coarse.neighbors = computeNeighbors(coarse.dims, coarseOffsets);
+    levels.push_back(coarse);
+    offsets = coarseOffsets;
+  }
+
+  for (Level& level : levels) {
+    const size_t n = level.numPoints * blockSize;
+    level.b.resize(n);
+    level.x.resize(n);
+    level.r.resize(n);
+  }
+}
+
+template <typename Float>
+void GeometricMultigrid<Float>::setup(const Float* vals) {
+  const int bs = blockSize;
+  const int bs2 = bs*bs;
+  levels[0].vals = vals;
+  for (size_t l=0; l < levels.size(); ++l) {
+    Level& level = levels[l];
+    if (l > 0) {
+      // Galerkin product of the level below
+      const Level& fine = levels[l-1];
+      const int numChildren = level.childWeights.size();
+      level.coarseVals.assign(level.numPoints * level.stencilSize * bs2, 0);
+      for (int I=0; I < level.numPoints; ++I) {
+        for (const typename Level::GalerkinTerm& term : level.galerkinTerms) {
+          const int x = level.children[I*numChildren + term.child];
+          const Float* a = &fine.vals[(x*fine.stencilSize + term.fineEntry) *
+                                      bs2];
+          Float* coarse = &level.coarseVals[(I*level.stencilSize +
+                                             term.coarseEntry) * bs2];
+          for (int k=0; k < bs2; ++k) {
+            coarse[k] += term.weight * a[k];
+          }
+        }
+      }
+      level.vals = level.coarseVals.data();
+    }
+    level.invDiagonal = invertDiagonal(level.numPoints, level.stencilSize, bs,
+                                       level.neighbors.data(), level.vals,
+                                       true);
+  }
+
+  // The dense inverse of the coarsest level, if it is small and nonsingular
+  Level& coarsest = levels.back();
+  coarsest.denseInverse.clear();
+  const int n = coarsest.numPoints * bs;
+  if (n <= kMaxDenseRows) {
+    vector<double> dense(n*n, 0.0);
+    for (int i=0; i < coarsest.numPoints; ++i) {
+      for (int e=0; e < coarsest.stencilSize; ++e) {
+        const int ie = i*coarsest.stencilSize + e;
+        const int j = coarsest.neighbors[ie];
+        for (int bi=0; bi < bs; ++bi) {
+          for (int bj=0; bj < bs; ++bj) {
+            dense[(i*bs+bi)*n + j*bs+bj] += coarsest.vals[ie*bs2 + bi*bs+bj];
+          }
+        }
+      }
+    }
+    if (invertMatrix(n, dense)) {
+      coarsest.denseInverse.assign(dense.begin(), dense.end());
+    }
+  }
+}
+
+template <typename Float>
+void GeometricMultigrid<Float>::multiply(const Float* x, Float* y) const {
+  multiply(levels[0], x, y);
+}
+
+template <typename Float>
+void GeometricMultigrid<Float>::vcycle(const Float* b, Float* x) {
+  vcycle(0, b, x);
+}
+
+template <typename Float>
+void GeometricMultigrid<Float>::multiply(const Level& level, const Float* x,
+                                         Float* y) const {
+  multiplyStencil(level.numPoints, level.stencilSize, blockSize,
+                  level.neighbors.data(), level.vals, x, y);
+}
+
+template <typename Float>
+void GeometricMultigrid<Float>::smooth(Level& level, const Float* b, Float* x,
+                                       int numSweeps) {
+  const int n = level.numPoints * blockSize;
+  Float* r = level.r.data();
+  for (int sweep=0; sweep < numSweeps; ++sweep) {
+    multiply(level, x, r);
+    for (int k=0; k < n; ++k) {
+      r[k] = b[k] - r[k];
+    }
+    const int bs = blockSize;
+    for (int i=0; i < level.numPoints; ++i) {
+      const Float* inverse = &level.invDiagonal[i*bs*bs];
+      for (int bi=0; bi < bs; ++bi) {
+        Float correction = 0;
+        for (int bj=0; bj < bs; ++bj) {
+          correction += inverse[bi*bs+bj] * r[i*bs+bj];
+        }
+        x[i*bs+bi] += kSmootherWeight * correction;
+      }
+    }
+  }
+}
+
+template <typename Float>
+void GeometricMultigrid<Float>::vcycle(int l, const Float* b, Float* x) {
+  Level& level = levels[l];
+  const int bs = blockSize;
+  const int n = level.numPoints * bs;
+  if (l+1 == (int)levels.size() && !level.denseInverse.empty()) {
+    for (int i=0; i < n; ++i) {
+      x[i] = dot(n, &level.denseInverse[i*n], b);
+    }
+    return;
+  }
+
+  fill(x, x+n, (Float)0);
+  if (l+1 == (int)levels.size()) {
+    smooth(level, b, x, kNumCoarsestSweeps);
+    return;
+  }
+  smooth(level, b, x, kNumSweeps);
+
+  // Restrict the residual, correct from the coarse level and interpolate the
+  // correction
+  Float* r = level.r.data();
+  multiply(level, x, r);
+  for (int k=0; k < n; ++k) {
+    r[k] = b[k] - r[k];
+  }
+  Level& coarse = levels[l+1];
+  const int numChildren = coarse.childWeights.size();
+  for (int I=0; I < coarse.numPoints; ++I) {
+    Float* bI = &coarse.b[I*bs];
+    fill(bI, bI+bs, (Float)0);
+    for (int c=0; c < numChildren; ++c) {
+      const Float* rc = &r[coarse.children[I*numChildren + c]*bs];
+      for (int k=0; k < bs; ++k) {
+        bI[k] += coarse.childWeights[c] * rc[k];
+      }
+    }
+  }
+  vcycle(l+1, coarse.b.data(), coarse.x.data());
+  for (int I=0; I < coarse.numPoints; ++I) {
+    const Float* xI = &coarse.x[I*bs];
+    for (int c=0; c < numChildren; ++c) {
+      Float* xc = &x[coarse.children[I*numChildren + c]*bs];
+      for (int k=0; k < bs; ++k) {
+        xc[k] += coarse.childWeights[c] * xI[k];
+      }
+    }
+  }
+
+  smooth(level, b, x, kNumSweeps);
+}
+
+namespace {
+
+// The multigrid hierarchy of the stencil matrices with one structure, which
+// is set up and used while its mutex is held, so that solves with different
+// structures run concurrently while solves with the same structure run one
+// after another.
+template <typename Float>
+struct StencilHierarchy {
+  std::mutex mutex;
+  unique_ptr<GeometricMultigrid<Float>> multigrid;
+};
+
+typedef tuple<vector<int>,vector<vector<int>>,int> StencilKey;
+
+// Guards the maps of the hierarchies below. Solves share the hierarchies they
+// use, so that freeStencilSolverCaches can drop them while they run.
+std::mutex& getHierarchiesMutex() {
+  static std::mutex hierarchiesMutex;
+  return hierarchiesMutex;
+}
+
+template <typename Float>
+map<StencilKey, shared_ptr<StencilHierarchy<Float>>>& getHierarchies() {
+  static map<StencilKey, shared_ptr<StencilHierarchy<Float>>> hierarchies;
+  return hierarchies;
+}
+
+template <typename Float>
+shared_ptr<StencilHierarchy<Float>>
+getHierarchy(const StencilStructure& structure) {
+  lock_guard<std::mutex> lock(getHierarchiesMutex());
+  shared_ptr<StencilHierarchy<Float>>& hierarchy =
+      getHierarchies<Float>()[make_tuple(structure.dims, structure.offsets,
+                                         structure.blockSize)];
+  if (hierarchy == nullptr) {
+    hierarchy.reset(new StencilHierarchy<Float>());
+  }
+  return hierarchy;
+}
+
+}
+
+template <typename Float>
+SolverStatistics solveStencil(const StencilStructure& structure,
+                              const Float* vals, const Float* b, Float* x,
+                              const SolverSettings& settings) {
+  uassert(settings.method == KrylovMethod::CG ||
+          settings.method == KrylovMethod::Richardson)
+      << "Stencil matrices can only be solved with CG or Richardson iteration";
+  uassert(settings.preconditioner != Preconditioner::IncompleteCholesky &&
+          settings.preconditioner != Preconditioner::AlgebraicMultigrid)
+      << "Stencil matrices can only be preconditioned with Jacobi, block "
+      << "Jacobi or geometric multigrid";
+
+  const int bs = structure.blockSize;
+  const int numPoints = structure.getNumPoints();
+  const int stencilSize = structure.offsets.size();
+  const size_t n = (size_t)numPoints*bs;
+
+  // The preconditioner z = M*r
+  shared_ptr<StencilHierarchy<Float>> hierarchy;
+  unique_lock<std::mutex> hierarchyLock;
+  GeometricMultigrid<Float>* multigrid = nullptr;
+  vector<int> neighbors;
+  vector<Float> invDiagonal;
+  if (settings.preconditioner == Preconditioner::Multigrid) {
+    hierarchy = getHierarchy<Float>(structure);
+    hierarchyLock = unique_lock<std::mutex>(hierarchy->mutex);
+    if (hierarchy->multigrid == nullptr) {
+      hierarchy->multigrid.reset(new GeometricMultigrid<Float>(structure));
+    }
+    multigrid = hierarchy->multigrid.get();
+    multigrid->setup(vals);
+  }
+  else {
+    neighbors = computeNeighbors(structure.dims, structure.offsets);
+    if (settings.preconditioner != Preconditioner::Identity) {
+      invDiagonal = invertDiagonal(numPoints, stencilSize, bs,
+                                   neighbors.data(), vals,
+                                   settings.preconditioner ==
+                                   Preconditioner::BlockJacobi);
+    }
+  }
+  auto multiply = [&](const Float* v, Float* y) {
+    if (multigrid != nullptr) {
+      multigrid->multiply(v, y);
+    }
+    else {
+      multiplyStencil(numPoints, stencilSize, bs, neighbors.data(), vals, v,
+                      y);
+    }
+  };
+  auto precondition = [&](const Float* r, Float* z) {
+    if (multigrid != nullptr) {
+      multigrid->vcycle(r, z);
+    }
+    else if (!invDiagonal.empty()) {
+      multiplyBlocks(numPoints, bs, invDiagonal.data(), r, z);
+    }
+    else {
+      copy(r, r+n, z);
+    }
+  };
+
+  // r = b - A*x
+  vector<Float> r(n);
+  vector<Float> z(n);
+  if (settings.warmStart) {
+    multiply(x, r.data());
+    for (size_t k=0; k < n; ++k) {
+      r[k] = b[k] - r[k];
+    }
+  }
+  else {
+    fill(x, x+n, (Float)0);
+    copy(b, b+n, r.begin());
+  }
+  const double bb = dot(n, b, b);
+  double rr = dot(n, r.data(), r.data());
+
+  SolverStatistics statistics = {0, 0.0, true};
+  if (bb == 0.0) {
+    fill(x, x+n, (Float)0);
+    return statistics;
+  }
+  const double tolerance = (settings.tolerance > 0.0)
+                           ? settings.tolerance
+                           : numeric_limits<Float>::epsilon();
+  const double threshold = max(tolerance*tolerance*bb,
+                               (double)numeric_limits<Float>::min());
+
+  if (settings.method == KrylovMethod::Richardson) {
+    while (rr >= threshold && statistics.iterations < settings.maxIterations) {
+      precondition(r.data(), z.data());
+      for (size_t k=0; k < n; ++k) {
+        x[k] += z[k];
+      }
+      multiply(x, r.data());
+      for (size_t k=0; k < n; ++k) {
+        r[k] = b[k] - r[k];
+      }
+      rr = dot(n, r.data(), r.data());
+      ++statistics.iterations;
+    }
+  }
+  else {
+    vector<Float> p(n);
+    vector<Float> q(n);
+    precondition(r.data(), z.data());
+    copy(z.begin(), z.end(), p.begin());
+    double rz = dot(n, r.data(), z.data());
+    while (rr >= threshold && statistics.iterations < settings.maxIterations) {
+      multiply(p.data(), q.data());
+      const Float alpha = rz / dot(n, p.data(), q.data());
+      for (size_t k=0; k < n; ++k) {
+        x[k] += alpha * p[k];
+        r[k] -= alpha * q[k];
+      }
+      rr = dot(n, r.data(), r.data());
+      ++statistics.iterations;
+      if (rr < threshold) {
+        break;
+      }
+      precondition(r.data(), z.data());
+      const double rzNew = dot(n, r.data(), z.data());
+      const Float beta = rzNew / rz;
+      rz = rzNew;
+      for (size_t k=0; k < n; ++k) {
+        p[k] = z[k] + beta * p[k];
+      }
+    }
+  }
+
+  statistics.error = sqrt(rr / bb);
+  statistics.converged = statistics.error <= tolerance;
+  return statistics;
+}
+
+template class GeometricMultigrid<float>;
+template class GeometricMultigrid<double>;
+
+template SolverStatistics solveStencil<float>(const StencilStructure&,
+                                              const float*, const float*,
+                                              float*, const SolverSettings&);
+template SolverStatistics solveStencil<double>(const StencilStructure&,
+                                               const double*, const double*,
+                                               double*, const SolverSettings&);
+
+void freeStencilSolverCaches() {
+  lock_guard<std::mutex> lock(getHierarchiesMutex());
+  getHierarchies<float>().clear();
+  getHierarchies<double>().clear();
+}
+
+}
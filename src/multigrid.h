@@ -0,0 +1,121 @@
+#ifndef SIMIT_MULTIGRID_H
+#define SIMIT_MULTIGRID_H
+
+#include <vector>
+
+#include "solvers.h"
+
+namespace simit {
+
+/// The structure of a matrix over the points of a periodic lattice that is
+/// stored like the matrices Simit assembles with stencils on lattice link
+/// sets: the row of every point has one block per stencil offset, and block e
+/// of the row of point i couples it to the point at offsets[e] from it, with
+/// periodic boundaries. The block is stored at
+/// vals[(i*offsets.size() + e) * blockSize*blockSize], and points are ordered
+/// with the first dimension fastest (see Set::getLatticePoint).
+struct StencilStructure {
+  std::vector<int> dims;
+  std::vector<std::vector<int>> offsets;
+  int blockSize;
+
+  int getNumPoints() const;
+};
+
+/// A geometric multigrid hierarchy of a stencil matrix. Every coarse lattice
+/// halves the even dimensions of at least 4 points of the one below it (the
+/// other dimensions are kept), and coarse point I corresponds to fine point
+/// 2I. Prolongation is multilinear interpolation, restriction is its
+/// transpose, and the coarse operators are the Galerkin products
+/// P^T*A*P, whose stencils stay within one point of the center in every
+/// coarsened dimension when the fine stencil does. Levels are smoothed with
+/// damped block Jacobi, and the coarsest level is solved with its dense
+/// inverse when it is small and nonsingular, or smoothed repeatedly otherwise.
+///
+/// The iteration counts of multigrid solves do not depend on the lattice size
+/// for Poisson-like systems on lattices whose dimensions are multiples of
+/// large powers of two.
+template <typename Float>
+class GeometricMultigrid {
+public:
+  explicit GeometricMultigrid(const StencilStructure& structure);
+
+  int getNumLevels() const {return levels.size();}
+
+  /// The lattice dimensions of a level, where level 0 is the fine lattice.
+  const std::vector<int>& getDimensions(int level) const {
+    return levels[level].dims;
+  }
+
+  /// Computes the smoothers and coarse operators of the matrix with the given
+  /// values, which are read again by multiply and vcycle.
+  void setup(const Float* vals);
+
+  /// y = A*x
+  void multiply(const Float* x, Float* y) const;
+
+  /// Approximates the solution of A*x = b with one V-cycle from x = 0.
+  void vcycle(const Float* b, Float* x);
+
+private:
+  struct Level {
+    std::vector<int> dims;
+    int numPoints;
+    int stencilSize;
+
+    /// The point that block e of the row of point i couples it to, at
+    /// neighbors[i*stencilSize + e].
+    std::vector<int> neighbors;
+
+    /// The values of the coarse operators (the fine values are the user's).
+    std::vector<Float> coarseVals;
+    const Float* vals;
+
+    /// The inverses of the diagonal blocks.
+    std::vector<Float> invDiagonal;
+
+    /// The point of the level below at offset s (in {-1,0,1} in coarsened
+    /// dimensions and 0 otherwise) from point 2I of coarse point I, at
+    /// children[I*numChildren + s], and the interpolation weight of s.
+    std::vector<int> children;
+    std::vector<double> childWeights;
+
+    /// The terms of the Galerkin product: block e of child s of the row of I
+    /// (in the level below) is added to coarse block coarseEntry, scaled by
+    /// weight.
+    struct GalerkinTerm {
+      int child;
+      int fineEntry;
+      int coarseEntry;
+      double weight;
+    };
+    std::vector<GalerkinTerm> galerkinTerms;
+
+    /// The dense inverse of the coarsest level, if it is used.
+    std::vector<Float> denseInverse;
+
+    std::vector<Float> b;
+    std::vector<Float> x;
+    std::vector<Float> r;
+  };
+
+  int blockSize;
+  std::vector<Level> levels;
+
+  void multiply(const Level& level, const Float* x, Float* y) const;
+  void smooth(Level& level, const Float* b, Float* x, int numSweeps);
+  void vcycle(int l, const Float* b, Float* x);
+};
+
+/// Solves A*x = b for a symmetric stencil matrix with the method and
+/// preconditioner of the settings, which must be CG or Richardson and
+/// Identity, Jacobi, BlockJacobi or Multigrid. The multigrid hierarchy of
+/// every stencil structure is built once, until freeStencilSolverCaches, and
+/// concurrent solves with the same structure run one after another.
+template <typename Float>
+SolverStatistics solveStencil(const StencilStructure& structure,
+                              const Float* vals, const Float* b, Float* x,
+                              const SolverSettings& settings);
+
+}
+#endif
@@ -0,0 +1,219 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "graph.h"
+#include "partition.h"
+#include "init.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+// Memory policies and flags of the mbind system call (see numaif.h, which is
+// only installed with libnuma)
+const int MPOL_BIND = 2;
+const int MPOL_INTERLEAVE = 3;
+const unsigned MPOL_MF_MOVE = 1 << 1;
+
+size_t getPageSize() {
+#ifdef __linux__
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+#else
+  return 4096;
+#endif
+}
+
+// The whole pages in [data, data+size) as [begin, end)
+bool getPages(const void* data, size_t size, uintptr_t& begin, uintptr_t& end) {
+  const size_t pageSize = getPageSize();
+  begin = ((uintptr_t)data + pageSize-1) / pageSize * pageSize;
+  end = ((uintptr_t)data + size) / pageSize * pageSize;
+  return begin < end;
+}
+
+void setPolicy(void* data, size_t size, int mode, const vector<int>& nodes) {
+#ifdef __linux__
+  uintptr_t begin, end;
+  if (!getPages(data, size, begin, end)) {
+    return;
+  }
+  const size_t bitsPerWord = 8 * sizeof(unsigned long);
+  const int numNodes = getNumNumaNodes();
+  vector<unsigned long> mask((numNodes + bitsPerWord-1) / bitsPerWord, 0);
+  for (int node : nodes) {
+    mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+  }
+  // Fails harmlessly if the kernel does not support NUMA policies
+  syscall(SYS_mbind, (void*)begin, end-begin, mode, mask.data(),
+          mask.size()*bitsPerWord + 1, MPOL_MF_MOVE);
+#endif
+}
+
+}
+
+int getNumNumaNodes() {
+  static int numNodes = 0;
+  if (numNodes == 0) {
+    numNodes = 1;
+#ifdef __linux__
+    // A list of node ranges, such as 0-3 or 0,2-3
+    ifstream online("/sys/devices/system/node/online");
+    string ranges;
+    if (online >> ranges) {
+      size_t pos = ranges.find_last_of(",-");
+      string last = (pos == string::npos) ? ranges : ranges.substr(pos+1);
+      numNodes = max(1, atoi(last.c_str()) + 1);
+    }
+#endif
+  }
+  return numNodes;
+}
+
+void placeMemory(void* data, size_t size) {
+  if (kNumaPolicy == NumaPolicy::Interleave && getNumNumaNodes() > 1) {
+    interleaveMemory(data, size);
+  }
+}
+
+void interleaveMemory(void* data, size_t size) {
+  vector<int> nodes(getNumNumaNodes());
+  for (size_t i=0; i < nodes.size(); ++i) {
+    nodes[i] = i;
+  }
+  setPolicy(data, size, MPOL_INTERLEAVE, nodes);
+}
+
+void bindMemory(void* data, size_t size, int node) {
+  uassert(node >= 0 && node < getNumNumaNodes()) << "Invalid node " << node;
+  setPolicy(data, size, MPOL_BIND, {node});
+}
+
+void placeByPartition(Set& vertexSet, const Partitioning& partitioning) {
+  const int numPartitions = partitioning.numPartitions;
+  uassert(partitioning.vertexStarts.size() == (size_t)numPartitions+1)
+      << "The partitions must be stored contiguously";
+  const int numNodes = getNumNumaNodes();
+  if (numNodes == 1) {
+    return;
+  }
+
+  // Binds the field data of the elements of each partition, and their
+  // endpoints, to the partition's node
+  auto place = [&](Set& set, const vector<int>& starts) {
+    for (int p=0; p < numPartitions; ++p) {
+      const int node = (long long)p * numNodes / numPartitions;
+      const int begin = starts[p];
+      const int end = starts[p+1];
+      if (begin == end) {
+        continue;
+      }
+      for (Set::FieldData* field : set.getFields()) {
+        const size_t compSize = componentSize(field->type->getComponentType());
+        char* data = (char*)field->data;
+        size_t first = field->getComponentIndex(begin, 0) * compSize;
+        size_t last = field->getComponentIndex(end-1, 0)*compSize +
+                      field->groupStride*compSize;
+        bindMemory(data + first, last - first, node);
+      }
+      if (set.getCardinality() > 0 && set.getEndpointsData() != nullptr) {
+        const int cardinality = set.getCardinality();
+        bindMemory(set.getEndpointsData() + begin*cardinality,
+                   (end-begin)*cardinality*sizeof(int), node);
+      }
+    }
+  };
+
+  place(vertexSet, partitioning.vertexStarts);
+  for (Set* edgeSet : vertexSet.getEdgeSets()) {
+    auto edgeStarts = partitioning.edgeStarts.find(edgeSet);
+    if (edgeStarts != partitioning.edgeStarts.end()) {
+      place(*edgeSet, edgeStarts->second);
+    }
+  }
+}
+
+vector<size_t> getMemoryPlacement(const void* data, size_t size) {
+  vector<size_t> placement(getNumNumaNodes(), 0);
+#ifdef __linux__
+  const size_t pageSize = getPageSize();
+  uintptr_t begin = (uintptr_t)data / pageSize * pageSize;
+  uintptr_t end = ((uintptr_t)data + size + pageSize-1) / pageSize * pageSize;
+  vector<void*> pages;
+  for (uintptr_t page = begin; page < end; page += pageSize) {
+    pages.push_back((void*)page);
+  }
+  // Without target nodes move_pages reports the node of every page, or a
+  // negative error if it has not been touched
+  vector<int> status(pages.size(), -1);
+  if (!pages.empty() &&
+      syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr,
+              status.data(), 0) == 0) {
+    for (size_t i=0; i < pages.size(); ++i) {
+      if (status[i] >= 0 && status[i] < (int)placement.size()) {
+        uintptr_t first = max((uintptr_t)pages[i], (uintptr_t)data);
+        uintptr_t last = min((uintptr_t)pages[i] + pageSize,
+                             (uintptr_t)data + size);
+        placement[status[i]] += last - first;
+      }
+    }
+  }
+#endif
+  return placement;
+}
+
+void printMemoryPlacement(std::ostream& os, Set& set) {
+  auto print = [&](const string& name, const void* data, size_t size) {
+    os << "  " << name << ":";
+    vector<size_t> placement = getMemoryPlacement(data, size);
+    for (size_t node=0; node < placement.size(); ++node) {
+      os << " " << placement[node] << "B on node " << node
+         << (node+1 < placement.size() ? "," : "");
+    }
+    os << endl;
+  };
+
+  os << "Memory placement of " << (set.getName().empty() ? "set"
+                                                          : set.getName())
+     << " (" << getNumNumaNodes() << " nodes)" << endl;
+
+  // Interleaved fields share their data, which is printed once
+  map<const void*, string> names;
+  map<const void*, size_t> sizes;
+  vector<const void*> order;
+  for (Set::FieldData* field : set.getFields()) {
+    const void* data = field->data;
+    if (names.find(data) == names.end()) {
+      order.push_back(data);
+      size_t compSize = componentSize(field->type->getComponentType());
+      sizes[data] = set.getSize() * field->groupStride * compSize;
+    }
+    else {
+      names[data] += ",";
+    }
+    names[data] += field->name;
+  }
+  for (const void* data : order) {
+    print(names.at(data), data, sizes.at(data));
+  }
+  if (set.getCardinality() > 0 && set.getEndpointsData() != nullptr) {
+    print("endpoints", set.getEndpointsData(),
+          set.getSize() * set.getCardinality() * sizeof(int));
+  }
+}
+
+}
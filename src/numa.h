@@ -0,0 +1,58 @@
+#ifndef SIMIT_NUMA_H
+#define SIMIT_NUMA_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace simit {
+class Set;
+struct Partitioning;
+
+/// Where the pages of field data, endpoints, path indices and temporaries are
+/// placed on machines with several NUMA nodes.
+enum class NumaPolicy {
+  /// Pages are placed on the node of the thread that first touches them, which
+  /// is usually the thread that loaded the mesh.
+  Default,
+
+  /// Pages are interleaved round-robin over all the nodes when the arrays are
+  /// allocated or grown, which spreads bandwidth over all the memory
+  /// controllers when threads are not pinned to the data they compute on.
+  Interleave
+};
+
+/// The number of NUMA nodes of the machine, or 1 if it is not known.
+int getNumNumaNodes();
+
+/// Applies the NumaPolicy of the Settings to newly allocated or grown memory,
+/// moving the pages that were already touched. Placement is best effort: only
+/// the whole pages in the range are placed, and nothing is done if the
+/// operating system does not support it.
+void placeMemory(void* data, size_t size);
+
+/// Interleaves the pages of the range over all the nodes.
+void interleaveMemory(void* data, size_t size);
+
+/// Moves the pages of the range to the given node.
+void bindMemory(void* data, size_t size, int node);
+
+/// Moves the field data of every partition of the vertex set, and the field
+/// data and endpoints of every partition of its edge sets, to node
+/// p*getNumNumaNodes()/numPartitions for partition p. The partitions must be
+/// stored contiguously (see reorderByPartition), and thread t of a computation
+/// with numPartitions threads should run on node t*getNumNumaNodes()/
+/// numPartitions. Data is moved under every NumaPolicy, which only applies to
+/// memory when it is allocated or grown.
+void placeByPartition(Set& vertexSet, const Partitioning& partitioning);
+
+/// Returns the number of bytes of the range that reside on each node. Pages
+/// that have not been touched yet are not counted.
+std::vector<size_t> getMemoryPlacement(const void* data, size_t size);
+
+/// Prints the number of bytes of every field, and of the endpoints, of the set
+/// that reside on each node.
+void printMemoryPlacement(std::ostream& os, Set& set);
+
+}
+#endif
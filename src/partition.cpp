@@ -0,0 +1,357 @@
+#include "partition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "graph.h"
+#include "graph_indices.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+// A graph with vertex and edge weights, in compressed sparse row form. The
+// edge weights count how many fine edges a coarse edge stands for, and the
+// vertex weights how many fine vertices a coarse vertex stands for.
+struct WeightedGraph {
+  vector<int> start;
+  vector<int> neighbors;
+  vector<int> edgeWeights;
+  vector<int> vertexWeights;
+
+  int getSize() const {return vertexWeights.size();}
+};
+
+// Builds the adjacency graph of the homogeneous edge sets of the vertex set,
+// where the weight of an edge is the number of edge sets that connect its
+// vertices.
+void buildGraph(const Set& vertexSet, WeightedGraph& graph) {
+  vector<const internal::NeighborIndex*> indices;
+  for (const Set* edgeSet : vertexSet.getEdgeSets()) {
+    if (edgeSet->getCardinality() >= 2 && edgeSet->isHomogeneous()) {
+      indices.push_back(edgeSet->getNeighborIndex());
+    }
+  }
+
+  const int size = vertexSet.getSize();
+  graph.start.resize(size+1);
+  graph.vertexWeights.assign(size, 1);
+  graph.start[0] = 0;
+  vector<int> position(size, -1);
+  for (int v = 0; v < size; ++v) {
+    const int rowStart = graph.neighbors.size();
+    for (const internal::NeighborIndex* index : indices) {
+      const int* starts = index->getStartIndex();
+      const int* sinks = index->getNeighborIndex();
+      for (int i = starts[v]; i < starts[v+1]; ++i) {
+        const int w = sinks[i];
+        if (w == v) {
+          continue;
+        }
+        if (position[w] >= rowStart) {
+          graph.edgeWeights[position[w]] += 1;
+        }
+        else {
+          position[w] = graph.neighbors.size();
+          graph.neighbors.push_back(w);
+          graph.edgeWeights.push_back(1);
+        }
+      }
+    }
+    graph.start[v+1] = graph.neighbors.size();
+  }
+}
+
+// Matches every vertex with its unmatched neighbor across the heaviest edge,
+// visiting vertices by increasing degree, and contracts the matched pairs into
+// the coarse graph. coarseMap maps fine vertices to coarse vertices.
+void coarsen(const WeightedGraph& fine, int maxVertexWeight,
+             WeightedGraph& coarse, vector<int>& coarseMap) {
+  const int size = fine.getSize();
+  vector<int> order(size);
+  for (int v = 0; v < size; ++v) {
+    order[v] = v;
+  }
+  stable_sort(order.begin(), order.end(), [&fine](int a, int b) {
+    return fine.start[a+1] - fine.start[a] < fine.start[b+1] - fine.start[b];
+  });
+
+  coarseMap.assign(size, -1);
+  vector<int> members;  // the one or two fine vertices of each coarse vertex
+  for (int v : order) {
+    if (coarseMap[v] != -1) {
+      continue;
+    }
+    int match = -1;
+    int matchWeight = 0;
+    for (int i = fine.start[v]; i < fine.start[v+1]; ++i) {
+      const int w = fine.neighbors[i];
+      if (coarseMap[w] == -1 && fine.edgeWeights[i] > matchWeight &&
+          fine.vertexWeights[v] + fine.vertexWeights[w] <= maxVertexWeight) {
+        match = w;
+        matchWeight = fine.edgeWeights[i];
+      }
+    }
+    const int c = members.size() / 2;
+    coarseMap[v] = c;
+    members.push_back(v);
+    if (match != -1) {
+      coarseMap[match] = c;
+    }
+    members.push_back(match);
+  }
+
+  // Contract the matched vertices, merging their edges to the same coarse
+  // vertices and dropping the edges between them
+  const int coarseSize = members.size() / 2;
+  coarse.start.assign(coarseSize+1, 0);
+  coarse.neighbors.clear();
+  coarse.edgeWeights.clear();
+  coarse.vertexWeights.assign(coarseSize, 0);
+  vector<int> position(coarseSize, -1);
+  for (int c = 0; c < coarseSize; ++c) {
+    const int rowStart = coarse.neighbors.size();
+    for (int m = 0; m < 2; ++m) {
+      const int v = members[2*c + m];
+      if (v == -1) {
+        continue;
+      }
+      coarse.vertexWeights[c] += fine.vertexWeights[v];
+      for (int i = fine.start[v]; i < fine.start[v+1]; ++i) {
+        const int d = coarseMap[fine.neighbors[i]];
+        if (d == c) {
+          continue;
+        }
+        if (position[d] >= rowStart) {
+          coarse.edgeWeights[position[d]] += fine.edgeWeights[i];
+        }
+        else {
+          position[d] = coarse.neighbors.size();
+          coarse.neighbors.push_back(d);
+          coarse.edgeWeights.push_back(fine.edgeWeights[i]);
+        }
+      }
+    }
+    coarse.start[c+1] = coarse.neighbors.size();
+  }
+}
+
+// Partitions the graph by growing the parts one at a time breadth first from
+// a seed vertex, until each holds its share of the remaining vertex weight.
+// Seeds are the first unassigned vertices from firstSeed on.
+void growPartitions(const WeightedGraph& graph, int numPartitions,
+                    int firstSeed, vector<int>& partitions) {
+  const int size = graph.getSize();
+  long long remainingWeight = 0;
+  for (int w : graph.vertexWeights) {
+    remainingWeight += w;
+  }
+
+  partitions.assign(size, -1);
+  int nextSeed = firstSeed;
+  int numSeeds = 0;
+  vector<int> frontier;
+  for (int p = 0; p < numPartitions - 1; ++p) {
+    const double target = (double)remainingWeight / (numPartitions - p);
+    long long weight = 0;
+    frontier.clear();
+    size_t next = 0;
+    while (weight < target) {
+      if (next == frontier.size()) {
+        // The part is not connected, so continue it from a new seed
+        while (numSeeds < size && partitions[nextSeed] != -1) {
+          nextSeed = (nextSeed + 1) % size;
+          ++numSeeds;
+        }
+        if (numSeeds == size) {
+          break;
+        }
+        frontier.push_back(nextSeed);
+      }
+      const int v = frontier[next++];
+      if (partitions[v] != -1) {
+        continue;
+      }
+      partitions[v] = p;
+      weight += graph.vertexWeights[v];
+      for (int i = graph.start[v]; i < graph.start[v+1]; ++i) {
+        if (partitions[graph.neighbors[i]] == -1) {
+          frontier.push_back(graph.neighbors[i]);
+        }
+      }
+    }
+    remainingWeight -= weight;
+  }
+  for (int v = 0; v < size; ++v) {
+    if (partitions[v] == -1) {
+      partitions[v] = numPartitions - 1;
+    }
+  }
+}
+
+long long getEdgeCut(const WeightedGraph& graph,
+                     const vector<int>& partitions) {
+  long long edgeCut = 0;
+  for (int v = 0; v < graph.getSize(); ++v) {
+    for (int i = graph.start[v]; i < graph.start[v+1]; ++i) {
+      if (v < graph.neighbors[i] &&
+          partitions[v] != partitions[graph.neighbors[i]]) {
+        edgeCut += graph.edgeWeights[i];
+      }
+    }
+  }
+  return edgeCut;
+}
+
+// Greedy k-way refinement: boundary vertices are moved to the neighboring part
+// they are most connected to if that reduces the edge cut, or keeps it and
+// improves the balance. Vertices of overweight parts are moved even if that
+// increases the edge cut. No move may make a part overweight.
+void refine(const WeightedGraph& graph, int numPartitions,
+            long long maxPartWeight, vector<int>& partitions) {
+  const int size = graph.getSize();
+  vector<long long> partWeights(numPartitions, 0);
+  for (int v = 0; v < size; ++v) {
+    partWeights[partitions[v]] += graph.vertexWeights[v];
+  }
+
+  vector<int> connectivity(numPartitions, 0);
+  vector<int> adjacentParts;
+  for (int pass = 0; pass < 8; ++pass) {
+    int moves = 0;
+    for (int v = 0; v < size; ++v) {
+      const int p = partitions[v];
+      const int vertexWeight = graph.vertexWeights[v];
+      adjacentParts.clear();
+      for (int i = graph.start[v]; i < graph.start[v+1]; ++i) {
+        const int q = partitions[graph.neighbors[i]];
+        if (connectivity[q] == 0) {
+          adjacentParts.push_back(q);
+        }
+        connectivity[q] += graph.edgeWeights[i];
+      }
+
+      int best = -1;
+      int bestGain = 0;
+      for (int q : adjacentParts) {
+        if (q == p || partWeights[q] + vertexWeight > maxPartWeight) {
+          continue;
+        }
+        const int gain = connectivity[q] - connectivity[p];
+        const bool improves =
+            gain > 0 ||
+            (gain == 0 && partWeights[q] + vertexWeight < partWeights[p]) ||
+            partWeights[p] > maxPartWeight;
+        if (improves && (best == -1 || gain > bestGain)) {
+          best = q;
+          bestGain = gain;
+        }
+      }
+      for (int q : adjacentParts) {
+        connectivity[q] = 0;
+      }
+      connectivity[p] = 0;
+
+      if (best != -1) {
+        partitions[v] = best;
+        partWeights[p] -= vertexWeight;
+        partWeights[best] += vertexWeight;
+        ++moves;
+      }
+    }
+    if (moves == 0) {
+      break;
+    }
+  }
+}
+
+}
+
+void partitionGraph(const Set& vertexSet, int numPartitions,
+                    Partitioning& partitioning, double imbalance) {
+  uassert(vertexSet.getKind() == Set::Unstructured) << "Only unstructured \
+    sets can be partitioned";
+  uassert(numPartitions > 0) << "Invalid number of partitions: "
+                             << numPartitions;
+  uassert(imbalance >= 0.0) << "Invalid partition imbalance: " << imbalance;
+
+  // Coarsen until the graph is small enough to partition directly, or until
+  // matching no longer shrinks it
+  vector<WeightedGraph> graphs(1);
+  vector<vector<int>> coarseMaps;
+  buildGraph(vertexSet, graphs[0]);
+  const int size = graphs[0].getSize();
+  const int coarsestSize = max(15 * numPartitions, 64);
+  const int maxVertexWeight = max(1, (int)(1.5 * size / coarsestSize));
+  while (graphs.back().getSize() > coarsestSize) {
+    WeightedGraph coarse;
+    vector<int> coarseMap;
+    coarsen(graphs.back(), maxVertexWeight, coarse, coarseMap);
+    if (coarse.getSize() > 0.95 * graphs.back().getSize()) {
+      break;
+    }
+    graphs.push_back(coarse);
+    coarseMaps.push_back(coarseMap);
+  }
+
+  // Partition the coarsest graph, growing the parts from a few different
+  // seeds and keeping the best result, then project the partitions back to
+  // the vertex set and refine them on every level
+  const long long maxPartWeight =
+      (long long)ceil((1.0 + imbalance) * size / numPartitions);
+  const WeightedGraph& coarsest = graphs.back();
+  const int numTrials = 4;
+  vector<int> partitions;
+  long long bestEdgeCut = -1;
+  for (int trial = 0; trial < numTrials && trial < coarsest.getSize();
+       ++trial) {
+    vector<int> trialPartitions;
+    growPartitions(coarsest, numPartitions,
+                   trial * coarsest.getSize() / numTrials, trialPartitions);
+    refine(coarsest, numPartitions, maxPartWeight, trialPartitions);
+    long long edgeCut = getEdgeCut(coarsest, trialPartitions);
+    if (bestEdgeCut == -1 || edgeCut < bestEdgeCut) {
+      partitions.swap(trialPartitions);
+      bestEdgeCut = edgeCut;
+    }
+  }
+  for (int level = coarseMaps.size() - 1; level >= 0; --level) {
+    const vector<int>& coarseMap = coarseMaps[level];
+    vector<int> finePartitions(coarseMap.size());
+    for (size_t v = 0; v < coarseMap.size(); ++v) {
+      finePartitions[v] = partitions[coarseMap[v]];
+    }
+    partitions.swap(finePartitions);
+    refine(graphs[level], numPartitions, maxPartWeight, partitions);
+  }
+
+  partitioning.numPartitions = numPartitions;
+  partitioning.vertexPartitions = partitions;
+  partitioning.vertexStarts.clear();
+  partitioning.edgeStarts.clear();
+
+  partitioning.edgeCut = getEdgeCut(graphs[0], partitions);
+
+  // Edges belong to the lowest partition of their endpoints in the vertex set
+  partitioning.edgePartitions.clear();
+  for (const Set* edgeSet : vertexSet.getEdgeSets()) {
+    const int cardinality = edgeSet->getCardinality();
+    const int* endpoints = edgeSet->getEndpointsData();
+    vector<int>& edgePartitions = partitioning.edgePartitions[edgeSet];
+    edgePartitions.assign(edgeSet->getSize(), numPartitions);
+    for (int e = 0; e < edgeSet->getSize(); ++e) {
+      for (int j = 0; j < cardinality; ++j) {
+        if (edgeSet->getEndpointSet(j) == &vertexSet) {
+          edgePartitions[e] = min(edgePartitions[e],
+                                  partitions[endpoints[e*cardinality + j]]);
+        }
+      }
+    }
+  }
+}
+
+}
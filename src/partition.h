@@ -0,0 +1,50 @@
+#ifndef SIMIT_PARTITION_H
+#define SIMIT_PARTITION_H
+
+#include <map>
+#include <vector>
+
+namespace simit {
+class Set;
+
+/// A partitioning of a vertex set, and of every edge set with endpoints in it,
+/// into parts that are connected by few edges. Each part can be owned by one
+/// thread or process, and reorderByPartition stores each part contiguously.
+struct Partitioning {
+  int numPartitions;
+
+  /// The partition of the vertex at each location of the vertex set.
+  std::vector<int> vertexPartitions;
+
+  /// The partitions of the elements of every edge set with endpoints in the
+  /// vertex set, by location. An edge belongs to the lowest partition of its
+  /// endpoints in the vertex set.
+  std::map<const Set*, std::vector<int>> edgePartitions;
+
+  /// The number of adjacent vertex pairs in different partitions, counted once
+  /// for every homogeneous edge set that connects them.
+  long long edgeCut;
+
+  /// If the partitions are stored contiguously (see reorderByPartition), the
+  /// vertices of partition p are at locations
+  /// vertexStarts[p]:vertexStarts[p+1], and the edges of partition p of every
+  /// edge set are at locations edgeStarts[set][p]:edgeStarts[set][p+1].
+  /// Empty otherwise.
+  std::vector<int> vertexStarts;
+  std::map<const Set*, std::vector<int>> edgeStarts;
+
+  Partitioning() : numPartitions(0), edgeCut(0) {}
+};
+
+/// Partitions the vertex set into numPartitions parts with the multilevel
+/// k-way scheme: the adjacency graph of its homogeneous edge sets (see
+/// NeighborIndex) is coarsened by heavy-edge matching, the coarsest graph is
+/// partitioned by greedy graph growing, and the partitioning is refined on
+/// every level as it is projected back to the vertex set. Parts hold at most
+/// (1+imbalance) times the average number of vertices, except when single
+/// coarse vertices are heavier than that.
+void partitionGraph(const Set& vertexSet, int numPartitions,
+                    Partitioning& partitioning, double imbalance=0.03);
+
+}
+#endif
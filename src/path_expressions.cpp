@@ -284,6 +284,79 @@ bool RenamedPathExpression::lt(const PathExpressionImpl &o) const {
 }
 
 
+// Free functions
+/// Path expression sets are bound to graph sets by name.
+static bool isSameSet(const Set &a, const Set &b) {
+  return a == b || (a.defined() && b.defined() && a.getName() == b.getName());
+}
+
+static const Link* getLink(const PathExpression &pe) {
+  if (isa<RenamedPathExpression>(pe)) {
+    return getLink(to<RenamedPathExpression>(pe)->getPathExpression());
+  }
+  return isa<Link>(pe) ? to<Link>(pe) : nullptr;
+}
+
+bool isSymmetric(const PathExpression &pe) {
+  if (!pe.defined() || pe.getNumPathEndpoints() != 2) {
+    return false;
+  }
+
+  if (isa<RenamedPathExpression>(pe)) {
+    return isSymmetric(to<RenamedPathExpression>(pe)->getPathExpression());
+  }
+  else if (isa<Link>(pe)) {
+    // Only vertex-vertex links can relate elements of the same set, and they
+    // are symmetric if every stencil offset has its negation in the stencil.
+    const Link *link = to<Link>(pe);
+    if (link->getType() != Link::vv || !link->hasStencil() ||
+        !isSameSet(link->getVertexSet(0), link->getVertexSet(1))) {
+      return false;
+    }
+    map<vector<int>,int> layout = link->getStencil().getLayout();
+    for (auto &kv : layout) {
+      vector<int> negated(kv.first.size());
+      transform(kv.first.begin(), kv.first.end(), negated.begin(),
+                [](int offset) {return -offset;});
+      if (!util::contains(layout, negated)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  else if (isa<QuantifiedConnective>(pe)) {
+    const QuantifiedConnective *qc = to<QuantifiedConnective>(pe);
+    const vector<Var> &freeVars = qc->getFreeVars();
+    if (freeVars.size() != 2 ||
+        !isSameSet(pe.getSet(freeVars[0]), pe.getSet(freeVars[1]))) {
+      return false;
+    }
+
+    if (!qc->isQuantified()) {
+      return isSymmetric(qc->getLhs()) && isSymmetric(qc->getRhs());
+    }
+
+    // Composing a symmetric path expression with itself (e.g. v-e-v-e-v) is
+    // also symmetric.
+    if (qc->getLhs() == qc->getRhs() && isSymmetric(qc->getLhs())) {
+      return true;
+    }
+
+    // A quantified connective `exist q: lhs(u,q) op rhs(q,v)` is symmetric if
+    // lhs and rhs relate the free variables to q in the same way, which is the
+    // case for two links between the same vertex set and edge set (v-e-v).
+    const Link *lhs = getLink(qc->getLhs());
+    const Link *rhs = getLink(qc->getRhs());
+    return qc->getQuantifiedVars().size() == 1 &&
+           lhs != nullptr && rhs != nullptr &&
+           lhs->getType() != Link::vv && rhs->getType() != Link::vv &&
+           isSameSet(lhs->getEdgeSet(), rhs->getEdgeSet()) &&
+           isSameSet(lhs->getVertexSet(), rhs->getVertexSet());
+  }
+  return false;
+}
+
+
 // class PathExpressionVisitor
 void PathExpressionVisitor::visit(const Link *pe) {
 }
@@ -357,6 +357,15 @@ private:
 };
 
 
+/// Returns true if the binary path expression `pe` relates its two path
+/// endpoints symmetrically, that is if (u,v) is in the path relation whenever
+/// (v,u) is. Path indices built from a symmetric path expression are the same
+/// in both directions. The test is conservative: it recognizes links through
+/// the same edge set (v-e-v), lattice links with stencils that are closed
+/// under negation, and unquantified connectives of symmetric operands.
+bool isSymmetric(const PathExpression &pe);
+
+
 class PathExpressionVisitor {
 public:
   virtual ~PathExpressionVisitor() {}
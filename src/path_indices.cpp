@@ -8,6 +8,7 @@
 #include "path_expressions.h"
 #include "graph.h"
 #include "util/collections.h"
+#include "util/util.h"
 
 using namespace std;
 
@@ -47,37 +48,50 @@ unsigned SetEndpointPathIndex::numNeighbors() const {
 
 SetEndpointPathIndex::Neighbors
 SetEndpointPathIndex::neighbors(unsigned elemID) const {
+  // The neighbors are the locations of the endpoints of the edge stored at
+  // elemID (see Set::getLocation)
   class SetEndpointNeighbors : public PathIndexImpl::Neighbors::Base {
     class Iterator : public PathIndexImpl::Neighbors::Iterator::Base {
     public:
-      Iterator(const simit::Set::Endpoints::Iterator &epit) : epit(epit) {}
+      Iterator(const simit::Set &edgeSet, unsigned elemID, int endpointNum)
+          : edgeSet(edgeSet), elemID(elemID), endpointNum(endpointNum) {}
 
-      void operator++() {++epit;}
-      unsigned operator*() const {return epit->getIdent();}
+      void operator++() {++endpointNum;}
+      unsigned operator*() const {
+        return edgeSet.getEndpointLocation(elemID, endpointNum);
+      }
       Base* clone() const {return new Iterator(*this);}
 
     protected:
       bool eq(const Base& o) const {
         const Iterator *other = static_cast<const Iterator*>(&o);
-        return epit == other->epit;
+        return &edgeSet == &other->edgeSet && elemID == other->elemID &&
+               endpointNum == other->endpointNum;
       }
 
     private:
-      simit::Set::Endpoints::Iterator epit;
+      const simit::Set &edgeSet;
+      unsigned elemID;
+      int endpointNum;
     };
 
   public:
-    SetEndpointNeighbors(const simit::Set::Endpoints &endpoints)
-        : endpoints(endpoints) {}
+    SetEndpointNeighbors(const simit::Set &edgeSet, unsigned elemID)
+        : edgeSet(edgeSet), elemID(elemID) {}
 
-    Neighbors::Iterator begin() const {return new Iterator(endpoints.begin());}
-    Neighbors::Iterator end() const {return new Iterator(endpoints.end());}
+    Neighbors::Iterator begin() const {
+      return new Iterator(edgeSet, elemID, 0);
+    }
+    Neighbors::Iterator end() const {
+      return new Iterator(edgeSet, elemID, edgeSet.getCardinality());
+    }
 
   private:
-    simit::Set::Endpoints endpoints;
+    const simit::Set &edgeSet;
+    unsigned elemID;
   };
 
-  return new SetEndpointNeighbors(edgeSet.getEndpoints(ElementRef(elemID)));
+  return new SetEndpointNeighbors(edgeSet, elemID);
 }
 
 void SetEndpointPathIndex::print(std::ostream &os) const {
@@ -177,8 +191,9 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
       }
 
       size_t numElements = pathNeighbors.size();
-      uint32_t* coordsData= (uint32_t*)malloc((numElements+1)*sizeof(uint32_t));
-      uint32_t* sinksData = (uint32_t*)malloc(numNeighbors*sizeof(uint32_t));
+      uint32_t* coordsData =
+          (uint32_t*)allocate((numElements+1)*sizeof(uint32_t));
+      uint32_t* sinksData = (uint32_t*)allocate(numNeighbors*sizeof(uint32_t));
 
       int currNbrsStart = 0;
       for (auto& p : pathNeighbors) {
@@ -229,9 +244,10 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
           // populate neighbor lists
           for (auto &e : edgeSet) {
             iassert(e.getIdent() >= 0);
-            for (auto &ep : edgeSet.getEndpoints(e)) {
-              iassert(ep.getIdent() >= 0);
-              pathNeighbors.at(ep.getIdent()).push_back(e.getIdent());
+            for (int i=0; i < edgeSet.getCardinality(); ++i) {
+              int ep = edgeSet.getEndpointLocation(e.getIdent(), i);
+              iassert(ep >= 0);
+              pathNeighbors.at(ep).push_back(e.getIdent());
             }
           }
           pi = pack(pathNeighbors);
@@ -479,9 +495,6 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
     PathIndexBuilder *builder;
   };
 
-  // TODO: Possible optimization is to detect symmetric path expressions, and
-  //       return the same path index when they are evaluated in both directions
-
   // Check if we have memoized the path index for this path expression, starting
   // at this sourceEndpoint, bound to these sets.
   if (util::contains(pathIndices, {pe,sourceEndpoint})) {
@@ -490,9 +503,171 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
 
   PathIndex pi = PathNeighborVisitor(this).build(pe);
   pathIndices.insert({{pe,sourceEndpoint}, pi});
+
+  // Symmetric path expressions have the same path index when they are
+  // evaluated in both directions, so we memoize it for both.
+  if (isSymmetric(pe)) {
+    for (unsigned ep=0; ep < pe.getNumPathEndpoints(); ++ep) {
+      pathIndices.insert({{pe,ep}, pi});
+    }
+  }
+  return pi;
+}
+
+PathIndex PathIndexBuilder::buildUpperTriangular(const PathExpression &pe) {
+  iassert(isSymmetric(pe))
+      << "only symmetric path expressions have upper triangular indices: "
+      << pe;
+
+  if (util::contains(upperTriangularIndices, pe)) {
+    return upperTriangularIndices.at(pe);
+  }
+
+  // The upper triangle is extracted from the full index, which is only kept
+  // if it was built before (and is thus used by other tensors).
+  const bool fullIsMemoized = util::contains(pathIndices, make_pair(pe,0u));
+  PathIndex full = buildSegmented(pe, 0);
+  size_t numElements = full.numElements();
+
+  // Keep the neighbors that are not smaller than the source, in the order they
+  // appear in the full index.
+  size_t numNeighbors = 0;
+  for (unsigned elem : full) {
+    for (unsigned nbr : full.neighbors(elem)) {
+      numNeighbors += (nbr >= elem) ? 1 : 0;
+    }
+  }
+  uint32_t* coordsData = (uint32_t*)allocate((numElements+1)*sizeof(uint32_t));
+  uint32_t* sinksData = (uint32_t*)allocate(numNeighbors*sizeof(uint32_t));
+
+  uint32_t currNbrsStart = 0;
+  for (unsigned elem : full) {
+    coordsData[elem] = currNbrsStart;
+    for (unsigned nbr : full.neighbors(elem)) {
+      if (nbr >= elem) {
+        sinksData[currNbrsStart++] = nbr;
+      }
+    }
+  }
+  coordsData[numElements] = currNbrsStart;
+  iassert(currNbrsStart == numNeighbors);
+
+  if (!fullIsMemoized) {
+    for (unsigned ep=0; ep < pe.getNumPathEndpoints(); ++ep) {
+      pathIndices.erase({pe,ep});
+    }
+  }
+
+  PathIndex pi = new SegmentedPathIndex(numElements, coordsData, sinksData);
+  upperTriangularIndices.insert({pe, pi});
+  return pi;
+}
+
+PathIndex PathIndexBuilder::load(const PathExpression &pe,
+                                 const std::string &filename,
+                                 bool upperTriangular) {
+  if (upperTriangular && util::contains(upperTriangularIndices, pe)) {
+    return upperTriangularIndices.at(pe);
+  }
+  if (!upperTriangular && util::contains(pathIndices, make_pair(pe,0u))) {
+    return pathIndices.at({pe,0});
+  }
+
+  internal::IndexFileKind kind = upperTriangular
+                                 ? internal::IndexFileKind::UpperTriangularIndex
+                                 : internal::IndexFileKind::PathIndex;
+  shared_ptr<internal::MappedIndexFile> indexFile =
+      internal::MappedIndexFile::open(filename, kind, fingerprint(pe));
+  if (indexFile == nullptr) {
+    return PathIndex();
+  }
+
+  PathIndex pi = new SegmentedPathIndex(indexFile);
+  if (upperTriangular) {
+    upperTriangularIndices.insert({pe, pi});
+  }
+  else {
+    pathIndices.insert({{pe,0}, pi});
+    if (isSymmetric(pe)) {
+      for (unsigned ep=1; ep < pe.getNumPathEndpoints(); ++ep) {
+        pathIndices.insert({{pe,ep}, pi});
+      }
+    }
+  }
   return pi;
 }
 
+bool PathIndexBuilder::save(const PathExpression &pe, const PathIndex &pi,
+                            const std::string &filename,
+                            bool upperTriangular) const {
+  iassert(isa<SegmentedPathIndex>(pi))
+      << "only segmented path indices can be saved";
+  const SegmentedPathIndex *spi = to<SegmentedPathIndex>(pi);
+  internal::IndexFileKind kind = upperTriangular
+                                 ? internal::IndexFileKind::UpperTriangularIndex
+                                 : internal::IndexFileKind::PathIndex;
+  return internal::writeIndexFile(filename, kind, fingerprint(pe),
+                                  spi->numElements(), spi->getCoordData(),
+                                  spi->getSinkData());
+}
+
+uint64_t PathIndexBuilder::fingerprint(const PathExpression &pe) const {
+  /// Collects the graphs that a path expression is evaluated over, and the
+  /// stencils of its lattice links.
+  class CollectGraphs : public PathExpressionVisitor {
+  public:
+    CollectGraphs(const PathIndexBuilder *builder) : builder(builder) {}
+
+    map<string, const simit::Set*> graphs;
+    vector<int> stencilOffsets;
+
+  private:
+    const PathIndexBuilder *builder;
+
+    void visit(const Link *link) {
+      switch (link->getType()) {
+        case Link::ev:
+        case Link::ve:
+          add(link->getEdgeSet().getName(),
+              builder->getBinding(link->getEdgeSet()));
+          add(link->getVertexSet().getName(),
+              builder->getBinding(link->getVertexSet()));
+          break;
+        case Link::vv: {
+          const ir::StencilLayout& stencil = link->getStencil();
+          add(stencil.getLatticeSet().getName(),
+              builder->getBinding(stencil.getLatticeSet()));
+          add(link->getVertexSet(0).getName(),
+              builder->getBinding(link->getVertexSet(0)));
+          for (auto &kv : stencil.getLayoutReversed()) {
+            stencilOffsets.push_back(kv.first);
+            stencilOffsets.insert(stencilOffsets.end(),
+                                  kv.second.begin(), kv.second.end());
+          }
+          break;
+        }
+      }
+    }
+
+    void add(const string &name, const simit::Set *set) {
+      graphs.insert({name, set});
+    }
+  };
+
+  CollectGraphs collector(this);
+  pe.accept(&collector);
+
+  string peString = util::toString(pe);
+  uint64_t hash = internal::fingerprint(peString.data(), peString.size());
+  hash = internal::fingerprint(collector.stencilOffsets.data(),
+                               collector.stencilOffsets.size()*sizeof(int),
+                               hash);
+  for (auto &graph : collector.graphs) {
+    hash = internal::fingerprint(*graph.second, hash);
+  }
+  return hash;
+}
+
 void PathIndexBuilder::bind(std::string name, const simit::Set* set) {
   bindings.insert({name,set});
 }
@@ -6,7 +6,9 @@
 #include <memory>
 #include <typeinfo>
 
+#include "allocator.h"
 #include "graph.h"
+#include "index_files.h"
 #include "path_expressions.h"
 #include "interfaces/printable.h"
 
@@ -175,8 +177,10 @@ private:
 class SegmentedPathIndex : public PathIndexImpl {
 public:
   ~SegmentedPathIndex() {
-    free(coordsData);
-    free(sinksData);
+    if (!indexFile) {
+      deallocate(coordsData);
+      deallocate(sinksData);
+    }
   }
 
   unsigned numElements() const {return numElems;}
@@ -199,6 +203,10 @@ private:
   uint32_t* coordsData;
   uint32_t* sinksData;
 
+  /// The index file that the segmented vector is mapped from, if the index was
+  /// loaded from a file.
+  std::shared_ptr<internal::MappedIndexFile> indexFile;
+
   void print(std::ostream &os) const;
 
   friend PathIndexBuilder;
@@ -206,6 +214,14 @@ private:
   SegmentedPathIndex(size_t numElements, uint32_t *nbrsStart, uint32_t *nbrs)
       : numElems(numElements), coordsData(nbrsStart), sinksData(nbrs) {}
 
+  // The index file is mapped read-only, and segmented path indices are never
+  // modified after they are built.
+  SegmentedPathIndex(std::shared_ptr<internal::MappedIndexFile> indexFile)
+      : numElems(indexFile->getNumElements()),
+        coordsData(const_cast<uint32_t*>(indexFile->getCoords())),
+        sinksData(const_cast<uint32_t*>(indexFile->getSinks())),
+        indexFile(indexFile) {}
+
   SegmentedPathIndex() : numElems(0), coordsData(nullptr), sinksData(nullptr) {
     coordsData = new uint32_t[1];
     coordsData[0] = 0;
@@ -237,6 +253,28 @@ public:
   // Build a Segmented path index by evaluating the `pe` over the given graph.
   PathIndex buildSegmented(const PathExpression &pe, unsigned sourceEndpoint);
 
+  // Build a Segmented path index that only contains the upper triangle of the
+  // symmetric path expression `pe`, that is the neighbors of each element that
+  // are not smaller than the element itself. The lower triangle is implied by
+  // symmetry, so this halves the index and the values of matrices that use it.
+  PathIndex buildUpperTriangular(const PathExpression &pe);
+
+  // Load the (upper triangular) segmented path index of `pe` from the index
+  // file `filename` (see index_files.h), without copying the index. Returns an
+  // undefined path index if the file does not exist, or if it was saved for
+  // `pe` evaluated over graphs that differ from those bound to this builder.
+  PathIndex load(const PathExpression &pe, const std::string &filename,
+                 bool upperTriangular=false);
+
+  // Save the (upper triangular) segmented path index `pi` of `pe`, evaluated
+  // over the graphs bound to this builder, to the index file `filename`.
+  // Returns false on I/O errors.
+  bool save(const PathExpression &pe, const PathIndex &pi,
+            const std::string &filename, bool upperTriangular=false) const;
+
+  // Fingerprint of `pe` evaluated over the graphs bound to this builder.
+  uint64_t fingerprint(const PathExpression &pe) const;
+
   void bind(std::string name, const simit::Set* set);
 
   const simit::Set* getBinding(pe::Set pset) const;
@@ -244,6 +282,7 @@ public:
 
 private:
   std::map<std::pair<PathExpression,unsigned>, PathIndex> pathIndices;
+  std::map<PathExpression, PathIndex> upperTriangularIndices;
   std::map<std::string, const simit::Set*> bindings;
 };
 
@@ -0,0 +1,214 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+std::ostream& operator<<(std::ostream& os, ProfileRegion::Kind kind) {
+  switch (kind) {
+    case ProfileRegion::Function:
+      return os << "function";
+    case ProfileRegion::Map:
+      return os << "map";
+    case ProfileRegion::Loop:
+      return os << "loop";
+    case ProfileRegion::Solve:
+      return os << "solve";
+  }
+  unreachable;
+  return os;
+}
+
+Profiler::Profiler(const std::vector<ProfileRegion>& regions,
+                   size_t traceCapacity)
+    : regions(regions), counters(new Counters[regions.size()]),
+      traceCapacity(traceCapacity), events(new Event[traceCapacity]),
+      creationCycles(readCycleCounter()) {
+  for (size_t i = 0; i < regions.size(); ++i) {
+    iassert(regions[i].parent < (int)i) << "regions must follow their parent";
+  }
+  reset();
+}
+
+uint64_t Profiler::getCount(int region) const {
+  return counters[region].count.load(memory_order_relaxed);
+}
+
+uint64_t Profiler::getCycles(int region) const {
+  return counters[region].cycles.load(memory_order_relaxed);
+}
+
+double Profiler::getSeconds(int region) const {
+  return getCycles(region) / getCyclesPerSecond();
+}
+
+double Profiler::getSelfSeconds(int region) const {
+  uint64_t cycles = getCycles(region);
+  for (size_t i = region+1; i < regions.size(); ++i) {
+    if (regions[i].parent == region) {
+      cycles -= min(cycles, getCycles(i));
+    }
+  }
+  return cycles / getCyclesPerSecond();
+}
+
+size_t Profiler::getNumDroppedEvents() const {
+  size_t numRecorded = numEvents.load(memory_order_relaxed);
+  return (numRecorded > traceCapacity) ? numRecorded - traceCapacity : 0;
+}
+
+void Profiler::reset() {
+  for (size_t i = 0; i < regions.size(); ++i) {
+    counters[i].count.store(0, memory_order_relaxed);
+    counters[i].cycles.store(0, memory_order_relaxed);
+  }
+  numEvents.store(0, memory_order_relaxed);
+}
+
+/// The nesting depth of each region.
+static vector<int> getDepths(const vector<ProfileRegion>& regions) {
+  vector<int> depths(regions.size());
+  for (size_t i = 0; i < regions.size(); ++i) {
+    depths[i] = (regions[i].parent < 0) ? 0 : depths[regions[i].parent] + 1;
+  }
+  return depths;
+}
+
+void Profiler::print(std::ostream& os) const {
+  const size_t NAME_WIDTH = 60;
+  const vector<int> depths = getDepths(regions);
+
+  double totalSeconds = 0.0;
+  for (size_t i = 0; i < regions.size(); ++i) {
+    if (regions[i].parent < 0) {
+      totalSeconds += getSeconds(i);
+    }
+  }
+
+  ios::fmtflags flags = os.flags();
+  for (size_t i = 0; i < regions.size(); ++i) {
+    string name = string(2*depths[i], ' ') + regions[i].name;
+    if (name.size() > NAME_WIDTH) {
+      name = name.substr(0, NAME_WIDTH-3) + "...";
+    }
+    double percentage = (totalSeconds > 0.0)
+                        ? 100.0 * getSeconds(i) / totalSeconds : 0.0;
+    os << left << setw(NAME_WIDTH) << name << right << fixed
+       << setprecision(6) << setw(12) << getSeconds(i) << " s"
+       << setprecision(1) << setw(7) << percentage << "%"
+       << setw(12) << getCount(i) << endl;
+  }
+  os.flags(flags);
+}
+
+static string escapeJSON(const string& str) {
+  stringstream ss;
+  for (char c : str) {
+    switch (c) {
+      case '"':  ss << "\\\""; break;
+      case '\\': ss << "\\\\"; break;
+      case '\n': ss << "\\n";  break;
+      case '\t': ss << "\\t";  break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          ss << "\\u" << hex << setw(4) << setfill('0') << (int)c;
+        }
+        else {
+          ss << c;
+        }
+    }
+  }
+  return ss.str();
+}
+
+void Profiler::printJSON(std::ostream& os) const {
+  ios::fmtflags flags = os.flags();
+  os << setprecision(9);
+  os << "{\"cyclesPerSecond\": " << getCyclesPerSecond() << ", "
+     << "\"droppedEvents\": " << getNumDroppedEvents() << ", "
+     << "\"regions\": [";
+  for (size_t i = 0; i < regions.size(); ++i) {
+    os << ((i == 0) ? "\n  " : ",\n  ")
+       << "{\"id\": " << i << ", "
+       << "\"name\": \"" << escapeJSON(regions[i].name) << "\", "
+       << "\"kind\": \"" << regions[i].kind << "\", "
+       << "\"parent\": " << regions[i].parent << ", "
+       << "\"count\": " << getCount(i) << ", "
+       << "\"cycles\": " << getCycles(i) << ", "
+       << "\"seconds\": " << getSeconds(i) << ", "
+       << "\"selfSeconds\": " << getSelfSeconds(i) << "}";
+  }
+  os << "\n]}" << endl;
+  os.flags(flags);
+}
+
+void Profiler::printChromeTrace(std::ostream& os) const {
+  const double microsecondsPerCycle = 1e6 / getCyclesPerSecond();
+  const size_t numTraced = min(numEvents.load(memory_order_acquire),
+                               traceCapacity);
+
+  ios::fmtflags flags = os.flags();
+  os << fixed << setprecision(3);
+  os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  for (size_t i = 0; i < numTraced; ++i) {
+    const Event& event = events[i];
+    const ProfileRegion& region = regions[event.region];
+    // Events recorded before a reset may start before the profiler did
+    double start = (double)(int64_t)(event.start - creationCycles);
+    os << ((i == 0) ? "\n  " : ",\n  ")
+       << "{\"name\": \"" << escapeJSON(region.name) << "\", "
+       << "\"cat\": \"" << region.kind << "\", "
+       << "\"ph\": \"X\", "
+       << "\"ts\": " << start * microsecondsPerCycle << ", "
+       << "\"dur\": " << (event.end-event.start) * microsecondsPerCycle << ", "
+       << "\"pid\": 0, \"tid\": " << event.thread << ", "
+       << "\"args\": {\"region\": " << event.region << "}}";
+  }
+  os << "\n]}" << endl;
+  os.flags(flags);
+}
+
+uint64_t Profiler::readCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// Measure the rate of the cycle counter against the steady clock.
+static double measureCyclesPerSecond() {
+  const auto duration = chrono::milliseconds(10);
+  const auto startTime = chrono::steady_clock::now();
+  const uint64_t startCycles = Profiler::readCycleCounter();
+  auto time = startTime;
+  while (time - startTime < duration) {
+    time = chrono::steady_clock::now();
+  }
+  const uint64_t cycles = Profiler::readCycleCounter() - startCycles;
+  return cycles / chrono::duration<double>(time - startTime).count();
+}
+
+double Profiler::getCyclesPerSecond() {
+  static const double cyclesPerSecond = measureCyclesPerSecond();
+  return cyclesPerSecond;
+}
+
+int Profiler::getThreadId() {
+  static atomic<int> numThreads(0);
+  static thread_local int id = numThreads.fetch_add(1);
+  return id;
+}
+
+}
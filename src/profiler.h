@@ -0,0 +1,133 @@
+#ifndef SIMIT_PROFILER_H
+#define SIMIT_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+
+/// A part of a profiled function whose executions its Profiler records.
+/// Regions nest: the profiled function contains the internal functions it
+/// calls and its maps, loops and solves, which contain the regions inside
+/// them. A function that is called from several places has one region, nested
+/// in the region of the first call, which records the executions of all the
+/// calls. Its time is therefore subtracted from the self time of the first
+/// caller only, and counted in the self time of the other callers.
+struct ProfileRegion {
+  enum Kind {Function, Map, Loop, Solve};
+
+  /// The name of the function, the map or solve statement, or the loop header.
+  std::string name;
+  Kind kind;
+
+  /// The region that contains this one, or -1 for the profiled function.
+  int parent;
+
+  ProfileRegion(const std::string& name, Kind kind, int parent)
+      : name(name), kind(kind), parent(parent) {}
+};
+
+std::ostream& operator<<(std::ostream&, ProfileRegion::Kind);
+
+/// A Profiler records the time a function compiled with profiling (see
+/// Program::compileWithTimers) spends in its regions. The generated code
+/// reads the processor's cycle counter when it enters and leaves a region and
+/// records the difference, so each region costs two counter reads and a call
+/// per execution. Loops that are nested in other loops or in maps, and the
+/// statements inside maps, are not regions, so profiling does not slow down
+/// the inner loops of a function.
+///
+/// The profiler counts the executions and the cycles of every region with
+/// atomic counters, so functions may record from several threads. It also
+/// keeps the first traceCapacity executions as trace events, which can be
+/// exported in the Chrome trace format (chrome://tracing).
+class Profiler {
+public:
+  static const size_t DEFAULT_TRACE_CAPACITY = 1 << 16;
+
+  explicit Profiler(const std::vector<ProfileRegion>& regions,
+                    size_t traceCapacity=DEFAULT_TRACE_CAPACITY);
+
+  const std::vector<ProfileRegion>& getRegions() const {return regions;}
+
+  /// Record an execution of the region that started and ended at the given
+  /// cycle counter values. Called by generated code, and thread-safe.
+  inline void record(int region, uint64_t start, uint64_t end) {
+    counters[region].count.fetch_add(1, std::memory_order_relaxed);
+    counters[region].cycles.fetch_add(end - start, std::memory_order_relaxed);
+    size_t event = numEvents.fetch_add(1, std::memory_order_relaxed);
+    if (event < traceCapacity) {
+      events[event] = {region, getThreadId(), start, end};
+    }
+  }
+
+  /// The number of times the region was executed.
+  uint64_t getCount(int region) const;
+
+  /// The cycles spent in the region, including its subregions.
+  uint64_t getCycles(int region) const;
+
+  /// The seconds spent in the region, including its subregions.
+  double getSeconds(int region) const;
+
+  /// The seconds spent in the region, excluding its subregions. Functions
+  /// called from several places make this inexact (see ProfileRegion).
+  double getSelfSeconds(int region) const;
+
+  /// The number of executions that were not kept as trace events, because
+  /// the trace was full.
+  size_t getNumDroppedEvents() const;
+
+  /// Clear the counters and the trace.
+  void reset();
+
+  /// Print the regions as an indented table of their seconds, share of the
+  /// function's time and number of executions.
+  void print(std::ostream& os) const;
+
+  /// Print the regions and their counters as a JSON object.
+  void printJSON(std::ostream& os) const;
+
+  /// Print the trace events in the Chrome trace event format, as complete
+  /// events with timestamps in microseconds since the profiler was created.
+  void printChromeTrace(std::ostream& os) const;
+
+  /// Read the cycle counter that generated code reads: the time stamp counter
+  /// on x86, and a nanosecond clock on other architectures.
+  static uint64_t readCycleCounter();
+
+  /// The rate of the cycle counter, measured once per process.
+  static double getCyclesPerSecond();
+
+private:
+  struct Counters {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> cycles;
+  };
+
+  struct Event {
+    int region;
+    int thread;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  std::vector<ProfileRegion> regions;
+  std::unique_ptr<Counters[]> counters;
+
+  size_t traceCapacity;
+  std::unique_ptr<Event[]> events;
+  std::atomic<size_t> numEvents;
+
+  uint64_t creationCycles;
+
+  /// A small id of the calling thread, for the trace events.
+  static int getThreadId();
+};
+
+}
+#endif
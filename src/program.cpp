@@ -10,7 +10,6 @@
 #include "program_context.h"
 #include "storage.h"
 #include "lower/lower.h"
-#include "timers.h"
 
 #include "backend/backend.h"
 
@@ -46,6 +46,10 @@ public:
   /// Compile and return a runnable function, or an undefined function if an
   /// error occured.
   Function compile(const std::string &function);
+
+  /// Compile a function like \ref compile, with profiling regions that record
+  /// where it spends its time in the function's Profiler (see
+  /// Function::getProfiler).
   Function compileWithTimers(const std::string &function);
 
   /// Verify the program by executing in-code comment tests.
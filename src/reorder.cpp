@@ -1,130 +1,456 @@
 #include "reorder.h"
 #include "graph.h"
 #include "hilbert.h"
+#include "graph_indices.h"
+#include "thread_pool.h"
 
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
 #include <climits>
 #include <cfloat>
 #include <string>
+#include <thread>
 
 using namespace std;
 namespace simit {
 
-  // ---------- Hilbert Reordering Heuristic ----------
+  // ---------- Parallel Helpers ----------
+  static unsigned getNumThreads(unsigned numThreads, size_t size) {
+    if (numThreads == 0) {
+      numThreads = max(thread::hardware_concurrency(), 1u);
+    }
+    // Do not start threads for small sets
+    const size_t minSizePerThread = 1 << 14;
+    return max<size_t>(1, min<size_t>(numThreads, size / minSizePerThread));
+  }
+
+  // Calls f(threadIndex, begin, end) on numThreads contiguous chunks of
+  // [0, size) in parallel, on the threads of the runtime's thread pool.
+  template <typename F>
+  static void parallelFor(unsigned numThreads, size_t size, F f) {
+    if (numThreads == 1) {
+      f(0, 0, size);
+      return;
+    }
+    // Share the solvers' pool, which by default has one thread per hardware
+    // thread, instead of starting threads for every loop
+    const unsigned poolThreads =
+        max(numThreads, max(thread::hardware_concurrency(), 1u));
+    getThreadPool(poolThreads).parallelFor(numThreads, size, f);
+  }
+
+  // ---------- Space Filling Curve Reordering Heuristics ----------
   namespace hilbert {
-    // This function populates the hilbertId field of each vertex_t in nodes, by
-    // remapping every vertex onto an n^3 lattice using appropriate scaling 
-    // factors,
-    // and then traversing the lattice using a 3-D Hilbert curve.
-    //
-    // hilbertBits = number of bits in Hilbert grid (grid with side 
-    // 2^hilbertBits)
-    void assignHilbertIds(vertex_t * const nodes, const int cntNodes,
-                          const unsigned hilbertBits) {
-      // We first traverse all vertices to find the maximal and minimal 
-      // coordinates
-      // along each axis: xMin, xMax, yMin, yMax, zMin, zMax.
-
-      double xMin, xMax, yMin, yMax, zMin, zMax;
-      uint64_t hilbertGridN = 1 << hilbertBits; xMin = yMin = zMin = DBL_MAX;
-      xMax = yMax = zMax = DBL_MIN;
-      for (int i = 0; i < cntNodes; ++i) {
-        xMin = fmin(xMin, nodes[i].x);
-        yMin = fmin(yMin, nodes[i].y);
-        zMin = fmin(zMin, nodes[i].z);
-        xMax = fmax(xMax, nodes[i].x);
-        yMax = fmax(yMax, nodes[i].y);
-        zMax = fmax(zMax, nodes[i].z);
+    // Spreads the low 21 bits of x so that there are two zero bits between
+    // each bit.
+    static uint64_t spreadBits3(uint64_t x) {
+      x &= 0x1fffff;
+      x = (x | x << 32) & 0x001f00000000ffffull;
+      x = (x | x << 16) & 0x001f0000ff0000ffull;
+      x = (x | x << 8)  & 0x100f00f00f00f00full;
+      x = (x | x << 4)  & 0x10c30c30c30c30c3ull;
+      x = (x | x << 2)  & 0x1249249249249249ull;
+      return x;
+    }
+
+    // Spreads the low 32 bits of x so that there is a zero bit between each
+    // bit.
+    static uint64_t spreadBits2(uint64_t x) {
+      x &= 0xffffffff;
+      x = (x | x << 16) & 0x0000ffff0000ffffull;
+      x = (x | x << 8)  & 0x00ff00ff00ff00ffull;
+      x = (x | x << 4)  & 0x0f0f0f0f0f0f0f0full;
+      x = (x | x << 2)  & 0x3333333333333333ull;
+      x = (x | x << 1)  & 0x5555555555555555ull;
+      return x;
+    }
+
+    static uint64_t mortonKey(const bitmask_t* coords, unsigned dims) {
+      if (dims == 3) {
+        return spreadBits3(coords[0]) << 2 | spreadBits3(coords[1]) << 1 |
+               spreadBits3(coords[2]);
       }
+      return spreadBits2(coords[0]) << 1 | spreadBits2(coords[1]);
+    }
 
-      // We now create a mapping that maps:
-      //   (xMin, yMin, zMin) to lattice point (0, 0, 0)
-      //   (xMax, yMax, zMax) to lattice point (n-1, n-1, n-1)
-      // where n = hilbertGridN
-      //
-      // This mapping is the following: for the T axis,
-      // tLattice = round((t - tMin) * (hilbertGridN - 1) / tMax);
+    // Computes the curve key of every vertex by mapping the bounding cube of
+    // the vertices onto a grid with side 2^bits and indexing the grid cell
+    // of the vertex along the curve.
+    template <typename T>
+    static void computeKeys(const Set::FieldData* spatialField, int numNodes,
+                            Curve curve, unsigned bits, unsigned numThreads,
+                            vector<uint64_t>& keys) {
+      const T* coords = static_cast<const T*>(spatialField->data);
+      const unsigned dims = spatialField->type->getDimension(0);
 
-      for (int i = 0; i < cntNodes; ++i) {
-        bitmask_t latticeCoords[3];
-        bitmask_t hilbertIndex;
+      // Bounding box of the vertices
+      vector<vector<double>> mins(numThreads, vector<double>(dims, DBL_MAX));
+      vector<vector<double>> maxs(numThreads, vector<double>(dims, -DBL_MAX));
+      parallelFor(numThreads, numNodes, [&](unsigned t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+          for (unsigned d = 0; d < dims; ++d) {
+            double x = coords[spatialField->getComponentIndex(i, d)];
+            mins[t][d] = min(mins[t][d], x);
+            maxs[t][d] = max(maxs[t][d], x);
+          }
+        }
+      });
+      vector<double> lo(dims, DBL_MAX);
+      double extent = 0.0;
+      for (unsigned d = 0; d < dims; ++d) {
+        double hi = -DBL_MAX;
+        for (unsigned t = 0; t < numThreads; ++t) {
+          lo[d] = min(lo[d], mins[t][d]);
+          hi = max(hi, maxs[t][d]);
+        }
+        extent = max(extent, hi - lo[d]);
+      }
+
+      // Scale all axes by the same factor to preserve the shape of the mesh
+      const uint64_t gridMax = (uint64_t(1) << bits) - 1;
+      const double scale = (extent > 0.0) ? gridMax / extent : 0.0;
+
+      keys.resize(numNodes);
+      parallelFor(numThreads, numNodes, [&](unsigned t, size_t b, size_t e) {
+        bitmask_t cell[3];
+        for (size_t i = b; i < e; ++i) {
+          for (unsigned d = 0; d < dims; ++d) {
+            double x = coords[spatialField->getComponentIndex(i, d)];
+            cell[d] = min<uint64_t>(gridMax, (uint64_t)((x - lo[d]) * scale));
+          }
+          keys[i] = (curve == Curve::Hilbert) ? hilbert_c2i(dims, bits, cell)
+                                              : mortonKey(cell, dims);
+        }
+      });
+    }
 
-        nodes[i].id = (vid_t)i;
+    // Sorts ids by keys with a stable least significant digit radix sort. In
+    // each pass every thread counts the digits of its chunk, and then scatters
+    // its chunk to the offsets of its digits after the chunks of the threads
+    // before it.
+    static void radixSort(vector<uint64_t>& keys, vector<int>& ids,
+                          unsigned keyBits, unsigned numThreads) {
+      const unsigned digitBits = 8;
+      const unsigned numDigits = 1 << digitBits;
+      const size_t size = keys.size();
+      vector<uint64_t> tmpKeys(size);
+      vector<int> tmpIds(size);
+      vector<size_t> counts(numThreads * numDigits);
 
-        latticeCoords[0] = (uint64_t) round((nodes[i].x - xMin) * (hilbertGridN 
-              - 1) / xMax);
-        latticeCoords[1] = (uint64_t) round((nodes[i].y - yMin) * (hilbertGridN 
-              - 1) / yMax);
-        latticeCoords[2] = (uint64_t) round((nodes[i].z - zMin) * (hilbertGridN 
-              - 1) / zMax);
+      for (unsigned shift = 0; shift < keyBits; shift += digitBits) {
+        fill(counts.begin(), counts.end(), 0);
+        parallelFor(numThreads, size, [&](unsigned t, size_t b, size_t e) {
+          size_t* count = &counts[t * numDigits];
+          for (size_t i = b; i < e; ++i) {
+            ++count[(keys[i] >> shift) & (numDigits-1)];
+          }
+        });
 
-        hilbertIndex = hilbert_c2i(3, hilbertBits, latticeCoords);
-        nodes[i].hilbertId = (vid_t) hilbertIndex;
+        // Offsets ordered by digit and then by thread
+        size_t offset = 0;
+        for (unsigned digit = 0; digit < numDigits; ++digit) {
+          for (unsigned t = 0; t < numThreads; ++t) {
+            size_t count = counts[t * numDigits + digit];
+            counts[t * numDigits + digit] = offset;
+            offset += count;
+          }
+        }
 
+        parallelFor(numThreads, size, [&](unsigned t, size_t b, size_t e) {
+          size_t* offsets = &counts[t * numDigits];
+          for (size_t i = b; i < e; ++i) {
+            size_t loc = offsets[(keys[i] >> shift) & (numDigits-1)]++;
+            tmpKeys[loc] = keys[i];
+            tmpIds[loc] = ids[i];
+          }
+        });
+        keys.swap(tmpKeys);
+        ids.swap(tmpIds);
       }
     }
 
-    bool vertexComparator(const vertex_t& a, const vertex_t& b) {
-      if (a.hilbertId != b.hilbertId) {
-        return a.hilbertId < b.hilbertId;
-      } else {
-        return a.id < b.id;
+    void spaceFillingCurveReorder(const Set& vertexSet,
+        vector<int>& vertexOrdering, Curve curve, unsigned bits,
+        unsigned numThreads) {
+      const Set::FieldData* spatialField = vertexSet.getFields()[
+          vertexSet.getFieldIndex(vertexSet.getSpatialFieldName())];
+      const unsigned dims = spatialField->type->getDimension(0);
+      uassert(bits > 0 && dims * bits <= 64) << "Space filling curve keys of "
+          << dims << "D points can have at most " << 64/dims << " bits per axis";
+
+      const int cntNodes = vertexSet.getSize();
+      numThreads = getNumThreads(numThreads, cntNodes);
+
+      vector<uint64_t> keys;
+      switch (spatialField->type->getComponentType()) {
+        case ComponentType::Float:
+          computeKeys<float>(spatialField, cntNodes, curve, bits, numThreads,
+                             keys);
+          break;
+        case ComponentType::Double:
+          computeKeys<double>(spatialField, cntNodes, curve, bits, numThreads,
+                              keys);
+          break;
+        default:
+          ierror << "Spatial field must have float or double components";
+      }
+
+      vector<int> ids(cntNodes);
+      for (int i = 0; i < cntNodes; ++i) {
+        ids[i] = i;
       }
-    }
+      radixSort(keys, ids, dims * bits, numThreads);
 
-    static void createIdTranslationMapping(vertex_t * reorderedNodes, 
-        vector<int>& vertexOrdering, int cntNodes) {
       iassert(vertexOrdering.size() == 0);
       vertexOrdering.resize(cntNodes);
+      parallelFor(numThreads, cntNodes, [&](unsigned t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+          vertexOrdering[ids[i]] = i;
+        }
+      });
+    }
 
-      for (int i = 0; i < cntNodes; ++i) {
-        vertexOrdering[reorderedNodes[i].id] = i;
+    void hilbertReorder(const Set& vertexSet, vector<int>& vertexOrdering) {
+      spaceFillingCurveReorder(vertexSet, vertexOrdering, Curve::Hilbert);
+    }
+  } // namespace simit::hilbert
+
+  // ---------- Graph Reordering Heuristics ----------
+  namespace graph {
+    // Vertex adjacency of one or more edge sets that connect the same vertex
+    // set, without self loops.
+    struct Adjacency {
+      Adjacency(const vector<const Set*>& edgeSets) {
+        uassert(edgeSets.size() > 0) << "Graph reordering requires an edge set";
+        const Set* vertexSet = edgeSets[0]->getEndpointSet(0);
+        vector<const int*> starts;
+        vector<const int*> sinks;
+        for (const Set* edgeSet : edgeSets) {
+          uassert(edgeSet->getCardinality() >= 2 && edgeSet->isHomogeneous() &&
+                  edgeSet->getEndpointSet(0) == vertexSet)
+              << "Graph reordering requires edge sets that connect the \
+                 vertices of one vertex set";
+          const internal::NeighborIndex* nbrs = edgeSet->getNeighborIndex();
+          starts.push_back(nbrs->getStartIndex());
+          sinks.push_back(nbrs->getNeighborIndex());
+        }
+        numVertices = vertexSet->getSize();
+
+        start.resize(numVertices+1);
+        degree.resize(numVertices);
+        start[0] = 0;
+        for (int v = 0; v < numVertices; ++v) {
+          size_t first = neighbors.size();
+          for (size_t k = 0; k < starts.size(); ++k) {
+            for (int i = starts[k][v]; i < starts[k][v+1]; ++i) {
+              if (sinks[k][i] != v) {
+                neighbors.push_back(sinks[k][i]);
+              }
+            }
+          }
+          // Vertices connected by several edge sets are listed once
+          if (starts.size() > 1) {
+            sort(neighbors.begin() + first, neighbors.end());
+            neighbors.erase(unique(neighbors.begin() + first, neighbors.end()),
+                            neighbors.end());
+          }
+          start[v+1] = neighbors.size();
+          degree[v] = start[v+1] - start[v];
+        }
+      }
+
+      int numVertices;
+      vector<int> start;
+      vector<int> neighbors;
+      vector<int> degree;
+    };
+
+    // Breadth first search from root over the vertices that are not ordered.
+    // Appends the visited vertices to levelOrder and returns the number of
+    // levels. The level of each visited vertex is recorded in levels, which
+    // must be -1 for unvisited vertices and is reset before returning.
+    static int breadthFirstLevels(const Adjacency& adj, int root,
+        const vector<bool>& ordered, vector<int>& levels,
+        vector<int>& levelOrder, int* lastLevelStart) {
+      size_t first = levelOrder.size();
+      levelOrder.push_back(root);
+      levels[root] = 0;
+      int numLevels = 1;
+      *lastLevelStart = first;
+      for (size_t i = first; i < levelOrder.size(); ++i) {
+        int v = levelOrder[i];
+        for (int j = adj.start[v]; j < adj.start[v+1]; ++j) {
+          int w = adj.neighbors[j];
+          if (levels[w] == -1 && !ordered[w]) {
+            levels[w] = levels[v] + 1;
+            if (levels[w] == numLevels) {
+              *lastLevelStart = levelOrder.size();
+              ++numLevels;
+            }
+            levelOrder.push_back(w);
+          }
+        }
+      }
+      for (size_t i = first; i < levelOrder.size(); ++i) {
+        levels[levelOrder[i]] = -1;
       }
+      return numLevels;
     }
 
-    void loadNodes(Set& vertexSet, vertex_t ** outNodes, int numNodes) {
-      vertex_t * nodes = new (nothrow) vertex_t[numNodes];
-      
-      auto& fields = vertexSet.getFields();
-      int fieldIndex = vertexSet.getFieldIndex(vertexSet.getSpatialFieldName());
-      double * spatialData = static_cast<double*>(fields[fieldIndex]->data);  
-     
-      for (int i = 0; i < numNodes; ++i) {
-        nodes[i].id = i; nodes[i].x = spatialData[i*3+0];
-        nodes[i].y = spatialData[i*3+1];
-        nodes[i].z = spatialData[i*3+2];
+    // Finds a pseudo-peripheral vertex in the component of start with the
+    // George-Liu algorithm: repeatedly move to a vertex of smallest degree in
+    // the last breadth first level, until the number of levels stops growing.
+    static int findPseudoPeripheralVertex(const Adjacency& adj, int start,
+        const vector<bool>& ordered, vector<int>& levels) {
+      vector<int> levelOrder;
+      int lastLevelStart;
+      int root = start;
+      int numLevels = breadthFirstLevels(adj, root, ordered, levels,
+                                         levelOrder, &lastLevelStart);
+      while (true) {
+        int candidate = levelOrder[lastLevelStart];
+        for (size_t i = lastLevelStart; i < levelOrder.size(); ++i) {
+          if (adj.degree[levelOrder[i]] < adj.degree[candidate]) {
+            candidate = levelOrder[i];
+          }
+        }
+        levelOrder.clear();
+        int candidateLevels = breadthFirstLevels(adj, candidate, ordered,
+            levels, levelOrder, &lastLevelStart);
+        if (candidateLevels <= numLevels) {
+          return root;
+        }
+        root = candidate;
+        numLevels = candidateLevels;
       }
-      
-      *outNodes = nodes;
     }
 
-    void hilbertReorder(Set& vertexSet, vector<int>& vertexOrdering) {
-      vertex_t * nodes;
-      const int hilbertBits = 8;  int cntNodes = vertexSet.getSize();
-      loadNodes(vertexSet, &nodes, cntNodes);
+    // Computes the Cuthill-McKee permutation, where permutation[i] is the
+    // vertex placed at position i.
+    static vector<int> cuthillMcKee(const vector<const Set*>& edgeSets) {
+      Adjacency adj(edgeSets);
+      const int n = adj.numVertices;
+
+      // Components are started from their vertex of lowest degree
+      vector<int> byDegree(n);
+      for (int v = 0; v < n; ++v) {
+        byDegree[v] = v;
+      }
+      stable_sort(byDegree.begin(), byDegree.end(), [&adj](int a, int b) {
+        return adj.degree[a] < adj.degree[b];
+      });
+
+      vector<int> permutation;
+      permutation.reserve(n);
+      vector<bool> ordered(n, false);
+      vector<int> levels(n, -1);
+      vector<int> unorderedNeighbors;
+      for (int start : byDegree) {
+        if (ordered[start]) {
+          continue;
+        }
+        int root = findPseudoPeripheralVertex(adj, start, ordered, levels);
+        size_t next = permutation.size();
+        permutation.push_back(root);
+        ordered[root] = true;
+        for (; next < permutation.size(); ++next) {
+          int v = permutation[next];
+          unorderedNeighbors.clear();
+          for (int j = adj.start[v]; j < adj.start[v+1]; ++j) {
+            int w = adj.neighbors[j];
+            if (!ordered[w]) {
+              ordered[w] = true;
+              unorderedNeighbors.push_back(w);
+            }
+          }
+          stable_sort(unorderedNeighbors.begin(), unorderedNeighbors.end(),
+              [&adj](int a, int b) {return adj.degree[a] < adj.degree[b];});
+          permutation.insert(permutation.end(), unorderedNeighbors.begin(),
+                             unorderedNeighbors.end());
+        }
+      }
+      iassert(permutation.size() == (size_t)n);
+      return permutation;
+    }
+
+    static void createIdTranslationMapping(const vector<int>& permutation,
+        vector<int>& vertexOrdering) {
+      iassert(vertexOrdering.size() == 0);
+      vertexOrdering.resize(permutation.size());
+      for (size_t i = 0; i < permutation.size(); ++i) {
+        vertexOrdering[permutation[i]] = i;
+      }
+    }
 
-      assignHilbertIds(nodes, cntNodes, hilbertBits);
-      stable_sort(nodes, nodes + cntNodes, vertexComparator);
-      createIdTranslationMapping(nodes, vertexOrdering, cntNodes);
+    void rcmReorder(const vector<const Set*>& edgeSets,
+                    vector<int>& vertexOrdering) {
+      vector<int> permutation = cuthillMcKee(edgeSets);
+      reverse(permutation.begin(), permutation.end());
+      createIdTranslationMapping(permutation, vertexOrdering);
     }
-  } // namespace simit::hilbert
+
+    void rcmReorder(const Set& edgeSet, vector<int>& vertexOrdering) {
+      rcmReorder(vector<const Set*>(1, &edgeSet), vertexOrdering);
+    }
+
+    void bfsReorder(const vector<const Set*>& edgeSets,
+                    vector<int>& vertexOrdering) {
+      createIdTranslationMapping(cuthillMcKee(edgeSets), vertexOrdering);
+    }
+
+    void bfsReorder(const Set& edgeSet, vector<int>& vertexOrdering) {
+      bfsReorder(vector<const Set*>(1, &edgeSet), vertexOrdering);
+    }
+  } // namespace simit::graph
+
+  // ---------- Matrix Bandwidth ----------
+  ostream& operator<<(ostream& os, const MatrixBandwidth& bw) {
+    return os << "bandwidth " << bw.bandwidth << ", profile " << bw.profile;
+  }
+
+  ostream& operator<<(ostream& os, const ReorderingReport& report) {
+    return os << "before: " << report.before << endl
+              << "after:  " << report.after;
+  }
+
+  MatrixBandwidth getBandwidth(const Set& edgeSet,
+      const vector<int>& vertexOrdering) {
+    const internal::NeighborIndex* nbrs = edgeSet.getNeighborIndex();
+    const int* start = nbrs->getStartIndex();
+    const int* neighbors = nbrs->getNeighborIndex();
+    const int numVertices = edgeSet.getEndpointSet(0)->getSize();
+    iassert(vertexOrdering.size() == (size_t)numVertices);
+
+    MatrixBandwidth bw;
+    for (int v = 0; v < numVertices; ++v) {
+      int row = vertexOrdering[v];
+      int firstColumn = row;
+      for (int i = start[v]; i < start[v+1]; ++i) {
+        int column = vertexOrdering[neighbors[i]];
+        bw.bandwidth = max(bw.bandwidth, abs(row - column));
+        firstColumn = min(firstColumn, column);
+      }
+      bw.profile += row - firstColumn;
+    }
+    return bw;
+  }
+
+  MatrixBandwidth getBandwidth(const Set& edgeSet) {
+    vector<int> identity(edgeSet.getEndpointSet(0)->getSize());
+    for (size_t i = 0; i < identity.size(); ++i) {
+      identity[i] = i;
+    }
+    return getBandwidth(edgeSet, identity);
+  }
  
   // ---------- Simit Level Reordering Heuristics ----------
-  int qsortCompare( const void* a, const void* b) {
-       int int_a = * ( (int*) a );
-       int int_b = * ( (int*) b );
-
-       if ( int_a == int_b ) return 0;
-       else if ( int_a < int_b ) return -1;
-       else return 1;
-  } 
-  
   struct edgeCompare{
-    edgeCompare(int* endpoints, const int cardinality) : endpoints(endpoints),
-      cardinality(cardinality)
+    edgeCompare(const int* endpoints, const int cardinality)
+      : endpoints(endpoints), cardinality(cardinality)
       {}
     
     bool operator()(int const&left, int const&right) const {
@@ -135,39 +461,142 @@ namespace simit {
         if (leftID != rightID) {
           return leftID < rightID; }
       }
-      return true;
+      return left < right;
     }
     private:
-      int* endpoints;
+      const int* endpoints;
       const int cardinality;
   };
 
-  void edgeVertexSortReordering(Set& edgeSet, vector<int>& edgeOrdering) {
-    int* endpoints = edgeSet.getEndpointsPtr();
-    const int size = edgeSet.getSize();
+  // Computes the edge ordering (old to new) that sorts the edges of the edge
+  // set by their endpoints in the vertex set, compared as sorted tuples.
+  // Endpoints in other sets of heterogeneous edge sets are not considered.
+  // Keys are built and sorted in parallel chunks that are then merged.
+  static void edgeVertexSortReordering(const Set& edgeSet,
+      const Set& vertexSet, vector<int>& edgeOrdering) {
+    const int* endpoints = edgeSet.getEndpointsData();
+    const size_t size = edgeSet.getSize();
     const int cardinality = edgeSet.getCardinality();
-    
-    assert(edgeOrdering.size() == 0);
+    vector<int> slots;
+    for (int j=0; j < cardinality; ++j) {
+      if (edgeSet.getEndpointSet(j) == &vertexSet) {
+        slots.push_back(j);
+      }
+    }
+    const int numKeys = slots.size();
+    const unsigned numThreads = getNumThreads(0, size);
+
+    vector<int> keys(size * numKeys);
+    vector<int> sortedEdges(size);
+    edgeCompare compare(keys.data(), numKeys);
+    parallelFor(numThreads, size, [&](unsigned t, size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) {
+        // Insertion sort the handful of endpoints of the edge
+        int* key = &keys[i*numKeys];
+        for (int j=0; j < numKeys; ++j) {
+          int endpoint = endpoints[i*cardinality + slots[j]];
+          int k = j;
+          for (; k > 0 && key[k-1] > endpoint; --k) {
+            key[k] = key[k-1];
+          }
+          key[k] = endpoint;
+        }
+        sortedEdges[i] = i;
+      }
+      sort(sortedEdges.begin() + b, sortedEdges.begin() + e, compare);
+    });
+    for (size_t width = 1; width < numThreads; width *= 2) {
+      for (size_t t = 0; t + width < numThreads; t += 2*width) {
+        inplace_merge(sortedEdges.begin() + size*t/numThreads,
+                      sortedEdges.begin() + size*(t+width)/numThreads,
+                      sortedEdges.begin() +
+                          size*min<size_t>(t+2*width, numThreads)/numThreads,
+                      compare);
+      }
+    }
+
+    // Map old to new indices
+    iassert(edgeOrdering.size() == 0);
     edgeOrdering.resize(size);
-    int* sortableEndpoints = static_cast<int *>(malloc(size * cardinality * 
-          sizeof(int)));
-    memcpy(sortableEndpoints, endpoints, size * cardinality * sizeof(int));
+    parallelFor(numThreads, size, [&](unsigned t, size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) {
+        edgeOrdering[sortedEdges[i]] = i;
+      }
+    });
+  }
 
-    for (int index=0; index < size; ++index) {
-      edgeOrdering[index] = index;
-      qsort(sortableEndpoints+ index*cardinality, cardinality, sizeof(int), 
-          qsortCompare);
-    } 
-    
-    sort(edgeOrdering.begin(), edgeOrdering.end(), 
-        edgeCompare(sortableEndpoints, cardinality));
-    free(sortableEndpoints);
+  void computeIterationOrder(const Set& edgeSet, vector<int>& iterationOrder) {
+    uassert(edgeSet.getKind() == Set::Unstructured &&
+            edgeSet.getCardinality() > 0) << "Iteration orders are computed \
+      for unstructured edge sets";
+    const size_t size = edgeSet.getSize();
+    const int cardinality = edgeSet.getCardinality();
+    const Set& vertexSet = *edgeSet.getEndpointSet(0);
+    if (!vertexSet.hasSpatialField()) {
+      vector<int> edgeOrdering;
+      edgeVertexSortReordering(edgeSet, vertexSet, edgeOrdering);
+      iterationOrder.resize(size);
+      for (size_t i = 0; i < size; ++i) {
+        iterationOrder[edgeOrdering[i]] = i;
+      }
+      return;
+    }
+
+    // Sort edges by the curve position of their first endpoint, and edges
+    // that share it by their location
+    vector<int> vertexOrdering;
+    hilbert::spaceFillingCurveReorder(vertexSet, vertexOrdering);
+    const int* endpoints = edgeSet.getEndpointsData();
+    vector<int> keys(size);
+    iterationOrder.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+      keys[i] = vertexOrdering[endpoints[i*cardinality]];
+      iterationOrder[i] = i;
+    }
+    sort(iterationOrder.begin(), iterationOrder.end(),
+         edgeCompare(keys.data(), 1));
+  }
+
+  void computeSparseTiles(const Set& edgeSet, int tileSize,
+      vector<int>& tileStarts, vector<int>& tileEdges) {
+    uassert(edgeSet.getKind() == Set::Unstructured &&
+            edgeSet.getCardinality() > 0) << "Sparse tiles are computed for \
+      unstructured edge sets";
+    uassert(tileSize > 0) << "Invalid sparse tile size: " << tileSize;
+    const int size = edgeSet.getSize();
+    const int cardinality = edgeSet.getCardinality();
+    const Set& vertexSet = *edgeSet.getEndpointSet(0);
+    for (int i = 1; i < cardinality; ++i) {
+      uassert(edgeSet.getEndpointSet(i) == &vertexSet) << "Sparse tiles are \
+        computed for edge sets whose endpoints are in one set";
+    }
+    const int numTiles = (vertexSet.getSize() + tileSize - 1) / tileSize;
+
+    // Counting sort of the edges by the tile of their smallest endpoint
+    const int* endpoints = edgeSet.getEndpointsData();
+    vector<int> tiles(size);
+    tileStarts.assign(numTiles + 1, 0);
+    for (int e = 0; e < size; ++e) {
+      const int* edge = &endpoints[e * cardinality];
+      tiles[e] = *min_element(edge, edge + cardinality) / tileSize;
+      ++tileStarts[tiles[e] + 1];
+    }
+    for (int t = 0; t < numTiles; ++t) {
+      tileStarts[t + 1] += tileStarts[t];
+    }
+    vector<int> next(tileStarts.begin(), tileStarts.end() - 1);
+    tileEdges.resize(size);
+    for (int e = 0; e < size; ++e) {
+      tileEdges[next[tiles[e]]++] = e;
+    }
   }
 
   // ---------- Reordering Helper Functions ----------
   void reorderFields(vector<Set::FieldData*>& fields, const vector<int>& 
       ordering) {
     for (auto f : fields) {
+      uassert(f->layout == FieldLayout::SoA) << "Interleaved fields cannot \
+        be reordered, reorder before calling Set::setFieldLayout()";
       switch (f->type->getComponentType()) {
         case ComponentType::Float: {
           float* data = static_cast<float *>(f->data);
@@ -187,14 +616,17 @@ namespace simit {
         case ComponentType::Boolean: {
           bool* data = static_cast<bool *>(f->data);
           reorderFieldData(data, ordering, f->sizeOfType);
+          break;
         }
         case ComponentType::DoubleComplex: {
           double_complex* data = static_cast<double_complex *>(f->data);
           reorderFieldData(data, ordering, f->sizeOfType);
+          break;
         }
         case ComponentType::FloatComplex: {
           float_complex* data = static_cast<float_complex *>(f->data);
           reorderFieldData(data, ordering, f->sizeOfType);
+          break;
         }
       }
     }
@@ -215,20 +647,24 @@ namespace simit {
       iassert(edgeIndex < edgeOrdering.size());
       iassert(edgeOrdering[edgeIndex] < (int) ((size - 1) * cardinality * 
             sizeof(int)));
-      memcpy(newEndpoints + edgeIndex * cardinality, endpoints + 
-          edgeOrdering[edgeIndex] * cardinality, cardinality * sizeof(int));
+      memcpy(newEndpoints + edgeOrdering[edgeIndex] * cardinality, endpoints +
+          edgeIndex * cardinality, cardinality * sizeof(int));
     }
     memcpy(endpoints, newEndpoints, size * cardinality * sizeof(int));
     free(newEndpoints);
+    edgeSet.clearNeighborIndex();
     
     reorderFields(edgeSet.getFields(), edgeOrdering);
   }
 
   void reorderEdgeSetByVertexOrdering(Set& edgeSet, const vector<int>& 
       vertexOrdering) {
+    uassert(edgeSet.isHomogeneous()) << "The endpoints of heterogeneous edge \
+      sets are reordered with reorder(Set&)";
     for (int i=0; i < edgeSet.getSize() * edgeSet.getCardinality(); ++i) {
       edgeSet.getEndpointsPtr()[i] = 
         vertexOrdering[edgeSet.getEndpointsPtr()[i]]; }
+    edgeSet.clearNeighborIndex();
   }
     
   void reorderVertexSet(Set& edgeSet, Set& vertexSet, vector<int>& 
@@ -246,25 +682,210 @@ namespace simit {
     reorderFields(vertexSet.getFields(), vertexOrdering);
   }
   
-  void reorder(Set& edgeSet, Set& vertexSet, vector<int>& edgeOrdering, 
+  // Returns the edge sets that connect the vertices of the vertex set and so
+  // define its adjacency graph.
+  static vector<const Set*> getAdjacencyEdgeSets(const Set& vertexSet) {
+    vector<const Set*> edgeSets;
+    for (const Set* edgeSet : vertexSet.getEdgeSets()) {
+      if (edgeSet->getCardinality() >= 2 && edgeSet->isHomogeneous()) {
+        edgeSets.push_back(edgeSet);
+      }
+    }
+    return edgeSets;
+  }
+
+  static void computeVertexOrdering(const vector<const Set*>& edgeSets,
+      Set& vertexSet, ReorderingHeuristic heuristic,
       vector<int>& vertexOrdering) {
-    iassert(vertexSet.hasSpatialField()) << "Vertex Set must have a spatial \
-      field set prior to reordering";
+    switch (heuristic) {
+      case ReorderingHeuristic::Hilbert:
+      case ReorderingHeuristic::Morton:
+        uassert(vertexSet.hasSpatialField()) << "Vertex Set must have a \
+          spatial field set prior to reordering";
+        hilbert::spaceFillingCurveReorder(vertexSet, vertexOrdering,
+            (heuristic == ReorderingHeuristic::Hilbert) ? hilbert::Curve::Hilbert
+                                                        : hilbert::Curve::Morton);
+        break;
+      case ReorderingHeuristic::RCM:
+      case ReorderingHeuristic::BFS:
+        uassert(edgeSets.size() > 0 &&
+                edgeSets[0]->getEndpointSet(0) == &vertexSet) << "Graph \
+          reordering requires an edge set that connects the vertex set";
+        if (heuristic == ReorderingHeuristic::RCM) {
+          graph::rcmReorder(edgeSets, vertexOrdering);
+        }
+        else {
+          graph::bfsReorder(edgeSets, vertexOrdering);
+        }
+        break;
+    }
+  }
+
+  // Relocates the vertex set by the vertex ordering and then every edge set
+  // with endpoints in it by the sorted endpoints of its edges. Edge sets are
+  // relocated one at a time, each sort running in parallel, and edge sets that
+  // are themselves the endpoint sets of other edge sets go last, since
+  // relocating them updates those.
+  // If edgeOrderings is not null, the edge ordering of every edge set is
+  // stored in it.
+  static void relocateGraph(Set& vertexSet, const vector<int>& vertexOrdering,
+                            bool keepIdentifiers,
+                            map<const Set*,vector<int>>* edgeOrderings=nullptr) {
+    vertexSet.relocateElements(vertexOrdering, keepIdentifiers);
+
+    vector<Set*> edgeSets = vertexSet.getEdgeSets();
+    vector<bool> independent(edgeSets.size());
+    vector<vector<int>> orderings(edgeSets.size());
+    for (size_t i = 0; i < edgeSets.size(); ++i) {
+      independent[i] = edgeSets[i]->getEdgeSets().empty();
+    }
+    auto reorderEdges = [&](size_t i) {
+      edgeVertexSortReordering(*edgeSets[i], vertexSet, orderings[i]);
+      edgeSets[i]->relocateElements(orderings[i], keepIdentifiers);
+    };
+
+    for (size_t i = 0; i < edgeSets.size(); ++i) {
+      if (independent[i]) {
+        reorderEdges(i);
+      }
+    }
+    for (size_t i = 0; i < edgeSets.size(); ++i) {
+      if (!independent[i]) {
+        reorderEdges(i);
+      }
+    }
+
+    if (edgeOrderings != nullptr) {
+      for (size_t i = 0; i < edgeSets.size(); ++i) {
+        (*edgeOrderings)[edgeSets[i]].swap(orderings[i]);
+      }
+    }
+  }
+
+  // Relocates the vertex set by the heuristic and then its edge sets.
+  static void reorderGraph(Set& vertexSet, ReorderingHeuristic heuristic,
+                           bool keepIdentifiers) {
+    uassert(vertexSet.getKind() == Set::Unstructured) << "Lattice link sets \
+      are ordered by their lattice coordinates and cannot be reordered";
+    vector<int> vertexOrdering;
+    computeVertexOrdering(getAdjacencyEdgeSets(vertexSet), vertexSet,
+                          heuristic, vertexOrdering);
+    relocateGraph(vertexSet, vertexOrdering, keepIdentifiers);
+  }
+  
+  void reorder(Set& edgeSet, Set& vertexSet, vector<int>& edgeOrdering, 
+      vector<int>& vertexOrdering, ReorderingHeuristic heuristic,
+      ReorderingReport* report) {
+    uassert(edgeSet.getKind() == Set::Unstructured) << "Lattice link sets are \
+      ordered by their lattice coordinates and cannot be reordered";
+    uassert(!edgeSet.isPermuted() && !vertexSet.isPermuted()) << "Sets that \
+      were reordered with reorderStorage cannot be reordered again";
     vertexOrdering.clear();
     edgeOrdering.clear();
     
     // Get new vertex ordering based on given heuristic 
-    hilbert::hilbertReorder(vertexSet, vertexOrdering);
-    reorderVertexSet(edgeSet, vertexSet, vertexOrdering);
+    computeVertexOrdering(vector<const Set*>(1, &edgeSet), vertexSet,
+                          heuristic, vertexOrdering);
+    if (report != nullptr) {
+      report->before = getBandwidth(edgeSet);
+      report->after = getBandwidth(edgeSet, vertexOrdering);
+    }
+    vertexSet.relocateElements(vertexOrdering, false);
 
     // Get new edge ordering based on given heuristic 
-    edgeVertexSortReordering(edgeSet, edgeOrdering); reorderEdgeSet(edgeSet, 
-        edgeOrdering);
+    edgeVertexSortReordering(edgeSet, vertexSet, edgeOrdering);
+    edgeSet.relocateElements(edgeOrdering, false);
+  }
+
+  void reorder(Set& vertexSet, ReorderingHeuristic heuristic) {
+    uassert(!vertexSet.isPermuted()) << "Sets that were reordered with \
+      reorderStorage cannot be reordered again";
+    for (const Set* edgeSet : vertexSet.getEdgeSets()) {
+      uassert(!edgeSet->isPermuted()) << "Sets that were reordered with \
+        reorderStorage cannot be reordered again";
+    }
+    reorderGraph(vertexSet, heuristic, false);
+  }
+
+  void reorderStorage(Set& edgeSet, Set& vertexSet,
+      ReorderingHeuristic heuristic) {
+    uassert(edgeSet.getKind() == Set::Unstructured) << "Lattice link sets are \
+      ordered by their lattice coordinates and cannot be reordered";
+
+    // The vertex set may already have been relocated with another edge set
+    if (!vertexSet.isPermuted()) {
+      vector<int> vertexOrdering;
+      computeVertexOrdering(vector<const Set*>(1, &edgeSet), vertexSet,
+                            heuristic, vertexOrdering);
+      vertexSet.relocateElements(vertexOrdering);
+    }
+    if (!edgeSet.isPermuted()) {
+      vector<int> edgeOrdering;
+      edgeVertexSortReordering(edgeSet, vertexSet, edgeOrdering);
+      edgeSet.relocateElements(edgeOrdering);
+    }
+  }
+
+  void reorderStorage(Set& vertexSet, ReorderingHeuristic heuristic) {
+    reorderGraph(vertexSet, heuristic, true);
+  }
+
+  void reorderByPartition(Set& vertexSet, Partitioning& partitioning) {
+    uassert(vertexSet.getKind() == Set::Unstructured) << "Lattice link sets \
+      are ordered by their lattice coordinates and cannot be reordered";
+    const int size = vertexSet.getSize();
+    const int numPartitions = partitioning.numPartitions;
+    uassert(partitioning.vertexPartitions.size() == (size_t)size)
+        << "The partitioning is not a partitioning of the vertex set";
+
+    // Counting sort of the vertices by partition, keeping their order within
+    // each partition
+    vector<int>& vertexStarts = partitioning.vertexStarts;
+    vertexStarts.assign(numPartitions+1, 0);
+    for (int p : partitioning.vertexPartitions) {
+      ++vertexStarts[p+1];
+    }
+    for (int p = 0; p < numPartitions; ++p) {
+      vertexStarts[p+1] += vertexStarts[p];
+    }
+    vector<int> next(vertexStarts.begin(), vertexStarts.end()-1);
+    vector<int> vertexOrdering(size);
+    for (int v = 0; v < size; ++v) {
+      vertexOrdering[v] = next[partitioning.vertexPartitions[v]]++;
+    }
+
+    // Edges are sorted by their lowest endpoint, which is in the partition
+    // they belong to, so the edges of each partition also end up contiguous
+    map<const Set*,vector<int>> edgeOrderings;
+    relocateGraph(vertexSet, vertexOrdering, true, &edgeOrderings);
+
+    sort(partitioning.vertexPartitions.begin(),
+         partitioning.vertexPartitions.end());
+    partitioning.edgeStarts.clear();
+    for (auto& edgeOrdering : edgeOrderings) {
+      const Set* edgeSet = edgeOrdering.first;
+      vector<int>& edgePartitions = partitioning.edgePartitions[edgeSet];
+      iassert(edgePartitions.size() == edgeOrdering.second.size());
+      vector<int> relocated(edgePartitions.size());
+      for (size_t e = 0; e < edgePartitions.size(); ++e) {
+        relocated[edgeOrdering.second[e]] = edgePartitions[e];
+      }
+      edgePartitions.swap(relocated);
+
+      vector<int>& edgeStarts = partitioning.edgeStarts[edgeSet];
+      edgeStarts.assign(numPartitions+1, 0);
+      for (int p : edgePartitions) {
+        ++edgeStarts[p+1];
+      }
+      for (int p = 0; p < numPartitions; ++p) {
+        edgeStarts[p+1] += edgeStarts[p];
+      }
+    }
   }
   
-  void reorder(Set& edgeSet, Set& vertexSet) {
+  void reorder(Set& edgeSet, Set& vertexSet, ReorderingHeuristic heuristic) {
     vector<int> vertexOrdering;
     vector<int> edgeOrdering;
-    reorder(edgeSet, vertexSet, edgeOrdering, vertexOrdering);
+    reorder(edgeSet, vertexSet, edgeOrdering, vertexOrdering, heuristic);
   }
 }
@@ -2,6 +2,7 @@
 #define SIMIT_REORDER_H
 
 #include <graph.h>
+#include "partition.h"
 #include <vector>
 #include <string>
 #include <cassert>
@@ -9,22 +10,121 @@
 #include <fstream>
 
 namespace simit { 
-  /// Reorders edge set and vertex set by hilbert reordering of the vertex set.
-  /// Vertex set must have a set spatial field in 3 dimensions.
-  void reorder(Set& edgeSet, Set& vertexSet);
+  /// Heuristics that compute a vertex ordering.
+  enum class ReorderingHeuristic {
+    /// Order vertices along a Hilbert curve through their spatial field.
+    Hilbert,
+    /// Order vertices along a Morton (Z-order) curve through their spatial
+    /// field.
+    Morton,
+    /// Reverse Cuthill-McKee ordering of the graph of the edge set.
+    RCM,
+    /// Cuthill-McKee (degree-aware breadth first) ordering of the graph of the
+    /// edge set.
+    BFS
+  };
 
-  /// Reorders edge set and vertex set by hilbert reordering of the vertex set.
-  /// Vertex set must have a set spatial field in 3 dimensions.
+  /// The bandwidth and profile of the vertex x vertex matrix of an edge set,
+  /// where the bandwidth is the largest distance of a nonzero from the
+  /// diagonal and the profile is the sum, over all rows, of the distance from
+  /// the first nonzero to the diagonal.
+  struct MatrixBandwidth {
+    int bandwidth;
+    long long profile;
+    MatrixBandwidth() : bandwidth(0), profile(0) {}
+  };
+  std::ostream& operator<<(std::ostream& os, const MatrixBandwidth& bw);
+
+  /// The bandwidth and profile of the matrix of an edge set before and after
+  /// it was reordered.
+  struct ReorderingReport {
+    MatrixBandwidth before;
+    MatrixBandwidth after;
+  };
+  std::ostream& operator<<(std::ostream& os, const ReorderingReport& report);
+
+  /// Reorders edge set and vertex set by reordering the vertex set with the
+  /// given heuristic. The Hilbert and Morton heuristics require the vertex set
+  /// to have a set spatial field in 2 or 3 dimensions, while the RCM and BFS heuristics
+  /// only use the vertex adjacency of the edge set, which must connect
+  /// vertices of the vertex set.
+  void reorder(Set& edgeSet, Set& vertexSet,
+      ReorderingHeuristic heuristic=ReorderingHeuristic::Hilbert);
+
+  /// Reorders edge set and vertex set by reordering the vertex set with the
+  /// given heuristic.
   /// The supplied edge and vertex ordering vectors are populated with the new 
-  /// mapping from old to new indices. 
+  /// mapping from old to new indices. If report is not null, it is populated
+  /// with the matrix bandwidth of the edge set before and after reordering.
   void reorder(Set& edgeSet, Set& vertexSet, std::vector<int>& edgeOrdering, 
-      std::vector<int>& vertexOrdering);
+      std::vector<int>& vertexOrdering,
+      ReorderingHeuristic heuristic=ReorderingHeuristic::Hilbert,
+      ReorderingReport* report=nullptr);
+
+  /// Reorders the vertex set with the given heuristic, and every edge set with
+  /// endpoints in it by the new locations of their endpoints, so that all the
+  /// edge sets of a mesh (e.g. tets, faces and springs over the same points)
+  /// are reordered consistently. Heterogeneous edge sets are sorted by their
+  /// endpoints in the vertex set. The RCM and BFS heuristics use the combined
+  /// adjacency of the homogeneous edge sets. Elements are renumbered in their
+  /// new order, and the fields of all the sets are moved with them.
+  void reorder(Set& vertexSet,
+      ReorderingHeuristic heuristic=ReorderingHeuristic::Hilbert);
+
+  /// Reorders the storage of the edge set and vertex set for locality, like
+  /// reorder, but without changing the identifiers of their elements: element
+  /// references and field references keep referring to the same elements
+  /// (see Set::relocateElements). A vertex set that was already reordered
+  /// with another edge set keeps its order.
+  void reorderStorage(Set& edgeSet, Set& vertexSet,
+      ReorderingHeuristic heuristic=ReorderingHeuristic::Hilbert);
+
+  /// Reorders the storage of the vertex set and of every edge set with
+  /// endpoints in it, like reorder(Set&), but without changing the identifiers
+  /// of their elements. Sets that were already relocated are relocated again.
+  void reorderStorage(Set& vertexSet,
+      ReorderingHeuristic heuristic=ReorderingHeuristic::Hilbert);
+
+  /// Reorders the storage of the vertex set and of every edge set with
+  /// endpoints in it, like reorderStorage, so that the elements of each
+  /// partition of the partitioning (see partitionGraph) are stored
+  /// contiguously. Vertices keep their order within each partition, so the
+  /// sets can be reordered for locality first. The partitioning is updated to
+  /// the new locations, and its vertexStarts and edgeStarts give the range of
+  /// locations of each partition, e.g. for threads that each own one.
+  void reorderByPartition(Set& vertexSet, Partitioning& partitioning);
+
+  /// Computes a locality-friendly order in which to visit the edges of the
+  /// edge set without moving them (the inspector of inspector-executor
+  /// iteration). iterationOrder[i] is the location of the i'th edge to visit.
+  /// Edges are sorted by the Hilbert key of their first endpoint if its set
+  /// has a spatial field, and by the locations of their endpoints otherwise.
+  void computeIterationOrder(const Set& edgeSet,
+      std::vector<int>& iterationOrder);
+
+  /// Partitions the edges of an edge set whose endpoints are in one vertex set
+  /// into sparse tiles (the inspector of sparse tiling). Vertex tile t holds
+  /// the vertices at locations [t*tileSize, (t+1)*tileSize), and every edge is
+  /// assigned to the tile of its smallest endpoint location. The locations of
+  /// the edges of tile t are tileEdges[tileStarts[t]:tileStarts[t+1]], in
+  /// increasing order.
+  void computeSparseTiles(const Set& edgeSet, int tileSize,
+      std::vector<int>& tileStarts, std::vector<int>& tileEdges);
+
+  /// Returns the bandwidth of the vertex x vertex matrix of the edge set.
+  MatrixBandwidth getBandwidth(const Set& edgeSet);
+
+  /// Returns the bandwidth of the vertex x vertex matrix of the edge set, if
+  /// its vertices were reordered by the supplied vertex ordering map.
+  MatrixBandwidth getBandwidth(const Set& edgeSet,
+      const std::vector<int>& vertexOrdering);
   
   /// Reorders edge set and vertex set by the supplied vertex ordering map.
   void reorderVertexSet(Set& edgeSet, Set& vertexSet, std::vector<int>& 
       vertexOrdering);
   
-  /// Reorders edge set by the supplied edge ordering map.
+  /// Reorders edge set by the supplied edge ordering map from old to new
+  /// indices.
   void reorderEdgeSet(Set& edgeSet, const std::vector<int>& edgeOrdering);
 
   /// Reorders edge set by the supplied vertex ordering map.
@@ -50,31 +150,53 @@ namespace simit {
   }
 
   namespace hilbert {
-    
-    typedef uint64_t vid_t;  // vertex id type
-
-    struct edges_t {
-      vid_t cntEdges;
-      vid_t * edges;
-    };
-    typedef struct edges_t edges_t;
-
-    struct vertex_t {
-      vid_t id;
-      vid_t hilbertId;
-      double x;
-      double y;
-      double z;
-      void * data;
-      edges_t edgeData;
-    };
-    typedef struct vertex_t vertex_t;
-
-    typedef std::pair<vid_t, vid_t> edge_t;
-
-    void hilbertReorder(Set& vertexSet, std::vector<int>& vertexOrdering, int 
-        vertexCount);
+    /// The largest number of bits per axis of space filling curve keys, such
+    /// that the keys of 3D points fit in 64 bits.
+    const unsigned MAX_CURVE_BITS = 21;
+
+    /// Space filling curves that vertices can be ordered along.
+    enum class Curve {Hilbert, Morton};
+
+    /// Computes the ordering of the vertices along a space filling curve
+    /// through the spatial field of the vertex set, which may be a 2D or 3D
+    /// field of floats or doubles. The bounding cube of the vertices is divided
+    /// into a grid with 2^bits cells per axis, and vertices in the same cell
+    /// keep their relative order. Keys are computed and sorted by numThreads
+    /// threads, or by one thread per hardware thread if numThreads is 0. The
+    /// ordering is only computed, and the vertex set is left unchanged.
+    void spaceFillingCurveReorder(const Set& vertexSet,
+        std::vector<int>& vertexOrdering, Curve curve=Curve::Hilbert,
+        unsigned bits=MAX_CURVE_BITS, unsigned numThreads=0);
+
+    /// Computes the ordering of the vertices along a Hilbert curve through
+    /// the spatial field of the vertex set.
+    void hilbertReorder(const Set& vertexSet,
+                        std::vector<int>& vertexOrdering);
   } // namespace simit::hilbert
 
+  namespace graph {
+    /// Computes the reverse Cuthill-McKee ordering of the vertices connected
+    /// by the edge set, using the edge set's neighbor index. Every connected
+    /// component is ordered starting from a pseudo-peripheral vertex.
+    void rcmReorder(const Set& edgeSet, std::vector<int>& vertexOrdering);
+
+    /// Computes the reverse Cuthill-McKee ordering of the vertices connected
+    /// by the union of the edge sets, which must all connect the same vertex
+    /// set.
+    void rcmReorder(const std::vector<const Set*>& edgeSets,
+                    std::vector<int>& vertexOrdering);
+
+    /// Computes the Cuthill-McKee ordering of the vertices connected by the
+    /// edge set: a breadth first ordering that starts every connected
+    /// component from a pseudo-peripheral vertex and visits the unvisited
+    /// neighbors of a vertex in order of increasing degree.
+    void bfsReorder(const Set& edgeSet, std::vector<int>& vertexOrdering);
+
+    /// Computes the Cuthill-McKee ordering of the vertices connected by the
+    /// union of the edge sets, which must all connect the same vertex set.
+    void bfsReorder(const std::vector<const Set*>& edgeSets,
+                    std::vector<int>& vertexOrdering);
+  } // namespace simit::graph
+
 } // namespace simit 
 #endif
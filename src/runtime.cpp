@@ -1,17 +1,25 @@
 #include "runtime.h"
 
+#include <atomic>
 #include <cmath>
-#include <time.h>
-#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <vector>
 
-#include "timers.h"
+#include "allocator.h"
+#include "block_cg.h"
+#include "init.h"
+#include "multigrid.h"
+#include "profiler.h"
+#include "solvers.h"
 #include "stdio.h"
 
 #ifdef EIGEN
 #include <Eigen/Core>
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
+#include <unsupported/Eigen/IterativeSolvers>
 #endif
 
 extern "C" {
@@ -26,9 +34,7 @@ double atan2_f64(double y, double x) {
 }
 
 float atan2_f32(float y, float x) {
-  double d_y = y;
-  double d_x = x;
-  return (float)atan2(d_y, d_x);
+  return atan2f(y, x);
 }
 
 double tan_f64(double x) {
@@ -36,8 +42,7 @@ double tan_f64(double x) {
 }
 
 float tan_f32(float x) {
-  double d_x = x;
-  return (float)tan(d_x);
+  return tanf(x);
 }
 
 double asin_f64(double x) {
@@ -45,8 +50,7 @@ double asin_f64(double x) {
 }
 
 float asin_f32(float x) {
-  double d_x = x;
-  return (float)asin(d_x);
+  return asinf(x);
 }
 
 double acos_f64(double x) {
@@ -54,99 +58,77 @@ double acos_f64(double x) {
 }
 
 float acos_f32(float x) {
-  double d_x = x;
-  return (float)acos(d_x);
+  return acosf(x);
 }
 
-double det3_f64(double * a){
-  return a[0] * (a[4]*a[8]-a[5]*a[7])
-       - a[1] * (a[3]*a[8]-a[5]*a[6])
-       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+double complexNorm_f64(double r, double i) {
+  return sqrt(r*r+i*i);
 }
 
-float det3_f32(float * a){
-  return a[0] * (a[4]*a[8]-a[5]*a[7])
-       - a[1] * (a[3]*a[8]-a[5]*a[6])
-       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+float complexNorm_f32(float r, float i) {
+  return sqrt(r*r+i*i);
 }
 
-void inv3_f64(double * a, double * inv){
-  double cof00 = a[4]*a[8]-a[5]*a[7];
-  double cof01 =-a[3]*a[8]+a[5]*a[6];
-  double cof02 = a[3]*a[7]-a[4]*a[6];
-
-  double cof10 =-a[1]*a[8]+a[2]*a[7];
-  double cof11 = a[0]*a[8]-a[2]*a[6];
-  double cof12 =-a[0]*a[7]+a[1]*a[6];
-
-  double cof20 = a[1]*a[5]-a[2]*a[4];
-  double cof21 =-a[0]*a[5]+a[2]*a[3];
-  double cof22 = a[0]*a[4]-a[1]*a[3];
-
-  double determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
-
-  determ = 1.0/determ;
-  inv[0] = cof00 * determ;
-  inv[1] = cof10 * determ;
-  inv[2] = cof20 * determ;
-
-  inv[3] = cof01 * determ;
-  inv[4] = cof11 * determ;
-  inv[5] = cof21 * determ;
-
-  inv[6] = cof02 * determ;
-  inv[7] = cof12 * determ;
-  inv[8] = cof22 * determ;
+void simitProfilerRecord(void* profiler, int region,
+                         uint64_t start, uint64_t end) {
+  static_cast<simit::Profiler*>(profiler)->record(region, start, end);
 }
 
-void inv3_f32(float * a, float * inv){
-  float cof00 = a[4]*a[8]-a[5]*a[7];
-  float cof01 =-a[3]*a[8]+a[5]*a[6];
-  float cof02 = a[3]*a[7]-a[4]*a[6];
-
-  float cof10 =-a[1]*a[8]+a[2]*a[7];
-  float cof11 = a[0]*a[8]-a[2]*a[6];
-  float cof12 =-a[0]*a[7]+a[1]*a[6];
-
-  float cof20 = a[1]*a[5]-a[2]*a[4];
-  float cof21 =-a[0]*a[5]+a[2]*a[3];
-  float cof22 = a[0]*a[4]-a[1]*a[3];
-
-  float determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
-
-  determ = 1.0/determ;
-  inv[0] = cof00 * determ;
-  inv[1] = cof10 * determ;
-  inv[2] = cof20 * determ;
-
-  inv[3] = cof01 * determ;
-  inv[4] = cof11 * determ;
-  inv[5] = cof21 * determ;
-
-  inv[6] = cof02 * determ;
-  inv[7] = cof12 * determ;
-  inv[8] = cof22 * determ;
+uint64_t simitReadCycleCounter() {
+  return simit::Profiler::readCycleCounter();
 }
 
-double complexNorm_f64(double r, double i) {
-  return sqrt(r*r+i*i);
+void* simitAllocate(size_t size) {
+  return simit::allocate(size);
 }
+} // extern "C"
 
-float complexNorm_f32(float r, float i) {
-  return sqrt(r*r+i*i);
+// Sparse matrix operations
+/// Computes y = A*x, where A is a symmetric blocked CSR matrix of which only
+/// the upper triangle is stored. Each stored off-diagonal block A(i,j) also
+/// contributes its transpose to row j.
+template <typename Float>
+void symmatvec(int n,  int m,  int* rowptr, int* colidx,
+               int nn, int mm, Float* Avals, Float* xvals, Float* yvals) {
+  int numRows = n/nn;
+  int blockSize = nn*mm;
+  for (int i=0; i < n; ++i) {
+    yvals[i] = 0;
+  }
+  for (int i=0; i < numRows; ++i) {
+    Float* xi = &xvals[i*nn];
+    Float* yi = &yvals[i*nn];
+    for (int ij=rowptr[i]; ij < rowptr[i+1]; ++ij) {
+      int j = colidx[ij];
+      Float* block = &Avals[ij*blockSize];
+      Float* xj = &xvals[j*mm];
+      for (int bi=0; bi < nn; ++bi) {
+        for (int bj=0; bj < mm; ++bj) {
+          yi[bi] += block[bi*mm+bj] * xj[bj];
+        }
+      }
+      if (j != i) {
+        Float* yj = &yvals[j*mm];
+        for (int bi=0; bi < nn; ++bi) {
+          for (int bj=0; bj < mm; ++bj) {
+            yj[bj] += block[bi*mm+bj] * xi[bi];
+          }
+        }
+      }
+    }
+  }
 }
 
-void simitStoreTime(int i, double value) {
-  simit::ir::TimerStorage::getInstance().storeTime(i, value);
+extern "C" {
+void symmatvec_f64(int n,  int m,  int* rowptr, int* colidx,
+                   int nn, int mm, double* A, double* x, double* y) {
+  return symmatvec(n, m, rowptr, colidx, nn, mm, A, x, y);
+}
+void symmatvec_f32(int n,  int m,  int* rowptr, int* colidx,
+                   int nn, int mm, float* A, float* x, float* y) {
+  return symmatvec(n, m, rowptr, colidx, nn, mm, A, x, y);
 }
-
-double simitClock() {
-  using namespace std::chrono;
-  auto t = high_resolution_clock::now();
-  time_point<high_resolution_clock,microseconds> usec = time_point_cast<microseconds>(t);
-  return (double)(usec.time_since_epoch().count());
 }
-} // extern "C"
 
 // Solvers
 #ifdef EIGEN
@@ -158,18 +140,224 @@ do {                                                            \
   ierror << "Solvers require that Simit was built with Eigen."; \
 } while (false)
 
-template <typename Float>
-void solve(int n,  int m,  int* rowptr, int* colidx,
-           int nn, int mm, Float* Avals, Float* xvals, Float* bvals) {
+namespace simit {
+static std::deque<SolverStatistics> solverStatistics;
+static SolverTotals solverTotals = {0, 0, 0};
+
+const std::deque<SolverStatistics>& getSolverStatistics() {
+  return solverStatistics;
+}
+
+const SolverTotals& getSolverTotals() {
+  return solverTotals;
+}
+
+void clearSolverStatistics() {
+  solverStatistics.clear();
+  solverTotals = {0, 0, 0};
+}
+
+static void recordSolverStatistics(const SolverStatistics& statistics) {
+  if (solverStatistics.size() == kMaxSolverStatistics) {
+    solverStatistics.pop_front();
+  }
+  solverStatistics.push_back(statistics);
+  solverTotals.solves += 1;
+  solverTotals.iterations += statistics.iterations;
+  solverTotals.unconverged += statistics.converged ? 0 : 1;
+}
+}
+
 #ifdef EIGEN
-  auto A = csr2eigen<Float, Eigen::ColMajor>(n, m, rowptr, colidx, nn, mm, Avals);
-  auto b = new Map<Matrix<Float,Dynamic,1>>(bvals, n);
-  auto x = new Map<Matrix<Float,Dynamic,1>>(xvals, m);
+/// Preconditions with the inverses of the blockSize x blockSize blocks on the
+/// diagonal of a matrix. Blocks that are singular are left out (treated as
+/// identity), like zeros on the diagonal by Eigen's DiagonalPreconditioner.
+template <typename Float>
+class BlockJacobiPreconditioner {
+  typedef Matrix<Float,Dynamic,1> Vector;
+  typedef Matrix<Float,Dynamic,Dynamic> Block;
+public:
+  BlockJacobiPreconditioner() : blockSize(1) {}
+
+  void setBlockSize(int blockSize) {
+    this->blockSize = blockSize;
+  }
+
+  template <typename MatrixType>
+  BlockJacobiPreconditioner& analyzePattern(const MatrixType&) {
+    return *this;
+  }
+
+  template <typename MatrixType>
+  BlockJacobiPreconditioner& factorize(const MatrixType& A) {
+    const int numBlocks = (A.cols() + blockSize-1) / blockSize;
+    invBlocks.assign(numBlocks, Block::Zero(blockSize, blockSize));
+    for (int j=0; j < A.outerSize(); ++j) {
+      for (typename MatrixType::InnerIterator it(A, j); it; ++it) {
+        if (it.row()/blockSize == j/blockSize) {
+          invBlocks[j/blockSize](it.row()%blockSize, j%blockSize) = it.value();
+        }
+      }
+    }
+    // The last block is padded with identity if the size is not a multiple of
+    // the block size
+    for (int i=A.cols(); i < numBlocks*blockSize; ++i) {
+      invBlocks.back()(i%blockSize, i%blockSize) = 1;
+    }
+    for (Block& block : invBlocks) {
+      FullPivLU<Block> lu(block);
+      if (lu.isInvertible()) {
+        block = lu.inverse();
+      }
+      else {
+        block.setIdentity();
+      }
+    }
+    return *this;
+  }
+
+  template <typename MatrixType>
+  BlockJacobiPreconditioner& compute(const MatrixType& A) {
+    return factorize(A);
+  }
+
+  template <typename Rhs>
+  Vector solve(const MatrixBase<Rhs>& b) const {
+    const int n = b.rows();
+    Vector x(n);
+    for (size_t i=0; i < invBlocks.size(); ++i) {
+      const int begin = i*blockSize;
+      const int size = std::min(blockSize, n - begin);
+      x.segment(begin, size) = invBlocks[i].topLeftCorner(size, size) *
+                               b.segment(begin, size);
+    }
+    return x;
+  }
+
+  ComputationInfo info() {
+    return Success;
+  }
+
+private:
+  int blockSize;
+  std::vector<Block> invBlocks;
+};
+
+template <typename Preconditioner>
+void setBlockSize(Preconditioner&, int) {}
 
-  ConjugateGradient<SparseMatrix<Float>,Lower,IdentityPreconditioner> solver;
-  solver.setMaxIterations(50);
+template <typename Float>
+void setBlockSize(BlockJacobiPreconditioner<Float>& preconditioner,
+                  int blockSize) {
+  preconditioner.setBlockSize(blockSize);
+}
+
+/// Solves A*x = b with an iterative Eigen solver configured by the solver
+/// settings, and records its statistics.
+template <typename Solver, typename Float>
+void iterate(const SparseMatrix<Float>& A, int blockSize,
+             const Map<Matrix<Float,Dynamic,1>>& b,
+             Map<Matrix<Float,Dynamic,1>>& x) {
+  const simit::SolverSettings& settings = simit::kSolverSettings;
+  Solver solver;
+  solver.setMaxIterations(settings.maxIterations);
+  if (settings.tolerance > 0.0) {
+    solver.setTolerance(settings.tolerance);
+  }
+  setBlockSize(solver.preconditioner(), blockSize);
   solver.compute(A);
-  *b = solver.solve(*x);
+  if (settings.warmStart) {
+    x = solver.solveWithGuess(b, Matrix<Float,Dynamic,1>(x));
+  }
+  else {
+    x = solver.solve(b);
+  }
+  simit::recordSolverStatistics({(int)solver.iterations(),
+                                 (double)solver.error(),
+                                 solver.info() == Success});
+}
+
+template <typename Float, typename Preconditioner>
+void iterate(const SparseMatrix<Float>& A, int blockSize,
+             const Map<Matrix<Float,Dynamic,1>>& b,
+             Map<Matrix<Float,Dynamic,1>>& x) {
+  typedef SparseMatrix<Float> MatrixType;
+  switch (simit::kSolverSettings.method) {
+    case simit::KrylovMethod::CG:
+      iterate<ConjugateGradient<MatrixType,Lower,Preconditioner>>(A, blockSize,
+                                                                  b, x);
+      break;
+    case simit::KrylovMethod::BiCGSTAB:
+      iterate<BiCGSTAB<MatrixType,Preconditioner>>(A, blockSize, b, x);
+      break;
+    case simit::KrylovMethod::MINRES:
+      iterate<MINRES<MatrixType,Lower,Preconditioner>>(A, blockSize, b, x);
+      break;
+    case simit::KrylovMethod::Richardson:
+      unreachable;
+      break;
+  }
+}
+#endif
+
+template <typename Float>
+void solve(int n,  int m,  int* rowptr, int* colidx,
+           int nn, int mm, Float* Avals, Float* xvals, Float* bvals,
+           bool upperTriangular=false) {
+  // The right-hand side is x and the result is stored to b
+  const simit::SolverSettings& settings = simit::kSolverSettings;
+  uassert(settings.method != simit::KrylovMethod::Richardson &&
+          settings.preconditioner != simit::Preconditioner::Multigrid)
+      << "Richardson iteration and multigrid require a matrix assembled with "
+      << "a stencil on a lattice";
+  uassert(!upperTriangular ||
+          (settings.method == simit::KrylovMethod::CG && nn == mm &&
+           (settings.preconditioner == simit::Preconditioner::Identity ||
+            settings.preconditioner == simit::Preconditioner::Jacobi ||
+            settings.preconditioner == simit::Preconditioner::BlockJacobi)))
+      << "matrices with upper triangular indices (see "
+      << "Settings::symmetricMatrices) are solved with CG and the identity, "
+      << "Jacobi or block Jacobi preconditioner";
+  if (settings.method == simit::KrylovMethod::CG && nn == mm && n == m &&
+      settings.preconditioner != simit::Preconditioner::IncompleteCholesky) {
+    simit::recordSolverStatistics(
+        simit::blockCG(n/nn, nn, rowptr, colidx, Avals, xvals, bvals,
+                       upperTriangular, settings));
+    return;
+  }
+  uassert(settings.preconditioner != simit::Preconditioner::AlgebraicMultigrid)
+      << "Algebraic multigrid requires CG on a matrix with square blocks";
+
+#ifdef EIGEN
+  std::unique_lock<std::mutex> lock;
+  const SparseMatrix<Float>& A =
+      csr2eigenCached(n, m, rowptr, colidx, nn, mm, Avals, lock);
+  Map<Matrix<Float,Dynamic,1>> b(bvals, n);
+  Map<Matrix<Float,Dynamic,1>> x(xvals, m);
+
+  const int blockSize = (nn == mm) ? nn : 1;
+  switch (settings.preconditioner) {
+    case simit::Preconditioner::Identity:
+      iterate<Float,IdentityPreconditioner>(A, blockSize, x, b);
+      break;
+    case simit::Preconditioner::Jacobi:
+      iterate<Float,DiagonalPreconditioner<Float>>(A, blockSize, x, b);
+      break;
+    case simit::Preconditioner::BlockJacobi:
+      iterate<Float,BlockJacobiPreconditioner<Float>>(A, blockSize, x, b);
+      break;
+    case simit::Preconditioner::IncompleteCholesky:
+#if EIGEN_VERSION_AT_LEAST(3,3,0)
+      iterate<Float,IncompleteCholesky<Float>>(A, blockSize, x, b);
+#else
+      not_supported_yet << "Incomplete Cholesky requires Eigen 3.3";
+#endif
+      break;
+    case simit::Preconditioner::Multigrid:
+    case simit::Preconditioner::AlgebraicMultigrid:
+      unreachable;
+      break;
+  }
 #else
   SOLVER_ERROR;
 #endif
@@ -184,18 +372,125 @@ void cMatSolve_f32(int n,  int m,  int* rowptr, int* colidx,
                    int nn, int mm, float* A, float* x, float* b) {
   return solve(n, m, rowptr, colidx, nn, mm, A, x, b);
 }
+void cUpperMatSolve_f64(int n,  int m,  int* rowptr, int* colidx,
+                        int nn, int mm, double* A, double* x, double* b) {
+  return solve(n, m, rowptr, colidx, nn, mm, A, x, b, true);
+}
+void cUpperMatSolve_f32(int n,  int m,  int* rowptr, int* colidx,
+                        int nn, int mm, float* A, float* x, float* b) {
+  return solve(n, m, rowptr, colidx, nn, mm, A, x, b, true);
+}
+}
+
+/// Solves a system whose matrix is stored with a stencil on a lattice of up to
+/// three dimensions (the unused dimensions are 1). The offsets of the stencil
+/// entries are stored at offsets[entry*numDims + d].
+template <typename Float>
+void stencilSolve(int n, int m, int numDims, int dim0, int dim1, int dim2,
+                  int stencilSize, int* offsets, int nn, int mm,
+                  Float* Avals, Float* xvals, Float* bvals) {
+  // The right-hand side is x and the result is stored to b
+  uassert(n == m && nn == mm) << "Stencil solves require square matrices";
+  simit::StencilStructure structure;
+  const int dims[] = {dim0, dim1, dim2};
+  structure.dims.assign(dims, dims + numDims);
+  for (int e = 0; e < stencilSize; ++e) {
+    structure.offsets.push_back(std::vector<int>(offsets + e*numDims,
+                                                 offsets + (e+1)*numDims));
+  }
+  structure.blockSize = nn;
+  iassert(structure.getNumPoints()*nn == n);
+  simit::recordSolverStatistics(
+      simit::solveStencil(structure, Avals, xvals, bvals,
+                          simit::kSolverSettings));
+}
+
+extern "C" {
+void cStencilSolve_f64(int n, int m, int numDims, int dim0, int dim1, int dim2,
+                       int stencilSize, int* offsets, int nn, int mm,
+                       double* A, double* x, double* b) {
+  return stencilSolve(n, m, numDims, dim0, dim1, dim2, stencilSize, offsets,
+                      nn, mm, A, x, b);
+}
+void cStencilSolve_f32(int n, int m, int numDims, int dim0, int dim1, int dim2,
+                       int stencilSize, int* offsets, int nn, int mm,
+                       float* A, float* x, float* b) {
+  return stencilSolve(n, m, numDims, dim0, dim1, dim2, stencilSize, offsets,
+                      nn, mm, A, x, b);
+}
 }
 
+#ifdef EIGEN
+/// The Cholesky factorization of the matrices of a blocked CSR index, whose
+/// symbolic analysis (fill-reducing ordering and elimination tree) is kept for
+/// as long as the index structure does not change, so that chol only repeats
+/// the numeric factorization on every time step.
+template <typename Float>
+struct CholeskyCache {
+  std::vector<int> rowPtr;
+  std::vector<int> colIdx;
+  SimplicialCholesky<SparseMatrix<Float>> solver;
+
+  /// Whether the solver was returned by chol and not yet freed by cholfree.
+  /// Atomic, since cholfree does not hold the lock of the index.
+  std::atomic<bool> inUse{false};
+
+  bool matches(int numRows, int* rowPtr, int* colIdx) const {
+    return this->rowPtr.size() == (size_t)numRows+1 &&
+           std::equal(rowPtr, rowPtr+numRows+1, this->rowPtr.begin()) &&
+           std::equal(colIdx, colIdx+rowPtr[numRows], this->colIdx.begin());
+  }
+};
+
+template <typename Float>
+std::map<std::pair<int*,int*>, CholeskyCache<Float>>& getCholeskyCaches() {
+  static std::map<std::pair<int*,int*>, CholeskyCache<Float>> caches;
+  return caches;
+}
+#endif
+
 template <typename Float>
 void chol(int An,  int Am,  int* Arowptr, int* Acolidx,
           int Ann, int Amm, Float* Avals,
-          void** solverPtr) {
+          void** solverPtr, bool upperTriangular=false) {
 #ifdef EIGEN
-  auto A = csr2eigen<Float,Eigen::ColMajor>(An, Am, Arowptr, Acolidx,
-                                            Ann, Amm, Avals);
-  auto solver = new SimplicialCholesky<SparseMatrix<Float>>();
-  solver->compute(A);
-  *solverPtr = static_cast<void*>(solver);
+  // The Cholesky cache of the index is guarded by the lock of its Eigen matrix
+  std::unique_lock<std::mutex> lock;
+  const SparseMatrix<Float>& stored =
+      csr2eigenCached(An, Am, Arowptr, Acolidx, Ann, Amm, Avals, lock);
+
+  // The factorization reads the lower triangle, which is the transpose of the
+  // upper triangle of matrices with upper triangular indices
+  SparseMatrix<Float> transposed;
+  if (upperTriangular) {
+    transposed = stored.transpose();
+  }
+  const SparseMatrix<Float>& A = upperTriangular ? transposed : stored;
+  CholeskyCache<Float>* cached;
+  {
+    std::lock_guard<std::mutex> cachesLock(getSolverCachesMutex());
+    cached = &getCholeskyCaches<Float>()[{Arowptr, Acolidx}];
+  }
+  CholeskyCache<Float>& cache = *cached;
+
+  // Two factorizations of matrices with the same index may be live at once,
+  // in which case the second is not cached
+  if (cache.inUse) {
+    auto solver = new SimplicialCholesky<SparseMatrix<Float>>();
+    solver->compute(A);
+    *solverPtr = static_cast<void*>(solver);
+    return;
+  }
+
+  const int numRows = An/Ann;
+  if (!cache.matches(numRows, Arowptr, Acolidx)) {
+    cache.rowPtr.assign(Arowptr, Arowptr+numRows+1);
+    cache.colIdx.assign(Acolidx, Acolidx+Arowptr[numRows]);
+    cache.solver.analyzePattern(A);
+  }
+  cache.solver.factorize(A);
+  cache.inUse = true;
+  *solverPtr = static_cast<void*>(&cache.solver);
 #else
   SOLVER_ERROR;
 #endif
@@ -212,6 +507,16 @@ void dchol(int An,  int Am,  int* Arowptr, int* Acolidx,
            void** solver) {
   return chol(An, Am, Arowptr, Acolidx, Ann, Amm, Avals, solver);
 }
+void scholUpper(int An,  int Am,  int* Arowptr, int* Acolidx,
+                int Ann, int Amm, float* Avals,
+                void** solver) {
+  return chol(An, Am, Arowptr, Acolidx, Ann, Amm, Avals, solver, true);
+}
+void dcholUpper(int An,  int Am,  int* Arowptr, int* Acolidx,
+                int Ann, int Amm, double* Avals,
+                void** solver) {
+  return chol(An, Am, Arowptr, Acolidx, Ann, Amm, Avals, solver, true);
+}
 }
 
 template <typename Float>
@@ -242,6 +547,13 @@ template <typename Float>
 void cholfree(void** solverPtr) {
 #ifdef EIGEN
   auto solver=static_cast<SimplicialCholesky<SparseMatrix<Float>>*>(*solverPtr);
+  std::lock_guard<std::mutex> cachesLock(getSolverCachesMutex());
+  for (auto& cache : getCholeskyCaches<Float>()) {
+    if (&cache.second.solver == solver) {
+      cache.second.inUse = false;
+      return;
+    }
+  }
   delete solver;
 #else
   SOLVER_ERROR;
@@ -256,3 +568,33 @@ void dcholfree(void** solverPtr){
   return cholfree<double>(solverPtr);
 }
 }
+
+#ifdef EIGEN
+template <typename Float>
+static void freeCholeskyCache(const std::pair<int*,int*>& index) {
+  auto& caches = getCholeskyCaches<Float>();
+  auto cache = caches.find(index);
+  if (cache != caches.end()) {
+    // Factorizations are only in use while the function that computed them
+    // runs, and indices are freed between runs
+    iassert(!cache->second.inUse) << "freeing an index while it is factorized";
+    caches.erase(cache);
+  }
+}
+#endif
+
+namespace simit {
+void freeSolverCaches(const int* rowPtr, const int* colIdx) {
+#ifdef EIGEN
+  const std::pair<int*,int*> index(const_cast<int*>(rowPtr),
+                                   const_cast<int*>(colIdx));
+  // Indices are freed between runs, when no solve holds their lock
+  std::lock_guard<std::mutex> cachesLock(getSolverCachesMutex());
+  getEigenMatrixCaches<float>().erase(index);
+  getEigenMatrixCaches<double>().erase(index);
+  freeCholeskyCache<float>(index);
+  freeCholeskyCache<double>(index);
+#endif
+  freeBlockCGCaches(rowPtr, colIdx);
+}
+}
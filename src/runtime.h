@@ -1,6 +1,12 @@
 #ifndef SIMIT_RUNTIME_H
 #define SIMIT_RUNTIME_H
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #ifdef EIGEN
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -31,6 +37,123 @@ csr2eigen(int n, int m, int* rowPtr, int* colIdx, int nn, int mm, Float* vals) {
   return mat;
 }
 
+/// Guards the maps of the Eigen matrix and Cholesky caches of the blocked CSR
+/// indices, while entries are looked up, added and removed.
+inline std::mutex& getSolverCachesMutex() {
+  static std::mutex cachesMutex;
+  return cachesMutex;
+}
+
+/// A blocked CSR matrix converted to a column-major Eigen matrix, whose
+/// structure is converted once and kept for as long as the blocked CSR
+/// structure does not change, so that solvers that are called repeatedly on
+/// the same tensor index only copy values.
+template<typename Float>
+class EigenMatrixCache {
+public:
+  /// Returns the Eigen matrix with the values in vals, converting the
+  /// structure first if rowPtr and colIdx differ from the previous call.
+  const Eigen::SparseMatrix<Float>& get(int n, int m, int* rowPtr,
+                                        int* colIdx, int nn, int mm,
+                                        Float* vals) {
+    const int numRows = n/nn;
+    const int nnz = rowPtr[numRows];
+    if (mat.rows() != n || mat.cols() != m || blockSize != nn*mm ||
+        this->rowPtr.size() != (size_t)numRows+1 ||
+        this->colIdx.size() != (size_t)nnz ||
+        !std::equal(rowPtr, rowPtr+numRows+1, this->rowPtr.begin()) ||
+        !std::equal(colIdx, colIdx+nnz, this->colIdx.begin())) {
+      convert(n, m, rowPtr, colIdx, nn, mm);
+    }
+
+    Float* values = mat.valuePtr();
+    const int numValues = valueLocations.size();
+    for (int k=0; k < numValues; ++k) {
+      values[k] = vals[valueLocations[k]];
+    }
+    return mat;
+  }
+
+  /// Held while the matrix is converted and used, so that solves with the
+  /// same index run one after another.
+  std::mutex mutex;
+
+private:
+  std::vector<int> rowPtr;
+  std::vector<int> colIdx;
+  int blockSize = 0;
+
+  /// The location in the blocked CSR values of every Eigen nonzero.
+  std::vector<int> valueLocations;
+  Eigen::SparseMatrix<Float> mat;
+
+  void convert(int n, int m, int* rowPtr, int* colIdx, int nn, int mm) {
+    const int numRows = n/nn;
+    const int nnz = rowPtr[numRows];
+    this->rowPtr.assign(rowPtr, rowPtr+numRows+1);
+    this->colIdx.assign(colIdx, colIdx+nnz);
+    blockSize = nn*mm;
+
+    // Count the nonzeros of every column, and then visit the rows in order so
+    // that the row indices of every column are sorted
+    mat.resize(n, m);
+    mat.resizeNonZeros(nnz*nn*mm);
+    int* colStart = mat.outerIndexPtr();
+    std::fill(colStart, colStart+m+1, 0);
+    for (int ij=0; ij < nnz; ++ij) {
+      for (int bj=0; bj<mm; bj++) {
+        colStart[colIdx[ij]*mm+bj+1] += nn;
+      }
+    }
+    for (int j=0; j < m; ++j) {
+      colStart[j+1] += colStart[j];
+    }
+
+    std::vector<int> next(colStart, colStart+m);
+    int* rowIdx = mat.innerIndexPtr();
+    valueLocations.resize(nnz*nn*mm);
+    for (int i=0; i<numRows; ++i) {
+      for (int bi=0; bi<nn; bi++) {
+        for (int ij=rowPtr[i]; ij<rowPtr[i+1]; ++ij) {
+          int j = colIdx[ij];
+          for (int bj=0; bj<mm; bj++) {
+            int k = next[j*mm+bj]++;
+            rowIdx[k] = i*nn+bi;
+            valueLocations[k] = ij*nn*mm+bi*nn+bj;
+          }
+        }
+      }
+    }
+  }
+};
+
+/// The Eigen matrix caches of every blocked CSR index, by row and column array.
+/// Entries are removed by simit::freeSolverCaches when their index is freed.
+template<typename Float>
+std::map<std::pair<int*,int*>, EigenMatrixCache<Float>>&
+getEigenMatrixCaches() {
+  static std::map<std::pair<int*,int*>, EigenMatrixCache<Float>> caches;
+  return caches;
+}
+
+/// Returns the Eigen matrix of the blocked CSR matrix like csr2eigen, but
+/// converts the structure of every blocked CSR index only once (see
+/// EigenMatrixCache). The matrix is valid while lock, which is locked on the
+/// mutex of the cache, is held.
+template<typename Float>
+const Eigen::SparseMatrix<Float>&
+csr2eigenCached(int n, int m, int* rowPtr, int* colIdx, int nn, int mm,
+                Float* vals, std::unique_lock<std::mutex>& lock) {
+  EigenMatrixCache<Float>* cache;
+  {
+    std::lock_guard<std::mutex> cachesLock(getSolverCachesMutex());
+    cache = &getEigenMatrixCaches<Float>()[{rowPtr, colIdx}];
+  }
+  lock = std::unique_lock<std::mutex>(cache->mutex, std::defer_lock);
+  lock.lock();
+  return cache->get(n, m, rowPtr, colIdx, nn, mm, vals);
+}
+
 template<typename Float> Eigen::Matrix<Float,Eigen::Dynamic,1>
 dense2eigen(int n, Float* vals) {
   auto result = Eigen::Matrix<Float,Eigen::Dynamic,1>(n);
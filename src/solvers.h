@@ -0,0 +1,125 @@
+#ifndef SIMIT_SOLVERS_H
+#define SIMIT_SOLVERS_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+namespace simit {
+
+/// The Krylov method of the solve intrinsic (`A \ b`).
+enum class KrylovMethod {
+  /// Conjugate gradients, for symmetric positive definite systems. Only the
+  /// lower triangle of the matrix is read. Runs directly on the blocked
+  /// matrix (see blockCG) unless the preconditioner is IncompleteCholesky.
+  CG,
+
+  /// Biconjugate gradients stabilized, for general square systems. Requires
+  /// Eigen.
+  BiCGSTAB,
+
+  /// Minimal residuals, for symmetric indefinite systems. Only the lower
+  /// triangle of the matrix is read. Requires Eigen.
+  MINRES,
+
+  /// Iterates x += M*(b - A*x) with the preconditioner M, which runs multigrid
+  /// V-cycles with the Multigrid preconditioner. Only for matrices assembled
+  /// with stencils on lattices.
+  Richardson
+};
+
+/// The preconditioner of the solve intrinsic.
+enum class Preconditioner {
+  Identity,
+
+  /// Divides by the diagonal of the matrix.
+  Jacobi,
+
+  /// Multiplies with the inverses of the diagonal blocks of the matrix, whose
+  /// size is the block size of the Simit matrix (e.g. 3x3 blocks for matrices
+  /// of tensor[3,3] blocks).
+  BlockJacobi,
+
+  /// Incomplete Cholesky factorization with fill-reducing ordering, for
+  /// symmetric positive definite systems. Requires Eigen 3.3 or newer.
+  IncompleteCholesky,
+
+  /// One geometric multigrid V-cycle on the lattice of the matrix (see
+  /// GeometricMultigrid), for symmetric positive definite systems. Only for
+  /// matrices assembled with stencils on lattices.
+  Multigrid,
+
+  /// One smoothed aggregation algebraic multigrid V-cycle (see
+  /// AlgebraicMultigrid), for symmetric positive definite systems such as the
+  /// stiffness matrices of unstructured meshes. Only with CG on matrices with
+  /// square blocks. The hierarchy is reused while the sparsity of the matrix
+  /// is fixed.
+  AlgebraicMultigrid
+};
+
+struct SolverSettings {
+  KrylovMethod method = KrylovMethod::CG;
+  Preconditioner preconditioner = Preconditioner::Identity;
+
+  /// The relative residual at which a solve stops. Machine epsilon of the
+  /// float type if 0.
+  double tolerance = 0.0;
+
+  int maxIterations = 50;
+
+  /// Start from the current values of the result vector instead of zero,
+  /// which speeds up solves of slowly changing systems, such as the steps of
+  /// a Newton loop or of a time integrator.
+  bool warmStart = false;
+
+  /// The number of threads of the native CG solver, or the hardware
+  /// concurrency if 0. Small systems are solved on fewer threads.
+  int numThreads = 0;
+};
+
+/// The outcome of a call to the solve intrinsic.
+struct SolverStatistics {
+  int iterations;
+
+  /// The relative residual.
+  double error;
+
+  /// Whether the tolerance was reached within the maximum number of
+  /// iterations.
+  bool converged;
+};
+
+/// The totals of all the solves since the last call to clearSolverStatistics.
+struct SolverTotals {
+  long long solves;
+  long long iterations;
+
+  /// The number of solves that did not converge.
+  long long unconverged;
+};
+
+/// The largest number of solves that getSolverStatistics returns.
+const std::size_t kMaxSolverStatistics = 1024;
+
+/// The statistics of the last kMaxSolverStatistics solves since the last call
+/// to clearSolverStatistics, in the order they were run. Older statistics are
+/// dropped, so that functions that solve in long loops do not grow the
+/// history, but are still counted by getSolverTotals.
+const std::deque<SolverStatistics>& getSolverStatistics();
+const SolverTotals& getSolverTotals();
+void clearSolverStatistics();
+
+/// Frees what solves cached for the blocked CSR index with the given row and
+/// column arrays: converted matrices, Cholesky factorizations, CG structures
+/// and multigrid hierarchies. Functions free the caches of their indices when
+/// the indices are rebuilt and when the functions are destroyed.
+void freeSolverCaches(const int* rowPtr, const int* colIdx);
+
+/// Frees the multigrid hierarchies that solves of stencil matrices cached.
+/// Hierarchies are shared by the stencil matrices with the same lattice,
+/// stencil and block size, in all functions, which rebuild them on their next
+/// solve. Functions that solve stencil matrices free them when destroyed.
+void freeStencilSolverCaches();
+
+}
+#endif
@@ -217,12 +217,19 @@ private:
   Environment* env;
   PathExpressionBuilder peBuilder;
 
-  TensorIndex getTensorIndex(const Var& var) {
+  TensorIndex getTensorIndex(const Var& var, bool upperTriangular=false) {
     auto pexpr = peBuilder.getPathExpression(var);
-    if (!env->hasTensorIndex(pexpr)) {
-      env->addTensorIndex(pexpr, var);
+    if (!env->hasTensorIndex(pexpr, upperTriangular)) {
+      env->addTensorIndex(pexpr, var, upperTriangular);
     }
-    return env->getTensorIndex(pexpr);
+    return env->getTensorIndex(pexpr, upperTriangular);
+  }
+
+  /// Matrices listed in Settings::symmetricMatrices are assembled with upper
+  /// triangular indices if their path expressions allow it.
+  bool isUpperTriangular(const Var& var) {
+    return util::contains(kSymmetricMatrices, var.getName()) &&
+           TensorIndex::canBeUpperTriangular(peBuilder.getPathExpression(var));
   }
 
   TensorIndex setStencilTensorIndex(const Var& var, std::string assemblyFunc,
@@ -357,7 +364,7 @@ private:
               tensorStorage = TensorStorage(TensorStorage::Diagonal);
             }
             else {
-              auto index = getTensorIndex(var);
+              auto index = getTensorIndex(var, isUpperTriangular(var));
               tensorStorage = TensorStorage(TensorStorage::Indexed, index);
 
               // Add path expression
@@ -431,7 +438,9 @@ private:
               tensorStorage = operandStorage.getKind();
               break;
             case TensorStorage::Indexed: {
-              auto index = getTensorIndex(var);
+              // Combinations of upper triangular matrices are also symmetric
+              bool upper = operandStorage.getTensorIndex().isUpperTriangular();
+              auto index = getTensorIndex(var, upper);
               tensorStorage = TensorStorage(TensorStorage::Indexed, index);
               break;
             }
@@ -450,6 +459,13 @@ private:
               unreachable;
           }
         }
+
+        tassert(operandStorageKind != TensorStorage::Indexed ||
+                tensorStorage.getKind() != TensorStorage::Indexed ||
+                operandStorage.getTensorIndex().isUpperTriangular() ==
+                    tensorStorage.getTensorIndex().isUpperTriangular())
+            << var << " combines symmetric and non-symmetric matrices; list "
+            << "all or none of them in Settings::symmetricMatrices";
       }
     }
 
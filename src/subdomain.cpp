@@ -0,0 +1,291 @@
+#include "subdomain.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "function.h"
+#include "partition.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+
+Set::FieldData* getField(Set& set, const string& name) {
+  for (Set::FieldData* field : set.getFields()) {
+    if (field->name == name) {
+      return field;
+    }
+  }
+  uerror << "The set has no field " << name;
+  return nullptr;
+}
+
+// Copies the field values of the elements at locations[i] of the global set to
+// location i of the local set, for every field of the local set that the global
+// set also has.
+void copyFields(Set& set, const vector<int>& locations, Set& localSet) {
+  map<string, Set::FieldData*> globalFields;
+  for (Set::FieldData* field : set.getFields()) {
+    globalFields[field->name] = field;
+  }
+  for (Set::FieldData* localField : localSet.getFields()) {
+    if (globalFields.find(localField->name) == globalFields.end()) {
+      continue;
+    }
+    Set::FieldData* field = globalFields.at(localField->name);
+    const ComponentType componentType = field->type->getComponentType();
+    uassert(componentType == localField->type->getComponentType() &&
+            field->type->getSize() == localField->type->getSize())
+        << "The local field " << localField->name
+        << " has a different type than the global field";
+    const size_t compSize = componentSize(componentType);
+    for (size_t i=0; i < locations.size(); ++i) {
+      for (size_t j=0; j < field->type->getSize(); ++j) {
+        memcpy((char*)localField->data +
+                   localField->getComponentIndex(i, j)*compSize,
+               (char*)field->data +
+                   field->getComponentIndex(locations[i], j)*compSize,
+               compSize);
+      }
+    }
+  }
+}
+
+}
+
+// class Subdomain
+Subdomain::Subdomain(Set& vertexSet, Set& edgeSet,
+                     const Partitioning& partitioning, int partition,
+                     Set& localVertexSet, Set& localEdgeSet)
+    : partition(partition), numGlobalVertices(vertexSet.getSize()) {
+  const int cardinality = edgeSet.getCardinality();
+  uassert(partition >= 0 && partition < partitioning.numPartitions)
+      << "Invalid partition " << partition;
+  uassert(partitioning.vertexPartitions.size() == (size_t)vertexSet.getSize())
+      << "The partitioning is not a partitioning of the vertex set";
+  uassert(edgeSet.getKind() == Set::Unstructured && cardinality > 0)
+      << "Subdomains need an unstructured edge set";
+  uassert(localVertexSet.getSize() == 0 && localEdgeSet.getSize() == 0)
+      << "The local sets of a subdomain must be empty";
+  uassert(localEdgeSet.getCardinality() == cardinality)
+      << "The local edge set has a different cardinality than the edge set";
+  for (int i=0; i < cardinality; ++i) {
+    uassert(edgeSet.getEndpointSet(i) == &vertexSet &&
+            localEdgeSet.getEndpointSet(i) == &localVertexSet)
+        << "The edge sets must connect the vertex sets";
+  }
+
+  const vector<int>& vertexPartitions = partitioning.vertexPartitions;
+  const int* endpoints = edgeSet.getEndpointsData();
+
+  // The edges with an owned endpoint, and the ghost endpoints of those edges
+  vector<bool> isGhost(vertexSet.getSize(), false);
+  for (int e=0; e < edgeSet.getSize(); ++e) {
+    bool owned = false;
+    for (int i=0; i < cardinality; ++i) {
+      owned |= vertexPartitions[endpoints[e*cardinality+i]] == partition;
+    }
+    if (!owned) {
+      continue;
+    }
+    edgeLocations.push_back(e);
+    for (int i=0; i < cardinality; ++i) {
+      int vertex = endpoints[e*cardinality+i];
+      if (vertexPartitions[vertex] != partition) {
+        isGhost[vertex] = true;
+      }
+    }
+  }
+
+  // Owned vertices first, then ghost vertices, in global location order
+  for (int v=0; v < vertexSet.getSize(); ++v) {
+    if (vertexPartitions[v] == partition) {
+      vertexLocations.push_back(v);
+    }
+  }
+  numOwned = vertexLocations.size();
+  for (int v=0; v < vertexSet.getSize(); ++v) {
+    if (isGhost[v]) {
+      vertexLocations.push_back(v);
+    }
+  }
+
+  vector<int> localLocations(vertexSet.getSize(), -1);
+  for (size_t i=0; i < vertexLocations.size(); ++i) {
+    localLocations[vertexLocations[i]] = i;
+    localVertexSet.add();
+  }
+  vector<ElementRef> localEndpoints(cardinality);
+  for (int e : edgeLocations) {
+    for (int i=0; i < cardinality; ++i) {
+      int vertex = localLocations[endpoints[e*cardinality+i]];
+      localEndpoints[i] = localVertexSet.getElementAt(vertex);
+    }
+    localEdgeSet.add(localEndpoints);
+  }
+
+  copyFields(vertexSet, vertexLocations, localVertexSet);
+  copyFields(edgeSet, edgeLocations, localEdgeSet);
+}
+
+
+// class HaloExchange
+/// The start of the shared memory, followed by the global copy of every field.
+/// The counters of the barrier are zero in a new shared memory object.
+struct HaloExchange::Header {
+  std::atomic<int> arrived;
+  std::atomic<int> generation;
+  std::atomic<int> aborted;
+};
+
+HaloExchange::HaloExchange(const string& name, const Subdomain& subdomain,
+                           int numProcesses, Set& localVertexSet,
+                           const vector<string>& fields, double timeout)
+    : subdomain(subdomain), numProcesses(numProcesses), timeout(timeout),
+      localVertexSet(localVertexSet), fields(fields), mapping(nullptr) {
+  uassert(numProcesses > 0) << "Invalid number of processes";
+  uassert(timeout > 0) << "Invalid timeout";
+  uassert(localVertexSet.getSize() ==
+          subdomain.getNumOwned() + subdomain.getNumGhosts())
+      << "The vertex set is not the local vertex set of the subdomain";
+  iassert(std::atomic<int>().is_lock_free())
+      << "Halo exchanges need lock-free atomics";
+
+  // Field arrays are cache line aligned, so that processes that write them do
+  // not share lines with the barrier
+  const size_t alignment = 64;
+  size = (sizeof(Header) + alignment-1) / alignment * alignment;
+  for (const string& field : fields) {
+    fieldOffsets.push_back(size);
+    size_t fieldSize = getField(localVertexSet, field)->sizeOfType;
+    size += (subdomain.getNumGlobalVertices()*fieldSize + alignment-1) /
+            alignment * alignment;
+  }
+
+  // Every process creates the object if it does not exist yet, and gives it
+  // its size. The new object is zero-filled, which initializes the barrier.
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+  uassert(fd != -1) << "Could not open the shared memory object " << name;
+  uassert(ftruncate(fd, size) == 0)
+      << "Could not resize the shared memory object " << name;
+  mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  uassert(mapping != MAP_FAILED)
+      << "Could not map the shared memory object " << name;
+
+  // Once all processes have mapped the object it is no longer needed by name.
+  // If a process times out or aborts, the object is unmapped and removed, so
+  // that the next decomposition with this name does not attach to the
+  // aborted barrier.
+  try {
+    barrier();
+  }
+  catch (...) {
+    munmap(mapping, size);
+    mapping = nullptr;
+    shm_unlink(name.c_str());
+    throw;
+  }
+  if (subdomain.getPartition() == 0) {
+    shm_unlink(name.c_str());
+  }
+}
+
+HaloExchange::~HaloExchange() {
+  if (mapping != nullptr && mapping != MAP_FAILED) {
+    munmap(mapping, size);
+  }
+}
+
+void HaloExchange::exchange() {
+  const vector<int>& vertexLocations = subdomain.getVertexLocations();
+  const int numOwned = subdomain.getNumOwned();
+  const int numLocal = vertexLocations.size();
+
+  // Copies the values of the local vertices in [begin,end) to (toShared) or
+  // from the global arrays
+  auto copy = [&](int begin, int end, bool toShared) {
+    for (size_t f=0; f < fields.size(); ++f) {
+      Set::FieldData* field = getField(localVertexSet, fields[f]);
+      const size_t compSize = componentSize(field->type->getComponentType());
+      const size_t fieldSize = field->type->getSize();
+      char* shared = (char*)mapping + fieldOffsets[f];
+      for (int i=begin; i < end; ++i) {
+        for (size_t j=0; j < fieldSize; ++j) {
+          char* local = (char*)field->data +
+                        field->getComponentIndex(i, j)*compSize;
+          char* global = shared +
+                         (vertexLocations[i]*fieldSize + j)*compSize;
+          if (toShared) {
+            memcpy(global, local, compSize);
+          }
+          else {
+            memcpy(local, global, compSize);
+          }
+        }
+      }
+    }
+  };
+
+  copy(0, numOwned, true);
+  barrier();
+  copy(numOwned, numLocal, false);
+  // Owners must not publish new values before all ghosts have been read
+  barrier();
+}
+
+void HaloExchange::run(Function& func) {
+  const vector<string> maps = func.getMapsReadingReducedFields();
+  if (maps.size() > 0) {
+    uerror << "The function cannot run on a domain decomposition, since "
+           << maps[0] << " reads ghost vertex fields computed from a reduce "
+           << "map before the halo is exchanged";
+  }
+  func.runSafe();
+  exchange();
+}
+
+void HaloExchange::barrier() {
+  Header* header = getHeader();
+  uassert(header->aborted.load() == 0)
+      << "The domain decomposition was aborted by another process";
+
+  const int generation = header->generation.load();
+  if (header->arrived.fetch_add(1) == numProcesses-1) {
+    header->arrived.store(0);
+    header->generation.fetch_add(1);
+    return;
+  }
+
+  // Processes that crash or stop exchanging must not hang the others
+  const auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(timeout));
+  while (header->generation.load() == generation) {
+    if (header->aborted.load() != 0) {
+      uerror << "The domain decomposition was aborted by another process";
+    }
+    if (std::chrono::steady_clock::now() > deadline) {
+      header->aborted.store(1);
+      uerror << "Timed out after " << timeout << " seconds waiting for the "
+             << "other processes of the domain decomposition";
+    }
+    std::this_thread::yield();
+  }
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef SIMIT_SUBDOMAIN_H
+#define SIMIT_SUBDOMAIN_H
+
+#include <string>
+#include <vector>
+
+namespace simit {
+class Set;
+class Function;
+struct Partitioning;
+
+/// The part of a vertex set, and of an edge set with endpoints in it, that one
+/// process of a domain decomposition computes on. The local vertex set stores
+/// the vertices of the process' partition (the owned vertices), followed by a
+/// halo of ghost vertices: the vertices of other partitions that share an edge
+/// with an owned vertex. The local edge set stores every edge with an owned
+/// endpoint, so edges that cross partitions are computed by all the processes
+/// that own one of their endpoints. With this redundancy the reduction of a map
+/// over the local edges computes the complete value of every owned vertex, and
+/// only ghost vertices must be updated by other processes (see HaloExchange).
+class Subdomain {
+public:
+  /// Adds the owned and ghost vertices of partition to localVertexSet, and the
+  /// edges with an owned endpoint to localEdgeSet, which must connect
+  /// localVertexSet like edgeSet connects vertexSet. The local sets must be
+  /// empty, and the fields they have in common with the global sets are copied.
+  Subdomain(Set& vertexSet, Set& edgeSet, const Partitioning& partitioning,
+            int partition, Set& localVertexSet, Set& localEdgeSet);
+
+  int getPartition() const {return partition;}
+
+  /// The number of vertices of the global vertex set.
+  int getNumGlobalVertices() const {return numGlobalVertices;}
+
+  /// The owned vertices are stored at local locations 0:getNumOwned(), and the
+  /// ghost vertices at getNumOwned():getNumOwned()+getNumGhosts().
+  int getNumOwned() const {return numOwned;}
+  int getNumGhosts() const {return (int)vertexLocations.size() - numOwned;}
+
+  /// The location in the global vertex set of every local vertex location.
+  const std::vector<int>& getVertexLocations() const {return vertexLocations;}
+
+  /// The location in the global edge set of every local edge location.
+  const std::vector<int>& getEdgeLocations() const {return edgeLocations;}
+
+private:
+  int partition;
+  int numGlobalVertices;
+  int numOwned;
+  std::vector<int> vertexLocations;
+  std::vector<int> edgeLocations;
+};
+
+/// Exchanges the values of vertex fields between the processes of a domain
+/// decomposition over POSIX shared memory. Every process owns a Subdomain, and
+/// exchange() is called by all of them after each computation that changes
+/// the fields of owned vertices (after a reduce map): each process publishes
+/// the field values of its owned vertices and reads those of its ghost
+/// vertices. Exchanges are collective, and every process must create the
+/// HaloExchange with the same name, number of processes and fields.
+///
+/// The halo is only exchanged between runs of a function, so a function may
+/// not read ghost vertex fields that were computed from a reduce map in the
+/// same run (see run()). A process that waits more than timeout seconds for the
+/// others aborts the decomposition, and every process then throws.
+class HaloExchange {
+public:
+  /// Maps the shared memory object called name, which holds one global copy of
+  /// every field and must not exist before the decomposition starts. Blocks
+  /// until all numProcesses processes have mapped it, and then removes the
+  /// name, so it can be reused by the next decomposition.
+  HaloExchange(const std::string& name, const Subdomain& subdomain,
+               int numProcesses, Set& localVertexSet,
+               const std::vector<std::string>& fields, double timeout=60.0);
+  ~HaloExchange();
+
+  /// Publishes the fields of the owned vertices and updates the fields of the
+  /// ghost vertices with the values published by their owners.
+  void exchange();
+
+  /// Runs func, which must be bound to the local sets, and then exchanges the
+  /// halo. Rejects functions where a map over edges reads a vertex field that
+  /// was written after a reduce map, since that map would read incomplete
+  /// ghost values (see Function::getMapsReadingReducedFields).
+  void run(Function& func);
+
+private:
+  struct Header;
+
+  const Subdomain& subdomain;
+  int numProcesses;
+  double timeout;
+  Set& localVertexSet;
+  std::vector<std::string> fields;
+
+  /// Offset of every field's global array from the start of the mapping.
+  std::vector<size_t> fieldOffsets;
+  size_t size;
+  void* mapping;
+
+  Header* getHeader() const {return (Header*)mapping;}
+  void barrier();
+
+  /// disable copy constructors
+  HaloExchange(const HaloExchange&);
+  HaloExchange& operator=(const HaloExchange&);
+};
+
+}
+#endif
@@ -19,13 +19,18 @@ struct TensorIndex::Content {
   StencilLayout stencil;
   Var coordArray;
   Var sinkArray;
+  bool upperTriangular;
 };
 
-TensorIndex::TensorIndex(std::string name, pe::PathExpression pexpr)
+TensorIndex::TensorIndex(std::string name, pe::PathExpression pexpr,
+                         bool upperTriangular)
     : content(new Content) {
+  iassert(!upperTriangular || canBeUpperTriangular(pexpr))
+      << pexpr << " cannot have an upper triangular index";
   content->name = name;
   content->pexpr = pexpr;
   content->kind = PExpr;
+  content->upperTriangular = upperTriangular;
 
   string prefix = (name == "") ? name : name + ".";
   content->coordArray = Var(prefix + "coords", ArrayType::make(ScalarType::Int));
@@ -37,6 +42,7 @@ TensorIndex::TensorIndex(std::string name, StencilLayout stencil)
   content->name = name;
   content->stencil = stencil;
   content->kind = Sten;
+  content->upperTriangular = false;
 }
 
 const std::string TensorIndex::getName() const {
@@ -55,6 +61,15 @@ bool TensorIndex::isComputed() const {
   }
 }
 
+bool TensorIndex::isUpperTriangular() const {
+  return content->upperTriangular;
+}
+
+bool TensorIndex::canBeUpperTriangular(const pe::PathExpression& pexpr) {
+  return pexpr.defined() && pe::isSymmetric(pexpr) &&
+         !pe::isa<pe::Link>(pexpr);
+}
+
 const pe::PathExpression& TensorIndex::getPathExpression() const {
   iassert(content->kind == PExpr);
   return content->pexpr;
@@ -107,8 +122,11 @@ ostream &operator<<(ostream& os, const TensorIndex& ti) {
   if (ti.getKind() == TensorIndex::PExpr) {
     auto rowptr = ti.getRowptrArray();
     auto colidx = ti.getColidxArray();
-    os << "tensor-index " << ti.getName() << ": " << ti.getPathExpression()
-       << endl;
+    os << "tensor-index " << ti.getName() << ": " << ti.getPathExpression();
+    if (ti.isUpperTriangular()) {
+      os << " (upper triangular)";
+    }
+    os << endl;
     os << "  " << rowptr << " : " << rowptr.getType() << endl;
     os << "  " << colidx << " : " << colidx.getType();
   }
@@ -30,7 +30,8 @@ public:
   enum Kind {PExpr, Sten};
   
   TensorIndex() {}
-  TensorIndex(std::string name, pe::PathExpression pexpr);
+  TensorIndex(std::string name, pe::PathExpression pexpr,
+              bool upperTriangular=false);
   TensorIndex(std::string name, StencilLayout stencil);
 
   /// Get tensor index name
@@ -50,6 +51,16 @@ public:
   /// function, or by Simit as they are computed.
   const pe::PathExpression& getPathExpression() const;
 
+  /// Get whether the tensor index only stores the upper triangle of a
+  /// symmetric sparsity pattern (see Settings::symmetricMatrices).  The lower
+  /// triangle of tensors with upper triangular indices is implied by symmetry.
+  bool isUpperTriangular() const;
+
+  /// Whether tensors with the path expression may have upper triangular
+  /// indices.  Lattice links are assembled through stencil locations that
+  /// assume the full index, so only symmetric edge set path expressions can.
+  static bool canBeUpperTriangular(const pe::PathExpression& pexpr);
+
   /// Return the tensor index's defining stencil.
   const StencilLayout& getStencilLayout() const;
 
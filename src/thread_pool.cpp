@@ -0,0 +1,113 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+ThreadPool::ThreadPool(unsigned numThreads)
+    : numThreads(numThreads), loop(nullptr), numChunks(0), size(0),
+      generation(0), remaining(0), stop(false) {
+  if (this->numThreads == 0) {
+    this->numThreads = max(thread::hardware_concurrency(), 1u);
+  }
+  for (unsigned t = 1; t < this->numThreads; ++t) {
+    threads.push_back(thread(&ThreadPool::work, this, t));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  started.notify_all();
+  for (thread& t : threads) {
+    t.join();
+  }
+}
+
+void ThreadPool::parallelFor(unsigned numChunks, size_t size,
+                             const function<void(unsigned,size_t,size_t)>& f) {
+  iassert(numChunks > 0 && numChunks <= numThreads)
+      << "Invalid number of chunks: " << numChunks;
+  if (numChunks == 1) {
+    f(0, 0, size);
+    return;
+  }
+
+  lock_guard<std::mutex> call(callMutex);
+  {
+    lock_guard<std::mutex> lock(mutex);
+    this->loop = &f;
+    this->numChunks = numChunks;
+    this->size = size;
+    remaining = numChunks-1;
+    ++generation;
+  }
+  started.notify_all();
+
+  f(0, 0, size / numChunks);
+
+  unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [this]() {return remaining == 0;});
+  loop = nullptr;
+}
+
+void ThreadPool::work(unsigned thread) {
+  unsigned seen = 0;
+  while (true) {
+    const function<void(unsigned,size_t,size_t)>* f;
+    unsigned numChunks;
+    size_t size;
+    {
+      unique_lock<std::mutex> lock(mutex);
+      started.wait(lock, [&]() {return stop || generation != seen;});
+      if (stop) {
+        return;
+      }
+      seen = generation;
+      f = loop;
+      numChunks = this->numChunks;
+      size = this->size;
+    }
+
+    // Threads without a chunk of this loop wait for the next one
+    if (thread >= numChunks) {
+      continue;
+    }
+    (*f)(thread, size * thread / numChunks, size * (thread+1) / numChunks);
+
+    bool last;
+    {
+      lock_guard<std::mutex> lock(mutex);
+      last = (--remaining == 0);
+    }
+    if (last) {
+      finished.notify_one();
+    }
+  }
+}
+
+ThreadPool& getThreadPool(unsigned numThreads) {
+  // Pools are leaked on purpose, so that they are not destroyed at exit while
+  // other threads may still be running loops on them
+  static std::mutex* poolsMutex = new std::mutex();
+  static auto* pools = new map<unsigned, unique_ptr<ThreadPool>>();
+  if (numThreads == 0) {
+    numThreads = max(thread::hardware_concurrency(), 1u);
+  }
+  lock_guard<std::mutex> lock(*poolsMutex);
+  unique_ptr<ThreadPool>& pool = (*pools)[numThreads];
+  if (pool == nullptr) {
+    pool.reset(new ThreadPool(numThreads));
+  }
+  return *pool;
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef SIMIT_THREAD_POOL_H
+#define SIMIT_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simit {
+
+/// A fixed set of threads that run the chunks of parallel loops, for runtime
+/// routines that run many short parallel loops in a row (such as the
+/// iterations of a solver), where starting threads for every loop would cost
+/// more than the loops themselves.
+class ThreadPool {
+public:
+  /// Creates a pool of numThreads threads, including the calling thread, or of
+  /// the hardware concurrency if numThreads is 0.
+  explicit ThreadPool(unsigned numThreads=0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned getNumThreads() const {return numThreads;}
+
+  /// Calls f(chunk, begin, end) on numChunks contiguous chunks of [0, size),
+  /// one chunk per thread, and returns when all of them are done. numChunks
+  /// must be at most getNumThreads(). Chunk 0 runs on the calling thread.
+  /// Concurrent calls run one after another, so f must not call parallelFor
+  /// on the same pool.
+  void parallelFor(unsigned numChunks, size_t size,
+                   const std::function<void(unsigned,size_t,size_t)>& f);
+
+private:
+  unsigned numThreads;
+  std::vector<std::thread> threads;
+
+  // Held for the whole of a parallelFor, since the pool runs one loop at a
+  // time
+  std::mutex callMutex;
+
+  std::mutex mutex;
+  std::condition_variable started;
+  std::condition_variable finished;
+
+  // The loop that is running, which the threads start when the generation
+  // changes
+  const std::function<void(unsigned,size_t,size_t)>* loop;
+  unsigned numChunks;
+  size_t size;
+  unsigned generation;
+  unsigned remaining;
+  bool stop;
+
+  void work(unsigned thread);
+};
+
+/// The pool shared by the runtime routines, with numThreads threads or one
+/// per hardware thread if numThreads is 0. There is one pool per number of
+/// threads, created on first use and kept for the lifetime of the program, so
+/// the returned reference stays valid and may be used from any thread.
+ThreadPool& getThreadPool(unsigned numThreads=0);
+
+}
+#endif
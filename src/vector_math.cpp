@@ -0,0 +1,25 @@
+#include "vector_math.h"
+
+namespace simit {
+
+static std::vector<VectorFunction> findVectorFunctions() {
+  std::vector<VectorFunction> functions;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  internal::sse::addVectorFunctions(functions);
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    internal::avx2::addVectorFunctions(functions);
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    internal::avx512::addVectorFunctions(functions);
+  }
+#endif
+  return functions;
+}
+
+const std::vector<VectorFunction>& getVectorFunctions() {
+  static const std::vector<VectorFunction> functions = findVectorFunctions();
+  return functions;
+}
+
+}
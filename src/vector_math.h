@@ -0,0 +1,54 @@
+#ifndef SIMIT_VECTOR_MATH_H
+#define SIMIT_VECTOR_MATH_H
+
+#include <vector>
+
+namespace simit {
+
+/// A vector variant of a math function called by generated code, which
+/// computes the function on `width` lanes at once. The loop vectorizer maps
+/// calls of the scalar function (an LLVM intrinsic such as `llvm.sin.f32`, or
+/// a runtime function such as `atan2_f64`) in vectorized loops to calls of the
+/// variant with the vectorization factor `width`, which take and return LLVM
+/// vectors (`<width x float>`) in vector registers. The mapping needs LLVM 3.8
+/// or later, and older versions call the scalar functions.
+///
+/// Variants exist for sin, cos, tan, exp, log, pow and atan2, for float and
+/// double, and for SSE2 (4 floats or 2 doubles), AVX2 with FMA (8 or 4) and
+/// AVX-512 (16 or 8). All instruction sets share one implementation, which
+/// computes every lane with the same instructions, and the maximum errors,
+/// measured against the exact results over the arguments in
+/// test/vector_math-tests.cpp, are:
+///
+///   function  float  double  notes
+///   sin, cos    2      2     |x| <= 2^20 (float) or 2^19 (double)
+///   tan         3      3     |x| <= 2^20 (float) or 2^19 (double)
+///   exp         1      2
+///   log         1      1
+///   pow         1      2     float is computed on double lanes
+///   atan2       3      2
+///
+/// in units in the last place (ulp). Lanes with larger arguments of the
+/// trigonometric functions, which need a more careful argument reduction,
+/// are computed with the C library. Special values (infinities, NaNs, signed
+/// zeros) follow C99 Annex F.
+struct VectorFunction {
+  const char* scalarName;
+  const char* name;
+  int width;
+  void* address;
+};
+
+/// The vector variants that the host supports, for the instruction sets it
+/// supports. Empty on other architectures than x86-64.
+const std::vector<VectorFunction>& getVectorFunctions();
+
+namespace internal {
+// Add the variants of the instruction sets, if they were compiled
+namespace sse    {void addVectorFunctions(std::vector<VectorFunction>&);}
+namespace avx2   {void addVectorFunctions(std::vector<VectorFunction>&);}
+namespace avx512 {void addVectorFunctions(std::vector<VectorFunction>&);}
+}
+
+}
+#endif
@@ -0,0 +1,17 @@
+// The vector math functions for AVX2 and FMA, when compiled with -mavx2 -mfma
+// (see src/CMakeLists.txt).
+#include "vector_math.h"
+
+#if defined(__AVX2__) && defined(__FMA__) && defined(__x86_64__)
+#define SIMIT_VECTOR_BYTES 32
+#define SIMIT_VECTOR_ISA avx2
+#define SIMIT_VECTOR_F32_LANES 8
+#define SIMIT_VECTOR_F64_LANES 4
+#include "vector_math_kernels.h"
+#else
+namespace simit {
+namespace internal {
+namespace avx2 {
+void addVectorFunctions(std::vector<VectorFunction>&) {}
+}}}
+#endif
@@ -0,0 +1,17 @@
+// The vector math functions for AVX-512, when compiled with -mavx512f (see
+// src/CMakeLists.txt).
+#include "vector_math.h"
+
+#if defined(__AVX512F__) && defined(__x86_64__)
+#define SIMIT_VECTOR_BYTES 64
+#define SIMIT_VECTOR_ISA avx512
+#define SIMIT_VECTOR_F32_LANES 16
+#define SIMIT_VECTOR_F64_LANES 8
+#include "vector_math_kernels.h"
+#else
+namespace simit {
+namespace internal {
+namespace avx512 {
+void addVectorFunctions(std::vector<VectorFunction>&) {}
+}}}
+#endif
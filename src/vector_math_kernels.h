@@ -0,0 +1,683 @@
+#ifndef SIMIT_VECTOR_MATH_KERNELS_H
+#define SIMIT_VECTOR_MATH_KERNELS_H
+
+// The vector math functions of vector_math.h, for vectors of
+// SIMIT_VECTOR_BYTES bytes, in namespace SIMIT_VECTOR_ISA. Included by the
+// translation unit of each instruction set, which is compiled for it and
+// defines SIMIT_VECTOR_F32_LANES and SIMIT_VECTOR_F64_LANES.
+//
+// The polynomials of sin, cos, tan, exp, log and atan are the ones of the
+// Cephes math library. Arguments are reduced, and special values handled,
+// with integer operations on the bits of the lanes, so that every lane runs
+// the same instructions.
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "vector_math.h"
+
+#if !defined(SIMIT_VECTOR_BYTES) || !defined(SIMIT_VECTOR_ISA) ||             \
+    !defined(SIMIT_VECTOR_F32_LANES) || !defined(SIMIT_VECTOR_F64_LANES)
+#error "The vector size, instruction set and lanes must be defined"
+#endif
+
+namespace simit {
+namespace internal {
+namespace SIMIT_VECTOR_ISA {
+
+typedef float   vf __attribute__((vector_size(SIMIT_VECTOR_BYTES)));
+typedef int32_t vi __attribute__((vector_size(SIMIT_VECTOR_BYTES)));
+typedef double  vd __attribute__((vector_size(SIMIT_VECTOR_BYTES)));
+typedef int64_t vl __attribute__((vector_size(SIMIT_VECTOR_BYTES)));
+
+const int F32_LANES = SIMIT_VECTOR_F32_LANES;
+const int F64_LANES = SIMIT_VECTOR_F64_LANES;
+
+const int32_t F32_SIGN = INT32_MIN;
+const int64_t F64_SIGN = INT64_MIN;
+
+// Lane operations
+static inline vf splat(float c) {return vf{} + c;}
+static inline vd splat(double c) {return vd{} + c;}
+
+static inline vf select(vi mask, vf a, vf b) {
+  return (vf)((mask & (vi)a) | (~mask & (vi)b));
+}
+
+static inline vd select(vl mask, vd a, vd b) {
+  return (vd)((mask & (vl)a) | (~mask & (vl)b));
+}
+
+static inline vl select(vl mask, vl a, vl b) {
+  return (mask & a) | (~mask & b);
+}
+
+static inline vf absolute(vf x) {return (vf)((vi)x & INT32_MAX);}
+static inline vd absolute(vd x) {return (vd)((vl)x & INT64_MAX);}
+
+static inline vf copySign(vf x, vf s) {
+  return (vf)(((vi)x & INT32_MAX) | ((vi)s & F32_SIGN));
+}
+
+static inline vd copySign(vd x, vd s) {
+  return (vd)(((vl)x & INT64_MAX) | ((vl)s & F64_SIGN));
+}
+
+template <typename Mask>
+static inline bool anyLane(Mask mask) {
+  bool any = false;
+  for (size_t i = 0; i < sizeof(Mask)/sizeof(mask[0]); ++i) {
+    any |= (mask[i] != 0);
+  }
+  return any;
+}
+
+/// Rounds the lanes to the nearest integers n, with |x| < 2^22 for floats and
+/// |x| < 2^51 for doubles, by adding 1.5 times 2^mantissa bits, which leaves n
+/// in the low bits.
+static inline vf roundToInt(vf x, vi& n) {
+  const vf t = x + 12582912.0f;
+  n = (vi)t - 0x4b400000;
+  return t - 12582912.0f;
+}
+
+static inline vd roundToInt(vd x, vl& n) {
+  const vd t = x + 6755399441055744.0;
+  n = (vl)t - 0x4338000000000000;
+  return t - 6755399441055744.0;
+}
+
+static inline vf toFloat(vi n) {return (vf)(n + 0x4b400000) - 12582912.0f;}
+static inline vd toDouble(vl n) {
+  return (vd)(n + 0x4338000000000000) - 6755399441055744.0;
+}
+
+/// 2^n, for exponents n of normal numbers.
+static inline vf pow2(vi n) {return (vf)((n + 127) << 23);}
+static inline vd pow2(vl n) {return (vd)((n + 1023) << 52);}
+
+// Double-double arithmetic, where hi + lo represents a sum exactly
+static inline void fastTwoSum(vd a, vd b, vd& hi, vd& lo) {
+  hi = a + b;
+  lo = b - (hi - a);
+}
+
+static inline void twoSum(vd a, vd b, vd& hi, vd& lo) {
+  hi = a + b;
+  const vd bb = hi - a;
+  lo = (a - (hi - bb)) + (b - bb);
+}
+
+static inline void split(vd a, vd& hi, vd& lo) {
+  const vd c = 134217729.0 * a;
+  const vd d = c - a;
+  hi = c - d;
+  lo = a - hi;
+}
+
+static inline void twoProd(vd a, vd b, vd& hi, vd& lo) {
+  vd ah, al, bh, bl;
+  split(a, ah, al);
+  split(b, bh, bl);
+  hi = a * b;
+  lo = ((ah*bh - hi) + ah*bl + al*bh) + al*bl;
+}
+
+
+// exp
+static inline vf exp(vf x) {
+  // exp(x) = 2^n * exp(r), with n = round(x/ln2) and |r| <= ln2/2, where the
+  // clamped arguments still over- and underflow (NaNs fail both comparisons)
+  x = select((vi)(x > 89.0f), splat(89.0f), x);
+  x = select((vi)(x < -104.0f), splat(-104.0f), x);
+  vi n;
+  const vf q = roundToInt(x * 1.44269504088896341f, n);
+  vf r = x - q * 0.693359375f;
+  r = r - q * -2.12194440e-4f;
+
+  vf p = splat(1.9875691500e-4f);
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  const vf y = p * (r * r) + r + 1.0f;
+
+  // Scale in two steps, so that 2^n of subnormal and overflowing results is
+  // representable
+  const vi n1 = n >> 1;
+  return y * pow2(n1) * pow2(n - n1);
+}
+
+/// exp(hi + lo), where lo is the low part of a double-double.
+static inline vd exp(vd x, vd lo) {
+  x = select((vl)(x > 710.0), splat(710.0), x);
+  x = select((vl)(x < -746.0), splat(-746.0), x);
+  vl n;
+  const vd q = roundToInt(x * 1.4426950408889634073599, n);
+  vd r = x - q * 6.93145751953125e-1;
+  r = r - q * 1.42860682030941723212e-6;
+  r = r + lo;
+
+  // exp(r) = 1 + 2r*P(r^2)/(Q(r^2) - r*P(r^2))
+  const vd rr = r * r;
+  vd p = splat(1.26177193074810590878e-4);
+  p = p * rr + 3.02994407707441961300e-2;
+  p = p * rr + 9.99999999999999999910e-1;
+  p = p * r;
+  vd q2 = splat(3.00198505138664455042e-6);
+  q2 = q2 * rr + 2.52448340349684104192e-3;
+  q2 = q2 * rr + 2.27265548208155028766e-1;
+  q2 = q2 * rr + 2.00000000000000000009e0;
+  const vd y = 1.0 + 2.0 * (p / (q2 - p));
+
+  const vl n1 = n >> 1;
+  return y * pow2(n1) * pow2(n - n1);
+}
+
+static inline vd exp(vd x) {
+  return exp(x, splat(0.0));
+}
+
+
+// log
+static inline vf log(vf x) {
+  const vf x0 = x;
+
+  // x = 2^e * m with m in [sqrt(1/2), sqrt(2)), after scaling subnormals
+  const vi subnormal = (vi)(x < 1.17549435e-38f);
+  x = select(subnormal, x * 8388608.0f, x);
+  const vi bits = (vi)x;
+  vi e = ((bits >> 23) & 0xff) - 126 - (subnormal & 23);
+  const vf m = (vf)((bits & 0x007fffff) | 0x3f000000);
+  const vi small = (vi)(m < 0.707106781186547524f);
+  e = e + small;
+  const vf f = select(small, m + m, m) - 1.0f;
+
+  // log(1+f) = f - f^2/2 + f^3*P(f)
+  const vf z = f * f;
+  vf p = splat(7.0376836292e-2f);
+  p = p * f - 1.1514610310e-1f;
+  p = p * f + 1.1676998740e-1f;
+  p = p * f - 1.2420140846e-1f;
+  p = p * f + 1.4249322787e-1f;
+  p = p * f - 1.6668057665e-1f;
+  p = p * f + 2.0000714765e-1f;
+  p = p * f - 2.4999993993e-1f;
+  p = p * f + 3.3333331174e-1f;
+  const vf fe = toFloat(e);
+  vf y = p * f * z;
+  y = y + fe * -2.12194440e-4f;
+  y = y - 0.5f * z;
+  vf r = f + y;
+  r = r + fe * 0.693359375f;
+
+  const float inf = std::numeric_limits<float>::infinity();
+  r = select((vi)(x0 == 0.0f), splat(-inf), r);
+  r = select((vi)(x0 < 0.0f), splat(std::numeric_limits<float>::quiet_NaN()), r);
+  r = select((vi)(x0 == inf), splat(inf), r);
+  return select((vi)(x0 != x0), x0, r);
+}
+
+/// Splits x into 2^e * (1+f), with 1+f in [sqrt(1/2), sqrt(2)), and returns f.
+static inline vd logReduce(vd x, vd& e) {
+  const vl subnormal = (vl)(x < 2.2250738585072014e-308);
+  x = select(subnormal, x * 18014398509481984.0, x);
+  const vl bits = (vl)x;
+  vl n = ((bits >> 52) & 0x7ff) - 1022 - (subnormal & 54);
+  const vd m = (vd)((bits & 0x000fffffffffffff) | 0x3fe0000000000000);
+  const vl small = (vl)(m < 0.70710678118654752440);
+  n = n + small;
+  e = toDouble(n);
+  return select(small, m + m, m) - 1.0;
+}
+
+/// log(x) for the special values of x, and r for all others.
+static inline vd logSpecialValues(vd x, vd r) {
+  const double inf = std::numeric_limits<double>::infinity();
+  r = select((vl)(x == 0.0), splat(-inf), r);
+  r = select((vl)(x < 0.0), splat(std::numeric_limits<double>::quiet_NaN()), r);
+  r = select((vl)(x == inf), splat(inf), r);
+  return select((vl)(x != x), x, r);
+}
+
+static inline vd log(vd x) {
+  vd e;
+  const vd f = logReduce(x, e);
+
+  // log(1+f) = f - f^2/2 + f^3*P(f)/Q(f)
+  const vd z = f * f;
+  vd p = splat(1.01875663804580931796e-4);
+  p = p * f + 4.97494994976747001425e-1;
+  p = p * f + 4.70579119878881725854e0;
+  p = p * f + 1.44989225341610930846e1;
+  p = p * f + 1.79368678507819816313e1;
+  p = p * f + 7.70838733755885391666e0;
+  vd q = f + 1.12873587189167450590e1;
+  q = q * f + 4.52279145837532221105e1;
+  q = q * f + 8.29875266912776603211e1;
+  q = q * f + 7.11544750618563894466e1;
+  q = q * f + 2.31251620126765340583e1;
+  vd y = f * (z * p / q);
+  y = y - e * 2.121944400546905827679e-4;
+  y = y - 0.5 * z;
+  vd r = f + y;
+  r = r + e * 0.693359375;
+  return logSpecialValues(x, r);
+}
+
+/// log(x) as a double-double hi + lo, accurate to about 2^-100 relative, for
+/// the exponent of pow, whose error is amplified by the magnitude of
+/// y*log(x).
+static inline vd logExtended(vd x, vd& lo) {
+  vd e;
+  const vd f = logReduce(x, e);
+
+  // log(1+f) = 2s + 2s^3/3 + 2s^5/5 + ..., with s = f/(2+f) and |s| < 0.172,
+  // where s and the first two terms are double-doubles
+  vd d, dl;
+  fastTwoSum(splat(2.0), f, d, dl);
+  const vd s = f / d;
+  vd sd, sdl;
+  twoProd(s, d, sd, sdl);
+  const vd sl = (((f - sd) - sdl) - s * dl) / d;
+
+  vd s2, s2l;
+  twoProd(s, s, s2, s2l);
+  s2l = s2l + 2.0 * s * sl;
+  vd s3, s3l;
+  twoProd(s2, s, s3, s3l);
+  s3l = s3l + s2l * s + s2 * sl;
+  vd t, tl;
+  twoProd(s3, splat(0.66666666666666663), t, tl);
+  tl = tl + s3 * 3.700743415417188e-17 + s3l * 0.66666666666666663;
+
+  // The remaining terms, to s^25
+  vd tail = splat(2.0/25);
+  tail = tail * s2 + 2.0/23;
+  tail = tail * s2 + 2.0/21;
+  tail = tail * s2 + 2.0/19;
+  tail = tail * s2 + 2.0/17;
+  tail = tail * s2 + 2.0/15;
+  tail = tail * s2 + 2.0/13;
+  tail = tail * s2 + 2.0/11;
+  tail = tail * s2 + 2.0/9;
+  tail = tail * s2 + 2.0/7;
+  tail = tail * s2 + 2.0/5;
+  tail = tail * s2 * s2 * s;
+
+  vd hi, err;
+  fastTwoSum(2.0 * s, t, hi, err);
+  vd l = err + 2.0 * sl + tl + tail;
+
+  // + e*ln2, where the high part of ln2 has 32 trailing zeros
+  vd h;
+  twoSum(e * 6.93147180369123816490e-01, hi, h, err);
+  l = l + err + e * 1.90821492927058770002e-10;
+  fastTwoSum(h, l, hi, lo);
+  lo = select((vl)(x > 0.0) & (vl)(x < std::numeric_limits<double>::infinity()),
+              lo, splat(0.0));
+  return logSpecialValues(x, hi);
+}
+
+
+// pow
+/// Whether the lanes of y are integers, and which of them are odd.
+static inline vl isInteger(vd y, vl& odd) {
+  // Below 2^52, t holds the nearest integer in its last bit. From 2^52 to 2^53
+  // the last bit of y is its ones digit, and larger numbers are even.
+  const vd ay = absolute(y);
+  const vd t = ay + 4503599627370496.0;
+  const vl small = (vl)(ay < 4503599627370496.0);
+  odd = select(small, -((vl)t & 1),
+               select((vl)(ay < 9007199254740992.0), -((vl)ay & 1), vl{}));
+  return select(small, (vl)((t - 4503599627370496.0) == ay), (vl)(ay == ay));
+}
+
+static inline vd pow(vd x, vd y) {
+  // x^y = exp(y*log|x|), with y*log|x| as a double-double
+  vd lo;
+  const vd hi = logExtended(absolute(x), lo);
+  vd p, pl;
+  twoProd(y, hi, p, pl);
+  pl = pl + y * lo;
+  pl = select((vl)(absolute(p) < 746.0), pl, splat(0.0));
+  vd r = exp(p, pl);
+
+  // Negative bases are defined for integer exponents, with the sign of the
+  // base for odd ones
+  vl odd;
+  const vl integer = isInteger(y, odd);
+  const double inf = std::numeric_limits<double>::infinity();
+  r = select(((vl)x < 0) & integer & odd, -r, r);
+  r = select((vl)(x < 0.0) & (vl)(x != -inf) & ~integer,
+             splat(std::numeric_limits<double>::quiet_NaN()), r);
+
+  // x^0 = 1 and 1^y = 1, even for NaNs, and (-1)^(+-inf) = 1
+  const vl one = (vl)(y == 0.0) | (vl)(x == 1.0) |
+                 ((vl)(x == -1.0) & (vl)(absolute(y) == inf));
+  return select(one, splat(1.0), r);
+}
+
+static inline vf pow(vf x, vf y) {
+  // Computed on double lanes, so that the error of the float result is its
+  // rounding
+  vf r = {};
+  for (int h = 0; h < 2; ++h) {
+    vd xd = {};
+    vd yd = {};
+    for (int i = 0; i < F64_LANES; ++i) {
+      xd[i] = x[h*F64_LANES + i];
+      yd[i] = y[h*F64_LANES + i];
+    }
+    const vd rd = pow(xd, yd);
+    for (int i = 0; i < F64_LANES; ++i) {
+      r[h*F64_LANES + i] = (float)rd[i];
+    }
+  }
+  return r;
+}
+
+
+// sin, cos and tan
+/// Reduces |x| to r = |x| - q*pi/2 in [-pi/4, pi/4]. Floats are reduced on
+/// double lanes, with pi/2 in two parts whose first has 31 bits, so that its
+/// product with q < 2^20 is exact. Their q is also computed on double lanes,
+/// since |x|*2/pi rounded to float can round to the wrong side of a half and
+/// leave r outside [-pi/4, pi/4]. Doubles are reduced with pi/2 in three
+/// parts whose first two have 24 bits.
+static inline vf reduce(vf ax, vi& q) {
+  vf r = {};
+  for (int h = 0; h < 2; ++h) {
+    vd a = {};
+    for (int i = 0; i < F64_LANES; ++i) {
+      a[i] = ax[h*F64_LANES + i];
+    }
+    vl n;
+    const vd b = roundToInt(a * 0.63661977236758134308, n);
+    const vd rd = (a - b * 1.57079632673412561417e0) -
+                  b * 6.07710050650619224932e-11;
+    for (int i = 0; i < F64_LANES; ++i) {
+      q[h*F64_LANES + i] = (int32_t)n[i];
+      r[h*F64_LANES + i] = (float)rd[i];
+    }
+  }
+  return r;
+}
+
+static inline vd reduce(vd ax, vl& q) {
+  const vd fq = roundToInt(ax * 0.63661977236758134308, q);
+  vd r = ax - fq * 1.57079625129699707031e0;
+  r = r - fq * 7.54978941586159635336e-8;
+  r = r - fq * 5.39030285815811905290e-15;
+  return r;
+}
+
+static inline vf sinPoly(vf r, vf z) {
+  vf p = splat(-1.9515295891e-4f);
+  p = p * z + 8.3321608736e-3f;
+  p = p * z - 1.6666654611e-1f;
+  return p * z * r + r;
+}
+
+static inline vf cosPoly(vf z) {
+  vf p = splat(2.443315711809948e-5f);
+  p = p * z - 1.388731625493765e-3f;
+  p = p * z + 4.166664568298827e-2f;
+  return p * z * z - 0.5f * z + 1.0f;
+}
+
+static inline vd sinPoly(vd r, vd z) {
+  vd p = splat(1.58962301576546568060e-10);
+  p = p * z - 2.50507477628578072866e-8;
+  p = p * z + 2.75573136213857245213e-6;
+  p = p * z - 1.98412698295895385996e-4;
+  p = p * z + 8.33333333332211858878e-3;
+  p = p * z - 1.66666666666666307295e-1;
+  return r + r * z * p;
+}
+
+static inline vd cosPoly(vd z) {
+  vd p = splat(-1.13585365213876817300e-11);
+  p = p * z + 2.08757008419747316778e-9;
+  p = p * z - 2.75573141792967388112e-7;
+  p = p * z + 2.48015872888517045348e-5;
+  p = p * z - 1.38888888888730564116e-3;
+  p = p * z + 4.16666666666665929218e-2;
+  return 1.0 - 0.5 * z + z * z * p;
+}
+
+static inline vf tanPoly(vf r, vf z) {
+  vf p = splat(9.38540185543e-3f);
+  p = p * z + 3.11992232697e-3f;
+  p = p * z + 2.44301354525e-2f;
+  p = p * z + 5.34112807005e-2f;
+  p = p * z + 1.33387994085e-1f;
+  p = p * z + 3.33331568548e-1f;
+  return p * z * r + r;
+}
+
+static inline vd tanPoly(vd r, vd z) {
+  vd p = splat(-1.30936939181383777646e4);
+  p = p * z + 1.15351664838587416140e6;
+  p = p * z - 1.79565251976484877988e7;
+  vd q = z + 1.36812963470692954678e4;
+  q = q * z - 1.32089234440210967447e6;
+  q = q * z + 2.50083801823357915839e7;
+  q = q * z - 5.38695755929454629881e7;
+  return r + r * (z * p / q);
+}
+
+// Lanes outside the range of the reduction, infinities and NaNs are computed
+// by the C library
+#define SIMIT_LIBM_LANES(V, M, f, x, y, range)                                 \
+  do {                                                                         \
+    const M large = ~(M)(absolute(x) <= range);                                \
+    if (anyLane(large)) {                                                      \
+      for (size_t i = 0; i < sizeof(V)/sizeof(x[0]); ++i) {                    \
+        if (large[i]) y[i] = std::f(x[i]);                                     \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+static inline vf sin(vf x) {
+  vi q;
+  const vf r = reduce(absolute(x), q);
+  const vf z = r * r;
+
+  // sin(r + q*pi/2) is sin(r), cos(r), -sin(r) and -cos(r) for q mod 4
+  vf y = select((vi)((q & 1) == 0), sinPoly(r, z), cosPoly(z));
+  y = (vf)((vi)y ^ (-((q >> 1) & 1) & F32_SIGN) ^ ((vi)x & F32_SIGN));
+  SIMIT_LIBM_LANES(vf, vi, sin, x, y, 1048576.0f);
+  return y;
+}
+
+static inline vd sin(vd x) {
+  vl q;
+  const vd r = reduce(absolute(x), q);
+  const vd z = r * r;
+  vd y = select((vl)((q & 1) == 0), sinPoly(r, z), cosPoly(z));
+  y = (vd)((vl)y ^ (-((q >> 1) & 1) & F64_SIGN) ^ ((vl)x & F64_SIGN));
+  SIMIT_LIBM_LANES(vd, vl, sin, x, y, 524288.0);
+  return y;
+}
+
+static inline vf cos(vf x) {
+  vi q;
+  const vf r = reduce(absolute(x), q);
+  const vf z = r * r;
+
+  // cos(r + q*pi/2) is cos(r), -sin(r), -cos(r) and sin(r) for q mod 4
+  vf y = select((vi)((q & 1) == 0), cosPoly(z), sinPoly(r, z));
+  y = (vf)((vi)y ^ (-(((q + 1) >> 1) & 1) & F32_SIGN));
+  SIMIT_LIBM_LANES(vf, vi, cos, x, y, 1048576.0f);
+  return y;
+}
+
+static inline vd cos(vd x) {
+  vl q;
+  const vd r = reduce(absolute(x), q);
+  const vd z = r * r;
+  vd y = select((vl)((q & 1) == 0), cosPoly(z), sinPoly(r, z));
+  y = (vd)((vl)y ^ (-(((q + 1) >> 1) & 1) & F64_SIGN));
+  SIMIT_LIBM_LANES(vd, vl, cos, x, y, 524288.0);
+  return y;
+}
+
+static inline vf tan(vf x) {
+  vi q;
+  const vf r = reduce(absolute(x), q);
+  vf y = tanPoly(r, r * r);
+
+  // tan(r + pi/2) = -1/tan(r)
+  y = select((vi)((q & 1) != 0), -1.0f / y, y);
+  y = (vf)((vi)y ^ ((vi)x & F32_SIGN));
+  SIMIT_LIBM_LANES(vf, vi, tan, x, y, 1048576.0f);
+  return y;
+}
+
+static inline vd tan(vd x) {
+  vl q;
+  const vd r = reduce(absolute(x), q);
+  vd y = tanPoly(r, r * r);
+  y = select((vl)((q & 1) != 0), -1.0 / y, y);
+  y = (vd)((vl)y ^ ((vl)x & F64_SIGN));
+  SIMIT_LIBM_LANES(vd, vl, tan, x, y, 524288.0);
+  return y;
+}
+
+#undef SIMIT_LIBM_LANES
+
+
+// atan2
+/// atan(x) for x >= 0, including infinity.
+static inline vf atanPositive(vf x) {
+  // Reduce x to [0, tan(pi/8)] with atan(x) = pi/2 - atan(1/x) and
+  // atan(x) = pi/4 + atan((x-1)/(x+1))
+  const vi large = (vi)(x > 2.414213562373095f);
+  const vi medium = (vi)(x > 0.4142135623730950f);
+  const vf t = select(large, -1.0f / x,
+                      select(medium, (x - 1.0f) / (x + 1.0f), x));
+  const vf y0 = select(large, splat(1.5707963267948966f),
+                       select(medium, splat(0.7853981633974483f), splat(0.0f)));
+  const vf z = t * t;
+  vf p = splat(8.05374449538e-2f);
+  p = p * z - 1.38776856032e-1f;
+  p = p * z + 1.99777106478e-1f;
+  p = p * z - 3.33329491539e-1f;
+  return y0 + (p * z * t + t);
+}
+
+static inline vd atanPositive(vd x) {
+  const vl large = (vl)(x > 2.41421356237309504880);
+  const vl medium = (vl)(x > 0.66);
+  const vd t = select(large, -1.0 / x,
+                      select(medium, (x - 1.0) / (x + 1.0), x));
+  // pi/2 and pi/4, and their low parts
+  const vd y0 = select(large, splat(1.57079632679489661923),
+                       select(medium, splat(7.85398163397448309616e-1),
+                              splat(0.0)));
+  const vd y0l = select(large, splat(6.123233995736765886130e-17),
+                        select(medium, splat(3.061616997868382943065e-17),
+                               splat(0.0)));
+  const vd z = t * t;
+  vd p = splat(-8.750608600031904122785e-1);
+  p = p * z - 1.615753718733365076637e1;
+  p = p * z - 7.500855792314704667340e1;
+  p = p * z - 1.228866684490136173410e2;
+  p = p * z - 6.485021904942025371773e1;
+  vd q = z + 2.485846490142306297962e1;
+  q = q * z + 1.650270098316988542046e2;
+  q = q * z + 4.328810604912902668951e2;
+  q = q * z + 4.853903996359136964868e2;
+  q = q * z + 1.945506571482613964425e2;
+  return y0 + ((t * (z * p / q) + t) + y0l);
+}
+
+static inline vf atan2(vf y, vf x) {
+  // atan2(y, x) = +-atan(|y/x|) for x >= 0 and +-(pi - atan(|y/x|)) for
+  // x < 0, with the sign of y. Both zero or both infinite is 0 or pi/4.
+  const vf ay = absolute(y);
+  const vf ax = absolute(x);
+  const float inf = std::numeric_limits<float>::infinity();
+  vf a = atanPositive(ay / ax);
+  a = select((vi)(ay == 0.0f) & (vi)(ax == 0.0f), splat(0.0f), a);
+  a = select((vi)(ay == inf) & (vi)(ax == inf), splat(0.7853981633974483f), a);
+  a = select((vi)x < 0, (3.1415927410125732f - a) - 8.742278000372485e-08f, a);
+  return copySign(a, y);
+}
+
+static inline vd atan2(vd y, vd x) {
+  const vd ay = absolute(y);
+  const vd ax = absolute(x);
+  const double inf = std::numeric_limits<double>::infinity();
+  vd a = atanPositive(ay / ax);
+  a = select((vl)(ay == 0.0) & (vl)(ax == 0.0), splat(0.0), a);
+  a = select((vl)(ay == inf) & (vl)(ax == inf), splat(7.85398163397448309616e-1), a);
+  a = select((vl)x < 0, (3.141592653589793 - a) + 1.2246467991473532e-16, a);
+  return copySign(a, y);
+}
+
+}}}
+
+
+// Entry points, named simit_<function>_<type>x<lanes>
+#define SIMIT_VECTOR_NAME(f, type, lanes) SIMIT_VECTOR_NAME_(f, type, lanes)
+#define SIMIT_VECTOR_NAME_(f, type, lanes) simit_##f##_##type##x##lanes
+#define SIMIT_VECTOR_STR(s) SIMIT_VECTOR_STR_(s)
+#define SIMIT_VECTOR_STR_(s) #s
+
+#define SIMIT_VECTOR_UNARY(f, type, lanes, V)                                  \
+  extern "C" V SIMIT_VECTOR_NAME(f, type, lanes)(V x);                         \
+  V SIMIT_VECTOR_NAME(f, type, lanes)(V x) {return f(x);}
+#define SIMIT_VECTOR_BINARY(f, type, lanes, V)                                 \
+  extern "C" V SIMIT_VECTOR_NAME(f, type, lanes)(V x, V y);                    \
+  V SIMIT_VECTOR_NAME(f, type, lanes)(V x, V y) {return f(x, y);}
+
+#define SIMIT_VECTOR_FUNCTIONS(type, lanes, V)                                 \
+  SIMIT_VECTOR_UNARY(sin, type, lanes, V)                                      \
+  SIMIT_VECTOR_UNARY(cos, type, lanes, V)                                      \
+  SIMIT_VECTOR_UNARY(tan, type, lanes, V)                                      \
+  SIMIT_VECTOR_UNARY(exp, type, lanes, V)                                      \
+  SIMIT_VECTOR_UNARY(log, type, lanes, V)                                      \
+  SIMIT_VECTOR_BINARY(pow, type, lanes, V)                                     \
+  SIMIT_VECTOR_BINARY(atan2, type, lanes, V)
+
+namespace simit {
+namespace internal {
+namespace SIMIT_VECTOR_ISA {
+
+SIMIT_VECTOR_FUNCTIONS(f32, SIMIT_VECTOR_F32_LANES, vf)
+SIMIT_VECTOR_FUNCTIONS(f64, SIMIT_VECTOR_F64_LANES, vd)
+
+// The scalar functions are the LLVM intrinsics that the backend emits for
+// sin, cos, exp, log and pow, and the runtime functions for tan and atan2
+#define SIMIT_ADD_VECTOR_FUNCTION(scalarName, f, type, lanes)                  \
+  functions.push_back({scalarName,                                             \
+                       SIMIT_VECTOR_STR(SIMIT_VECTOR_NAME(f, type, lanes)),    \
+                       lanes, (void*)&SIMIT_VECTOR_NAME(f, type, lanes)})
+
+void addVectorFunctions(std::vector<VectorFunction>& functions) {
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.sin.f32", sin, f32, SIMIT_VECTOR_F32_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.cos.f32", cos, f32, SIMIT_VECTOR_F32_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("tan_f32", tan, f32, SIMIT_VECTOR_F32_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.exp.f32", exp, f32, SIMIT_VECTOR_F32_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.log.f32", log, f32, SIMIT_VECTOR_F32_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.pow.f32", pow, f32, SIMIT_VECTOR_F32_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("atan2_f32", atan2, f32, SIMIT_VECTOR_F32_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.sin.f64", sin, f64, SIMIT_VECTOR_F64_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.cos.f64", cos, f64, SIMIT_VECTOR_F64_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("tan_f64", tan, f64, SIMIT_VECTOR_F64_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.exp.f64", exp, f64, SIMIT_VECTOR_F64_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.log.f64", log, f64, SIMIT_VECTOR_F64_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("llvm.pow.f64", pow, f64, SIMIT_VECTOR_F64_LANES);
+  SIMIT_ADD_VECTOR_FUNCTION("atan2_f64", atan2, f64, SIMIT_VECTOR_F64_LANES);
+}
+
+#undef SIMIT_ADD_VECTOR_FUNCTION
+
+}}}
+
+#endif
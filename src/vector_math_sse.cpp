@@ -0,0 +1,16 @@
+// The vector math functions for SSE2, which every x86-64 processor has.
+#include "vector_math.h"
+
+#if defined(__SSE2__) && defined(__x86_64__)
+#define SIMIT_VECTOR_BYTES 16
+#define SIMIT_VECTOR_ISA sse
+#define SIMIT_VECTOR_F32_LANES 4
+#define SIMIT_VECTOR_F64_LANES 2
+#include "vector_math_kernels.h"
+#else
+namespace simit {
+namespace internal {
+namespace sse {
+void addVectorFunctions(std::vector<VectorFunction>&) {}
+}}}
+#endif
@@ -0,0 +1,142 @@
+#include "simit-test.h"
+
+#include <cmath>
+#include <vector>
+
+#include "amg.h"
+#include "block_matrix.h"
+
+using namespace std;
+using namespace simit;
+
+// The blocked CSR matrix of a triangulated n x n grid, where every edge (i,j)
+// couples its vertices with the block -w_ij*B for a symmetric positive
+// definite B that couples the components of the vertices, and the diagonal
+// blocks balance the rows plus a small mass term. The weights of the edges
+// vary, like the stiffness of the elements of an unstructured mesh.
+struct MeshMatrix : BlockMatrix {
+  MeshMatrix(int n, int bs) : BlockMatrix(n*n, bs) {
+    vector<vector<pair<int,double>>> edges(numRows);
+    auto addEdge = [&](int i, int j) {
+      const double w = 1.0 + 0.5*sin(3.0*i + j);
+      edges[i].push_back({j, w});
+      edges[j].push_back({i, w});
+    };
+    for (int y = 0; y < n; ++y) {
+      for (int x = 0; x < n; ++x) {
+        const int i = y*n+x;
+        if (x+1 < n)            addEdge(i, i+1);
+        if (y+1 < n)            addEdge(i, i+n);
+        if (x+1 < n && y+1 < n) addEdge(i, i+n+1);
+      }
+    }
+
+    const int bs2 = bs*bs;
+    auto B = [&](int bi, int bj) {
+      return (bi == bj) ? 2.0 : (abs(bi-bj) == 1) ? 0.5 : 0.0;
+    };
+    rowPtr.push_back(0);
+    for (int i = 0; i < numRows; ++i) {
+      edges[i].push_back({i, 0.0});
+      sort(edges[i].begin(), edges[i].end());
+      double rowWeight = 0.0;
+      for (auto& edge : edges[i]) {
+        rowWeight += edge.second;
+      }
+      for (auto& edge : edges[i]) {
+        colIdx.push_back(edge.first);
+        for (int k = 0; k < bs2; ++k) {
+          const int bi = k / bs;
+          const int bj = k % bs;
+          vals.push_back((edge.first == i)
+                         ? rowWeight*B(bi, bj) + ((bi == bj) ? 0.01 : 0.0)
+                         : -edge.second*B(bi, bj));
+        }
+      }
+      rowPtr.push_back(colIdx.size());
+    }
+  }
+
+  vector<double> rhs() const {
+    vector<double> b(numRows*blockSize);
+    for (size_t i = 0; i < b.size(); ++i) {
+      b[i] = sin(0.3*i) + (double)(i % 5) - 2.0;
+    }
+    return b;
+  }
+};
+
+TEST(AMG, hierarchy) {
+  MeshMatrix A(40, 3);
+  AlgebraicMultigrid<double> amg(A.numRows, 3, A.rowPtr.data(),
+                                 A.colIdx.data(), A.vals.data());
+  ASSERT_GT(amg.getNumLevels(), 2);
+  ASSERT_EQ(A.numRows, amg.getNumRows(0));
+  for (int l = 1; l < amg.getNumLevels(); ++l) {
+    ASSERT_LT(amg.getNumRows(l), amg.getNumRows(l-1) / 2);
+  }
+  ASSERT_LE(amg.getNumRows(amg.getNumLevels()-1)*3, 256);
+  ASSERT_TRUE(amg.matches(A.numRows, 3, A.rowPtr.data(), A.colIdx.data()));
+  ASSERT_FALSE(amg.matches(A.numRows, 1, A.rowPtr.data(), A.colIdx.data()));
+}
+
+TEST(AMG, solve) {
+  for (int bs : {1, 3}) {
+    MeshMatrix A(32, bs);
+    vector<double> b = A.rhs();
+
+    SolverSettings settings;
+    settings.tolerance = 1e-10;
+    settings.maxIterations = 1000;
+    settings.preconditioner = Preconditioner::BlockJacobi;
+    vector<double> x(b.size());
+    SolverStatistics blockJacobi = A.solve(b, x, settings);
+    ASSERT_TRUE(blockJacobi.converged);
+
+    settings.preconditioner = Preconditioner::AlgebraicMultigrid;
+    fill(x.begin(), x.end(), 0.0);
+    SolverStatistics amg = A.solve(b, x, settings);
+    ASSERT_TRUE(amg.converged);
+    ASSERT_LT(A.residual(b, x), 1e-9);
+    ASSERT_LT(amg.iterations, blockJacobi.iterations / 4);
+  }
+}
+
+TEST(AMG, meshIndependence) {
+  SolverSettings settings;
+  settings.preconditioner = Preconditioner::AlgebraicMultigrid;
+  settings.tolerance = 1e-8;
+  settings.maxIterations = 1000;
+  vector<int> iterations;
+  for (int n : {16, 32, 64}) {
+    MeshMatrix A(n, 3);
+    vector<double> b = A.rhs();
+    vector<double> x(b.size());
+    SolverStatistics statistics = A.solve(b, x, settings);
+    ASSERT_TRUE(statistics.converged);
+    iterations.push_back(statistics.iterations);
+  }
+  ASSERT_LE(iterations.back(), 2*iterations.front());
+}
+
+TEST(AMG, reuse) {
+  MeshMatrix A(24, 3);
+  vector<double> b = A.rhs();
+  SolverSettings settings;
+  settings.preconditioner = Preconditioner::AlgebraicMultigrid;
+  settings.tolerance = 1e-12;
+  settings.maxIterations = 1000;
+  vector<double> x(b.size());
+  ASSERT_TRUE(A.solve(b, x, settings).converged);
+
+  // The hierarchy of the index is set up again for new values
+  for (double& val : A.vals) {
+    val *= 2.0;
+  }
+  vector<double> y(b.size());
+  ASSERT_TRUE(A.solve(b, y, settings).converged);
+  ASSERT_LT(A.residual(b, y), 1e-11);
+  for (size_t i = 0; i < b.size(); ++i) {
+    ASSERT_NEAR(x[i]/2.0, y[i], 1e-9);
+  }
+}
@@ -0,0 +1,179 @@
+#include "simit-test.h"
+
+#include <cmath>
+#include <vector>
+
+#include "block_cg.h"
+#include "block_matrix.h"
+
+using namespace std;
+using namespace simit;
+
+// The blocked CSR matrix of the stiffness of an n x n grid with blocks of size
+// bs x bs, which is symmetric positive definite. The diagonal blocks couple
+// their components and are scaled differently from row to row.
+struct GridMatrix : BlockMatrix {
+  GridMatrix(int n, int bs) : BlockMatrix(n*n, bs) {
+    rowPtr.push_back(0);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        const int row = i*n+j;
+        vector<int> neighbors;
+        if (i > 0)   neighbors.push_back(row-n);
+        if (j > 0)   neighbors.push_back(row-1);
+        neighbors.push_back(row);
+        if (j+1 < n) neighbors.push_back(row+1);
+        if (i+1 < n) neighbors.push_back(row+n);
+        for (int col : neighbors) {
+          colIdx.push_back(col);
+          for (int bi = 0; bi < bs; ++bi) {
+            for (int bj = 0; bj < bs; ++bj) {
+              double val = (bi == bj) ? -1.0 : 0.0;
+              if (col == row) {
+                val = (2 + row%3) * ((bi == bj) ? 12.0
+                                                : 2.0*((bi+bj+row)%3 - 1));
+              }
+              vals.push_back(val);
+            }
+          }
+        }
+        rowPtr.push_back(colIdx.size());
+      }
+    }
+  }
+};
+
+TEST(BlockCG, preconditioners) {
+  for (int bs : {1, 3, 5}) {
+    GridMatrix A(12, bs);
+    vector<double> b(A.numRows*bs);
+    for (size_t i = 0; i < b.size(); ++i) {
+      b[i] = (double)(i % 5) - 2.0;
+    }
+
+    SolverSettings settings;
+    settings.tolerance = 1e-10;
+    settings.maxIterations = 1000;
+    vector<int> iterations;
+    for (Preconditioner preconditioner : {Preconditioner::Identity,
+                                          Preconditioner::Jacobi,
+                                          Preconditioner::BlockJacobi}) {
+      settings.preconditioner = preconditioner;
+      vector<double> x(b.size(), 42.0);
+      SolverStatistics statistics = A.solve(b, x, settings);
+      ASSERT_TRUE(statistics.converged);
+      ASSERT_LE(statistics.error, 1e-10);
+      ASSERT_LT(A.residual(b, x), 5e-10);
+      iterations.push_back(statistics.iterations);
+
+      // Warm starting from the solution converges without iterating
+      settings.warmStart = true;
+      ASSERT_EQ(0, A.solve(b, x, settings).iterations);
+      settings.warmStart = false;
+    }
+    if (bs > 1) {
+      ASSERT_LT(iterations[2], iterations[1]);
+    }
+  }
+}
+
+TEST(BlockCG, lowerTriangle) {
+  GridMatrix A(8, 2);
+  vector<double> b(A.numRows*2, 1.0);
+  SolverSettings settings;
+  settings.tolerance = 1e-12;
+  settings.maxIterations = 1000;
+  vector<double> expected(b.size());
+  A.solve(b, expected, settings);
+
+  // Blocks above the diagonal are not read
+  for (int i = 0; i < A.numRows; ++i) {
+    for (int ij = A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      if (A.colIdx[ij] > i) {
+        A.vals[ij*4] = 100.0;
+      }
+      else if (A.colIdx[ij] == i) {
+        A.vals[ij*4+1] = -100.0;
+      }
+    }
+  }
+  vector<double> actual(b.size());
+  A.solve(b, actual, settings);
+  for (size_t i = 0; i < b.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(expected[i], actual[i]);
+  }
+}
+
+TEST(BlockCG, upperTriangle) {
+  GridMatrix A(8, 3);
+  vector<double> b(A.numRows*3);
+  for (size_t i = 0; i < b.size(); ++i) {
+    b[i] = cos((double)i);
+  }
+  SolverSettings settings;
+  settings.preconditioner = Preconditioner::BlockJacobi;
+  settings.tolerance = 1e-12;
+  settings.maxIterations = 1000;
+  vector<double> expected(b.size());
+  A.solve(b, expected, settings);
+
+  // Keep the blocks on and above the diagonal, like an upper triangular index,
+  // and taint the lower triangles of the diagonal blocks, which are not read
+  GridMatrix upper = A;
+  upper.colIdx.clear();
+  upper.vals.clear();
+  for (int i = 0; i < A.numRows; ++i) {
+    upper.rowPtr[i] = upper.colIdx.size();
+    for (int ij = A.rowPtr[i]; ij < A.rowPtr[i+1]; ++ij) {
+      if (A.colIdx[ij] >= i) {
+        upper.colIdx.push_back(A.colIdx[ij]);
+        for (int k = 0; k < 9; ++k) {
+          bool lower = A.colIdx[ij] == i && k/3 > k%3;
+          upper.vals.push_back(lower ? 100.0 : A.vals[ij*9+k]);
+        }
+      }
+    }
+  }
+  upper.rowPtr[A.numRows] = upper.colIdx.size();
+
+  vector<double> actual(b.size());
+  SolverStatistics statistics = upper.solve(b, actual, settings, true);
+  ASSERT_TRUE(statistics.converged);
+  for (size_t i = 0; i < b.size(); ++i) {
+    ASSERT_NEAR(expected[i], actual[i], 1e-9);
+  }
+}
+
+TEST(BlockCG, threads) {
+  // Large enough to be split over several threads
+  GridMatrix A(120, 3);
+  vector<double> b(A.numRows*3);
+  for (size_t i = 0; i < b.size(); ++i) {
+    b[i] = sin((double)i);
+  }
+  SolverSettings settings;
+  settings.preconditioner = Preconditioner::BlockJacobi;
+  settings.tolerance = 1e-10;
+  settings.maxIterations = 1000;
+
+  settings.numThreads = 1;
+  vector<double> serial(b.size());
+  SolverStatistics serialStatistics = A.solve(b, serial, settings);
+  ASSERT_TRUE(serialStatistics.converged);
+
+  settings.numThreads = 4;
+  vector<double> parallel(b.size());
+  SolverStatistics parallelStatistics = A.solve(b, parallel, settings);
+  ASSERT_TRUE(parallelStatistics.converged);
+  ASSERT_LT(A.residual(b, parallel), 5e-10);
+  ASSERT_NEAR(serialStatistics.iterations, parallelStatistics.iterations, 1);
+  for (size_t i = 0; i < b.size(); ++i) {
+    ASSERT_NEAR(serial[i], parallel[i], 1e-8);
+  }
+
+  // Too few iterations are reported as not converged
+  settings.maxIterations = 3;
+  SolverStatistics statistics = A.solve(b, parallel, settings);
+  ASSERT_FALSE(statistics.converged);
+  ASSERT_EQ(3, statistics.iterations);
+}
@@ -0,0 +1,65 @@
+#ifndef SIMIT_BLOCK_MATRIX_H
+#define SIMIT_BLOCK_MATRIX_H
+
+#include <cmath>
+#include <vector>
+
+#include "block_cg.h"
+
+/// The norm of b - y relative to the norm of b, where y = A*x is computed
+/// from the solution x of A*x = b.
+inline double relativeResidual(const std::vector<double>& b,
+                               const std::vector<double>& y) {
+  double rr = 0.0;
+  double bb = 0.0;
+  for (size_t i = 0; i < b.size(); ++i) {
+    rr += (b[i]-y[i]) * (b[i]-y[i]);
+    bb += b[i]*b[i];
+  }
+  return std::sqrt(rr/bb);
+}
+
+/// A square blocked CSR matrix with blocks of size blockSize x blockSize,
+/// stored like the matrices Simit assembles. The solver tests derive their
+/// matrices from it and fill in the rows.
+struct BlockMatrix {
+  int numRows;
+  int blockSize;
+  std::vector<int> rowPtr;
+  std::vector<int> colIdx;
+  std::vector<double> vals;
+
+  BlockMatrix(int numRows, int blockSize)
+      : numRows(numRows), blockSize(blockSize) {}
+
+  std::vector<double> multiply(const std::vector<double>& x) const {
+    const int bs = blockSize;
+    std::vector<double> y(numRows*bs, 0.0);
+    for (int i = 0; i < numRows; ++i) {
+      for (int ij = rowPtr[i]; ij < rowPtr[i+1]; ++ij) {
+        for (int bi = 0; bi < bs; ++bi) {
+          for (int bj = 0; bj < bs; ++bj) {
+            y[i*bs+bi] += vals[(ij*bs+bi)*bs+bj] * x[colIdx[ij]*bs+bj];
+          }
+        }
+      }
+    }
+    return y;
+  }
+
+  double residual(const std::vector<double>& b,
+                  const std::vector<double>& x) const {
+    return relativeResidual(b, multiply(x));
+  }
+
+  simit::SolverStatistics solve(const std::vector<double>& b,
+                                std::vector<double>& x,
+                                const simit::SolverSettings& settings,
+                                bool upperTriangular=false) const {
+    return simit::blockCG(numRows, blockSize, rowPtr.data(), colIdx.data(),
+                          vals.data(), b.data(), x.data(), upperTriangular,
+                          settings);
+  }
+};
+
+#endif
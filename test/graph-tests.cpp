@@ -228,6 +228,169 @@ TEST(Field, boolean) {
   ASSERT_TRUE(b(p1));
 }
 
+TEST(Field, AoSLayout) {
+  Set points;
+  FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
+  FieldRef<simit_float>   m = points.addField<simit_float>("m");
+  FieldRef<int>           c = points.addField<int>("c");
+
+  vector<ElementRef> refs;
+  for (int i=0; i < 10; ++i) {
+    refs.push_back(points.add());
+    x.set(refs[i], {(simit_float)i, (simit_float)i+0.1, (simit_float)i+0.2});
+    m.set(refs[i], 100.0+i);
+  }
+
+  points.setFieldLayout({"x", "m"}, FieldLayout::AoS);
+  ASSERT_EQ(FieldLayout::AoS, points.getFieldLayout("x"));
+  ASSERT_EQ(FieldLayout::AoS, points.getFieldLayout("m"));
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("c"));
+  ASSERT_TRUE(points.hasFieldLayout({"x", "m"}, FieldLayout::AoS));
+  ASSERT_FALSE(points.hasFieldLayout({"x"}, FieldLayout::AoS));
+
+  // The fields are interleaved in one buffer
+  simit_float *data = static_cast<simit_float*>(points.getFieldData("x"));
+  ASSERT_EQ(data, points.getFieldData("m"));
+  SIMIT_ASSERT_FLOAT_EQ(1.0, data[4]);
+  SIMIT_ASSERT_FLOAT_EQ(1.2, data[6]);
+  SIMIT_ASSERT_FLOAT_EQ(101.0, data[7]);
+
+  // Field references to interleaved fields
+  for (int i=0; i < 10; ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(i+0.1, x.get(refs[i])(1));
+    SIMIT_ASSERT_FLOAT_EQ(100.0+i, m.get(refs[i]));
+  }
+
+  // Grow the set past its capacity
+  for (int i=10; i < 2000; ++i) {
+    refs.push_back(points.add());
+    x.set(refs[i], {(simit_float)i, (simit_float)i+0.1, (simit_float)i+0.2});
+    m.set(refs[i], 100.0+i);
+  }
+  SIMIT_ASSERT_FLOAT_EQ(1999.2, x.get(refs[1999])(2));
+  SIMIT_ASSERT_FLOAT_EQ(2099.0, m.get(refs[1999]));
+
+  // Moving m to a separate array also moves the rest of its group
+  points.setFieldLayout({"m"}, FieldLayout::SoA);
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("x"));
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("m"));
+  for (int i=0; i < 2000; ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(i+0.2, x.get(refs[i])(2));
+    SIMIT_ASSERT_FLOAT_EQ(100.0+i, m.get(refs[i]));
+  }
+}
+
+TEST(Field, AoSoALayout) {
+  Set points;
+  FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
+  FieldRef<simit_float>   m = points.addField<simit_float>("m");
+
+  vector<ElementRef> refs;
+  for (int i=0; i < 20; ++i) {
+    refs.push_back(points.add());
+    x.set(refs[i], {(simit_float)i, (simit_float)i+0.1, (simit_float)i+0.2});
+    m.set(refs[i], 100.0+i);
+  }
+
+  points.setFieldLayout({"x", "m"}, FieldLayout::AoSoA, 4);
+  ASSERT_TRUE(points.hasFieldLayout({"x", "m"}, FieldLayout::AoSoA, 4));
+  ASSERT_FALSE(points.hasFieldLayout({"x", "m"}, FieldLayout::AoSoA, 8));
+
+  // Element 5 is the second element of the second tile of 4*(3+1) components
+  simit_float *data = static_cast<simit_float*>(points.getFieldData("x"));
+  SIMIT_ASSERT_FLOAT_EQ(5.0, data[16+0*4+1]);
+  SIMIT_ASSERT_FLOAT_EQ(5.1, data[16+1*4+1]);
+  SIMIT_ASSERT_FLOAT_EQ(5.2, data[16+2*4+1]);
+  SIMIT_ASSERT_FLOAT_EQ(105.0, data[16+3*4+1]);
+
+  TensorRef<simit_float,3> x7 = x.get(refs[7]);
+  x7(1) = 42.0;
+  SIMIT_ASSERT_FLOAT_EQ(42.0, x.get(refs[7])(1));
+  SIMIT_ASSERT_FLOAT_EQ(7.2, x.get(refs[7])(2));
+
+  // Removing an element moves the last element into its place
+  points.remove(refs[3]);
+  ASSERT_EQ(19, points.getSize());
+  SIMIT_ASSERT_FLOAT_EQ(19.1, x.get(refs[3])(1));
+  SIMIT_ASSERT_FLOAT_EQ(119.0, m.get(refs[3]));
+
+  points.setFieldLayout({"x", "m"}, FieldLayout::SoA);
+  SIMIT_ASSERT_FLOAT_EQ(42.0, x.get(refs[7])(1));
+  SIMIT_ASSERT_FLOAT_EQ(119.0, m.get(refs[3]));
+}
+
+TEST(Field, setFieldLayouts) {
+  Set points;
+  FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
+  FieldRef<simit_float>   m = points.addField<simit_float>("m");
+  FieldRef<simit_float>   c = points.addField<simit_float>("c");
+
+  vector<ElementRef> refs;
+  for (int i=0; i < 10; ++i) {
+    refs.push_back(points.add());
+    x.set(refs[i], {(simit_float)i, (simit_float)i+0.1, (simit_float)i+0.2});
+    m.set(refs[i], 100.0+i);
+    c.set(refs[i], 200.0+i);
+  }
+  points.setFieldLayout({"m", "c"}, FieldLayout::AoS);
+
+  // Groups that are not given are split, and groups of other element types
+  // are ignored
+  points.setFieldLayouts("Point",
+                         {FieldGroup("Point", {"x", "m"}, FieldLayout::AoS),
+                          FieldGroup("Spring", {"c"}, FieldLayout::AoS)});
+  ASSERT_TRUE(points.hasFieldLayout({"x", "m"}, FieldLayout::AoS));
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("c"));
+  void *data = points.getFieldData("x");
+
+  // Groups that are already formed are kept
+  points.setFieldLayouts("Point",
+                         {FieldGroup("Point", {"x", "m"}, FieldLayout::AoS)});
+  ASSERT_EQ(data, points.getFieldData("x"));
+
+  points.setFieldLayouts("Point", {});
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("x"));
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("m"));
+  for (int i=0; i < 10; ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(i+0.2, x.get(refs[i])(2));
+    SIMIT_ASSERT_FLOAT_EQ(100.0+i, m.get(refs[i]));
+    SIMIT_ASSERT_FLOAT_EQ(200.0+i, c.get(refs[i]));
+  }
+}
+
+TEST(Field, Alignment) {
+  Set points;
+  Set springs(points, points);
+  FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
+  FieldRef<int> id = points.addField<int>("id");
+
+  // Field data and endpoints stay aligned, and keep their values, as the sets
+  // grow
+  vector<ElementRef> refs;
+  for (int i=0; i < 10000; ++i) {
+    refs.push_back(points.add());
+    x.set(refs[i], {(simit_float)i, 0.0, 0.0});
+    id.set(refs[i], i);
+    if (i > 0) {
+      springs.add(refs[i-1], refs[i]);
+    }
+    ASSERT_EQ(0u, (uintptr_t)points.getFieldData("x") % kArrayAlignment);
+    ASSERT_EQ(0u, (uintptr_t)points.getFieldData("id") % kArrayAlignment);
+    ASSERT_EQ(0u, (uintptr_t)springs.getEndpointsData() % kArrayAlignment);
+  }
+  for (int i=0; i < 10000; ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(i, x.get(refs[i])(0));
+    ASSERT_EQ(i, id.get(refs[i]));
+    if (i > 0) {
+      ASSERT_EQ(i-1, springs.getEndpointsData()[2*(i-1)]);
+      ASSERT_EQ(i, springs.getEndpointsData()[2*(i-1)+1]);
+    }
+  }
+
+  points.setFieldLayout({"x"}, FieldLayout::AoSoA, 4);
+  ASSERT_EQ(0u, (uintptr_t)points.getFieldData("x") % kArrayAlignment);
+}
+
 TEST(EdgeSet, CreateAndGetEdge) {
   Set points;
 
@@ -287,6 +450,50 @@ TEST(EdgeSet, EdgeIteratorTest) {
   ASSERT_EQ(count, 4);
 }
 
+TEST(EdgeSet, LatticeLinks) {
+  Set points;
+  FieldRef<simit_float> x = points.addField<simit_float>("x");
+  Set links(points, {3,2});
+  FieldRef<simit_float> a = links.addField<simit_float>("a");
+
+  ASSERT_EQ(6, points.getSize());
+  ASSERT_EQ(12, links.getSize());
+  ASSERT_EQ(nullptr, links.getEndpointsData());
+
+  ElementRef p10 = links.getLatticePoint({1,0});
+  ElementRef p20 = links.getLatticePoint({2,0});
+  ElementRef p11 = links.getLatticePoint({1,1});
+  ElementRef p01 = links.getLatticePoint({0,1});
+  ElementRef p21 = links.getLatticePoint({2,1});
+  x.set(p11, 1.1);
+  SIMIT_ASSERT_FLOAT_EQ(1.1, x.get(p11));
+
+  // Links connect a point to the next point in their direction, and wrap around
+  // at the lattice boundaries
+  ElementRef l100 = links.getLatticeLink({1,0},0);
+  ASSERT_EQ(p10, links.getEndpoint(l100,0));
+  ASSERT_EQ(p20, links.getEndpoint(l100,1));
+  ElementRef l101 = links.getLatticeLink({1,0},1);
+  ASSERT_EQ(p10, links.getEndpoint(l101,0));
+  ASSERT_EQ(p11, links.getEndpoint(l101,1));
+  ElementRef l210 = links.getLatticeLink({2,1},0);
+  ASSERT_EQ(p21, links.getEndpoint(l210,0));
+  ASSERT_EQ(p01, links.getEndpoint(l210,1));
+  ElementRef l111 = links.getLatticeLink({1,1},1);
+  ASSERT_EQ(p11, links.getEndpoint(l111,0));
+  ASSERT_EQ(p10, links.getEndpoint(l111,1));
+
+  a.set(l111, 2.2);
+  SIMIT_ASSERT_FLOAT_EQ(2.2, a.get(l111));
+
+  int count = 0;
+  for (auto &ep : links.getEndpoints(l101)) {
+    ASSERT_EQ((count == 0) ? p10 : p11, ep);
+    count++;
+  }
+  ASSERT_EQ(2, count);
+}
+
 TEST(GraphGenerator, createBox) {
   Set points;
   Set edges(points, points);
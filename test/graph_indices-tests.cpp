@@ -2,6 +2,9 @@
 
 #include "graph.h"
 #include "graph_indices.h"
+#include "index_files.h"
+#include "init.h"
+#include "temporary_directory.h"
 
 using namespace std;
 using namespace simit;
@@ -77,3 +80,126 @@ TEST(NeighborIndex, triangles) {
   ASSERT_EQ(nIndex.getNumNeighbors(p1), 4);
   ASSERT_EQ(nIndex.getNeighbors(p1)[0], 0);
 }
+
+TEST(NeighborIndex, saveLoad) {
+  Set points;
+  auto p0 = points.add();
+  auto p1 = points.add();
+  auto p2 = points.add();
+
+  Set edges(points, points);
+  edges.add(p0, p1);
+  edges.add(p1, p2);
+
+  TemporaryDirectory dir;
+  ASSERT_FALSE(dir.getPath().empty());
+  std::string filename = dir.getFile("neighbor_index_test.idx");
+  internal::NeighborIndex nIndex(edges);
+  ASSERT_TRUE(nIndex.save(edges, filename));
+
+  internal::NeighborIndex *loaded = internal::NeighborIndex::load(edges,
+                                                                  filename);
+  ASSERT_NE(nullptr, loaded);
+  ASSERT_EQ(nIndex.getSize(), loaded->getSize());
+  for (auto p : points) {
+    ASSERT_EQ(nIndex.getNumNeighbors(p), loaded->getNumNeighbors(p));
+    for (int i=0; i < nIndex.getNumNeighbors(p); ++i) {
+      ASSERT_EQ(nIndex.getNeighbors(p)[i], loaded->getNeighbors(p)[i]);
+    }
+  }
+  delete loaded;
+
+  // The index must not be loaded for an edge set with different endpoints
+  Set otherEdges(points, points);
+  otherEdges.add(p0, p1);
+  otherEdges.add(p0, p2);
+  ASSERT_EQ(nullptr, internal::NeighborIndex::load(otherEdges, filename));
+}
+
+TEST(NeighborIndex, indexCacheDir) {
+  Set points;
+  auto p0 = points.add();
+  auto p1 = points.add();
+  auto p2 = points.add();
+
+  Set edges(points, points);
+  edges.add(p0, p1);
+  edges.add(p1, p2);
+
+  // Neighbor indices are saved to the index cache directory, and loaded from
+  // it for edge sets with the same endpoints
+  TemporaryDirectory dir;
+  ASSERT_FALSE(dir.getPath().empty());
+  ScopedSetting<std::string> indexCacheDir(kIndexCacheDir, dir.getPath());
+  const internal::NeighborIndex* built = edges.getNeighborIndex();
+  std::string filename = internal::getIndexFilename(
+      dir.getPath(), internal::IndexFileKind::NeighborIndex,
+      internal::fingerprint(edges));
+  ASSERT_EQ(0, access(filename.c_str(), F_OK));
+
+  Set sameEdges(points, points);
+  sameEdges.add(p0, p1);
+  sameEdges.add(p1, p2);
+  const internal::NeighborIndex* loaded = sameEdges.getNeighborIndex();
+  ASSERT_EQ(built->getSize(), loaded->getSize());
+  for (auto p : points) {
+    ASSERT_EQ(built->getNumNeighbors(p), loaded->getNumNeighbors(p));
+  }
+}
+
+TEST(LocationTable, upperTriangularTriangles) {
+  Set points;
+  auto p0 = points.add();
+  auto p1 = points.add();
+  auto p2 = points.add();
+  auto p3 = points.add();
+
+  Set edges(points, points, points);
+  edges.add(p0, p1, p2);
+  edges.add(p1, p2, p3);
+
+  // An upper triangular index, that only stores the neighbors of every
+  // vertex at or after it
+  const vector<uint32_t> coords = {0, 3, 6, 8, 9};
+  const vector<uint32_t> sinks  = {0, 1, 2,  1, 2, 3,  2, 3,  3};
+
+  vector<int> locations;
+  computeLocationTable(edges, coords.data(), sinks.data(), locations);
+  const vector<int> expected = {
+       0,  1,  2,   -1,  3,  4,   -1, -1,  6,   // edge (p0,p1,p2)
+       3,  4,  5,   -1,  6,  7,   -1, -1,  8};  // edge (p1,p2,p3)
+  ASSERT_EQ(expected, locations);
+}
+
+TEST(LocationTable, neighborIndex) {
+  Set points;
+  auto p0 = points.add();
+  auto p1 = points.add();
+  auto p2 = points.add();
+
+  Set edges(points, points);
+  edges.add(p1, p0);
+  edges.add(p1, p2);
+
+  // Every endpoint of an edge is a neighbor of the others in a full index
+  NeighborIndex index(edges);
+  const int numVertices = points.getSize();
+  vector<uint32_t> coords(index.getStartIndex(),
+                          index.getStartIndex() + numVertices + 1);
+  vector<uint32_t> sinks(index.getNeighborIndex(),
+                         index.getNeighborIndex() + coords[numVertices]);
+
+  vector<int> locations;
+  computeLocationTable(edges, coords.data(), sinks.data(), locations);
+  ASSERT_EQ(8u, locations.size());
+  for (int e = 0; e < edges.getSize(); ++e) {
+    for (int i = 0; i < 2; ++i) {
+      for (int j = 0; j < 2; ++j) {
+        int location = locations[(e*2 + i)*2 + j];
+        ASSERT_GE(location, (int)coords[edges.getEndpointLocation(e, i)]);
+        ASSERT_LT(location, (int)coords[edges.getEndpointLocation(e, i)+1]);
+        ASSERT_EQ((uint32_t)edges.getEndpointLocation(e, j), sinks[location]);
+      }
+    }
+  }
+}
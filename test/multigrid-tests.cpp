@@ -0,0 +1,182 @@
+#include "simit-test.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "block_matrix.h"
+#include "multigrid.h"
+
+using namespace std;
+using namespace simit;
+
+// The stencil matrix of a periodic Laplacian with a small mass term on a
+// lattice of the given dimensions, with blocks of size bs x bs that couple
+// their components on the diagonal.
+struct PoissonStencil {
+  StencilStructure structure;
+  vector<double> vals;
+
+  PoissonStencil(const vector<int>& dims, int bs) {
+    structure.dims = dims;
+    structure.blockSize = bs;
+    const int numDims = dims.size();
+    structure.offsets.push_back(vector<int>(numDims, 0));
+    for (int d = 0; d < numDims; ++d) {
+      for (int s : {-1, 1}) {
+        vector<int> offset(numDims, 0);
+        offset[d] = s;
+        structure.offsets.push_back(offset);
+      }
+    }
+    const int numPoints = structure.getNumPoints();
+    for (int i = 0; i < numPoints; ++i) {
+      for (size_t e = 0; e < structure.offsets.size(); ++e) {
+        for (int bi = 0; bi < bs; ++bi) {
+          for (int bj = 0; bj < bs; ++bj) {
+            double val = (bi == bj) ? -1.0 : 0.0;
+            if (e == 0) {
+              val = (bi == bj) ? 2.0*numDims + 0.1 : 0.05;
+            }
+            vals.push_back(val);
+          }
+        }
+      }
+    }
+  }
+
+  vector<double> rhs() const {
+    vector<double> b(structure.getNumPoints()*structure.blockSize);
+    for (size_t i = 0; i < b.size(); ++i) {
+      b[i] = sin(0.1*i) + (double)(i % 7) - 3.0;
+    }
+    return b;
+  }
+
+  double residual(const vector<double>& b, const vector<double>& x) const {
+    GeometricMultigrid<double> multigrid(structure);
+    multigrid.setup(vals.data());
+    vector<double> r(b.size());
+    multigrid.multiply(x.data(), r.data());
+    return relativeResidual(b, r);
+  }
+};
+
+TEST(Multigrid, hierarchy) {
+  PoissonStencil A({64, 32}, 1);
+  GeometricMultigrid<double> multigrid(A.structure);
+  ASSERT_EQ(4, multigrid.getNumLevels());
+  ASSERT_EQ(vector<int>({8, 4}), multigrid.getDimensions(3));
+
+  // Odd dimensions are not coarsened
+  PoissonStencil B({64, 5}, 1);
+  GeometricMultigrid<double> semicoarsened(B.structure);
+  ASSERT_EQ(vector<int>({8, 5}), semicoarsened.getDimensions(3));
+}
+
+TEST(Multigrid, solve) {
+  for (int bs : {1, 2}) {
+    PoissonStencil A({32, 32}, bs);
+    vector<double> b = A.rhs();
+
+    SolverSettings settings;
+    settings.tolerance = 1e-10;
+    settings.maxIterations = 1000;
+    vector<int> iterations;
+    for (Preconditioner preconditioner : {Preconditioner::Identity,
+                                          Preconditioner::BlockJacobi,
+                                          Preconditioner::Multigrid}) {
+      settings.preconditioner = preconditioner;
+      vector<double> x(b.size());
+      SolverStatistics statistics =
+          solveStencil(A.structure, A.vals.data(), b.data(), x.data(),
+                       settings);
+      ASSERT_TRUE(statistics.converged);
+      ASSERT_LT(A.residual(b, x), 1e-9);
+      iterations.push_back(statistics.iterations);
+    }
+    ASSERT_LT(iterations[2], iterations[0] / 4);
+
+    // V-cycles converge on their own
+    settings.method = KrylovMethod::Richardson;
+    vector<double> x(b.size());
+    SolverStatistics statistics =
+        solveStencil(A.structure, A.vals.data(), b.data(), x.data(), settings);
+    ASSERT_TRUE(statistics.converged);
+    ASSERT_LT(A.residual(b, x), 1e-9);
+  }
+}
+
+TEST(Multigrid, gridIndependence) {
+  SolverSettings settings;
+  settings.preconditioner = Preconditioner::Multigrid;
+  settings.tolerance = 1e-8;
+  settings.maxIterations = 1000;
+  for (KrylovMethod method : {KrylovMethod::CG, KrylovMethod::Richardson}) {
+    settings.method = method;
+    for (int numDims : {2, 3}) {
+      vector<int> iterations;
+      for (int n : {16, 32, 64}) {
+        if (numDims == 3 && n > 32) {
+          break;
+        }
+        PoissonStencil A(vector<int>(numDims, n), 1);
+        vector<double> b = A.rhs();
+        vector<double> x(b.size());
+        SolverStatistics statistics =
+            solveStencil(A.structure, A.vals.data(), b.data(), x.data(),
+                         settings);
+        ASSERT_TRUE(statistics.converged);
+        iterations.push_back(statistics.iterations);
+      }
+      for (int count : iterations) {
+        ASSERT_LE(count, iterations.front() + 3);
+      }
+    }
+  }
+}
+
+TEST(Multigrid, concurrentSolves) {
+  SolverSettings settings;
+  settings.preconditioner = Preconditioner::Multigrid;
+  settings.tolerance = 1e-10;
+  settings.maxIterations = 1000;
+
+  // Threads that solve matrices with the same structure share a hierarchy,
+  // which each sets up with its own values
+  const int numThreads = 4;
+  vector<PoissonStencil> matrices;
+  for (int t = 0; t < numThreads; ++t) {
+    matrices.push_back(PoissonStencil({32, 32}, 1));
+    for (double& val : matrices.back().vals) {
+      val *= t+1;
+    }
+  }
+  vector<double> b = matrices[0].rhs();
+  vector<vector<double>> xs(numThreads, vector<double>(b.size()));
+  vector<SolverStatistics> statistics(numThreads);
+  vector<thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.push_back(thread([&, t]() {
+      for (int run = 0; run < 10; ++run) {
+        statistics[t] = solveStencil(matrices[t].structure,
+                                     matrices[t].vals.data(), b.data(),
+                                     xs[t].data(), settings);
+      }
+    }));
+  }
+  for (thread& t : threads) {
+    t.join();
+  }
+  for (int t = 0; t < numThreads; ++t) {
+    ASSERT_TRUE(statistics[t].converged);
+    ASSERT_LT(matrices[t].residual(b, xs[t]), 1e-9);
+  }
+
+  // Freed hierarchies are rebuilt
+  freeStencilSolverCaches();
+  vector<double> x(b.size());
+  ASSERT_TRUE(solveStencil(matrices[0].structure, matrices[0].vals.data(),
+                           b.data(), x.data(), settings).converged);
+  ASSERT_LT(matrices[0].residual(b, x), 1e-9);
+}
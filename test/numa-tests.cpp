@@ -0,0 +1,77 @@
+#include "simit-test.h"
+
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+#include "graph.h"
+#include "numa.h"
+#include "partition.h"
+#include "reorder.h"
+
+using namespace std;
+using namespace simit;
+
+static size_t sum(const vector<size_t>& placement) {
+  return accumulate(placement.begin(), placement.end(), (size_t)0);
+}
+
+TEST(Numa, placement) {
+  ASSERT_GE(getNumNumaNodes(), 1);
+
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  const int size = 100000;
+  for (int i = 0; i < size; ++i) {
+    x.set(points.add(), {(double)i, 0.0, 0.0});
+  }
+  void* data = points.getFieldData("x");
+  const size_t bytes = size * 3 * sizeof(double);
+  vector<size_t> placement = getMemoryPlacement(data, bytes);
+  ASSERT_EQ((size_t)getNumNumaNodes(), placement.size());
+
+  // Placement moves pages between nodes, but keeps their contents
+  size_t resident = sum(placement);
+  ASSERT_LE(resident, bytes);
+  interleaveMemory(data, bytes);
+  ASSERT_EQ(resident, sum(getMemoryPlacement(data, bytes)));
+  bindMemory(data, bytes, getNumNumaNodes()-1);
+  ASSERT_EQ(resident, sum(getMemoryPlacement(data, bytes)));
+  for (int i = 0; i < size; ++i) {
+    ASSERT_EQ(i, x.get(points.getElementAt(i))(0));
+  }
+
+  stringstream report;
+  printMemoryPlacement(report, points);
+  ASSERT_NE(string::npos, report.str().find("x:"));
+}
+
+TEST(Numa, partition) {
+  const int n = 64;
+  Set points;
+  Set springs(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  vector<ElementRef> p;
+  for (int i = 0; i < n*n; ++i) {
+    p.push_back(points.add());
+    id.set(p.back(), i);
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (j+1 < n) springs.add(p[i*n+j], p[i*n+j+1]);
+      if (i+1 < n) springs.add(p[i*n+j], p[(i+1)*n+j]);
+    }
+  }
+
+  Partitioning partitioning;
+  partitionGraph(points, 4, partitioning);
+  reorderByPartition(points, partitioning);
+  placeByPartition(points, partitioning);
+  for (int i = 0; i < n*n; ++i) {
+    ASSERT_EQ(i, id.get(p[i]));
+  }
+
+  stringstream report;
+  printMemoryPlacement(report, springs);
+  ASSERT_NE(string::npos, report.str().find("endpoints:"));
+}
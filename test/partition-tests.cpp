@@ -0,0 +1,124 @@
+#include "simit-test.h"
+
+#include <vector>
+
+#include "graph.h"
+#include "partition.h"
+#include "reorder.h"
+
+using namespace std;
+using namespace simit;
+
+// An n x n grid of points, connected by springs along the grid lines and by
+// triangles in every cell
+static void createGrid(Set& points, Set& springs, Set& triangles, int n,
+                       FieldRef<int>& id) {
+  vector<ElementRef> p;
+  for (int i = 0; i < n*n; ++i) {
+    p.push_back(points.add());
+    id.set(p.back(), i);
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (j+1 < n) springs.add(p[i*n+j], p[i*n+j+1]);
+      if (i+1 < n) springs.add(p[i*n+j], p[(i+1)*n+j]);
+      if (i+1 < n && j+1 < n) {
+        triangles.add(p[i*n+j], p[i*n+j+1], p[(i+1)*n+j+1]);
+      }
+    }
+  }
+}
+
+TEST(Partition, grid) {
+  const int n = 32;
+  const int k = 4;
+  Set points;
+  Set springs(points, points);
+  Set triangles(points, points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  createGrid(points, springs, triangles, n, id);
+
+  Partitioning partitioning;
+  partitionGraph(points, k, partitioning);
+  ASSERT_EQ(k, partitioning.numPartitions);
+  ASSERT_EQ((size_t)n*n, partitioning.vertexPartitions.size());
+
+  // Parts are balanced, and cut far fewer edges than a random partitioning
+  vector<int> partSizes(k, 0);
+  for (int p : partitioning.vertexPartitions) {
+    ASSERT_TRUE(p >= 0 && p < k);
+    ++partSizes[p];
+  }
+  for (int size : partSizes) {
+    ASSERT_LE(size, 1.03 * n*n / k + 1);
+  }
+  ASSERT_GT(partitioning.edgeCut, 0);
+  ASSERT_LT(partitioning.edgeCut, 8*n);
+
+  // Edges belong to the lowest partition of their endpoints
+  for (const Set* edgeSet : {(const Set*)&springs, (const Set*)&triangles}) {
+    const vector<int>& edgePartitions =
+        partitioning.edgePartitions.at(edgeSet);
+    const int cardinality = edgeSet->getCardinality();
+    const int* endpoints = edgeSet->getEndpointsData();
+    ASSERT_EQ((size_t)edgeSet->getSize(), edgePartitions.size());
+    for (int e = 0; e < edgeSet->getSize(); ++e) {
+      int lowest = k;
+      for (int j = 0; j < cardinality; ++j) {
+        lowest = min(lowest,
+                     partitioning.vertexPartitions[endpoints[e*cardinality+j]]);
+      }
+      ASSERT_EQ(lowest, edgePartitions[e]);
+    }
+  }
+
+  // Store every partition contiguously
+  vector<int> partitionOfId(n*n);
+  for (int i = 0; i < n*n; ++i) {
+    partitionOfId[id.get(points.getElementAt(i))] =
+        partitioning.vertexPartitions[i];
+  }
+  reorderByPartition(points, partitioning);
+  ASSERT_EQ((size_t)k+1, partitioning.vertexStarts.size());
+  for (int p = 0; p < k; ++p) {
+    ASSERT_EQ(partSizes[p], partitioning.vertexStarts[p+1] -
+                            partitioning.vertexStarts[p]);
+    for (int i = partitioning.vertexStarts[p];
+         i < partitioning.vertexStarts[p+1]; ++i) {
+      ASSERT_EQ(p, partitioning.vertexPartitions[i]);
+      ASSERT_EQ(p, partitionOfId[id.get(points.getElementAt(i))]);
+    }
+  }
+  for (const Set* edgeSet : {(const Set*)&springs, (const Set*)&triangles}) {
+    const vector<int>& edgeStarts = partitioning.edgeStarts.at(edgeSet);
+    const vector<int>& edgePartitions =
+        partitioning.edgePartitions.at(edgeSet);
+    const int cardinality = edgeSet->getCardinality();
+    const int* endpoints = edgeSet->getEndpointsData();
+    ASSERT_EQ(edgeSet->getSize(), edgeStarts[k]);
+    for (int p = 0; p < k; ++p) {
+      for (int e = edgeStarts[p]; e < edgeStarts[p+1]; ++e) {
+        ASSERT_EQ(p, edgePartitions[e]);
+        int lowest = k;
+        for (int j = 0; j < cardinality; ++j) {
+          lowest = min(lowest,
+                       partitioning.vertexPartitions[endpoints[e*cardinality+j]]);
+        }
+        ASSERT_EQ(p, lowest);
+      }
+    }
+  }
+}
+
+TEST(Partition, disconnected) {
+  // Without edges the vertices are split into contiguous blocks
+  Set points;
+  for (int i = 0; i < 10; ++i) {
+    points.add();
+  }
+  Partitioning partitioning;
+  partitionGraph(points, 3, partitioning);
+  ASSERT_EQ(0, partitioning.edgeCut);
+  vector<int> expected = {0, 0, 0, 0, 1, 1, 1, 2, 2, 2};
+  ASSERT_EQ(expected, partitioning.vertexPartitions);
+}
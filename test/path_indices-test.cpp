@@ -1,6 +1,7 @@
 #include "simit-test.h"
 #include "path_indices-tests.h"
 #include "path_expressions-test.h"
+#include "temporary_directory.h"
 
 #include <map>
 #include <set>
@@ -232,6 +233,105 @@ TEST(PathIndex, ExistAnd) {
   VERIFY_INDEX(vevgvIndex, nbrs({{0,2}, {0,2}, {0,2}}));
 }
 
+TEST(PathIndex, Symmetric) {
+  PathIndexBuilder builder;
+
+  simit::Set V;
+  simit::Set E(V,V);
+  createBox(&V, &E, 3, 1, 1);  // v-e-v-e-v
+
+  PathExpression ve = makeVE();
+  PathExpression ev = makeEV();
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+
+  ASSERT_FALSE(isSymmetric(ve));
+  ASSERT_FALSE(isSymmetric(ev));
+
+  Var vi("vi");
+  Var e("e");
+  Var vj("vj");
+  PathExpression vev = And::make({vi,vj}, {{QuantifiedVar::Exist,e}},
+                                 ve(vi, e), ev(e, vj));
+  ASSERT_TRUE(isSymmetric(vev));
+
+  Var vk("vk");
+  PathExpression vevev = And::make({vi,vj}, {{QuantifiedVar::Exist,vk}},
+                                   vev(vi,vk), vev(vk, vj));
+  ASSERT_TRUE(isSymmetric(vevev));
+
+  // Check that vev evaluated backwards gets the same index
+  PathIndex vevIndex = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(vevIndex, nbrs({{0,1}, {0,1,2}, {1,2}}));
+  ASSERT_EQ(vevIndex, builder.buildSegmented(vev, 1));
+
+  // Test the upper triangular vev index
+  PathIndex vevUpperIndex = builder.buildUpperTriangular(vev);
+  VERIFY_INDEX(vevUpperIndex, nbrs({{0,1}, {1,2}, {2}}));
+  ASSERT_EQ(vevUpperIndex, builder.buildUpperTriangular(vev));
+  ASSERT_NE(vevIndex, vevUpperIndex);
+
+  PathIndex vevevUpperIndex = builder.buildUpperTriangular(vevev);
+  VERIFY_INDEX(vevevUpperIndex, nbrs({{0,1,2}, {1,2}, {2}}));
+
+  // The full vev index was built before its upper triangle, so it is kept,
+  // while the full vevev index is not, and is rebuilt when it is needed
+  ASSERT_EQ(vevIndex, builder.buildSegmented(vev, 0));
+  PathIndex vevevIndex = builder.buildSegmented(vevev, 0);
+  VERIFY_INDEX(vevevIndex, nbrs({{0,1,2}, {0,1,2}, {0,1,2}}));
+  ASSERT_EQ(vevevIndex, builder.buildSegmented(vevev, 1));
+}
+
+TEST(PathIndex, SaveLoad) {
+  PathIndexBuilder builder;
+
+  simit::Set V;
+  simit::Set E(V,V);
+  createBox(&V, &E, 3, 1, 1);  // v-e-v-e-v
+
+  PathExpression ve = makeVE();
+  PathExpression ev = makeEV();
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+
+  Var vi("vi");
+  Var e("e");
+  Var vj("vj");
+  PathExpression vev = And::make({vi,vj}, {{QuantifiedVar::Exist,e}},
+                                 ve(vi, e), ev(e, vj));
+
+  TemporaryDirectory dir;
+  ASSERT_FALSE(dir.getPath().empty());
+  string filename = dir.getFile("path_index_test.idx");
+  string upperFilename = dir.getFile("path_index_upper_test.idx");
+  ASSERT_TRUE(builder.save(vev, builder.buildSegmented(vev, 0), filename));
+  ASSERT_TRUE(builder.save(vev, builder.buildUpperTriangular(vev),
+                           upperFilename, true));
+
+  PathIndexBuilder loader;
+  loader.bind("V", &V);
+  loader.bind("E", &E);
+  ASSERT_FALSE(loader.load(vev, filename, true).defined());
+
+  PathIndex vevIndex = loader.load(vev, filename);
+  VERIFY_INDEX(vevIndex, nbrs({{0,1}, {0,1,2}, {1,2}}));
+  ASSERT_EQ(vevIndex, loader.buildSegmented(vev, 0));
+  ASSERT_EQ(vevIndex, loader.buildSegmented(vev, 1));
+
+  PathIndex vevUpperIndex = loader.load(vev, upperFilename, true);
+  VERIFY_INDEX(vevUpperIndex, nbrs({{0,1}, {1,2}, {2}}));
+  ASSERT_EQ(vevUpperIndex, loader.buildUpperTriangular(vev));
+
+  // Indices must not be loaded for a different graph
+  simit::Set V2;
+  simit::Set E2(V2,V2);
+  createBox(&V2, &E2, 4, 1, 1);
+  PathIndexBuilder otherLoader;
+  otherLoader.bind("V", &V2);
+  otherLoader.bind("E", &E2);
+  ASSERT_FALSE(otherLoader.load(vev, filename).defined());
+}
+
 TEST(PathIndex, ExistOr) {
   PathIndexBuilder builder;
 
@@ -0,0 +1,137 @@
+#include "simit-test.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler.h"
+
+using namespace std;
+using namespace simit;
+
+static vector<ProfileRegion> getRegions() {
+  return {ProfileRegion("main", ProfileRegion::Function, -1),
+          ProfileRegion("for i in 0:n", ProfileRegion::Loop, 0),
+          ProfileRegion("map f to \"points\"", ProfileRegion::Map, 1),
+          ProfileRegion("x = solve(A, b)", ProfileRegion::Solve, 0)};
+}
+
+TEST(Profiler, record) {
+  Profiler profiler(getRegions());
+  profiler.record(0, 100, 1100);
+  profiler.record(1, 200, 700);
+  profiler.record(1, 700, 900);
+
+  ASSERT_EQ(1u, profiler.getCount(0));
+  ASSERT_EQ(1000u, profiler.getCycles(0));
+  ASSERT_EQ(2u, profiler.getCount(1));
+  ASSERT_EQ(700u, profiler.getCycles(1));
+  ASSERT_EQ(0u, profiler.getCount(2));
+  ASSERT_EQ(0u, profiler.getCycles(3));
+
+  profiler.reset();
+  ASSERT_EQ(0u, profiler.getCount(0));
+  ASSERT_EQ(0u, profiler.getCycles(1));
+}
+
+TEST(Profiler, selfSeconds) {
+  Profiler profiler(getRegions());
+  profiler.record(0, 0, 1000);
+  profiler.record(1, 0, 600);
+  profiler.record(2, 0, 500);
+  profiler.record(3, 600, 900);
+
+  double cyclesPerSecond = Profiler::getCyclesPerSecond();
+  ASSERT_GT(cyclesPerSecond, 0.0);
+  ASSERT_DOUBLE_EQ(1000 / cyclesPerSecond, profiler.getSeconds(0));
+  ASSERT_DOUBLE_EQ(100 / cyclesPerSecond, profiler.getSelfSeconds(0));
+  ASSERT_DOUBLE_EQ(100 / cyclesPerSecond, profiler.getSelfSeconds(1));
+  ASSERT_DOUBLE_EQ(500 / cyclesPerSecond, profiler.getSelfSeconds(2));
+  ASSERT_DOUBLE_EQ(300 / cyclesPerSecond, profiler.getSelfSeconds(3));
+}
+
+TEST(Profiler, readCycleCounter) {
+  uint64_t start = Profiler::readCycleCounter();
+  uint64_t end = Profiler::readCycleCounter();
+  ASSERT_LE(start, end);
+}
+
+TEST(Profiler, threads) {
+  const int numThreads = 8;
+  const int numRecords = 10000;
+  Profiler profiler(getRegions(), 1024);
+
+  vector<thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.push_back(thread([&profiler]() {
+      for (int i = 0; i < numRecords; ++i) {
+        profiler.record(2, i, i+3);
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  ASSERT_EQ((uint64_t)numThreads*numRecords, profiler.getCount(2));
+  ASSERT_EQ((uint64_t)numThreads*numRecords*3, profiler.getCycles(2));
+  ASSERT_EQ((size_t)numThreads*numRecords - 1024,
+            profiler.getNumDroppedEvents());
+}
+
+TEST(Profiler, print) {
+  Profiler profiler(getRegions());
+  profiler.record(0, 0, 1000);
+  profiler.record(1, 0, 600);
+
+  stringstream ss;
+  profiler.print(ss);
+  string table = ss.str();
+  ASSERT_NE(string::npos, table.find("main"));
+  ASSERT_NE(string::npos, table.find("\n  for i in 0:n"));
+  ASSERT_NE(string::npos, table.find("\n    map f to \"points\""));
+  ASSERT_NE(string::npos, table.find("\n  x = solve(A, b)"));
+}
+
+TEST(Profiler, printJSON) {
+  Profiler profiler(getRegions());
+  profiler.record(2, 0, 500);
+
+  stringstream ss;
+  profiler.printJSON(ss);
+  string json = ss.str();
+  ASSERT_NE(string::npos, json.find("\"name\": \"main\", \"kind\": \"function\""));
+  ASSERT_NE(string::npos,
+            json.find("{\"id\": 2, \"name\": \"map f to \\\"points\\\"\", "
+                      "\"kind\": \"map\", \"parent\": 1, \"count\": 1, "
+                      "\"cycles\": 500"));
+  ASSERT_NE(string::npos, json.find("\"kind\": \"solve\""));
+  ASSERT_NE(string::npos, json.find("\"droppedEvents\": 0"));
+}
+
+TEST(Profiler, printChromeTrace) {
+  Profiler profiler(getRegions(), 2);
+  uint64_t start = Profiler::readCycleCounter();
+  profiler.record(1, start, start+10);
+  profiler.record(3, start+10, start+20);
+  profiler.record(3, start+20, start+30);
+
+  stringstream ss;
+  profiler.printChromeTrace(ss);
+  string trace = ss.str();
+  ASSERT_NE(string::npos, trace.find("\"traceEvents\": ["));
+  ASSERT_NE(string::npos, trace.find("{\"name\": \"for i in 0:n\", "
+                                     "\"cat\": \"loop\", \"ph\": \"X\""));
+  ASSERT_NE(string::npos, trace.find("{\"name\": \"x = solve(A, b)\", "
+                                     "\"cat\": \"solve\", \"ph\": \"X\""));
+
+  // The third event did not fit in the trace
+  ASSERT_EQ(1u, profiler.getNumDroppedEvents());
+  size_t numEvents = 0;
+  for (size_t pos = trace.find("\"ph\""); pos != string::npos;
+       pos = trace.find("\"ph\"", pos+1)) {
+    ++numEvents;
+  }
+  ASSERT_EQ(2u, numEvents);
+}
@@ -3,33 +3,34 @@
 #include <iostream>
 
 #include "graph.h"
+#include "init.h"
 #include "program.h"
 #include "error.h"
 
 using namespace std;
 using namespace simit;
 
-TEST(Program, isprings_simple) {
+/// Builds a 3-chain of springs with the fields of isprings_simple.sim.
+static vector<ElementRef> initIspringsSimple(Set* points, Set* springs) {
   // Points
-  Set points;
-  simit::FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
-  simit::FieldRef<simit_float,3> v = points.addField<simit_float,3>("v");
-  simit::FieldRef<simit_float,3> x2 = points.addField<simit_float,3>("x2");
-  simit::FieldRef<simit_float,3> v2 = points.addField<simit_float,3>("v2");
+  simit::FieldRef<simit_float,3> x = points->addField<simit_float,3>("x");
+  simit::FieldRef<simit_float,3> v = points->addField<simit_float,3>("v");
+  points->addField<simit_float,3>("x2");
+  points->addField<simit_float,3>("v2");
 
-  simit::FieldRef<simit_float,3> ones = points.addField<simit_float,3>("ones");
-  simit::FieldRef<simit_float,3> zeros = points.addField<simit_float,3>("zeros");
+  simit::FieldRef<simit_float,3> ones = points->addField<simit_float,3>("ones");
+  simit::FieldRef<simit_float,3> zeros =
+      points->addField<simit_float,3>("zeros");
 
   // Springs
-  Set springs(points,points);
-  simit::FieldRef<simit_float> m = springs.addField<simit_float>("m");
-  simit::FieldRef<simit_float> l0 = springs.addField<simit_float>("l0");
-  simit::FieldRef<simit_float> k = springs.addField<simit_float>("k");
+  simit::FieldRef<simit_float> m = springs->addField<simit_float>("m");
+  simit::FieldRef<simit_float> l0 = springs->addField<simit_float>("l0");
+  simit::FieldRef<simit_float> k = springs->addField<simit_float>("k");
 
   // Build a 3-chain
-  ElementRef p0 = points.add();
-  ElementRef p1 = points.add();
-  ElementRef p2 = points.add();
+  ElementRef p0 = points->add();
+  ElementRef p1 = points->add();
+  ElementRef p2 = points->add();
 
   x(p0) = {0.0, 0.0, 0.0};
   x(p1) = {1.0, 0.0, 0.0};
@@ -47,8 +48,8 @@ TEST(Program, isprings_simple) {
   ones(p1) = {1.0, 1.0, 1.0};
   ones(p2) = {1.0, 1.0, 1.0};
 
-  ElementRef s0 = springs.add(p0,p1);
-  ElementRef s1 = springs.add(p1,p2);
+  ElementRef s0 = springs->add(p0,p1);
+  ElementRef s1 = springs->add(p1,p2);
 
   // Initialize springs
   simit_float rho = 1.0;
@@ -67,6 +68,27 @@ TEST(Program, isprings_simple) {
   k.set(s0, stiffness);
   k.set(s1, stiffness);
 
+  return {p0, p1, p2};
+}
+
+static void checkIspringsSimple(Set* points, const vector<ElementRef>& p) {
+  simit::FieldRef<simit_float,3> x2 = points->getField<simit_float,3>("x2");
+  SIMIT_ASSERT_FLOAT_EQ(0.10241860338789253, x2(p[0])(0));
+  SIMIT_ASSERT_FLOAT_EQ(0.0,                 x2(p[0])(1));
+  SIMIT_ASSERT_FLOAT_EQ(-0.0103815692520815, x2(p[0])(2));
+  SIMIT_ASSERT_FLOAT_EQ(1.01,                x2(p[1])(0));
+  SIMIT_ASSERT_FLOAT_EQ(0.0,                 x2(p[1])(1));
+  SIMIT_ASSERT_FLOAT_EQ(-0.020763138504163,  x2(p[1])(2));
+  SIMIT_ASSERT_FLOAT_EQ(1.9175813966121074,  x2(p[2])(0));
+  SIMIT_ASSERT_FLOAT_EQ(0.0,                 x2(p[2])(1));
+  SIMIT_ASSERT_FLOAT_EQ(-0.0103815692520815, x2(p[2])(2));
+}
+
+TEST(Program, isprings_simple) {
+  Set points;
+  Set springs(points,points);
+  vector<ElementRef> p = initIspringsSimple(&points, &springs);
+
   // Compile program and bind arguments
   Function func = loadFunction(TEST_FILE_NAME, "main");
   if (!func.defined()) FAIL();
@@ -77,15 +99,38 @@ TEST(Program, isprings_simple) {
   }
 
   // Check outputs
-  SIMIT_ASSERT_FLOAT_EQ(0.10241860338789253, x2(p0)(0));
-  SIMIT_ASSERT_FLOAT_EQ(0.0,                 x2(p0)(1));
-  SIMIT_ASSERT_FLOAT_EQ(-0.0103815692520815, x2(p0)(2));
-  SIMIT_ASSERT_FLOAT_EQ(1.01,                x2(p1)(0));
-  SIMIT_ASSERT_FLOAT_EQ(0.0,                 x2(p1)(1));
-  SIMIT_ASSERT_FLOAT_EQ(-0.020763138504163,  x2(p1)(2));
-  SIMIT_ASSERT_FLOAT_EQ(1.9175813966121074,  x2(p2)(0));
-  SIMIT_ASSERT_FLOAT_EQ(0.0,                 x2(p2)(1));
-  SIMIT_ASSERT_FLOAT_EQ(-0.0103815692520815, x2(p2)(2));
+  checkIspringsSimple(&points, p);
+}
+
+TEST(Program, isprings_simple_field_groups) {
+  Set points;
+  Set springs(points,points);
+  vector<ElementRef> p = initIspringsSimple(&points, &springs);
+
+  // The outputs are interleaved by the application, but not by the function
+  points.setFieldLayout({"x2", "v2"}, FieldLayout::AoS);
+
+  // HACK: Set kFieldGroups for this type of test. Functions are bound with the
+  // groups they were compiled for, even if the setting changes afterwards.
+  vector<FieldGroup> defaults = kFieldGroups;
+  kFieldGroups = {FieldGroup("Point", {"x", "v"}, FieldLayout::AoS),
+                  FieldGroup("Spring", {"k", "l0", "m"}, FieldLayout::AoSoA)};
+  Function func = loadFunction(string(TEST_INPUT_DIR) +
+                               "/program/isprings_simple.sim", "main");
+  kFieldGroups = defaults;
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+  ASSERT_TRUE(points.hasFieldLayout({"x", "v"}, FieldLayout::AoS));
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("x2"));
+  ASSERT_EQ(FieldLayout::SoA, points.getFieldLayout("v2"));
+  ASSERT_TRUE(springs.hasFieldLayout({"k", "l0", "m"}, FieldLayout::AoSoA));
+
+  for (size_t i=0; i < 10; ++i) {
+    func.runSafe();
+  }
+  checkIspringsSimple(&points, p);
 }
 
 TEST(Program, isprings) {
@@ -2,6 +2,7 @@
 
 
 #include "graph.h"
+#include "init.h"
 #include "reorder.h"
 #include "program.h"
 #include "error.h"
@@ -469,3 +470,566 @@ TEST(Program, reorderFemTest) {
   unsigned int nSteps = 10;
   femTest(filename, prefix, nSteps);
 }
+
+// A path graph whose vertices are scrambled
+static vector<ElementRef> createScrambledPath(Set& points, Set& edges, int n,
+    FieldRef<int>& id) {
+  vector<ElementRef> refs;
+  for (int i = 0; i < n; ++i) {
+    refs.push_back(points.add());
+    id.set(refs[i], i);
+  }
+  // Position i in the path is vertex (i*7) % n, which is a permutation of the
+  // vertices when n is not divisible by 7.
+  for (int i = 0; i < n-1; ++i) {
+    edges.add(refs[(i*7) % n], refs[((i+1)*7) % n]);
+  }
+  return refs;
+}
+
+TEST(Reorder, rcmPath) {
+  const int n = 100;
+  Set points;
+  Set edges(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  vector<ElementRef> refs = createScrambledPath(points, edges, n, id);
+  ASSERT_GT(getBandwidth(edges).bandwidth, 1);
+
+  vector<int> edgeOrdering;
+  vector<int> vertexOrdering;
+  ReorderingReport report;
+  reorder(edges, points, edgeOrdering, vertexOrdering,
+          ReorderingHeuristic::RCM, &report);
+
+  // A path is ordered from one end to the other
+  ASSERT_EQ(1, report.after.bandwidth);
+  ASSERT_EQ(n-1, report.after.profile);
+  ASSERT_GT(report.before.bandwidth, report.after.bandwidth);
+  ASSERT_EQ(1, getBandwidth(edges).bandwidth);
+
+  // Fields follow the vertices
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(i, id.get(refs[vertexOrdering[i]]));
+  }
+}
+
+TEST(Reorder, boolAndComplexFields) {
+  const int n = 100;
+  Set points;
+  Set edges(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  FieldRef<bool> even = points.addField<bool>("even");
+  FieldRef<double_complex> z = points.addField<double_complex>("z");
+  FieldRef<float_complex> w = points.addField<float_complex>("w");
+  FieldRef<bool> edgeEven = edges.addField<bool>("even");
+  FieldRef<float_complex> edgeW = edges.addField<float_complex>("w");
+  vector<ElementRef> refs = createScrambledPath(points, edges, n, id);
+  for (int i = 0; i < n; ++i) {
+    even.set(refs[i], i % 2 == 0);
+    z.set(refs[i], double_complex(i, -i));
+    w.set(refs[i], float_complex(-i, i));
+  }
+  vector<ElementRef> edgeRefs;
+  for (auto edge : edges) {
+    edgeRefs.push_back(edge);
+  }
+  for (int i = 0; i < n-1; ++i) {
+    edgeEven.set(edgeRefs[i], i % 2 == 0);
+    edgeW.set(edgeRefs[i], float_complex(i, 2*i));
+  }
+
+  vector<int> edgeOrdering;
+  vector<int> vertexOrdering;
+  reorder(edges, points, edgeOrdering, vertexOrdering,
+          ReorderingHeuristic::RCM);
+
+  // Fields of every component type follow their elements
+  for (int i = 0; i < n; ++i) {
+    ElementRef p = refs[vertexOrdering[i]];
+    ASSERT_EQ(i, id.get(p));
+    ASSERT_EQ(i % 2 == 0, (bool)even.get(p));
+    ASSERT_EQ(double_complex(i, -i), (double_complex)z.get(p));
+    ASSERT_EQ(-i, ((float_complex)w.get(p)).real);
+    ASSERT_EQ(i, ((float_complex)w.get(p)).imag);
+  }
+  for (int i = 0; i < n-1; ++i) {
+    ElementRef e = edgeRefs[edgeOrdering[i]];
+    ASSERT_EQ(i % 2 == 0, (bool)edgeEven.get(e));
+    ASSERT_EQ(i, ((float_complex)edgeW.get(e)).real);
+    ASSERT_EQ(2*i, ((float_complex)edgeW.get(e)).imag);
+  }
+}
+
+TEST(Reorder, bfsBox) {
+  Set points;
+  Set edges(points, points);
+  points.addField<simit_float,3>("x");
+  createBox(&points, &edges, 4, 5, 6);
+
+  // Scramble the vertices
+  const int n = points.getSize();
+  vector<int> scramble(n);
+  for (int i = 0; i < n; ++i) {
+    scramble[i] = (i*37) % n;
+  }
+  reorderVertexSet(edges, points, scramble);
+  MatrixBandwidth scrambled = getBandwidth(edges);
+
+  for (auto heuristic : {ReorderingHeuristic::BFS, ReorderingHeuristic::RCM}) {
+    vector<int> edgeOrdering;
+    vector<int> vertexOrdering;
+    ReorderingReport report;
+    reorder(edges, points, edgeOrdering, vertexOrdering, heuristic, &report);
+
+    // Every vertex is mapped to a distinct position
+    vector<bool> mapped(n, false);
+    for (int i = 0; i < n; ++i) {
+      ASSERT_FALSE(mapped[vertexOrdering[i]]);
+      mapped[vertexOrdering[i]] = true;
+    }
+
+    // Breadth first levels of a box are bounded by its two smallest sides
+    ASSERT_LE(report.after.bandwidth, 2*4*5);
+    ASSERT_LT(report.after.profile, scrambled.profile);
+  }
+}
+
+TEST(Reorder, mortonGrid) {
+  Set points;
+  FieldRef<float,2> x = points.addField<float,2>("x");
+  for (int i = 0; i < 16; ++i) {
+    x.set(points.add(), {(float)(i % 4), (float)(i / 4)});
+  }
+  points.setSpatialField("x");
+
+  vector<int> vertexOrdering;
+  hilbert::spaceFillingCurveReorder(points, vertexOrdering,
+                                    hilbert::Curve::Morton, 2, 1);
+
+  // The Morton key of (x,y) interleaves the bits x1 y1 x0 y0
+  for (int i = 0; i < 16; ++i) {
+    int cx = i % 4;
+    int cy = i / 4;
+    int key = (cx >> 1) << 3 | (cy >> 1) << 2 | (cx & 1) << 1 | (cy & 1);
+    ASSERT_EQ(key, vertexOrdering[i]);
+  }
+}
+
+TEST(Reorder, hilbertParallel) {
+  const int side = 256;
+  Set points;
+  FieldRef<double,2> x = points.addField<double,2>("x");
+  for (int i = 0; i < side*side; ++i) {
+    // Scramble the points, so that the sort has work to do
+    int cell = (int)(((long long)i * 7919) % (side*side));
+    x.set(points.add(), {(double)(cell % side), (double)(cell / side)});
+  }
+  points.setSpatialField("x");
+
+  vector<int> serialOrdering;
+  hilbert::spaceFillingCurveReorder(points, serialOrdering,
+                                    hilbert::Curve::Hilbert, 8, 1);
+  vector<int> parallelOrdering;
+  hilbert::spaceFillingCurveReorder(points, parallelOrdering,
+                                    hilbert::Curve::Hilbert, 8, 4);
+  ASSERT_EQ(serialOrdering, parallelOrdering);
+
+  // Consecutive cells on a Hilbert curve are adjacent
+  vector<int> permutation(side*side, -1);
+  for (int i = 0; i < side*side; ++i) {
+    ASSERT_EQ(-1, permutation[parallelOrdering[i]]);
+    permutation[parallelOrdering[i]] = i;
+  }
+  const double *data = static_cast<double*>(points.getFieldData("x"));
+  for (int i = 1; i < side*side; ++i) {
+    int a = permutation[i-1];
+    int b = permutation[i];
+    ASSERT_EQ(1.0, fabs(data[2*a] - data[2*b]) + fabs(data[2*a+1] - data[2*b+1]));
+  }
+}
+
+TEST(Reorder, reorderStorage) {
+  const int n = 100;
+  Set points;
+  Set edges(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  FieldRef<simit_float,2> x = points.addField<simit_float,2>("x");
+  FieldRef<int> edgeId = edges.addField<int>("id");
+  vector<ElementRef> refs = createScrambledPath(points, edges, n, id);
+  for (int i = 0; i < n; ++i) {
+    x.set(refs[i], {(simit_float)i, (simit_float)-i});
+  }
+  points.setFieldLayout({"x"}, FieldLayout::AoS);
+  vector<ElementRef> edgeRefs;
+  for (auto edge : edges) {
+    edgeRefs.push_back(edge);
+  }
+  for (int i = 0; i < n-1; ++i) {
+    edgeId.set(edgeRefs[i], i);
+  }
+
+  reorderStorage(edges, points, ReorderingHeuristic::RCM);
+  ASSERT_TRUE(points.isPermuted());
+  ASSERT_TRUE(edges.isPermuted());
+  ASSERT_EQ(1, getBandwidth(edges).bandwidth);
+
+  // References refer to the same elements
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(i, id.get(refs[i]));
+    SIMIT_ASSERT_FLOAT_EQ(-i, x.get(refs[i])(1));
+    ASSERT_EQ(refs[i], points.getElementAt(points.getLocation(refs[i])));
+  }
+  for (int i = 0; i < n-1; ++i) {
+    ASSERT_EQ(i, edgeId.get(edgeRefs[i]));
+    ASSERT_EQ(refs[(i*7) % n], edges.getEndpoint(edgeRefs[i], 0));
+    ASSERT_EQ(refs[((i+1)*7) % n], edges.getEndpoint(edgeRefs[i], 1));
+  }
+
+  // Add and remove elements of permuted sets
+  ElementRef p = points.add();
+  id.set(p, n);
+  ElementRef e = edges.add(refs[0], p);
+  ASSERT_EQ(p, edges.getEndpoint(e, 1));
+  ASSERT_EQ(refs[0], edges.getEndpoint(e, 0));
+
+  points.remove(refs[5]);
+  ASSERT_EQ(n, points.getSize());
+  ASSERT_EQ(n, id.get(refs[5]));
+  for (int i = 0; i < n; ++i) {
+    if (i != 5) {
+      ASSERT_EQ(i, id.get(refs[i]));
+    }
+  }
+}
+
+// Checks that every edge of the edge set still connects the vertices whose ids
+// it recorded, and that the edges are stored sorted by their endpoints in
+// points.
+static void checkEdges(const Set& points, const Set& edges,
+                       const vector<FieldRef<int>>& ends, FieldRef<int>& id) {
+  vector<int> previous;
+  for (int loc = 0; loc < edges.getSize(); ++loc) {
+    ElementRef e = edges.getElementAt(loc);
+    vector<int> locations;
+    for (int j = 0; j < edges.getCardinality(); ++j) {
+      if (edges.getEndpointSet(j) == &points) {
+        ASSERT_EQ((int)ends[j].get(e),
+                  (int)id.get(edges.getEndpoint(e, j)));
+        locations.push_back(points.getLocation(edges.getEndpoint(e, j)));
+      }
+    }
+    sort(locations.begin(), locations.end());
+    ASSERT_TRUE(previous <= locations);
+    previous = locations;
+  }
+}
+
+TEST(Reorder, reorderMesh) {
+  const int n = 60;
+  Set points;
+  Set anchors;
+  Set springs(points, points);
+  Set faces(points, points, points);
+  Set tets(points, points, points, points);
+  Set pins(anchors, points);
+  FieldRef<int> id = points.addField<int>("id");
+  FieldRef<int> anchorId = anchors.addField<int>("id");
+  vector<ElementRef> refs = createScrambledPath(points, springs, n, id);
+  vector<ElementRef> anchorRefs;
+  for (int i = 0; i < 3; ++i) {
+    anchorRefs.push_back(anchors.add());
+    anchorId.set(anchorRefs[i], i);
+  }
+
+  // Record the ids of the endpoints of every edge in its fields
+  vector<pair<Set*, vector<FieldRef<int>>>> edgeSets;
+  for (Set* edges : {&springs, &faces, &tets, &pins}) {
+    vector<FieldRef<int>> ends;
+    ends.reserve(edges->getCardinality());
+    for (int j = 0; j < edges->getCardinality(); ++j) {
+      FieldRef<int> end = edges->addField<int>("end" + to_string(j));
+      ends.push_back(end);
+    }
+    edgeSets.push_back({edges, ends});
+  }
+  for (int i = 0; i < n-3; ++i) {
+    int a = (i*7) % n, b = ((i+1)*7) % n, c = ((i+2)*7) % n,
+        d = ((i+3)*7) % n;
+    faces.add(refs[c], refs[a], refs[b]);
+    tets.add(refs[d], refs[b], refs[c], refs[a]);
+    pins.add(anchorRefs[i % 3], refs[b]);
+  }
+  for (auto& edgeSet : edgeSets) {
+    Set& edges = *edgeSet.first;
+    for (auto e : edges) {
+      for (int j = 0; j < edges.getCardinality(); ++j) {
+        FieldRef<int>& endpointId = (edges.getEndpointSet(j) == &points)
+                                    ? id : anchorId;
+        edgeSet.second[j].set(e, endpointId.get(edges.getEndpoint(e, j)));
+      }
+    }
+  }
+  ASSERT_GT(getBandwidth(springs).bandwidth, 1);
+  ASSERT_EQ(4u, points.getEdgeSets().size());
+
+  reorder(points, ReorderingHeuristic::RCM);
+  ASSERT_FALSE(points.isPermuted());
+  ASSERT_LE(getBandwidth(springs).bandwidth, 3);
+  ASSERT_LE(getBandwidth(tets).bandwidth, 3);
+  for (auto& edgeSet : edgeSets) {
+    checkEdges(points, *edgeSet.first, edgeSet.second, id);
+  }
+  for (auto e : pins) {
+    ASSERT_EQ((int)edgeSets[3].second[0].get(e),
+              (int)anchorId.get(pins.getEndpoint(e, 0)));
+  }
+
+  // Relocating again keeps element references
+  vector<ElementRef> pointRefs;
+  for (auto p : points) {
+    pointRefs.push_back(p);
+  }
+  reorderStorage(points, ReorderingHeuristic::BFS);
+  ASSERT_TRUE(points.isPermuted());
+  ASSERT_TRUE(tets.isPermuted());
+  for (size_t i = 0; i < pointRefs.size(); ++i) {
+    ASSERT_EQ(pointRefs[i],
+              points.getElementAt(points.getLocation(pointRefs[i])));
+  }
+  for (auto& edgeSet : edgeSets) {
+    checkEdges(points, *edgeSet.first, edgeSet.second, id);
+  }
+}
+
+TEST(Reorder, iterationOrder) {
+  const int n = 100;
+  Set points;
+  Set edges(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  createScrambledPath(points, edges, n, id);
+  vector<int> endpoints(edges.getEndpointsData(),
+                        edges.getEndpointsData() + 2*(n-1));
+
+  // Without a spatial field edges are visited by their sorted endpoints
+  vector<int> order;
+  computeIterationOrder(edges, order);
+  ASSERT_EQ((size_t)n-1, order.size());
+  vector<bool> visited(n-1, false);
+  pair<int,int> previous(-1, -1);
+  for (int e : order) {
+    ASSERT_FALSE(visited[e]);
+    visited[e] = true;
+    pair<int,int> sorted(min(endpoints[2*e], endpoints[2*e+1]),
+                         max(endpoints[2*e], endpoints[2*e+1]));
+    ASSERT_TRUE(previous < sorted);
+    previous = sorted;
+  }
+
+  // With a spatial field edges are visited by the curve position of their
+  // first endpoint
+  FieldRef<float,2> x = points.addField<float,2>("x");
+  for (auto p : points) {
+    int i = id.get(p);
+    x.set(p, {(float)(i % 10), (float)(i / 10)});
+  }
+  points.setSpatialField("x");
+  vector<int> vertexOrdering;
+  hilbert::spaceFillingCurveReorder(points, vertexOrdering);
+  order.clear();
+  computeIterationOrder(edges, order);
+  ASSERT_EQ((size_t)n-1, order.size());
+  for (size_t i = 1; i < order.size(); ++i) {
+    ASSERT_LE(vertexOrdering[endpoints[2*order[i-1]]],
+              vertexOrdering[endpoints[2*order[i]]]);
+  }
+
+  // The edges are not moved
+  for (int i = 0; i < 2*(n-1); ++i) {
+    ASSERT_EQ(endpoints[i], edges.getEndpointsData()[i]);
+  }
+}
+
+TEST(Reorder, sparseTiles) {
+  const int n = 100;
+  const int tileSize = 16;
+  Set points;
+  Set edges(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  createScrambledPath(points, edges, n, id);
+  const int* endpoints = edges.getEndpointsData();
+
+  vector<int> tileStarts;
+  vector<int> tileEdges;
+  computeSparseTiles(edges, tileSize, tileStarts, tileEdges);
+  const int numTiles = (n + tileSize - 1) / tileSize;
+  ASSERT_EQ((size_t)numTiles+1, tileStarts.size());
+  ASSERT_EQ(0, tileStarts[0]);
+  ASSERT_EQ(n-1, tileStarts[numTiles]);
+  ASSERT_EQ((size_t)n-1, tileEdges.size());
+
+  // Every edge is in the tile of its smallest endpoint, so no edge touches a
+  // vertex of an earlier tile
+  vector<bool> tiled(n-1, false);
+  for (int t = 0; t < numTiles; ++t) {
+    for (int k = tileStarts[t]; k < tileStarts[t+1]; ++k) {
+      int e = tileEdges[k];
+      ASSERT_FALSE(tiled[e]);
+      tiled[e] = true;
+      ASSERT_EQ(t, min(endpoints[2*e], endpoints[2*e+1]) / tileSize);
+      if (k > tileStarts[t]) {
+        ASSERT_LT(tileEdges[k-1], e);
+      }
+    }
+  }
+}
+
+TEST(Program, reorderSetting) {
+  const int n = 100;
+  Set points;
+  Set springs(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> c = points.addField<simit_float>("c");
+  FieldRef<simit_float> a = springs.addField<simit_float>("a");
+  vector<ElementRef> refs = createScrambledPath(points, springs, n, id);
+  vector<ElementRef> springRefs;
+  for (auto spring : springs) {
+    springRefs.push_back(spring);
+  }
+  for (int i = 0; i < n; ++i) {
+    b.set(refs[i], i);
+  }
+  for (int i = 0; i < n-1; ++i) {
+    a.set(springRefs[i], i+1);
+  }
+
+  // HACK: Set kReorder for this type of test
+  bool defaults = kReorder;
+  kReorder = true;
+  Function func = loadFunction(string(TEST_INPUT_DIR) + "/system/gemv.sim",
+                               "main");
+  if (!func.defined()) FAIL();
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+  kReorder = defaults;
+  ASSERT_TRUE(points.isPermuted());
+  ASSERT_TRUE(springs.isPermuted());
+  ASSERT_EQ(1, getBandwidth(springs).bandwidth);
+
+  func.runSafe();
+
+  // Results are read through the references created before reordering. Each
+  // spring adds a*(b(p0)+b(p1)) to c of both its endpoints.
+  vector<simit_float> expected(n, 0.0);
+  for (int i = 0; i < n-1; ++i) {
+    int p0 = (i*7) % n;
+    int p1 = ((i+1)*7) % n;
+    ASSERT_EQ(refs[p0], springs.getEndpoint(springRefs[i], 0));
+    ASSERT_EQ(refs[p1], springs.getEndpoint(springRefs[i], 1));
+    SIMIT_ASSERT_FLOAT_EQ(i+1, a.get(springRefs[i]));
+    expected[p0] += (i+1) * (simit_float)(p0 + p1);
+    expected[p1] += (i+1) * (simit_float)(p0 + p1);
+  }
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(i, id.get(refs[i]));
+    SIMIT_ASSERT_FLOAT_EQ(i, b.get(refs[i]));
+    SIMIT_ASSERT_FLOAT_EQ(expected[i], c.get(refs[i]));
+  }
+}
+
+TEST(Program, iteration_order) {
+  // Runs the program on a scrambled path, with the springs visited in storage
+  // order and in their inspected iteration order
+  auto run = [this](bool iterationOrder) {
+    const int n = 100;
+    Set points;
+    Set springs(points, points);
+    FieldRef<int> id = points.addField<int>("id");
+    FieldRef<simit_float> b = points.addField<simit_float>("b");
+    FieldRef<simit_float> c = points.addField<simit_float>("c");
+    FieldRef<simit_float> a = springs.addField<simit_float>("a");
+    vector<ElementRef> refs = createScrambledPath(points, springs, n, id);
+    for (int i = 0; i < n; ++i) {
+      b.set(refs[i], (i*13) % 17);
+    }
+    int i = 0;
+    for (auto spring : springs) {
+      a.set(spring, 1.0 + (i++ % 5));
+    }
+
+    // HACK: Set kIterationOrder for this type of test
+    bool defaults = kIterationOrder;
+    kIterationOrder = iterationOrder;
+    Function func = loadFunction(TEST_FILE_NAME, "main");
+    kIterationOrder = defaults;
+
+    vector<simit_float> results;
+    if (!func.defined()) return results;
+    func.bind("points", &points);
+    func.bind("springs", &springs);
+    func.runSafe();
+
+    for (int i = 0; i < n; ++i) {
+      results.push_back(b.get(refs[i]));
+      results.push_back(c.get(refs[i]));
+    }
+    return results;
+  };
+
+  vector<simit_float> storageOrder = run(false);
+  vector<simit_float> iterationOrder = run(true);
+  ASSERT_EQ(200u, storageOrder.size());
+  ASSERT_EQ(200u, iterationOrder.size());
+  for (size_t i = 0; i < storageOrder.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_NEAR_EQ(storageOrder[i], iterationOrder[i]);
+  }
+}
+
+TEST(Program, sparse_tiles) {
+  // Runs the program on a scrambled path, with and without executing the
+  // reduce-map and the vertex updates that follow it in sparse tiles
+  auto run = [this](int sparseTileSize) {
+    const int n = 100;
+    Set points;
+    Set springs(points, points);
+    FieldRef<int> id = points.addField<int>("id");
+    FieldRef<simit_float> x = points.addField<simit_float>("x");
+    FieldRef<simit_float> v = points.addField<simit_float>("v");
+    FieldRef<simit_float> k = springs.addField<simit_float>("k");
+    vector<ElementRef> refs = createScrambledPath(points, springs, n, id);
+    for (int i = 0; i < n; ++i) {
+      x.set(refs[i], (i*13) % 17);
+      v.set(refs[i], 0.0);
+    }
+    int i = 0;
+    for (auto spring : springs) {
+      k.set(spring, 1.0 + (i++ % 5));
+    }
+
+    // HACK: Set kSparseTileSize for this type of test
+    int defaults = kSparseTileSize;
+    kSparseTileSize = sparseTileSize;
+    Function func = loadFunction(TEST_FILE_NAME, "main");
+    kSparseTileSize = defaults;
+
+    vector<simit_float> results;
+    if (!func.defined()) return results;
+    func.bind("points", &points);
+    func.bind("springs", &springs);
+    func.runSafe();
+
+    for (int i = 0; i < n; ++i) {
+      results.push_back(x.get(refs[i]));
+      results.push_back(v.get(refs[i]));
+    }
+    return results;
+  };
+
+  vector<simit_float> untiled = run(0);
+  vector<simit_float> tiled = run(16);
+  ASSERT_EQ(200u, untiled.size());
+  ASSERT_EQ(200u, tiled.size());
+  for (size_t i = 0; i < untiled.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_NEAR_EQ(untiled[i], tiled[i]);
+  }
+}
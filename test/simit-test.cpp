@@ -4,9 +4,9 @@
 #include <iostream>
 #include <vector>
 
-#include "timers.h"
 #include "program.h"
 #include "init.h"
+#include "profiler.h"
 #include "ir.h"
 #include "util/util.h"
 
@@ -31,6 +31,9 @@ void ParseEnvironmentOptions(const char *progName, const char *envvar,
 
 static bool PROFILE(false);
 
+// The profilers of the functions loaded when profiling, printed after the tests
+static std::vector<std::shared_ptr<simit::Profiler>> profilers;
+
 #ifdef F32
 // F32 environment setup
 class F32Environment : public ::testing::Environment {
@@ -119,7 +122,10 @@ int main(int argc, char **argv) {
   int returnValue = RUN_ALL_TESTS();
 
   if (PROFILE) {
-    simit::ir::printTimes();
+    for (auto& profiler : profilers) {
+      profiler->print(std::cout);
+      std::cout << std::endl;
+    }
   }
   return returnValue;
 }
@@ -151,6 +157,9 @@ simit::Function loadFunction(std::string fileName, std::string funcName="main"){
   if (!f.defined()) {
     std::cerr << program.getDiagnostics().getMessage();
   }
+  else if (PROFILE) {
+    profilers.push_back(f.getProfiler());
+  }
 
   return f;
 }
@@ -168,6 +177,9 @@ simit::Function loadFunctionWithTimers(std::string fileName, std::string funcNam
   if (!f.defined()) {
     std::cerr << program.getDiagnostics().getMessage();
   }
+  else if (PROFILE) {
+    profilers.push_back(f.getProfiler());
+  }
 
   return f;
 }
@@ -13,11 +13,22 @@
 #include "types.h"
 
 #include "runtime.h"
+#include "init.h"
+#include "solvers.h"
 
 using namespace std;
 using namespace simit;
 using namespace simit::ir;
 
+extern "C" {
+void cMatSolve_f64(int n,  int m,  int* rowptr, int* colidx,
+                   int nn, int mm, double* A, double* x, double* b);
+void dchol(int An,  int Am,  int* Arowptr, int* Acolidx,
+           int Ann, int Amm, double* Avals, void** solver);
+void dlltsolves(void** solverPtr, int bn, double *bvals, int xn, double *xvals);
+void dcholfree(void** solverPtr);
+}
+
 TEST(solver, solve) {
   // Points
   Set points;
@@ -157,4 +168,360 @@ TEST(solver, chol) {
   SIMIT_ASSERT_FLOAT_EQ(60.0, c(p2));
 }
 
+TEST(solver, csr2eigenCached) {
+  // A 3x3 blocked matrix of 2x2 blocks, with a missing block
+  vector<int> rowPtr = {0, 2, 5, 7};
+  vector<int> colIdx = {0, 1, 0, 1, 2, 1, 2};
+  vector<double> vals(colIdx.size()*4);
+  for (size_t i = 0; i < vals.size(); ++i) {
+    vals[i] = i + 1.0;
+  }
+
+  auto expected = csr2eigen<double,Eigen::ColMajor>(6, 6, rowPtr.data(),
+                                                    colIdx.data(), 2, 2,
+                                                    vals.data());
+  std::unique_lock<std::mutex> lock;
+  const Eigen::SparseMatrix<double>& actual =
+      csr2eigenCached(6, 6, rowPtr.data(), colIdx.data(), 2, 2, vals.data(),
+                      lock);
+  ASSERT_TRUE(lock.owns_lock());
+  ASSERT_EQ(expected.nonZeros(), actual.nonZeros());
+  ASSERT_EQ(0.0, (Eigen::MatrixXd(expected) - Eigen::MatrixXd(actual)).norm());
+
+  // New values are copied into the cached structure
+  for (double& val : vals) {
+    val *= -2.0;
+  }
+  expected = csr2eigen<double,Eigen::ColMajor>(6, 6, rowPtr.data(),
+                                               colIdx.data(), 2, 2,
+                                               vals.data());
+  const Eigen::SparseMatrix<double>& updated =
+      csr2eigenCached(6, 6, rowPtr.data(), colIdx.data(), 2, 2, vals.data(),
+                      lock);
+  ASSERT_EQ(&actual, &updated);
+  ASSERT_EQ(0.0, (Eigen::MatrixXd(expected) - Eigen::MatrixXd(updated)).norm());
+
+  // A changed structure is converted again
+  colIdx[2] = 2;
+  colIdx[4] = 0;
+  expected = csr2eigen<double,Eigen::ColMajor>(6, 6, rowPtr.data(),
+                                               colIdx.data(), 2, 2,
+                                               vals.data());
+  const Eigen::SparseMatrix<double>& changed =
+      csr2eigenCached(6, 6, rowPtr.data(), colIdx.data(), 2, 2, vals.data(),
+                      lock);
+  ASSERT_EQ(0.0, (Eigen::MatrixXd(expected) - Eigen::MatrixXd(changed)).norm());
+
+  // The cache is freed with its index, once it is no longer used
+  lock.unlock();
+  const pair<int*,int*> index(rowPtr.data(), colIdx.data());
+  ASSERT_EQ(1u, getEigenMatrixCaches<double>().count(index));
+  freeSolverCaches(rowPtr.data(), colIdx.data());
+  ASSERT_EQ(0u, getEigenMatrixCaches<double>().count(index));
+}
+
+// A blocked tridiagonal matrix of 2x2 blocks with [4 1; 1 4] on the diagonal
+// and -I off the diagonal
+struct BlockTridiagonal {
+  static const int numBlocks = 20;
+  vector<int> rowPtr;
+  vector<int> colIdx;
+  vector<double> vals;
+
+  BlockTridiagonal() {
+    rowPtr.push_back(0);
+    for (int i = 0; i < numBlocks; ++i) {
+      for (int j = max(i-1, 0); j <= min(i+1, numBlocks-1); ++j) {
+        colIdx.push_back(j);
+        if (i == j) {
+          vals.insert(vals.end(), {4.0, 1.0, 1.0, 4.0});
+        }
+        else {
+          vals.insert(vals.end(), {-1.0, 0.0, 0.0, -1.0});
+        }
+      }
+      rowPtr.push_back(colIdx.size());
+    }
+  }
+
+  // Solves A*x = b and returns the norm of the residual
+  double solve(const vector<double>& b, vector<double>& x) {
+    const int n = numBlocks*2;
+    cMatSolve_f64(n, n, rowPtr.data(), colIdx.data(), 2, 2, vals.data(),
+                  const_cast<double*>(b.data()), x.data());
+    auto A = csr2eigen<double,Eigen::ColMajor>(n, n, rowPtr.data(),
+                                               colIdx.data(), 2, 2,
+                                               vals.data());
+    Eigen::Map<const Eigen::VectorXd> bmap(b.data(), n);
+    Eigen::Map<const Eigen::VectorXd> xmap(x.data(), n);
+    return (A*xmap - bmap).norm();
+  }
+};
+
+TEST(solver, settings) {
+  const SolverSettings defaults = kSolverSettings;
+  BlockTridiagonal A;
+  const int n = A.numBlocks*2;
+  vector<double> b(n);
+  for (int i = 0; i < n; ++i) {
+    b[i] = i % 3;
+  }
+
+  vector<KrylovMethod> methods = {KrylovMethod::CG, KrylovMethod::BiCGSTAB,
+                                  KrylovMethod::MINRES};
+  vector<Preconditioner> preconditioners = {
+      Preconditioner::Identity, Preconditioner::Jacobi,
+      Preconditioner::BlockJacobi, Preconditioner::IncompleteCholesky};
+  for (KrylovMethod method : methods) {
+    for (Preconditioner preconditioner : preconditioners) {
+      kSolverSettings.method = method;
+      kSolverSettings.preconditioner = preconditioner;
+      kSolverSettings.tolerance = 1e-10;
+      kSolverSettings.maxIterations = 1000;
+      kSolverSettings.warmStart = false;
+      clearSolverStatistics();
+
+      vector<double> x(n, 42.0);
+      ASSERT_LT(A.solve(b, x), 1e-8);
+      ASSERT_EQ(1u, getSolverStatistics().size());
+      SolverStatistics statistics = getSolverStatistics()[0];
+      ASSERT_TRUE(statistics.converged);
+      ASSERT_LE(statistics.error, 1e-10);
+
+      // Warm starting from the solution converges without iterating
+      kSolverSettings.warmStart = true;
+      ASSERT_LT(A.solve(b, x), 1e-8);
+      ASSERT_EQ(2u, getSolverStatistics().size());
+      ASSERT_EQ(0, getSolverStatistics()[1].iterations);
+    }
+  }
+
+  // Block Jacobi inverts the 2x2 diagonal blocks, so that it needs fewer
+  // iterations than Jacobi
+  kSolverSettings.method = KrylovMethod::CG;
+  kSolverSettings.warmStart = false;
+  clearSolverStatistics();
+  vector<double> x(n);
+  kSolverSettings.preconditioner = Preconditioner::Jacobi;
+  A.solve(b, x);
+  kSolverSettings.preconditioner = Preconditioner::BlockJacobi;
+  A.solve(b, x);
+  ASSERT_LT(getSolverStatistics()[1].iterations,
+            getSolverStatistics()[0].iterations);
+
+  // Too few iterations are reported as not converged
+  kSolverSettings.preconditioner = Preconditioner::Identity;
+  kSolverSettings.maxIterations = 2;
+  A.solve(b, x);
+  ASSERT_FALSE(getSolverStatistics()[2].converged);
+  ASSERT_EQ(2, getSolverStatistics()[2].iterations);
+
+  kSolverSettings = defaults;
+  clearSolverStatistics();
+}
+
+TEST(solver, statisticsHistory) {
+  const SolverSettings defaults = kSolverSettings;
+  BlockTridiagonal A;
+  const int n = A.numBlocks*2;
+  vector<double> b(n, 1.0);
+  vector<double> x(n);
+  clearSolverStatistics();
+
+  // The first solve iterates, and the warm started ones do not
+  A.solve(b, x);
+  const int iterations = getSolverStatistics()[0].iterations;
+  ASSERT_GT(iterations, 0);
+  kSolverSettings.warmStart = true;
+  const size_t numSolves = kMaxSolverStatistics + 10;
+  for (size_t i = 1; i < numSolves; ++i) {
+    A.solve(b, x);
+  }
+
+  // Only the statistics of the last solves are kept, but all are counted
+  ASSERT_EQ(kMaxSolverStatistics, getSolverStatistics().size());
+  ASSERT_EQ(0, getSolverStatistics()[0].iterations);
+  ASSERT_EQ((long long)numSolves, getSolverTotals().solves);
+  ASSERT_EQ(iterations, getSolverTotals().iterations);
+  ASSERT_EQ(0, getSolverTotals().unconverged);
+
+  clearSolverStatistics();
+  ASSERT_EQ(0u, getSolverStatistics().size());
+  ASSERT_EQ(0, getSolverTotals().solves);
+  kSolverSettings = defaults;
+}
+
+TEST(solver, cholCached) {
+  BlockTridiagonal A;
+  const int n = A.numBlocks*2;
+  vector<double> b(n);
+  for (int i = 0; i < n; ++i) {
+    b[i] = i % 3;
+  }
+  auto residual = [&](const vector<double>& x) {
+    auto mat = csr2eigen<double,Eigen::ColMajor>(n, n, A.rowPtr.data(),
+                                                 A.colIdx.data(), 2, 2,
+                                                 A.vals.data());
+    Eigen::Map<const Eigen::VectorXd> bmap(b.data(), n);
+    Eigen::Map<const Eigen::VectorXd> xmap(x.data(), n);
+    return (mat*xmap - bmap).norm();
+  };
+
+  // The factorization of the first step is reused, and refactorized with the
+  // values of the second step
+  void* first;
+  dchol(n, n, A.rowPtr.data(), A.colIdx.data(), 2, 2, A.vals.data(), &first);
+  vector<double> x(n);
+  dlltsolves(&first, n, b.data(), n, x.data());
+  ASSERT_LT(residual(x), 1e-10);
+  dcholfree(&first);
+
+  for (double& val : A.vals) {
+    val *= 3.0;
+  }
+  void* second;
+  dchol(n, n, A.rowPtr.data(), A.colIdx.data(), 2, 2, A.vals.data(), &second);
+  ASSERT_EQ(first, second);
+  dlltsolves(&second, n, b.data(), n, x.data());
+  ASSERT_LT(residual(x), 1e-10);
+
+  // A factorization with the same index while the first is live is separate
+  vector<double> vals = A.vals;
+  for (double& val : A.vals) {
+    val *= 0.5;
+  }
+  void* third;
+  dchol(n, n, A.rowPtr.data(), A.colIdx.data(), 2, 2, A.vals.data(), &third);
+  ASSERT_NE(second, third);
+  dlltsolves(&third, n, b.data(), n, x.data());
+  ASSERT_LT(residual(x), 1e-10);
+  A.vals = vals;
+  dlltsolves(&second, n, b.data(), n, x.data());
+  ASSERT_LT(residual(x), 1e-10);
+  dcholfree(&third);
+  dcholfree(&second);
+}
+
+TEST(solver, symmetric_matrices) {
+  // Runs the program with A assembled in full and upper triangular
+  auto run = [](const vector<string>& symmetricMatrices) {
+    Set points;
+    FieldRef<simit_float> b = points.addField<simit_float>("b");
+    points.addField<simit_float>("c");
+    points.addField<simit_float>("d");
+    points.addField<simit_float>("e");
+    points.addField<simit_float>("f");
+    points.addField<simit_float>("g");
+    vector<ElementRef> p;
+    for (int i = 0; i < 5; ++i) {
+      p.push_back(points.add());
+      b.set(p[i], 1.0 + i*i);
+    }
+
+    Set springs(points,points);
+    FieldRef<simit_float> a = springs.addField<simit_float>("a");
+    for (int i = 0; i < 4; ++i) {
+      a.set(springs.add(p[i],p[i+1]), 1.0 + i);
+    }
+    a.set(springs.add(p[0],p[4]), 0.5);
+
+    // HACK: Set kSymmetricMatrices for this type of test
+    vector<string> defaults = kSymmetricMatrices;
+    kSymmetricMatrices = symmetricMatrices;
+    Function func = loadFunction(TEST_FILE_NAME, "main");
+    kSymmetricMatrices = defaults;
+    map<string,vector<double>> results;
+    if (!func.defined()) return results;
+
+    func.bind("points", &points);
+    func.bind("springs", &springs);
+    func.runSafe();
+
+    for (string field : {"c", "d", "e", "f", "g"}) {
+      FieldRef<simit_float> x = points.getField<simit_float>(field);
+      for (ElementRef pi : p) {
+        results[field].push_back(x.get(pi));
+      }
+    }
+    return results;
+  };
+
+  map<string,vector<double>> full = run({});
+  map<string,vector<double>> upper = run({"A"});
+  ASSERT_EQ(5u, full["c"].size());
+  ASSERT_EQ(5u, upper["c"].size());
+
+  // A*b with A = [7.5 1 0 0 .5; 1 15 2 0 0; 0 2 25 3 0; 0 0 3 35 4;
+  //               .5 0 0 4 22.5]
+  ASSERT_NEAR(18.0, full["c"][0], 1e-8);
+  ASSERT_NEAR(41.0, full["c"][1], 1e-8);
+  ASSERT_NEAR(159.0, full["c"][2], 1e-8);
+  for (string field : {"c", "d", "e", "f", "g"}) {
+    SCOPED_TRACE(field);
+    for (size_t i = 0; i < full[field].size(); ++i) {
+      ASSERT_NEAR(full[field][i], upper[field][i], 1e-6);
+    }
+  }
+}
+
+TEST(solver, symmetric_and_full_matrices) {
+  // Runs a map that assembles A and B, with A assembled in full and upper
+  // triangular while B is always assembled in full
+  auto run = [](const vector<string>& symmetricMatrices) {
+    Set points;
+    FieldRef<simit_float> b = points.addField<simit_float>("b");
+    points.addField<simit_float>("c");
+    points.addField<simit_float>("d");
+    vector<ElementRef> p;
+    for (int i = 0; i < 5; ++i) {
+      p.push_back(points.add());
+      b.set(p[i], 1.0 + i*i);
+    }
+
+    Set springs(points,points);
+    FieldRef<simit_float> a = springs.addField<simit_float>("a");
+    for (int i = 0; i < 4; ++i) {
+      a.set(springs.add(p[i],p[i+1]), 1.0 + i);
+    }
+    a.set(springs.add(p[0],p[4]), 0.5);
+
+    // HACK: Set kSymmetricMatrices for this type of test
+    vector<string> defaults = kSymmetricMatrices;
+    kSymmetricMatrices = symmetricMatrices;
+    Function func = loadFunction(TEST_FILE_NAME, "main");
+    kSymmetricMatrices = defaults;
+    map<string,vector<double>> results;
+    if (!func.defined()) return results;
+
+    func.bind("points", &points);
+    func.bind("springs", &springs);
+    func.runSafe();
+
+    for (string field : {"c", "d"}) {
+      FieldRef<simit_float> x = points.getField<simit_float>(field);
+      for (ElementRef pi : p) {
+        results[field].push_back(x.get(pi));
+      }
+    }
+    return results;
+  };
+
+  map<string,vector<double>> full = run({});
+  map<string,vector<double>> upper = run({"A"});
+  ASSERT_EQ(5u, full["d"].size());
+  ASSERT_EQ(5u, upper["d"].size());
+
+  // B*b with B = [1.5 2 0 0 1; -1 3 4 0 0; 0 -2 5 6 0; 0 0 -3 7 8;
+  //               -.5 0 0 -4 4.5]
+  ASSERT_NEAR(22.5, upper["d"][0], 1e-8);
+  ASSERT_NEAR(25.0, upper["d"][1], 1e-8);
+  ASSERT_NEAR(18.0, upper["c"][0], 1e-8);
+  for (string field : {"c", "d"}) {
+    SCOPED_TRACE(field);
+    for (size_t i = 0; i < full[field].size(); ++i) {
+      ASSERT_NEAR(full[field][i], upper[field][i], 1e-6);
+    }
+  }
+}
+
 #endif
@@ -0,0 +1,209 @@
+#include "simit-test.h"
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "partition.h"
+#include "subdomain.h"
+#include "program.h"
+
+using namespace std;
+using namespace simit;
+
+static void addSpringFields(Set& points, Set& springs) {
+  points.addField<simit_float,3>("x");
+  points.addField<simit_float,3>("v");
+  points.addField<simit_float,3>("fs");
+  points.addField<simit_float,3>("fg");
+  points.addField<simit_float,3>("M");
+  points.addField<simit_float,3>("p");
+  springs.addField<simit_float>("l0");
+  springs.addField<simit_float>("m");
+}
+
+// An n x n sheet of points, connected by springs along the grid lines
+static void createSheet(Set& points, Set& springs, int n) {
+  addSpringFields(points, springs);
+  FieldRef<simit_float,3> x = points.getField<simit_float,3>("x");
+  FieldRef<simit_float> l0 = springs.getField<simit_float>("l0");
+  FieldRef<simit_float> m = springs.getField<simit_float>("m");
+
+  vector<ElementRef> p;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      p.push_back(points.add());
+      simit_float z = 0.1*((i*j)%3);
+      x.set(p.back(), {(simit_float)j, (simit_float)i, z});
+    }
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (j+1 < n) {
+        ElementRef s = springs.add(p[i*n+j], p[i*n+j+1]);
+        l0.set(s, 0.9);
+        m.set(s, 0.0282735);
+      }
+      if (i+1 < n) {
+        ElementRef s = springs.add(p[i*n+j], p[(i+1)*n+j]);
+        l0.set(s, 0.9);
+        m.set(s, 0.0282735);
+      }
+    }
+  }
+}
+
+TEST(Subdomain, springs) {
+  const int n = 12;
+  const int numProcesses = 4;
+  const int numSteps = 10;
+
+  // Single-process result
+  Set points;
+  Set springs(points, points);
+  createSheet(points, springs, n);
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+  for (int i = 0; i < numSteps; ++i) {
+    func.runSafe();
+  }
+
+  // Decompose a second sheet over processes that write the positions of their
+  // vertices to shared memory
+  Set sheet;
+  Set sheetSprings(sheet, sheet);
+  createSheet(sheet, sheetSprings, n);
+  Partitioning partitioning;
+  partitionGraph(sheet, numProcesses, partitioning);
+
+  const size_t resultsSize = n*n*3*sizeof(simit_float);
+  simit_float* results = (simit_float*)mmap(nullptr, resultsSize,
+                                            PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, (void*)results);
+
+  const string name = "/simit-subdomain-test-" + to_string(getpid());
+  const string fileName = TEST_FILE_NAME;
+  vector<pid_t> processes;
+  for (int rank = 0; rank < numProcesses; ++rank) {
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+      int status = 0;
+      try {
+        Set localPoints;
+        Set localSprings(localPoints, localPoints);
+        addSpringFields(localPoints, localSprings);
+        Subdomain subdomain(sheet, sheetSprings, partitioning, rank,
+                            localPoints, localSprings);
+        HaloExchange halo(name, subdomain, numProcesses, localPoints,
+                          {"x", "v"});
+
+        Function localFunc = loadFunction(fileName, "main");
+        localFunc.bind("points", &localPoints);
+        localFunc.bind("springs", &localSprings);
+        for (int i = 0; i < numSteps; ++i) {
+          halo.run(localFunc);
+        }
+
+        FieldRef<simit_float,3> x = localPoints.getField<simit_float,3>("x");
+        for (int i = 0; i < subdomain.getNumOwned(); ++i) {
+          TensorRef<simit_float,3> xi = x.get(localPoints.getElementAt(i));
+          int location = subdomain.getVertexLocations()[i];
+          for (int j = 0; j < 3; ++j) {
+            results[location*3+j] = xi(j);
+          }
+        }
+      }
+      catch (...) {
+        status = 1;
+      }
+      _exit(status);
+    }
+    processes.push_back(pid);
+  }
+  for (pid_t pid : processes) {
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+
+  FieldRef<simit_float,3> x = points.getField<simit_float,3>("x");
+  for (int i = 0; i < n*n; ++i) {
+    TensorRef<simit_float,3> xi = x.get(points.getElementAt(i));
+    for (int j = 0; j < 3; ++j) {
+      SIMIT_ASSERT_FLOAT_EQ(xi(j), results[i*3+j]);
+    }
+  }
+  munmap(results, resultsSize);
+}
+
+TEST(Subdomain, reduced_field_read) {
+  Set points;
+  Set springs(points, points);
+  points.addField<simit_float,3>("x");
+  springs.addField<simit_float>("l");
+  ElementRef p0 = points.add();
+  ElementRef p1 = points.add();
+  springs.add(p0, p1);
+
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  ASSERT_EQ(1u, func.getMapsReadingReducedFields().size());
+  ASSERT_NE(string::npos,
+            func.getMapsReadingReducedFields()[0].find("compute_length"));
+
+  Function springsFunc =
+      loadFunction(string(TEST_INPUT_DIR)+"/subdomain/springs.sim", "main");
+  if (!springsFunc.defined()) FAIL();
+  ASSERT_EQ(0u, springsFunc.getMapsReadingReducedFields().size());
+
+  // A single process decomposition rejects the function before running it
+  Partitioning partitioning;
+  partitionGraph(points, 1, partitioning);
+  Set localPoints;
+  Set localSprings(localPoints, localPoints);
+  localPoints.addField<simit_float,3>("x");
+  localSprings.addField<simit_float>("l");
+  Subdomain subdomain(points, springs, partitioning, 0,
+                      localPoints, localSprings);
+  const string name = "/simit-subdomain-test-" + to_string(getpid());
+  HaloExchange halo(name, subdomain, 1, localPoints, {"x"});
+  func.bind("points", &localPoints);
+  func.bind("springs", &localSprings);
+  ASSERT_THROW(halo.run(func), SimitException);
+}
+
+TEST(Subdomain, timeout) {
+  Set points;
+  Set springs(points, points);
+  points.addField<simit_float,3>("x");
+  ElementRef p0 = points.add();
+  ElementRef p1 = points.add();
+  springs.add(p0, p1);
+  Partitioning partitioning;
+  partitionGraph(points, 2, partitioning);
+
+  Set localPoints;
+  Set localSprings(localPoints, localPoints);
+  localPoints.addField<simit_float,3>("x");
+  Subdomain subdomain(points, springs, partitioning, 0,
+                      localPoints, localSprings);
+
+  // The second process never maps the shared memory
+  const string name = "/simit-subdomain-test-" + to_string(getpid());
+  ASSERT_THROW(HaloExchange(name, subdomain, 2, localPoints, {"x"}, 0.1),
+               SimitException);
+
+  // The aborted object was removed, so a new decomposition can use the name
+  ASSERT_EQ(-1, shm_open(name.c_str(), O_RDWR, 0));
+  HaloExchange halo(name, subdomain, 1, localPoints, {"x"}, 0.1);
+  halo.exchange();
+}
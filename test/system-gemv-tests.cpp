@@ -57,6 +57,60 @@ TEST(System, gemv) {
   ASSERT_EQ(10.0, c.get(p2));
 }
 
+TEST(System, gemv_rebind) {
+  // Binding another graph rebuilds the matrix index, and the location tables
+  // of the blocks that the map assembles into it
+  Function func = loadFunction(string(TEST_INPUT_DIR)+"/system/gemv.sim",
+                               "main");
+  if (!func.defined()) FAIL();
+
+  Set points;
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> c = points.addField<simit_float>("c");
+  ElementRef p0 = points.add();
+  ElementRef p1 = points.add();
+  ElementRef p2 = points.add();
+  b.set(p0, 1.0);
+  b.set(p1, 2.0);
+  b.set(p2, 3.0);
+  Set springs(points,points);
+  FieldRef<simit_float> a = springs.addField<simit_float>("a");
+  a.set(springs.add(p0,p1), 1.0);
+  a.set(springs.add(p1,p2), 2.0);
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+  func.runSafe();
+  ASSERT_EQ(3.0, c.get(p0));
+  ASSERT_EQ(13.0, c.get(p1));
+  ASSERT_EQ(10.0, c.get(p2));
+
+  // A graph with another structure, and edges whose first endpoint is not
+  // their lowest one
+  Set points2;
+  FieldRef<simit_float> b2 = points2.addField<simit_float>("b");
+  FieldRef<simit_float> c2 = points2.addField<simit_float>("c");
+  vector<ElementRef> q;
+  for (int i = 0; i < 4; ++i) {
+    q.push_back(points2.add());
+    b2.set(q[i], i+1.0);
+  }
+  Set springs2(points2,points2);
+  FieldRef<simit_float> a2 = springs2.addField<simit_float>("a");
+  a2.set(springs2.add(q[0],q[2]), 1.0);
+  a2.set(springs2.add(q[2],q[3]), 2.0);
+  a2.set(springs2.add(q[3],q[1]), 3.0);
+  a2.set(springs2.add(q[1],q[0]), 4.0);
+
+  func.bind("points", &points2);
+  func.bind("springs", &springs2);
+  func.runSafe();
+  ASSERT_EQ(16.0, c2.get(q[0]));
+  ASSERT_EQ(30.0, c2.get(q[1]));
+  ASSERT_EQ(18.0, c2.get(q[2]));
+  ASSERT_EQ(32.0, c2.get(q[3]));
+}
+
 TEST(System, gemv_stencil) {
   // Points
   Set points;
@@ -1256,3 +1310,74 @@ TEST(System, DISABLED_gemv_pass_element) {
   ASSERT_EQ(10.0, c.get(p2));
 }
 
+
+// Runs a program on a path of springs with kMatrixFree set to matrixFree,
+// and returns the b and x fields of the points
+static vector<simit_float> runMatrixFree(const string& fileName,
+                                         bool matrixFree) {
+  const int n = 10;
+  Set points;
+  Set springs(points, points);
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> x = points.addField<simit_float>("x");
+  FieldRef<simit_float> a = springs.addField<simit_float>("a");
+  vector<ElementRef> refs;
+  for (int i = 0; i < n; ++i) {
+    refs.push_back(points.add());
+    b.set(refs[i], 1.0 + (i*7) % 5);
+    x.set(refs[i], 0.0);
+  }
+  for (int i = 0; i+1 < n; ++i) {
+    a.set(springs.add(refs[i], refs[i+1]), 1.0 + i % 3);
+  }
+
+  // HACK: Set kMatrixFree for this type of test
+  bool defaults = kMatrixFree;
+  kMatrixFree = matrixFree;
+  Function func = loadFunction(fileName, "main");
+  kMatrixFree = defaults;
+
+  vector<simit_float> results;
+  if (!func.defined()) return results;
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+  func.runSafe();
+
+  for (int i = 0; i < n; ++i) {
+    results.push_back(b.get(refs[i]));
+    results.push_back(x.get(refs[i]));
+  }
+  return results;
+}
+
+static void compareMatrixFree(const string& fileName) {
+  vector<simit_float> assembled = runMatrixFree(fileName, false);
+  vector<simit_float> matrixFree = runMatrixFree(fileName, true);
+  ASSERT_EQ(20u, assembled.size());
+  ASSERT_EQ(20u, matrixFree.size());
+  for (size_t i = 0; i < assembled.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_NEAR_EQ(assembled[i], matrixFree[i]);
+  }
+}
+
+TEST(System, matrix_free_cg) {
+  // The products in the CG loop run the assembly kernel of the matrix
+  compareMatrixFree(TEST_FILE_NAME);
+}
+
+TEST(System, matrix_free_solve) {
+  // The matrix is solved with, so the product falls back to assembly
+  compareMatrixFree(TEST_FILE_NAME);
+}
+
+TEST(System, matrix_free_partial_actuals) {
+  // A partial actual of the assembly changes before the product, so the
+  // product falls back to assembly
+  compareMatrixFree(TEST_FILE_NAME);
+}
+
+TEST(System, matrix_free_compound) {
+  // The matrix is used in a compound expression, so the products fall back to
+  // assembly
+  compareMatrixFree(TEST_FILE_NAME);
+}
@@ -0,0 +1,80 @@
+#ifndef TEMPORARY_DIRECTORY_H
+#define TEMPORARY_DIRECTORY_H
+
+#include <string>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/// A directory created in the system's temporary directory, that is removed
+/// together with the files in it when the test that created it finishes, even
+/// if one of its assertions fails.
+class TemporaryDirectory {
+public:
+  TemporaryDirectory() {
+    const char* tmp = getenv("TMPDIR");
+    std::string pattern = std::string((tmp != nullptr) ? tmp : "/tmp") +
+                          "/simit-test-XXXXXX";
+    if (mkdtemp(&pattern[0]) != nullptr) {
+      path = pattern;
+    }
+  }
+
+  ~TemporaryDirectory() {
+    if (path.empty()) {
+      return;
+    }
+    if (DIR* dir = opendir(path.c_str())) {
+      while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+          remove((path + "/" + name).c_str());
+        }
+      }
+      closedir(dir);
+    }
+    rmdir(path.c_str());
+  }
+
+  /// The path of the directory, or the empty string if it could not be
+  /// created.
+  const std::string& getPath() const {return path;}
+
+  /// The path of the file with the given name in the directory.
+  std::string getFile(const std::string& name) const {
+    return path + "/" + name;
+  }
+
+private:
+  std::string path;
+
+  TemporaryDirectory(const TemporaryDirectory&);
+  TemporaryDirectory& operator=(const TemporaryDirectory&);
+};
+
+/// Sets a global setting, such as kIndexCacheDir, to a value until the test
+/// that declared it finishes, and then restores the previous value, even if
+/// one of the test's assertions fails. Declared after a TemporaryDirectory,
+/// it is restored before the directory is removed.
+template <typename T>
+class ScopedSetting {
+public:
+  ScopedSetting(T& setting, const T& value)
+      : setting(setting), previous(setting) {
+    setting = value;
+  }
+
+  ~ScopedSetting() {
+    setting = previous;
+  }
+
+private:
+  T& setting;
+  T previous;
+
+  ScopedSetting(const ScopedSetting&);
+  ScopedSetting& operator=(const ScopedSetting&);
+};
+
+#endif
@@ -0,0 +1,360 @@
+#include "simit-test.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "vector_math.h"
+
+using namespace std;
+using namespace simit;
+
+#if defined(__SSE2__) && defined(__x86_64__)
+typedef float  f32x4  __attribute__((vector_size(16)));
+typedef float  f32x8  __attribute__((vector_size(32)));
+typedef float  f32x16 __attribute__((vector_size(64)));
+typedef double f64x2  __attribute__((vector_size(16)));
+typedef double f64x4  __attribute__((vector_size(32)));
+typedef double f64x8  __attribute__((vector_size(64)));
+
+// Calls the variants of a vector type on arrays of lanes. The calls are
+// compiled for the instruction set of the variants, so that they pass the
+// vectors in the registers that the variants expect.
+#define DEFINE_VECTOR_CALLS(Vector, Float, Target)                            \
+  Target static void callUnary_##Vector(void* f, const Float* x, Float* r) { \
+    Vector v;                                                                 \
+    memcpy(&v, x, sizeof(v));                                                 \
+    v = reinterpret_cast<Vector (*)(Vector)>(f)(v);                           \
+    memcpy(r, &v, sizeof(v));                                                 \
+  }                                                                           \
+  Target static void callBinary_##Vector(void* f, const Float* x,             \
+                                         const Float* y, Float* r) {          \
+    Vector v, w;                                                              \
+    memcpy(&v, x, sizeof(v));                                                 \
+    memcpy(&w, y, sizeof(w));                                                 \
+    v = reinterpret_cast<Vector (*)(Vector, Vector)>(f)(v, w);                \
+    memcpy(r, &v, sizeof(v));                                                 \
+  }
+
+DEFINE_VECTOR_CALLS(f32x4, float, )
+DEFINE_VECTOR_CALLS(f64x2, double, )
+DEFINE_VECTOR_CALLS(f32x8, float, __attribute__((target("avx2,fma"))))
+DEFINE_VECTOR_CALLS(f64x4, double, __attribute__((target("avx2,fma"))))
+DEFINE_VECTOR_CALLS(f32x16, float, __attribute__((target("avx512f"))))
+DEFINE_VECTOR_CALLS(f64x8, double, __attribute__((target("avx512f"))))
+
+// A variant that the host supports, of any width
+template <typename Float>
+struct Variant {
+  string name;
+  int lanes;
+  void* address;
+  void (*unary)(void*, const Float*, Float*);
+  void (*binary)(void*, const Float*, const Float*, Float*);
+};
+
+static void setCalls(Variant<float>& variant) {
+  switch (variant.lanes) {
+    case 4:
+      variant.unary = callUnary_f32x4;
+      variant.binary = callBinary_f32x4;
+      break;
+    case 8:
+      variant.unary = callUnary_f32x8;
+      variant.binary = callBinary_f32x8;
+      break;
+    case 16:
+      variant.unary = callUnary_f32x16;
+      variant.binary = callBinary_f32x16;
+      break;
+  }
+}
+
+static void setCalls(Variant<double>& variant) {
+  switch (variant.lanes) {
+    case 2:
+      variant.unary = callUnary_f64x2;
+      variant.binary = callBinary_f64x2;
+      break;
+    case 4:
+      variant.unary = callUnary_f64x4;
+      variant.binary = callBinary_f64x4;
+      break;
+    case 8:
+      variant.unary = callUnary_f64x8;
+      variant.binary = callBinary_f64x8;
+      break;
+  }
+}
+
+// The variants of the function for every instruction set the host supports
+template <typename Float>
+static vector<Variant<Float>> getVariants(const string& name) {
+  const string prefix = "simit_" + name +
+                        (sizeof(Float) == sizeof(float) ? "_f32x" : "_f64x");
+  vector<Variant<Float>> variants;
+  for (const VectorFunction& function : getVectorFunctions()) {
+    if (function.name == prefix + to_string(function.width)) {
+      Variant<Float> variant = {function.name, function.width,
+                                function.address, nullptr, nullptr};
+      setCalls(variant);
+      if (variant.unary != nullptr) {
+        variants.push_back(variant);
+      }
+    }
+  }
+  return variants;
+}
+
+// The error of r in units in the last place of the exact result
+template <typename Float>
+static double ulpError(Float r, long double exact) {
+  if (std::isnan(exact)) {
+    return std::isnan(r) ? 0.0 : numeric_limits<double>::infinity();
+  }
+  if (std::isinf((Float)exact)) {
+    return (r == (Float)exact) ? 0.0 : numeric_limits<double>::infinity();
+  }
+  int e;
+  frexpl(exact, &e);
+  const int digits = numeric_limits<Float>::digits;
+  const int minExponent = numeric_limits<Float>::min_exponent - digits;
+  return fabsl(r - exact) / ldexpl(1.0L, max(e - digits, minExponent));
+}
+
+template <typename Float>
+static vector<Float> uniform(Float a, Float b, int n) {
+  mt19937 generator(n);
+  uniform_real_distribution<double> distribution(a, b);
+  vector<Float> values;
+  for (int i = 0; i < n; ++i) {
+    values.push_back((Float)distribution(generator));
+  }
+  return values;
+}
+
+// The maximum error of f over xs (and ys), in ulps
+template <typename Float>
+static double maxError(const Variant<Float>& f,
+                       long double (*exact)(long double),
+                       const vector<Float>& xs) {
+  const size_t lanes = f.lanes;
+  vector<Float> x(lanes);
+  vector<Float> r(lanes);
+  double error = 0.0;
+  for (size_t i = 0; i < xs.size(); i += lanes) {
+    for (size_t l = 0; l < lanes; ++l) {
+      x[l] = xs[(i+l) % xs.size()];
+    }
+    f.unary(f.address, x.data(), r.data());
+    for (size_t l = 0; l < lanes; ++l) {
+      error = max(error, ulpError<Float>(r[l], exact(x[l])));
+    }
+  }
+  return error;
+}
+
+template <typename Float>
+static double maxError(const Variant<Float>& f,
+                       long double (*exact)(long double, long double),
+                       const vector<Float>& xs, const vector<Float>& ys) {
+  const size_t lanes = f.lanes;
+  vector<Float> x(lanes);
+  vector<Float> y(lanes);
+  vector<Float> r(lanes);
+  double error = 0.0;
+  for (size_t i = 0; i < xs.size(); i += lanes) {
+    for (size_t l = 0; l < lanes; ++l) {
+      x[l] = xs[(i+l) % xs.size()];
+      y[l] = ys[(i+l) % ys.size()];
+    }
+    f.binary(f.address, x.data(), y.data(), r.data());
+    for (size_t l = 0; l < lanes; ++l) {
+      error = max(error, ulpError<Float>(r[l], exact(x[l], y[l])));
+    }
+  }
+  return error;
+}
+
+// Whether f computes the same special values as the C library
+template <typename Float>
+static bool same(Float a, Float b) {
+  if (std::isnan(a) || std::isnan(b)) {
+    return std::isnan(a) && std::isnan(b);
+  }
+  if (std::signbit(a) != std::signbit(b)) {
+    return false;
+  }
+  if (std::isinf(b) || b == 0) {
+    return a == b;
+  }
+  const Float ulp = nextafter(fabs(b), numeric_limits<Float>::infinity()) -
+                    fabs(b);
+  return fabs(a - b) <= 2*ulp;
+}
+
+template <typename Float>
+static void checkSpecialValues(const Variant<Float>& f, Float (*libm)(Float),
+                               const vector<Float>& xs) {
+  vector<Float> r(f.lanes);
+  for (Float value : xs) {
+    const vector<Float> x(f.lanes, value);
+    f.unary(f.address, x.data(), r.data());
+    ASSERT_TRUE(same(r[0], libm(value))) << f.name << "(" << value << ")";
+  }
+}
+
+template <typename Float>
+static void checkSpecialValues(const Variant<Float>& f,
+                               Float (*libm)(Float, Float),
+                               const vector<Float>& xs) {
+  vector<Float> r(f.lanes);
+  for (Float xValue : xs) {
+    for (Float yValue : xs) {
+      const vector<Float> x(f.lanes, xValue);
+      const vector<Float> y(f.lanes, yValue);
+      f.binary(f.address, x.data(), y.data(), r.data());
+      ASSERT_TRUE(same(r[0], libm(xValue, yValue)))
+          << f.name << "(" << xValue << ", " << yValue << ")";
+    }
+  }
+}
+
+template <typename Float>
+static vector<Float> specialValues() {
+  const Float inf = numeric_limits<Float>::infinity();
+  return {0, -0.0, 1, -1, 0.5, -2, 3, -3, 2.5, inf, -inf,
+          numeric_limits<Float>::quiet_NaN(), numeric_limits<Float>::min(),
+          numeric_limits<Float>::denorm_min()};
+}
+
+TEST(VectorMath, variants) {
+  // Every x86-64 processor has SSE2
+  const vector<Variant<float>> sin = getVariants<float>("sin");
+  ASSERT_FALSE(sin.empty());
+  ASSERT_EQ(4, sin.front().lanes);
+  for (const VectorFunction& function : getVectorFunctions()) {
+    ASSERT_NE(nullptr, function.address) << function.name;
+  }
+}
+
+TEST(VectorMath, trigonometric) {
+  const vector<float> xf = uniform(-10.0f, 10.0f, 100000);
+  const vector<float> xfLarge = uniform(-1048576.0f, 1048576.0f, 100000);
+  const vector<double> xd = uniform(-10.0, 10.0, 100000);
+  const vector<double> xdLarge = uniform(-524288.0, 524288.0, 100000);
+  const vector<float> xfLibm = uniform(-1e9f, 1e9f, 1000);
+  const vector<double> xdLibm = uniform(-1e12, 1e12, 1000);
+
+  struct Function {string name; long double (*exact)(long double);
+                   float (*libmf)(float); double (*libm)(double);
+                   double maxError;};
+  for (const Function& f : vector<Function>{{"sin", sinl, sinf, sin, 2.0},
+                                            {"cos", cosl, cosf, cos, 2.0},
+                                            {"tan", tanl, tanf, tan, 3.0}}) {
+    for (const Variant<float>& f32 : getVariants<float>(f.name)) {
+      ASSERT_LE(maxError(f32, f.exact, xf), f.maxError) << f32.name;
+      ASSERT_LE(maxError(f32, f.exact, xfLarge), f.maxError) << f32.name;
+      ASSERT_LE(maxError(f32, f.exact, xfLibm), 1.0) << f32.name;
+      checkSpecialValues(f32, f.libmf, specialValues<float>());
+    }
+    for (const Variant<double>& f64 : getVariants<double>(f.name)) {
+      ASSERT_LE(maxError(f64, f.exact, xd), f.maxError) << f64.name;
+      ASSERT_LE(maxError(f64, f.exact, xdLarge), f.maxError) << f64.name;
+      ASSERT_LE(maxError(f64, f.exact, xdLibm), 1.0) << f64.name;
+      checkSpecialValues(f64, f.libm, specialValues<double>());
+    }
+  }
+}
+
+TEST(VectorMath, exp) {
+  vector<float> specialFloats = specialValues<float>();
+  specialFloats.insert(specialFloats.end(), {100.0f, -200.0f, 88.8f});
+  vector<double> specialDoubles = specialValues<double>();
+  specialDoubles.insert(specialDoubles.end(), {1000.0, -1000.0, 709.8});
+  for (const Variant<float>& f32 : getVariants<float>("exp")) {
+    ASSERT_LE(maxError(f32, expl, uniform(-87.0f, 88.0f, 100000)), 1.0)
+        << f32.name;
+    ASSERT_LE(maxError(f32, expl, uniform(-5.0f, 5.0f, 100000)), 1.0)
+        << f32.name;
+    ASSERT_LE(maxError(f32, expl, uniform(-103.0f, -88.0f, 10000)), 1.0)
+        << f32.name;
+    checkSpecialValues(f32, expf, specialFloats);
+  }
+  for (const Variant<double>& f64 : getVariants<double>("exp")) {
+    ASSERT_LE(maxError(f64, expl, uniform(-707.0, 709.0, 100000)), 2.0)
+        << f64.name;
+    ASSERT_LE(maxError(f64, expl, uniform(-5.0, 5.0, 100000)), 2.0)
+        << f64.name;
+    ASSERT_LE(maxError(f64, expl, uniform(-744.0, -709.0, 10000)), 2.0)
+        << f64.name;
+    checkSpecialValues(f64, static_cast<double(*)(double)>(exp),
+                       specialDoubles);
+  }
+}
+
+TEST(VectorMath, log) {
+  vector<float> xf = uniform(0.0f, 4.0f, 100000);
+  vector<double> xd = uniform(0.0, 4.0, 100000);
+  for (int i = 0; i < 10000; ++i) {
+    xf.push_back(exp2f(xf[i]*64.0f - 149.0f));
+    xd.push_back(exp2(xd[i]*512.0 - 1074.0));
+    xd.push_back(exp2(xd[i]*512.0));
+  }
+  vector<float> specialFloats = specialValues<float>();
+  specialFloats.push_back(-numeric_limits<float>::denorm_min());
+  vector<double> specialDoubles = specialValues<double>();
+  specialDoubles.push_back(-numeric_limits<double>::denorm_min());
+  for (const Variant<float>& f32 : getVariants<float>("log")) {
+    ASSERT_LE(maxError(f32, logl, xf), 1.0) << f32.name;
+    checkSpecialValues(f32, logf, specialFloats);
+  }
+  for (const Variant<double>& f64 : getVariants<double>("log")) {
+    ASSERT_LE(maxError(f64, logl, xd), 1.0) << f64.name;
+    checkSpecialValues(f64, static_cast<double(*)(double)>(log),
+                       specialDoubles);
+  }
+}
+
+TEST(VectorMath, pow) {
+  vector<float> specialFloats = specialValues<float>();
+  specialFloats.insert(specialFloats.end(), {-0.5f, 1e30f, -1e30f});
+  vector<double> specialDoubles = specialValues<double>();
+  specialDoubles.insert(specialDoubles.end(), {-0.5, 1e300, -1e300});
+  for (const Variant<float>& f32 : getVariants<float>("pow")) {
+    ASSERT_LE(maxError(f32, powl, uniform(0.0f, 10.0f, 100000),
+                       uniform(-30.0f, 30.0f, 99999)), 1.0) << f32.name;
+    checkSpecialValues(f32, powf, specialFloats);
+  }
+  for (const Variant<double>& f64 : getVariants<double>("pow")) {
+    ASSERT_LE(maxError(f64, powl, uniform(0.0, 10.0, 100000),
+                       uniform(-300.0, 300.0, 99999)), 2.0) << f64.name;
+    // Large exponents amplify the error of log(x)
+    ASSERT_LE(maxError(f64, powl, uniform(0.9, 1.1, 100000),
+                       uniform(-7000.0, 7000.0, 99999)), 2.0) << f64.name;
+    checkSpecialValues(f64, static_cast<double(*)(double,double)>(pow),
+                       specialDoubles);
+  }
+}
+
+TEST(VectorMath, atan2) {
+  for (const Variant<float>& f32 : getVariants<float>("atan2")) {
+    ASSERT_LE(maxError(f32, atan2l, uniform(-10.0f, 10.0f, 100000),
+                       uniform(-10.0f, 10.0f, 99999)), 3.0) << f32.name;
+    ASSERT_LE(maxError(f32, atan2l, uniform(-1e-3f, 1e-3f, 100000),
+                       uniform(-1e3f, 1e3f, 99999)), 3.0) << f32.name;
+    checkSpecialValues(f32, atan2f, specialValues<float>());
+  }
+  for (const Variant<double>& f64 : getVariants<double>("atan2")) {
+    ASSERT_LE(maxError(f64, atan2l, uniform(-10.0, 10.0, 100000),
+                       uniform(-10.0, 10.0, 99999)), 2.0) << f64.name;
+    ASSERT_LE(maxError(f64, atan2l, uniform(-1e-3, 1e-3, 100000),
+                       uniform(-1e3, 1e3, 99999)), 2.0) << f64.name;
+    checkSpecialValues(f64, static_cast<double(*)(double,double)>(atan2),
+                       specialValues<double>());
+  }
+}
+#endif